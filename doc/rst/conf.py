@@ -159,6 +159,7 @@ man_pages = [
     ('dcp.1', 'dcp', u'distributed copy',[author], 1),
     ('ddup.1', 'ddup', u'report files with identical content',[author], 1),
     ('dfind.1', 'dfind', u'distributed file filtering',[author], 1),
+    ('dmv.1', 'dmv', u'distributed move',[author], 1),
     ('dreln.1', 'dreln', u'distributed relink',[author], 1),
     ('drm.1', 'drm', u'distributed remove',[author], 1),
     ('dstripe.1', 'dstripe', u'restripe files on underlying storage',[author], 1),
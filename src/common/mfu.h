@@ -28,7 +28,10 @@ extern "C" {
 #include "mfu_flist.h"
 #include "mfu_pred.h"
 #include "mfu_progress.h"
+#include "mfu_throttle.h"
 #include "mfu_bz2.h"
+#include "mfu_buf.h"
+#include "mfu_pool.h"
 
 #endif /* MFU_H */
 
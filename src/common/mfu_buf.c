@@ -0,0 +1,479 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "mfu_buf.h"
+
+/* x86 versions are compiled with target attributes, so the rest of
+ * the library can be built for a baseline CPU */
+#if (defined(__x86_64__) || defined(__i386__)) && \
+    (defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5))
+#define MFU_BUF_X86 1
+#include <immintrin.h>
+#endif
+
+/* table of kernels for one implementation */
+typedef struct {
+    const char* name;
+    int (*is_zero)(const void* buf, size_t size);
+    size_t (*diff)(const void* a, const void* b, size_t size);
+} mfu_buf_ops;
+
+/* implementation in use, selected on first call */
+static const mfu_buf_ops* mfu_buf_ops_cur = NULL;
+
+/* crc function in use, hardware if the CPU has SSE4.2 */
+static uint32_t (*mfu_buf_crc_cur)(uint32_t crc, const void* buf, size_t size) = NULL;
+
+/*****************************
+ * Portable
+ ****************************/
+
+static int is_zero_portable(const void* buf, size_t size)
+{
+    const unsigned char* p = (const unsigned char*) buf;
+
+    /* OR together 64 bytes at a time so we branch once per block */
+    while (size >= 64) {
+        uint64_t w[8];
+        memcpy(w, p, sizeof(w));
+        if ((w[0] | w[1] | w[2] | w[3] | w[4] | w[5] | w[6] | w[7]) != 0) {
+            return 0;
+        }
+        p    += 64;
+        size -= 64;
+    }
+
+    while (size > 0) {
+        if (*p != 0) {
+            return 0;
+        }
+        p++;
+        size--;
+    }
+    return 1;
+}
+
+static size_t diff_portable(const void* a, const void* b, size_t size)
+{
+    const unsigned char* pa = (const unsigned char*) a;
+    const unsigned char* pb = (const unsigned char*) b;
+
+    /* skip over equal words, then find the byte within the word */
+    size_t i = 0;
+    while (i + 8 <= size) {
+        uint64_t x, y;
+        memcpy(&x, pa + i, 8);
+        memcpy(&y, pb + i, 8);
+        if (x != y) {
+            break;
+        }
+        i += 8;
+    }
+
+    while (i < size && pa[i] == pb[i]) {
+        i++;
+    }
+    return i;
+}
+
+/* CRC32C lookup tables for slicing by 8 bytes, built on first use */
+static uint32_t crc32c_table[8][256];
+static int crc32c_table_init = 0;
+
+static void crc32c_build_table(void)
+{
+    uint32_t n;
+    for (n = 0; n < 256; n++) {
+        uint32_t crc = n;
+        int k;
+        for (k = 0; k < 8; k++) {
+            crc = (crc & 1) ? (crc >> 1) ^ 0x82F63B78 : (crc >> 1);
+        }
+        crc32c_table[0][n] = crc;
+    }
+    for (n = 0; n < 256; n++) {
+        uint32_t crc = crc32c_table[0][n];
+        int k;
+        for (k = 1; k < 8; k++) {
+            crc = crc32c_table[0][crc & 0xff] ^ (crc >> 8);
+            crc32c_table[k][n] = crc;
+        }
+    }
+    crc32c_table_init = 1;
+}
+
+static uint32_t crc32c_portable(uint32_t crc, const void* buf, size_t size)
+{
+    const unsigned char* p = (const unsigned char*) buf;
+
+    if (! crc32c_table_init) {
+        crc32c_build_table();
+    }
+
+    crc = ~crc;
+    while (size >= 8) {
+        /* assemble words byte by byte so this works on any endianness */
+        uint32_t lo = crc ^ ((uint32_t)p[0] | ((uint32_t)p[1] << 8) |
+                             ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24));
+        crc = crc32c_table[7][lo & 0xff] ^
+              crc32c_table[6][(lo >> 8) & 0xff] ^
+              crc32c_table[5][(lo >> 16) & 0xff] ^
+              crc32c_table[4][lo >> 24] ^
+              crc32c_table[3][p[4]] ^
+              crc32c_table[2][p[5]] ^
+              crc32c_table[1][p[6]] ^
+              crc32c_table[0][p[7]];
+        p    += 8;
+        size -= 8;
+    }
+    while (size > 0) {
+        crc = crc32c_table[0][(crc ^ *p) & 0xff] ^ (crc >> 8);
+        p++;
+        size--;
+    }
+    return ~crc;
+}
+
+static const mfu_buf_ops ops_portable = {"portable", is_zero_portable, diff_portable};
+
+#ifdef MFU_BUF_X86
+
+/*****************************
+ * SSE2
+ ****************************/
+
+__attribute__((target("sse2")))
+static int is_zero_sse2(const void* buf, size_t size)
+{
+    const char* p = (const char*) buf;
+    const __m128i zero = _mm_setzero_si128();
+    while (size >= 64) {
+        __m128i v0 = _mm_loadu_si128((const __m128i*)(p +  0));
+        __m128i v1 = _mm_loadu_si128((const __m128i*)(p + 16));
+        __m128i v2 = _mm_loadu_si128((const __m128i*)(p + 32));
+        __m128i v3 = _mm_loadu_si128((const __m128i*)(p + 48));
+        __m128i v  = _mm_or_si128(_mm_or_si128(v0, v1), _mm_or_si128(v2, v3));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero)) != 0xffff) {
+            return 0;
+        }
+        p    += 64;
+        size -= 64;
+    }
+    return is_zero_portable(p, size);
+}
+
+__attribute__((target("sse2")))
+static size_t diff_sse2(const void* a, const void* b, size_t size)
+{
+    const char* pa = (const char*) a;
+    const char* pb = (const char*) b;
+    size_t i = 0;
+    while (i + 16 <= size) {
+        __m128i va = _mm_loadu_si128((const __m128i*)(pa + i));
+        __m128i vb = _mm_loadu_si128((const __m128i*)(pb + i));
+        unsigned int mask = (unsigned int) _mm_movemask_epi8(_mm_cmpeq_epi8(va, vb));
+        if (mask != 0xffff) {
+            return i + (size_t) __builtin_ctz(~mask);
+        }
+        i += 16;
+    }
+    return i + diff_portable(pa + i, pb + i, size - i);
+}
+
+static const mfu_buf_ops ops_sse2 = {"sse2", is_zero_sse2, diff_sse2};
+
+/*****************************
+ * AVX2
+ ****************************/
+
+__attribute__((target("avx2")))
+static int is_zero_avx2(const void* buf, size_t size)
+{
+    const char* p = (const char*) buf;
+    while (size >= 128) {
+        __m256i v0 = _mm256_loadu_si256((const __m256i*)(p +  0));
+        __m256i v1 = _mm256_loadu_si256((const __m256i*)(p + 32));
+        __m256i v2 = _mm256_loadu_si256((const __m256i*)(p + 64));
+        __m256i v3 = _mm256_loadu_si256((const __m256i*)(p + 96));
+        __m256i v  = _mm256_or_si256(_mm256_or_si256(v0, v1), _mm256_or_si256(v2, v3));
+        if (! _mm256_testz_si256(v, v)) {
+            return 0;
+        }
+        p    += 128;
+        size -= 128;
+    }
+    return is_zero_portable(p, size);
+}
+
+__attribute__((target("avx2")))
+static size_t diff_avx2(const void* a, const void* b, size_t size)
+{
+    const char* pa = (const char*) a;
+    const char* pb = (const char*) b;
+    size_t i = 0;
+    while (i + 32 <= size) {
+        __m256i va = _mm256_loadu_si256((const __m256i*)(pa + i));
+        __m256i vb = _mm256_loadu_si256((const __m256i*)(pb + i));
+        unsigned int mask = (unsigned int) _mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+        if (mask != 0xffffffffU) {
+            return i + (size_t) __builtin_ctz(~mask);
+        }
+        i += 32;
+    }
+    return i + diff_portable(pa + i, pb + i, size - i);
+}
+
+static const mfu_buf_ops ops_avx2 = {"avx2", is_zero_avx2, diff_avx2};
+
+/*****************************
+ * AVX-512
+ ****************************/
+
+__attribute__((target("avx512f,avx512bw")))
+static int is_zero_avx512(const void* buf, size_t size)
+{
+    const char* p = (const char*) buf;
+    while (size >= 256) {
+        __m512i v0 = _mm512_loadu_si512((const void*)(p +   0));
+        __m512i v1 = _mm512_loadu_si512((const void*)(p +  64));
+        __m512i v2 = _mm512_loadu_si512((const void*)(p + 128));
+        __m512i v3 = _mm512_loadu_si512((const void*)(p + 192));
+        __m512i v  = _mm512_or_si512(_mm512_or_si512(v0, v1), _mm512_or_si512(v2, v3));
+        if (_mm512_test_epi64_mask(v, v) != 0) {
+            return 0;
+        }
+        p    += 256;
+        size -= 256;
+    }
+    return is_zero_portable(p, size);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static size_t diff_avx512(const void* a, const void* b, size_t size)
+{
+    const char* pa = (const char*) a;
+    const char* pb = (const char*) b;
+    size_t i = 0;
+    while (i + 64 <= size) {
+        __m512i va = _mm512_loadu_si512((const void*)(pa + i));
+        __m512i vb = _mm512_loadu_si512((const void*)(pb + i));
+        __mmask64 mask = _mm512_cmpneq_epi8_mask(va, vb);
+        if (mask != 0) {
+            return i + (size_t) __builtin_ctzll((unsigned long long) mask);
+        }
+        i += 64;
+    }
+    return i + diff_portable(pa + i, pb + i, size - i);
+}
+
+static const mfu_buf_ops ops_avx512 = {"avx512", is_zero_avx512, diff_avx512};
+
+/*****************************
+ * SSE4.2 CRC32C
+ ****************************/
+
+#ifdef __x86_64__
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_sse42(uint32_t crc, const void* buf, size_t size)
+{
+    const unsigned char* p = (const unsigned char*) buf;
+    uint64_t c = (uint64_t) ~crc;
+    while (size >= 8) {
+        uint64_t w;
+        memcpy(&w, p, 8);
+        c = _mm_crc32_u64(c, w);
+        p    += 8;
+        size -= 8;
+    }
+    uint32_t c32 = (uint32_t) c;
+    while (size > 0) {
+        c32 = _mm_crc32_u8(c32, *p);
+        p++;
+        size--;
+    }
+    return ~c32;
+}
+#endif
+
+#endif /* MFU_BUF_X86 */
+
+/*****************************
+ * Dispatch
+ ****************************/
+
+/* return kernels for the named implementation if the CPU supports it */
+static const mfu_buf_ops* mfu_buf_lookup(const char* name)
+{
+    if (strcmp(name, "portable") == 0) {
+        return &ops_portable;
+    }
+
+#ifdef MFU_BUF_X86
+    __builtin_cpu_init();
+    if (strcmp(name, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        return &ops_sse2;
+    }
+    if (strcmp(name, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        return &ops_avx2;
+    }
+    if (strcmp(name, "avx512") == 0 &&
+        __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw"))
+    {
+        return &ops_avx512;
+    }
+#endif
+
+    return NULL;
+}
+
+/* pick the crc function to go with the given implementation */
+static void mfu_buf_select(const mfu_buf_ops* ops)
+{
+    mfu_buf_crc_cur = crc32c_portable;
+#if defined(MFU_BUF_X86) && defined(__x86_64__)
+    if (ops != &ops_portable && __builtin_cpu_supports("sse4.2")) {
+        mfu_buf_crc_cur = crc32c_sse42;
+    }
+#endif
+    mfu_buf_ops_cur = ops;
+}
+
+/* select the best implementation the CPU supports */
+static void mfu_buf_init(void)
+{
+    const char* names[] = {"avx512", "avx2", "sse2", "portable"};
+    size_t i;
+    for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        const mfu_buf_ops* ops = mfu_buf_lookup(names[i]);
+        if (ops != NULL) {
+            mfu_buf_select(ops);
+            return;
+        }
+    }
+}
+
+/*****************************
+ * Combining checksums
+ ****************************/
+
+/* multiply a 32x32 bit matrix over GF(2) by a vector */
+static uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec)
+{
+    uint32_t sum = 0;
+    while (vec) {
+        if (vec & 1) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        mat++;
+    }
+    return sum;
+}
+
+/* square a 32x32 bit matrix over GF(2) */
+static void gf2_matrix_square(uint32_t* square, const uint32_t* mat)
+{
+    int n;
+    for (n = 0; n < 32; n++) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+/* advance the CRC32C register crc over len zero bytes in O(log len)
+ * steps, by repeatedly squaring the operator for a single zero bit,
+ * this is the method zlib uses in crc32_combine */
+static uint32_t crc32c_shift(uint32_t crc, uint64_t len)
+{
+    uint32_t even[32];
+    uint32_t odd[32];
+
+    if (len == 0) {
+        return crc;
+    }
+
+    /* operator for one zero bit */
+    odd[0] = 0x82F63B78;
+    uint32_t row = 1;
+    int n;
+    for (n = 1; n < 32; n++) {
+        odd[n] = row;
+        row <<= 1;
+    }
+
+    /* operators for two and four zero bits */
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+
+    /* apply len zero bytes, the first square gives one zero byte */
+    do {
+        gf2_matrix_square(even, odd);
+        if (len & 1) {
+            crc = gf2_matrix_times(even, crc);
+        }
+        len >>= 1;
+        if (len == 0) {
+            break;
+        }
+
+        gf2_matrix_square(odd, even);
+        if (len & 1) {
+            crc = gf2_matrix_times(odd, crc);
+        }
+        len >>= 1;
+    } while (len != 0);
+
+    return crc;
+}
+
+uint32_t mfu_buf_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2)
+{
+    return crc32c_shift(crc1, len2) ^ crc2;
+}
+
+uint32_t mfu_buf_crc32c_zeros(uint32_t crc, uint64_t len)
+{
+    return ~crc32c_shift(~crc, len);
+}
+
+int mfu_buf_is_zero(const void* buf, size_t size)
+{
+    if (mfu_buf_ops_cur == NULL) {
+        mfu_buf_init();
+    }
+    return mfu_buf_ops_cur->is_zero(buf, size);
+}
+
+size_t mfu_buf_diff(const void* a, const void* b, size_t size)
+{
+    if (mfu_buf_ops_cur == NULL) {
+        mfu_buf_init();
+    }
+    return mfu_buf_ops_cur->diff(a, b, size);
+}
+
+uint32_t mfu_buf_crc32c(uint32_t crc, const void* buf, size_t size)
+{
+    if (mfu_buf_ops_cur == NULL) {
+        mfu_buf_init();
+    }
+    return mfu_buf_crc_cur(crc, buf, size);
+}
+
+const char* mfu_buf_impl(void)
+{
+    if (mfu_buf_ops_cur == NULL) {
+        mfu_buf_init();
+    }
+    return mfu_buf_ops_cur->name;
+}
+
+int mfu_buf_set_impl(const char* name)
+{
+    const mfu_buf_ops* ops = mfu_buf_lookup(name);
+    if (ops == NULL) {
+        return -1;
+    }
+    mfu_buf_select(ops);
+    return 0;
+}
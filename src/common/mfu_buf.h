@@ -0,0 +1,48 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_BUF_H
+#define MFU_BUF_H
+
+/* Kernels that scan data buffers in the copy, compare, and dedup
+ * paths.  Each has a portable version and, on x86, versions using
+ * SSE2, AVX2, and AVX-512, the best one the CPU supports is picked
+ * on first use. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* return 1 if all size bytes of buf are zero, 0 otherwise */
+int mfu_buf_is_zero(const void* buf, size_t size);
+
+/* return offset of the first byte that differs between a and b,
+ * or size if the buffers are equal */
+size_t mfu_buf_diff(const void* a, const void* b, size_t size);
+
+/* update CRC32C (Castagnoli) checksum crc with size bytes from buf,
+ * start with crc = 0, checksums of consecutive buffers may be chained */
+uint32_t mfu_buf_crc32c(uint32_t crc, const void* buf, size_t size);
+
+/* return checksum of two consecutive buffers given the checksum crc1
+ * of the first, and the checksum crc2 and length len2 of the second */
+uint32_t mfu_buf_crc32c_combine(uint32_t crc1, uint32_t crc2, uint64_t len2);
+
+/* update checksum crc with len zero bytes without reading them */
+uint32_t mfu_buf_crc32c_zeros(uint32_t crc, uint64_t len);
+
+/* return name of the implementation in use */
+const char* mfu_buf_impl(void);
+
+/* select implementation by name: portable, sse2, avx2, or avx512,
+ * returns 0 on success and -1 if the name is unknown or the CPU
+ * does not support it */
+int mfu_buf_set_impl(const char* name);
+
+#endif /* MFU_BUF_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -64,6 +64,9 @@ mfu_walk_opts_t* mfu_walk_opts_new(void)
     /* Don't stat files in walk by default */
     opts->use_stat = 1;
 
+    /* Don't look for extended attributes in walk by default */
+    opts->xattrs = 0;
+
     return opts;
 }
 
@@ -237,6 +240,9 @@ void mfu_flist_increase(mfu_flist* pbflist)
 /* append element to tail of linked list */
 void mfu_flist_insert_elem(flist_t* flist, elem_t* elem)
 {
+    /* convert a mapped list to a linked list before modifying it */
+    mfu_flist_map_release(flist);
+
     /* set head if this is the first item */
     if (flist->list_head == NULL) {
         flist->list_head = elem;
@@ -326,6 +332,19 @@ void mfu_flist_insert_stat(flist_t* flist, const char* fpath, mode_t mode, const
 
         elem->size  = (uint64_t) sb->st_size;
 
+#if DCOPY_USE_XATTRS
+        /* a zero-length list means the item has no xattrs, which
+         * saves listing them again when copying or comparing */
+        if (flist->xattrs) {
+            ssize_t list_size = llistxattr(fpath, NULL, 0);
+            if (list_size > 0) {
+                elem->mode |= MFU_FLIST_MODE_XATTRS_KNOWN | MFU_FLIST_MODE_XATTRS;
+            } else if (list_size == 0 || errno == ENOTSUP) {
+                elem->mode |= MFU_FLIST_MODE_XATTRS_KNOWN;
+            }
+        }
+#endif
+
         /* TODO: link to user and group names? */
     }
     else {
@@ -355,6 +374,9 @@ static void list_delete(flist_t* flist)
     /* delete the cached index */
     mfu_free(&flist->list_index);
 
+    /* release mapped records, if any */
+    mfu_flist_map_free(flist);
+
     return;
 }
 
@@ -363,6 +385,15 @@ static void list_delete(flist_t* flist)
 static elem_t* list_get_elem(flist_t* flist, uint64_t idx)
 {
     uint64_t max = flist->list_count;
+
+    /* decode record directly from file if list is mapped */
+    if (flist->map_base != NULL) {
+        if (idx < max) {
+            mfu_flist_map_decode(flist, idx, &flist->map_elem);
+            return &flist->map_elem;
+        }
+        return NULL;
+    }
     
     /* build index of list elements if we don't already have one */
     if (flist->list_index == NULL) {
@@ -389,6 +420,15 @@ static elem_t* list_get_elem(flist_t* flist, uint64_t idx)
     return NULL;
 }
 
+/* given an index, return pointer to that file element so that
+ * it can be modified, NULL if index is not in range */
+static elem_t* list_get_elem_write(flist_t* flist, uint64_t idx)
+{
+    /* mapped records are read-only, so copy them to a linked list */
+    mfu_flist_map_release(flist);
+    return list_get_elem(flist, idx);
+}
+
 static void list_compute_summary(flist_t* flist)
 {
     /* initialize summary values */
@@ -428,6 +468,25 @@ static void list_compute_summary(flist_t* flist)
     int min_depth = -1;
     int max_depth = -1;
     uint64_t max_name = 0;
+    if (flist->map_base != NULL) {
+        /* names in mapped records are padded to a fixed length */
+        if (count > 0) {
+            max_name = flist->map_chars;
+        }
+
+        uint64_t idx;
+        for (idx = 0; idx < count; idx++) {
+            const char* name = flist->map_records + idx * flist->map_elem_size;
+            int depth = mfu_flist_compute_depth(name);
+            if (depth < min_depth || min_depth == -1) {
+                min_depth = depth;
+            }
+            if (depth > max_depth || max_depth == -1) {
+                max_depth = depth;
+            }
+        }
+    }
+
     elem_t* current = flist->list_head;
     while (current != NULL) {
         uint64_t len = (uint64_t)(strlen(current->file) + 1);
@@ -494,6 +553,7 @@ mfu_flist mfu_flist_new()
     flist_t* flist = (flist_t*) MFU_MALLOC(sizeof(flist_t));
 
     flist->detail = 0;
+    flist->xattrs = 0;
     flist->total_files = 0;
 
     /* initialize linked list */
@@ -502,6 +562,13 @@ mfu_flist mfu_flist_new()
     flist->list_tail  = NULL;
     flist->list_index = NULL;
 
+    /* not backed by a mapped cache file */
+    flist->map_base      = NULL;
+    flist->map_size      = 0;
+    flist->map_records   = NULL;
+    flist->map_chars     = 0;
+    flist->map_elem_size = 0;
+
     /* initialize user and group structures */
     mfu_flist_usrgrp_init(flist);
 
@@ -762,11 +829,22 @@ uint64_t mfu_flist_file_get_mode(mfu_flist bflist, uint64_t idx)
     flist_t* flist = (flist_t*) bflist;
     elem_t* elem = list_get_elem(flist, idx);
     if (elem != NULL && flist->detail > 0) {
-        mode = elem->mode;
+        mode = elem->mode & MFU_FLIST_MODE_MASK;
     }
     return mode;
 }
 
+int mfu_flist_file_get_xattrs(mfu_flist bflist, uint64_t idx)
+{
+    int xattrs = -1;
+    flist_t* flist = (flist_t*) bflist;
+    elem_t* elem = list_get_elem(flist, idx);
+    if (elem != NULL && flist->detail > 0 && (elem->mode & MFU_FLIST_MODE_XATTRS_KNOWN)) {
+        xattrs = (elem->mode & MFU_FLIST_MODE_XATTRS) ? 1 : 0;
+    }
+    return xattrs;
+}
+
 uint64_t mfu_flist_file_get_perm(mfu_flist bflist, uint64_t idx) {
     uint64_t mode = mfu_flist_file_get_mode(bflist, idx);
 
@@ -785,6 +863,12 @@ void *mfu_flist_file_get_acl(mfu_flist bflist, uint64_t idx, ssize_t *acl_size,
 
     *acl_size = 0;
 
+    /* ACLs are stored as xattrs, so there is nothing to read
+     * if the walk found none on this item */
+    if (mfu_flist_file_get_xattrs(bflist, idx) == 0) {
+        return val;
+    }
+
     while(retries < 3) {
         val_size = lgetxattr(filename, type, val, val_bufsize);
         if(val_size < 0) {
@@ -940,7 +1024,7 @@ const char* mfu_flist_file_get_groupname(mfu_flist bflist, uint64_t idx)
 void mfu_flist_file_set_name(mfu_flist bflist, uint64_t idx, const char* name)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         /* free existing name if there is one */
         mfu_free(&elem->file);
@@ -955,7 +1039,7 @@ void mfu_flist_file_set_name(mfu_flist bflist, uint64_t idx, const char* name)
 void mfu_flist_file_set_type(mfu_flist bflist, uint64_t idx, mfu_filetype type)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->type = type;
     }
@@ -965,7 +1049,7 @@ void mfu_flist_file_set_type(mfu_flist bflist, uint64_t idx, mfu_filetype type)
 void mfu_flist_file_set_detail(mfu_flist bflist, uint64_t idx, int detail)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->detail = detail;
     }
@@ -975,9 +1059,10 @@ void mfu_flist_file_set_detail(mfu_flist bflist, uint64_t idx, int detail)
 void mfu_flist_file_set_mode(mfu_flist bflist, uint64_t idx, uint64_t mode)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
-        elem->mode = mode;
+        /* keep what the walk recorded about xattrs */
+        elem->mode = (elem->mode & ~MFU_FLIST_MODE_MASK) | (mode & MFU_FLIST_MODE_MASK);
     }
     return;
 }
@@ -985,7 +1070,7 @@ void mfu_flist_file_set_mode(mfu_flist bflist, uint64_t idx, uint64_t mode)
 void mfu_flist_file_set_uid(mfu_flist bflist, uint64_t idx, uint64_t uid)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->uid = uid;
     }
@@ -995,7 +1080,7 @@ void mfu_flist_file_set_uid(mfu_flist bflist, uint64_t idx, uint64_t uid)
 void mfu_flist_file_set_gid(mfu_flist bflist, uint64_t idx, uint64_t gid)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->gid = gid;
     }
@@ -1005,7 +1090,7 @@ void mfu_flist_file_set_gid(mfu_flist bflist, uint64_t idx, uint64_t gid)
 void mfu_flist_file_set_atime(mfu_flist bflist, uint64_t idx, uint64_t atime)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->atime = atime;
     }
@@ -1015,7 +1100,7 @@ void mfu_flist_file_set_atime(mfu_flist bflist, uint64_t idx, uint64_t atime)
 void mfu_flist_file_set_atime_nsec(mfu_flist bflist, uint64_t idx, uint64_t atime_nsec)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->atime_nsec = atime_nsec;
     }
@@ -1025,7 +1110,7 @@ void mfu_flist_file_set_atime_nsec(mfu_flist bflist, uint64_t idx, uint64_t atim
 void mfu_flist_file_set_mtime(mfu_flist bflist, uint64_t idx, uint64_t mtime)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->mtime = mtime;
     }
@@ -1035,7 +1120,7 @@ void mfu_flist_file_set_mtime(mfu_flist bflist, uint64_t idx, uint64_t mtime)
 void mfu_flist_file_set_mtime_nsec(mfu_flist bflist, uint64_t idx, uint64_t mtime_nsec)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->mtime_nsec = mtime_nsec;
     }
@@ -1045,7 +1130,7 @@ void mfu_flist_file_set_mtime_nsec(mfu_flist bflist, uint64_t idx, uint64_t mtim
 void mfu_flist_file_set_ctime(mfu_flist bflist, uint64_t idx, uint64_t ctime)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->ctime = ctime;
     }
@@ -1055,7 +1140,7 @@ void mfu_flist_file_set_ctime(mfu_flist bflist, uint64_t idx, uint64_t ctime)
 void mfu_flist_file_set_ctime_nsec(mfu_flist bflist, uint64_t idx, uint64_t ctime_nsec)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->ctime_nsec = ctime_nsec;
     }
@@ -1065,7 +1150,7 @@ void mfu_flist_file_set_ctime_nsec(mfu_flist bflist, uint64_t idx, uint64_t ctim
 void mfu_flist_file_set_size(mfu_flist bflist, uint64_t idx, uint64_t size)
 {
     flist_t* flist = (flist_t*) bflist;
-    elem_t* elem = list_get_elem(flist, idx);
+    elem_t* elem = list_get_elem_write(flist, idx);
     if (elem != NULL) {
         elem->size = size;
     }
@@ -200,6 +200,36 @@ void mfu_flist_walk_param_paths(
     mfu_flist flist               /* OUT - flist to insert walked items into */
 );
 
+/* called on all processes with the items found in each round of
+ * a streaming walk, the list is freed after the call returns */
+typedef void (*mfu_flist_walk_batch_fn)(mfu_flist batch, void* arg);
+
+/* walk list of directories in rounds of about batch_items items,
+ * calling fn with the items of each round before walking further,
+ * items are found in the same order as in mfu_flist_walk_paths, so
+ * a directory is in the same or an earlier round than its contents,
+ * all items are also added to flist */
+void mfu_flist_walk_paths_stream(
+    uint64_t num_paths,          /* IN  - number of paths in array */
+    const char** paths,          /* IN  - array of paths to be walked */
+    mfu_walk_opts_t* walk_opts,  /* IN  - functions to perform during the walk */
+    uint64_t batch_items,        /* IN  - number of items to find in each round */
+    mfu_flist_walk_batch_fn fn,  /* IN  - called with the items of each round */
+    void* arg,                   /* IN  - passed through to fn */
+    mfu_flist flist              /* OUT - flist to insert walked items into */
+);
+
+/* given a list of param_paths, walk them in rounds and add to flist */
+void mfu_flist_walk_param_paths_stream(
+    uint64_t num,                 /* IN  - number of paths in array */
+    const mfu_param_path* params, /* IN  - array of paths to be walked */
+    mfu_walk_opts_t* walk_opts,   /* IN  - functions to perform during the walk */
+    uint64_t batch_items,         /* IN  - number of items to find in each round */
+    mfu_flist_walk_batch_fn fn,   /* IN  - called with the items of each round */
+    void* arg,                    /* IN  - passed through to fn */
+    mfu_flist flist               /* OUT - flist to insert walked items into */
+);
+
 /* skip function pointer: given a path input, along with user-provided
  * arguments, compute whether to enqueue this file in output list of
  * mfu_flist_stat, return 1 if file should be skipped, 0 if not. */
@@ -269,6 +299,16 @@ void mfu_flist_read_cache(
     mfu_flist flist
 );
 
+/* map file list from a version 4 cache file, each process serves
+ * a contiguous range of records directly from the mapped file,
+ * intended for quick queries on a single node, records are copied
+ * into memory on the first modification of the list, falls back
+ * to mfu_flist_read_cache for other file versions */
+void mfu_flist_read_cache_map(
+    const char* name,
+    mfu_flist flist
+);
+
 /* write file list to file */
 void mfu_flist_write_cache(
     const char* name,
@@ -380,6 +420,10 @@ uint64_t mfu_flist_file_get_ctime(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_ctime_nsec(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_size(mfu_flist flist, uint64_t index);
 uint64_t mfu_flist_file_get_perm(mfu_flist flist, uint64_t index);
+
+/* returns 1 if the walk found extended attributes on the item,
+ * 0 if it found none, and -1 if the walk did not check */
+int mfu_flist_file_get_xattrs(mfu_flist flist, uint64_t index);
 #if DCOPY_USE_XATTRS
 void *mfu_flist_file_get_acl(mfu_flist bflist, uint64_t idx, ssize_t *acl_size, char *type);
 #endif
@@ -451,6 +495,41 @@ int mfu_flist_copy(
     mfu_copy_opts_t* mfu_copy_opts  /* IN - options to be used during copy */
 );
 
+/* most destinations mfu_flist_copy_multi writes to */
+#define MFU_COPY_MAX_DESTS (16)
+
+/* copy items in list from source paths to each of numdests
+ * destinations, reading the data of each file once and writing it
+ * to all of them, into_dirs[i] gives copy_into_dir for destpaths[i]
+ * as set by mfu_param_path_check_copy, errors are reported for each
+ * destination, returns 0 on success -1 on error */
+int mfu_flist_copy_multi(
+    mfu_flist src_cp_list,           /* IN - flist providing source items */
+    int numpaths,                    /* IN - number of source paths */
+    const mfu_param_path* paths,     /* IN - array of source paths */
+    int numdests,                    /* IN - number of destination paths */
+    const mfu_param_path* destpaths, /* IN - array of destination paths */
+    const int* into_dirs,            /* IN - copy_into_dir of each destination */
+    mfu_copy_opts_t* mfu_copy_opts   /* IN - options to be used during copy */
+);
+
+/* walk source paths in rounds of about batch_items items, creating
+ * the directories found in each round and copying its other items to
+ * each destination before the walk goes on, directory permissions,
+ * ownership, and timestamps are set after the walk, all items found
+ * are added to src_cp_list, returns 0 on success -1 on error */
+int mfu_flist_copy_stream(
+    int numpaths,                    /* IN  - number of source paths */
+    const mfu_param_path* paths,     /* IN  - array of source paths */
+    mfu_walk_opts_t* walk_opts,      /* IN  - options for the walk */
+    uint64_t batch_items,            /* IN  - number of items to find in each round */
+    int numdests,                    /* IN  - number of destination paths */
+    const mfu_param_path* destpaths, /* IN  - array of destination paths */
+    const int* into_dirs,            /* IN  - copy_into_dir of each destination */
+    mfu_copy_opts_t* mfu_copy_opts,  /* IN  - options to be used during copy */
+    mfu_flist src_cp_list            /* OUT - flist to insert walked items into */
+);
+
 /* link items in list from source paths to destination,
  * each item in source list must come from the
  * source path, returns 0 on success -1 on error */
@@ -510,12 +589,85 @@ typedef struct mfu_file_chunk_struct {
  * is responsbile for */
 mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size);
 
+/* like mfu_file_chunk_list_alloc, but spread chunks so that each process
+ * has about the same estimated cost, where the cost of a chunk is its
+ * length in bytes plus file_cost if it is the first chunk of a file */
+mfu_file_chunk* mfu_file_chunk_list_alloc_weighted(mfu_flist list, uint64_t chunk_size, uint64_t file_cost);
+
+/* like mfu_file_chunk_list_alloc_weighted, but only count bytes held in
+ * data extents of each chunk, so holes in sparse files cost nothing,
+ * this opens each file that spans more than one chunk */
+mfu_file_chunk* mfu_file_chunk_list_alloc_data(mfu_flist list, uint64_t chunk_size, uint64_t file_cost);
+
+/* how chunks are weighed when spreading them over processes */
+typedef enum {
+    MFU_FILE_CHUNK_WEIGHT_NONE  = 0, /* every chunk costs the same, as in mfu_file_chunk_list_alloc */
+    MFU_FILE_CHUNK_WEIGHT_BYTES = 1, /* bytes plus per-file cost, as in mfu_file_chunk_list_alloc_weighted */
+    MFU_FILE_CHUNK_WEIGHT_DATA  = 2, /* data extents plus per-file cost, as in mfu_file_chunk_list_alloc_data */
+} mfu_file_chunk_weight;
+
+/* callback to decide whether the section of item idx in list starting
+ * at offset is left out of a chunk list, returns 1 to leave it out */
+typedef int (*mfu_file_chunk_skip_fn)(mfu_flist list, uint64_t idx,
+    uint64_t offset, uint64_t length, void* arg);
+
+/* like mfu_file_chunk_list_alloc, but weigh chunks as given, and leave
+ * out chunks for which skip returns 1 before spreading the rest,
+ * skip may be NULL to keep all chunks */
+mfu_file_chunk* mfu_file_chunk_list_alloc_skip(
+    mfu_flist list,              /* IN - list of files to split into chunks */
+    uint64_t chunk_size,         /* IN - size of each chunk in bytes */
+    mfu_file_chunk_weight weight,/* IN - how to weigh chunks */
+    uint64_t file_cost,          /* IN - per-file cost when weight is not NONE */
+    mfu_file_chunk_skip_fn skip, /* IN - function to pick chunks to leave out, or NULL */
+    void* arg                    /* IN - opaque argument passed to skip */
+);
+
+/* like mfu_file_chunk_list_alloc_skip with bytes as weight, but lay
+ * chunks out in order of the device holding their file and the address
+ * of their first byte on it, from FIEMAP, rather than in list order,
+ * each process gets a contiguous range of that order and its list is
+ * in that order, this opens each file to look up its layout */
+mfu_file_chunk* mfu_file_chunk_list_alloc_physical(
+    mfu_flist list,              /* IN - list of files to split into chunks */
+    uint64_t chunk_size,         /* IN - size of each chunk in bytes */
+    uint64_t file_cost,          /* IN - per-file cost added to first chunk of each file */
+    mfu_file_chunk_skip_fn skip, /* IN - function to pick chunks to leave out, or NULL */
+    void* arg                    /* IN - opaque argument passed to skip */
+);
+
+/* give a copy of each element of the chunk list to the process shift
+ * ranks after this one, wrapping around, and return the elements
+ * received, this lets a process other than the one that wrote a chunk
+ * read it back, the caller frees both lists */
+mfu_file_chunk* mfu_file_chunk_list_shift(const mfu_file_chunk* head, int shift);
+
 /* free the linked list allocated with mfu_file_chunk_list_alloc */
 void mfu_file_chunk_list_free(mfu_file_chunk** phead);
 
 /* return number of items in chunk list */
 uint64_t mfu_file_chunk_list_size(const mfu_file_chunk* list);
 
+/* callback invoked by mfu_file_chunk_list_execute on a section of a file,
+ * returns 0 on success and -1 on error, or a positive bit mask to tell
+ * apart several ways the section failed */
+typedef int (*mfu_file_chunk_fn)(const char* name, uint64_t offset,
+    uint64_t length, uint64_t file_size, void* arg);
+
+/* invoke fn on each section of the chunk list, and set vals[i] to 0 if
+ * fn succeeded on all parts of element i, and otherwise to the OR of
+ * the masks fn returned, where -1 counts as 1, if dynamic is set,
+ * processes that run out of work steal sections from busy processes,
+ * in which case fn may be called on sections from other processes */
+void mfu_file_chunk_list_execute(
+    const mfu_file_chunk* head, /* IN  - chunk list generated from flist */
+    uint64_t chunk_size,        /* IN  - chunk size used to generate list */
+    int dynamic,                /* IN  - whether to balance work between processes at run time */
+    mfu_file_chunk_fn fn,       /* IN  - function to process each section */
+    void* arg,                  /* IN  - opaque argument passed to fn */
+    int* vals                   /* OUT - array of flags, one element for each chunk in the chunk list */
+);
+
 /* given an flist, a file chunk list generated from that flist,
  * and an input array of flags with one element per chunk,
  * execute a LOR per item in the flist, and return the result
@@ -8,6 +8,9 @@
 #include "dtcmp.h"
 #include "mfu.h"
 
+#include <fcntl.h>
+#include <sys/stat.h>
+
 /****************************************
  * Functions to divide flist into linked list of file sections
  ***************************************/
@@ -32,202 +35,104 @@ static int map_chunk_to_rank(uint64_t offset, uint64_t cutoff, uint64_t chunks_p
     return rank;
 }
 
-/* This is a long routine, but the idea is simple.  All tasks sum up
- * the number of file chunks they have, and those are then evenly
- * distributed amongst the processes.  */
-mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
+/* parameters to map a chunk to a rank given its position in the
+ * global order of chunks, when weighted is set, the position is the
+ * sum of the costs of all chunks that come before it */
+typedef struct {
+    int weighted;             /* whether positions are costs rather than chunk counts */
+    uint64_t cutoff;          /* rank of the last process to hold an extra chunk */
+    uint64_t chunks_per_rank; /* number of chunks per rank */
+    uint64_t total;           /* total cost across all chunks */
+    int ranks;                /* number of ranks */
+} chunk_map;
+
+/* compute cost of a chunk, each chunk counts as one unless weighted,
+ * in which case it costs its length in bytes plus file_cost if
+ * it is the first chunk of its file */
+static uint64_t chunk_cost(int weighted, uint64_t file_cost, uint64_t chunk_id, uint64_t length)
 {
-    /* get our rank and number of ranks */
-    int rank, ranks;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
-
-    /* total up number of file chunks for all files in our list */
-    uint64_t count = 0;
-    uint64_t idx;
-    uint64_t size = mfu_flist_size(list);
-    for (idx = 0; idx < size; idx++) {
-        /* get type of item */
-        mfu_filetype type = mfu_flist_file_get_type(list, idx);
-
-        /* if we have a file, add up its chunks */
-        if (type == MFU_TYPE_FILE) {
-            /* get size of file */
-            uint64_t file_size = mfu_flist_file_get_size(list, idx);
-
-            /* compute number of chunks to copy for this file */
-            uint64_t chunks = file_size / chunk_size;
-            if (chunks * chunk_size < file_size || file_size == 0) {
-                /* this accounts for the last chunk, which may be
-                 * partial or it adds a chunk for 0-size files */
-                chunks++;
-            }
-
-            /* include these chunks in our total */
-            count += chunks;
-        }
+    if (! weighted) {
+        return 1;
     }
 
-    /* compute total number of chunks across procs */
-    uint64_t total;
-    MPI_Allreduce(&count, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-
-    /* get global offset of our first chunk */
-    uint64_t offset;
-    MPI_Exscan(&count, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-    if (rank == 0) {
-        offset = 0;
+    uint64_t cost = length;
+    if (chunk_id == 0) {
+        cost += file_cost;
     }
 
-    /* compute number of chunks per task, ranks below cutoff will
-     * be responsible for (chunks_per_rank+1) and ranks at cutoff
-     * and above are responsible for chunks_per_rank */
-    uint64_t chunks_per_rank = total / (uint64_t) ranks;
-    uint64_t coverage = chunks_per_rank * (uint64_t) ranks;
-    uint64_t cutoff = total - coverage;
-
-    /* TODO: replace this with DSDE */
-
-    /* allocate an array of integers to use in alltoall,
-     * we'll set a flag to 1 if we have data for that rank
-     * and set it to 0 otherwise, then we'll exchange flags
-     * with an alltoall */
-    int* sendlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
-    int* recvlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
-
-    /* assume we won't send to any ranks,
-     * so initialize all ranks to 0 */
-    int i;
-    for (i = 0; i < ranks; i++) {
-        sendlist[i] = 0;
+    /* every chunk costs something */
+    if (cost == 0) {
+        cost = 1;
     }
+    return cost;
+}
 
-    /* if we have some chunks, figure out the number of ranks
-     * we'll send to and the range of rank ids, set flags to 1 */
-    int send_ranks = 0;
-    int first_send_rank, last_send_rank;
-    if (count > 0) {
-        /* compute first rank we'll send data to */
-        first_send_rank = map_chunk_to_rank(offset, cutoff, chunks_per_rank);
+/* compute the rank responsible for the chunk at the given position */
+static int map_pos_to_rank(uint64_t pos, const chunk_map* m)
+{
+    if (! m->weighted) {
+        return map_chunk_to_rank(pos, m->cutoff, m->chunks_per_rank);
+    }
 
-        /* compute last rank we'll send to */
-        uint64_t last_offset = offset + count - 1;
-        last_send_rank  = map_chunk_to_rank(last_offset, cutoff, chunks_per_rank);
+    /* split the total cost into equal ranges per rank,
+     * this is monotonic in pos so ranks get contiguous chunks */
+    int rank = (int) ((double)pos / (double)m->total * (double)m->ranks);
+    if (rank >= m->ranks) {
+        rank = m->ranks - 1;
+    }
+    return rank;
+}
 
-        /* set flag for each process we'll send data to */
-        for (i = first_send_rank; i <= last_send_rank; i++) {
-            sendlist[i] = 1;
+/* set lengths[i] to the number of bytes in data extents of chunk i
+ * of the named file, the full chunk length is used for any chunk
+ * we can't look at */
+static void chunk_data_lengths(const char* name, uint64_t file_size,
+                               uint64_t chunk_size, uint64_t chunks, uint64_t* lengths)
+{
+    uint64_t chunk_id;
+    for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+        uint64_t length = chunk_size;
+        if (file_size - chunk_id * chunk_size < length) {
+            length = file_size - chunk_id * chunk_size;
         }
-
-        /* compute total number of destinations we'll send to */
-        send_ranks = last_send_rank - first_send_rank + 1;
+        lengths[chunk_id] = length;
     }
 
-    /* allocate a linked list for each process we'll send to */
-    mfu_file_chunk** heads = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
-    mfu_file_chunk** tails = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
-    uint64_t* counts  = (uint64_t*)   MFU_MALLOC((size_t)send_ranks * sizeof(uint64_t));
-    uint64_t* bytes   = (uint64_t*)   MFU_MALLOC((size_t)send_ranks * sizeof(uint64_t));
-    char** sendbufs   = (char**)      MFU_MALLOC((size_t)send_ranks * sizeof(char*));
-
-    /* initialize values */
-    for (i = 0; i < send_ranks; i++) {
-        heads[i]    = NULL;
-        tails[i]    = NULL;
-        counts[i]   = 0;
-        bytes[i]    = 0;
-        sendbufs[i] = NULL;
+    /* files in a single chunk are rarely sparse,
+     * so avoid opening them */
+    if (chunks < 2) {
+        return;
     }
 
-    /* now iterate through files and build up list of chunks we'll
-     * send to each task, as an optimization, we encode consecutive
-     * chunks of the same file into a single unit */
-    uint64_t current_offset = offset;
-    for (idx = 0; idx < size; idx++) {
-        /* get type of item */
-        mfu_filetype type = mfu_flist_file_get_type(list, idx);
-
-        /* if we have a file, add up its chunks */
-        if (type == MFU_TYPE_FILE) {
-            /* get size of file */
-            uint64_t file_size = mfu_flist_file_get_size(list, idx);
-
-            /* compute number of chunks to copy for this file */
-            uint64_t chunks = file_size / chunk_size;
-            if (chunks * chunk_size < file_size || file_size == 0) {
-                chunks++;
-            }
-
-            /* iterate over each chunk of this file and determine the
-             * rank we should send it to */
-            int prev_rank = MPI_PROC_NULL;
-            uint64_t chunk_id;
-            for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
-                /* determine which rank we should map this chunk to */
-                int current_rank = map_chunk_to_rank(current_offset, cutoff, chunks_per_rank);
-
-                /* compute index into our send_ranks arrays */
-                int rank_index = current_rank - first_send_rank;
-
-                /* if this chunk goes to a rank we've already created
-                 * an element for, just update that element, otherwise
-                 * create a new element */
-                if (current_rank == prev_rank) {
-                    /* we've already got an element started for this
-                     * file and rank, just update its count field to
-                     * append this element */
-                    mfu_file_chunk* elem = tails[rank_index];
-                    elem->length += chunk_size;
-
-                    /* adjusting length in case chunk is a partial chunk */
-                    uint64_t remainder = file_size - elem->offset;
-                    if (remainder < elem->length) {
-                        elem->length = remainder;
-                    }
-                } else {
-                    /* we're sending to a new rank or have the start
-                     * of a new file, either way allocate a new element */
-                    mfu_file_chunk* elem = (mfu_file_chunk*) MFU_MALLOC(sizeof(mfu_file_chunk));
-                    elem->name             = mfu_flist_file_get_name(list, idx);
-                    elem->offset           = chunk_id * chunk_size;
-                    elem->length           = chunk_size;
-                    elem->file_size        = file_size;
-                    elem->rank_of_owner    = rank;
-                    elem->index_of_owner   = idx;
-                    elem->next             = NULL;
-
-                    /* adjusting length in case chunk is a partial chunk */
-                    uint64_t remainder = file_size - elem->offset;
-                    if (remainder < elem->length) {
-                        elem->length = remainder;
-                    }
+    int fd = mfu_open(name, O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
 
-                    /* compute bytes needed to pack this item,
-                     * full name NUL-terminated, chunk id,
-                     * number of chunks, and file size */
-                    size_t pack_size = strlen(elem->name) + 1;
-                    pack_size += 5 * 8;
+    for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+        off_t data = mfu_data_size(name, fd, (off_t)(chunk_id * chunk_size), (off_t)lengths[chunk_id]);
+        if (data >= 0) {
+            lengths[chunk_id] = (uint64_t) data;
+        }
+    }
 
-                    /* append element to list */
-                    if (heads[rank_index] == NULL) {
-                        heads[rank_index] = elem;
-                    }
-                    if (tails[rank_index] != NULL) {
-                        tails[rank_index]->next = elem;
-                    }
-                    tails[rank_index] = elem;
-                    counts[rank_index]++;
-                    bytes[rank_index] += pack_size;
+    mfu_close(name, fd);
+}
 
-                    /* remember which rank we're sending to */
-                    prev_rank = current_rank;
-                }
+/* given flags in sendlist marking the ranks we send to, which are
+ * the send_ranks ranks starting at first_send_rank, a list of elements
+ * for each of them, and the bytes needed to pack each list, send the
+ * elements to those ranks and return the list of elements we receive,
+ * in order of the rank that sent them, frees the elements sent */
+static mfu_file_chunk* chunk_list_exchange(int* sendlist, int first_send_rank, int send_ranks,
+                                           mfu_file_chunk** heads, const uint64_t* bytes)
+{
+    int i;
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-                /* go on to our next chunk */
-                current_offset++;
-            }
-        }
-    }
+    int* recvlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    char** sendbufs = (char**) MFU_MALLOC((size_t)send_ranks * sizeof(char*));
 
     /* exchange flags with ranks so everyone knows who they'll
      * receive data from */
@@ -393,155 +298,745 @@ mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
         tail = p;
     }
 
-    return head;
-}
-
-/* free the linked list of structs (copy elem's) */
-void mfu_file_chunk_list_free(mfu_file_chunk** phead)
-{
-    /* check whether we were given a pointer */
-    if (phead != NULL) {
-        /* free the linked list of structs (mfu_file_chunk) */
-        mfu_file_chunk* tmp;
-        mfu_file_chunk* current = *phead;
-        while (current != NULL) {
-            /* get pointer to current element and advance current */
-            tmp = current;
-            current = current->next;
-
-            /* free the name string we had strdup'd */
-            mfu_free(&tmp->name);
-
-            /* free the element */
-            mfu_free(&tmp);
+    /* free elements we sent */
+    for (i = 0; i < send_ranks; i++) {
+        mfu_file_chunk* elem = heads[i];
+        while (elem != NULL) {
+            mfu_file_chunk* next = elem->next;
+            mfu_free(&elem);
+            elem = next;
         }
-
-        /* set caller's pointer to NULL to indicate it's freed */
-        *phead = NULL;
+        mfu_free(&sendbufs[i]);
     }
 
-    return;
-}
+    mfu_free(&recvbuf);
+    mfu_free(&send_counts);
+    mfu_free(&recv_counts);
+    mfu_free(&request);
+    mfu_free(&status);
+    mfu_free(&recvranklist);
+    mfu_free(&sendbufs);
+    mfu_free(&recvlist);
 
-uint64_t mfu_file_chunk_list_size(const mfu_file_chunk* p)
-{
-    uint64_t count = 0;
-    while (p != NULL) {
-        count++;
-        p = p->next;
-    }
-    return count;
+    return head;
 }
 
-/* given an flist, a file chunk list generated from that flist,
- * and an input array of flags with one element per chunk,
- * execute a LOR per item in the flist, and return the result
- * to the process owning that item in the flist */
-void mfu_file_chunk_list_lor(mfu_flist list, const mfu_file_chunk* head, const int* vals, int* results)
+/* This is a long routine, but the idea is simple.  All tasks sum up
+ * the number of file chunks they have, and those are then evenly
+ * distributed amongst the processes.  If weight is set, chunks are
+ * distributed so that each process has about the same cost of bytes
+ * plus file_cost for each file it starts, where bytes only counts
+ * data extents and not holes with MFU_FILE_CHUNK_WEIGHT_DATA.
+ * Chunks for which skip returns 1 are given no cost and left out. */
+static mfu_file_chunk* chunk_list_alloc(mfu_flist list, uint64_t chunk_size,
+                                        int weight, uint64_t file_cost,
+                                        mfu_file_chunk_skip_fn skip, void* arg)
 {
-    /* get the largest filename */
-    uint64_t max_name = mfu_flist_file_max_name(list);
+    int weighted = (weight != MFU_FILE_CHUNK_WEIGHT_NONE);
 
-    /* if list is empty, we can't do much */
-    if (max_name == 0) {
-        return;
-    }
+    /* get our rank and number of ranks */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* get a count of how many items are the chunk list */
-    uint64_t list_count = mfu_file_chunk_list_size(head);
+    /* total up number of file chunks for all files in our list */
+    uint64_t count = 0;
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        /* get type of item */
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
 
-    /* keys are the filename, so only bytes that belong to 
-     * the same file will be compared via a flag in the segmented scan */
-    char* keys = (char*) MFU_MALLOC(list_count * max_name);
+        /* if we have a file, add up its chunks */
+        if (type == MFU_TYPE_FILE) {
+            /* get size of file */
+            uint64_t file_size = mfu_flist_file_get_size(list, idx);
 
-    /* ltr pointer for the output of the left-to-right-segmented scan */
-    int* ltr = (int*) MFU_MALLOC(list_count * sizeof(int));
+            /* compute number of chunks to copy for this file */
+            uint64_t chunks = file_size / chunk_size;
+            if (chunks * chunk_size < file_size || file_size == 0) {
+                /* this accounts for the last chunk, which may be
+                 * partial or it adds a chunk for 0-size files */
+                chunks++;
+            }
 
-    /* copy file names into comparison buffer for segmented scan */
-    uint64_t i;
-    const mfu_file_chunk* p = head;
-    for (i = 0; i < list_count; i++) {
-        char* name = keys + max_name * i;
-        strncpy(name, p->name, max_name);
-        p = p->next;
+            /* include these chunks in our total */
+            count += chunks;
+        }
     }
 
-    /* create type and comparison operation for file names for the segmented scan */
-    MPI_Datatype keytype = MPI_DATATYPE_NULL;
-    DTCMP_Op keyop = DTCMP_OP_NULL;
-    DTCMP_Str_create_ascend((int)max_name, &keytype, &keyop);
+    /* compute the cost of each of our chunks, add them up,
+     * and remember the cost of the last one so we can find its position,
+     * chunks we leave out get a cost of 0 */
+    uint64_t* costs = (uint64_t*) MFU_MALLOC(count * sizeof(uint64_t));
+    uint64_t cost = 0;
+    uint64_t last_cost = 0;
+    uint64_t kept = 0;
+    uint64_t current_chunk = 0;
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        if (type == MFU_TYPE_FILE) {
+            uint64_t file_size = mfu_flist_file_get_size(list, idx);
+            uint64_t chunks = file_size / chunk_size;
+            if (chunks * chunk_size < file_size || file_size == 0) {
+                chunks++;
+            }
 
-    /* execute segmented scan of comparison flags across file names */
-    DTCMP_Segmented_scanv_ltr(
-        (int)list_count, keys, keytype, keyop,
-        vals, ltr, MPI_INT, MPI_LOR,
-        DTCMP_FLAG_NONE, MPI_COMM_WORLD
-    );
-    
-    /* we're done with the MPI type and operation, free them */
-    MPI_Type_free(&keytype);
-    DTCMP_Op_free(&keyop);
+            /* get the number of bytes in each chunk, leaving out holes
+             * if we're weighing by data extents */
+            uint64_t* lengths = &costs[current_chunk];
+            if (weight == MFU_FILE_CHUNK_WEIGHT_DATA) {
+                const char* name = mfu_flist_file_get_name(list, idx);
+                chunk_data_lengths(name, file_size, chunk_size, chunks, lengths);
+            } else {
+                uint64_t chunk_id;
+                for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+                    uint64_t length = chunk_size;
+                    if (file_size - chunk_id * chunk_size < length) {
+                        length = file_size - chunk_id * chunk_size;
+                    }
+                    lengths[chunk_id] = length;
+                }
+            }
+
+            /* convert lengths to costs in place */
+            uint64_t chunk_id;
+            for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+                if (skip != NULL) {
+                    uint64_t chunk_offset = chunk_id * chunk_size;
+                    uint64_t chunk_length = chunk_size;
+                    if (file_size - chunk_offset < chunk_length) {
+                        chunk_length = file_size - chunk_offset;
+                    }
+                    if ((*skip)(list, idx, chunk_offset, chunk_length, arg)) {
+                        lengths[chunk_id] = 0;
+                        continue;
+                    }
+                }
+                kept++;
+                last_cost = chunk_cost(weighted, file_cost, chunk_id, lengths[chunk_id]);
+                lengths[chunk_id] = last_cost;
+                cost += last_cost;
+            }
+            current_chunk += chunks;
+        }
+    }
+
+    /* compute total cost of chunks across procs */
+    uint64_t total;
+    MPI_Allreduce(&cost, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    /* get global position of our first chunk */
+    uint64_t offset;
+    MPI_Exscan(&cost, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        offset = 0;
+    }
+
+    /* compute number of chunks per task, ranks below cutoff will
+     * be responsible for (chunks_per_rank+1) and ranks at cutoff
+     * and above are responsible for chunks_per_rank */
+    uint64_t chunks_per_rank = total / (uint64_t) ranks;
+    uint64_t coverage = chunks_per_rank * (uint64_t) ranks;
+    uint64_t cutoff = total - coverage;
+
+    /* record how to map chunk positions to ranks */
+    chunk_map map;
+    map.weighted        = weighted;
+    map.cutoff          = cutoff;
+    map.chunks_per_rank = chunks_per_rank;
+    map.total           = total;
+    map.ranks           = ranks;
+
+    /* TODO: replace this with DSDE */
+
+    /* allocate an array of integers to use in alltoall,
+     * we'll set a flag to 1 if we have data for that rank
+     * and set it to 0 otherwise, then we'll exchange flags
+     * with an alltoall */
+    int* sendlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+
+    /* assume we won't send to any ranks,
+     * so initialize all ranks to 0 */
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendlist[i] = 0;
+    }
+
+    /* if we have some chunks, figure out the number of ranks
+     * we'll send to and the range of rank ids, set flags to 1 */
+    int send_ranks = 0;
+    int first_send_rank = 0, last_send_rank = 0;
+    if (kept > 0) {
+        /* compute first rank we'll send data to */
+        first_send_rank = map_pos_to_rank(offset, &map);
+
+        /* compute last rank we'll send to */
+        uint64_t last_offset = offset + cost - last_cost;
+        last_send_rank  = map_pos_to_rank(last_offset, &map);
+
+        /* set flag for each process we'll send data to */
+        for (i = first_send_rank; i <= last_send_rank; i++) {
+            sendlist[i] = 1;
+        }
+
+        /* compute total number of destinations we'll send to */
+        send_ranks = last_send_rank - first_send_rank + 1;
+    }
+
+    /* allocate a linked list for each process we'll send to */
+    mfu_file_chunk** heads = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
+    mfu_file_chunk** tails = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
+    uint64_t* counts  = (uint64_t*)   MFU_MALLOC((size_t)send_ranks * sizeof(uint64_t));
+    uint64_t* bytes   = (uint64_t*)   MFU_MALLOC((size_t)send_ranks * sizeof(uint64_t));
+
+    /* initialize values */
+    for (i = 0; i < send_ranks; i++) {
+        heads[i]    = NULL;
+        tails[i]    = NULL;
+        counts[i]   = 0;
+        bytes[i]    = 0;
+    }
+
+    /* now iterate through files and build up list of chunks we'll
+     * send to each task, as an optimization, we encode consecutive
+     * chunks of the same file into a single unit */
+    uint64_t current_offset = offset;
+    current_chunk = 0;
+    for (idx = 0; idx < size; idx++) {
+        /* get type of item */
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+
+        /* if we have a file, add up its chunks */
+        if (type == MFU_TYPE_FILE) {
+            /* get size of file */
+            uint64_t file_size = mfu_flist_file_get_size(list, idx);
+
+            /* compute number of chunks to copy for this file */
+            uint64_t chunks = file_size / chunk_size;
+            if (chunks * chunk_size < file_size || file_size == 0) {
+                chunks++;
+            }
+
+            /* iterate over each chunk of this file and determine the
+             * rank we should send it to */
+            int prev_rank = MPI_PROC_NULL;
+            uint64_t chunk_id;
+            for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+                /* leave out skipped chunks, the next chunk we keep
+                 * starts a new element */
+                if (costs[current_chunk] == 0) {
+                    prev_rank = MPI_PROC_NULL;
+                    current_chunk++;
+                    continue;
+                }
+
+                /* determine which rank we should map this chunk to */
+                int current_rank = map_pos_to_rank(current_offset, &map);
+
+                /* compute index into our send_ranks arrays */
+                int rank_index = current_rank - first_send_rank;
+
+                /* if this chunk goes to a rank we've already created
+                 * an element for, just update that element, otherwise
+                 * create a new element */
+                if (current_rank == prev_rank) {
+                    /* we've already got an element started for this
+                     * file and rank, just update its count field to
+                     * append this element */
+                    mfu_file_chunk* elem = tails[rank_index];
+                    elem->length += chunk_size;
+
+                    /* adjusting length in case chunk is a partial chunk */
+                    uint64_t remainder = file_size - elem->offset;
+                    if (remainder < elem->length) {
+                        elem->length = remainder;
+                    }
+                } else {
+                    /* we're sending to a new rank or have the start
+                     * of a new file, either way allocate a new element */
+                    mfu_file_chunk* elem = (mfu_file_chunk*) MFU_MALLOC(sizeof(mfu_file_chunk));
+                    elem->name             = mfu_flist_file_get_name(list, idx);
+                    elem->offset           = chunk_id * chunk_size;
+                    elem->length           = chunk_size;
+                    elem->file_size        = file_size;
+                    elem->rank_of_owner    = rank;
+                    elem->index_of_owner   = idx;
+                    elem->next             = NULL;
+
+                    /* adjusting length in case chunk is a partial chunk */
+                    uint64_t remainder = file_size - elem->offset;
+                    if (remainder < elem->length) {
+                        elem->length = remainder;
+                    }
+
+                    /* compute bytes needed to pack this item,
+                     * full name NUL-terminated, chunk id,
+                     * number of chunks, and file size */
+                    size_t pack_size = strlen(elem->name) + 1;
+                    pack_size += 5 * 8;
+
+                    /* append element to list */
+                    if (heads[rank_index] == NULL) {
+                        heads[rank_index] = elem;
+                    }
+                    if (tails[rank_index] != NULL) {
+                        tails[rank_index]->next = elem;
+                    }
+                    tails[rank_index] = elem;
+                    counts[rank_index]++;
+                    bytes[rank_index] += pack_size;
+
+                    /* remember which rank we're sending to */
+                    prev_rank = current_rank;
+                }
+
+                /* go on to our next chunk */
+                current_offset += costs[current_chunk];
+                current_chunk++;
+            }
+        }
+    }
+    mfu_free(&costs);
+
+    /* send the elements to the ranks that will process them */
+    mfu_file_chunk* head = chunk_list_exchange(sendlist, first_send_rank, send_ranks, heads, bytes);
+
+    mfu_free(&sendlist);
+    mfu_free(&heads);
+    mfu_free(&tails);
+    mfu_free(&counts);
+    mfu_free(&bytes);
+
+    return head;
+}
+
+/* number of uint64_t fields in the key and satellite data of a chunk
+ * record when ordering chunks by physical location */
+#define CHUNK_PHYS_KEYS (5) /* device, address, owner rank, owner index, offset */
+#define CHUNK_PHYS_SATS (3) /* length, file size, cost */
+
+/* Like chunk_list_alloc with bytes as weight, but rather than in list
+ * order, chunks are laid out in order of the device holding their file
+ * and the address of their first byte on it, as reported by FIEMAP.
+ * Each process gets a contiguous range of that order with about the
+ * same cost, and processes its chunks in that order, so that a source
+ * on disks is read in long sequential runs.  Chunks whose address is
+ * unknown go after the others of their device in list order. */
+static mfu_file_chunk* chunk_list_alloc_physical(mfu_flist list, uint64_t chunk_size,
+                                                 uint64_t file_cost,
+                                                 mfu_file_chunk_skip_fn skip, void* arg)
+{
+    /* get our rank and number of ranks */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* records hold the full file name, padded so fields stay aligned */
+    uint64_t chars = mfu_flist_file_max_name(list);
+    chars = (chars + 7) / 8 * 8;
+    size_t rec_size = (CHUNK_PHYS_KEYS + CHUNK_PHYS_SATS) * 8 + (size_t) chars;
+
+    /* count the chunks of our files */
+    uint64_t count = 0;
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) == MFU_TYPE_FILE) {
+            uint64_t file_size = mfu_flist_file_get_size(list, idx);
+            uint64_t chunks = file_size / chunk_size;
+            if (chunks * chunk_size < file_size || file_size == 0) {
+                chunks++;
+            }
+            count += chunks;
+        }
+    }
+
+    /* build a record for each chunk we keep, looking up the
+     * physical address of each chunk of a file with one open */
+    char* recs = (char*) MFU_MALLOC(count * rec_size);
+    uint64_t* phys = NULL;
+    uint64_t phys_count = 0;
+    uint64_t kept = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) != MFU_TYPE_FILE) {
+            continue;
+        }
+
+        const char* name = mfu_flist_file_get_name(list, idx);
+        uint64_t file_size = mfu_flist_file_get_size(list, idx);
+        uint64_t chunks = file_size / chunk_size;
+        if (chunks * chunk_size < file_size || file_size == 0) {
+            chunks++;
+        }
+
+        if (chunks > phys_count) {
+            mfu_free(&phys);
+            phys = (uint64_t*) MFU_MALLOC(chunks * sizeof(uint64_t));
+            phys_count = chunks;
+        }
+
+        uint64_t dev = 0;
+        int have_phys = 0;
+        int fd = mfu_open(name, O_RDONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd, &st) == 0) {
+                dev = (uint64_t) st.st_dev;
+            }
+            if (file_size > 0 && mfu_physical_offsets(name, fd, chunk_size, chunks, phys) == 0) {
+                have_phys = 1;
+            }
+            mfu_close(name, fd);
+        }
+
+        uint64_t chunk_id;
+        for (chunk_id = 0; chunk_id < chunks; chunk_id++) {
+            uint64_t offset = chunk_id * chunk_size;
+            uint64_t length = chunk_size;
+            if (file_size - offset < length) {
+                length = file_size - offset;
+            }
+
+            if (skip != NULL && (*skip)(list, idx, offset, length, arg)) {
+                continue;
+            }
+
+            uint64_t* fields = (uint64_t*) (recs + kept * rec_size);
+            fields[0] = dev;
+            fields[1] = have_phys ? phys[chunk_id] : UINT64_MAX;
+            fields[2] = (uint64_t) rank;
+            fields[3] = idx;
+            fields[4] = offset;
+            fields[5] = length;
+            fields[6] = file_size;
+            fields[7] = chunk_cost(1, file_cost, chunk_id, length);
+            strncpy((char*) &fields[8], name, (size_t) chars);
+            kept++;
+        }
+    }
+    mfu_free(&phys);
+
+    /* sort records globally by key, this leaves each process
+     * with as many records as it put in */
+    MPI_Datatype dt_key, dt_sat, dt_keysat;
+    MPI_Type_contiguous(CHUNK_PHYS_KEYS, MPI_UINT64_T, &dt_key);
+    MPI_Type_contiguous((int)(rec_size - CHUNK_PHYS_KEYS * 8), MPI_BYTE, &dt_sat);
+    MPI_Type_commit(&dt_key);
+    MPI_Type_commit(&dt_sat);
+    MPI_Datatype keysat_types[2] = {dt_key, dt_sat};
+    if (DTCMP_Type_create_series(2, keysat_types, &dt_keysat) != DTCMP_SUCCESS) {
+        MFU_ABORT(1, "Failed to create keysat type");
+    }
+
+    DTCMP_Op ops[CHUNK_PHYS_KEYS];
+    int i;
+    for (i = 0; i < CHUNK_PHYS_KEYS; i++) {
+        ops[i] = DTCMP_OP_UINT64T_ASCEND;
+    }
+    DTCMP_Op op_key;
+    if (DTCMP_Op_create_series(CHUNK_PHYS_KEYS, ops, &op_key) != DTCMP_SUCCESS) {
+        MFU_ABORT(1, "Failed to create sorting operation for key");
+    }
+
+    DTCMP_Sortv(DTCMP_IN_PLACE, recs, (int) kept, dt_key, dt_keysat,
+        op_key, DTCMP_FLAG_NONE, MPI_COMM_WORLD);
+
+    DTCMP_Op_free(&op_key);
+    MPI_Type_free(&dt_keysat);
+    MPI_Type_free(&dt_sat);
+    MPI_Type_free(&dt_key);
+
+    /* sum the cost of the records we now hold and find the
+     * global position of our first one */
+    uint64_t cost = 0;
+    uint64_t last_cost = 0;
+    uint64_t r;
+    for (r = 0; r < kept; r++) {
+        uint64_t* fields = (uint64_t*) (recs + r * rec_size);
+        last_cost = fields[7];
+        cost += last_cost;
+    }
+
+    uint64_t total;
+    MPI_Allreduce(&cost, &total, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    uint64_t offset;
+    MPI_Exscan(&cost, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        offset = 0;
+    }
+
+    chunk_map map;
+    map.weighted        = 1;
+    map.cutoff          = 0;
+    map.chunks_per_rank = 0;
+    map.total           = total;
+    map.ranks           = ranks;
+
+    /* positions only increase, so the ranks we send to are contiguous */
+    int* sendlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        sendlist[i] = 0;
+    }
+    int send_ranks = 0;
+    int first_send_rank = 0;
+    if (kept > 0) {
+        first_send_rank = map_pos_to_rank(offset, &map);
+        int last_send_rank = map_pos_to_rank(offset + cost - last_cost, &map);
+        for (i = first_send_rank; i <= last_send_rank; i++) {
+            sendlist[i] = 1;
+        }
+        send_ranks = last_send_rank - first_send_rank + 1;
+    }
+
+    mfu_file_chunk** heads = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
+    mfu_file_chunk** tails = (mfu_file_chunk**) MFU_MALLOC((size_t)send_ranks * sizeof(mfu_file_chunk*));
+    uint64_t* bytes = (uint64_t*) MFU_MALLOC((size_t)send_ranks * sizeof(uint64_t));
+    for (i = 0; i < send_ranks; i++) {
+        heads[i] = NULL;
+        tails[i] = NULL;
+        bytes[i] = 0;
+    }
 
+    /* build a list for each rank in sorted order, merging a chunk into
+     * the one before it when it continues the same file, which is
+     * common since files tend to be laid out in order on disk */
+    uint64_t pos = offset;
+    for (r = 0; r < kept; r++) {
+        uint64_t* fields = (uint64_t*) (recs + r * rec_size);
+        int rank_index = map_pos_to_rank(pos, &map) - first_send_rank;
+        pos += fields[7];
+
+        mfu_file_chunk* tail = tails[rank_index];
+        if (tail != NULL &&
+            tail->rank_of_owner  == fields[2] &&
+            tail->index_of_owner == fields[3] &&
+            tail->offset + tail->length == fields[4])
+        {
+            tail->length += fields[5];
+            continue;
+        }
+
+        mfu_file_chunk* elem = (mfu_file_chunk*) MFU_MALLOC(sizeof(mfu_file_chunk));
+        elem->name           = (const char*) &fields[8];
+        elem->offset         = fields[4];
+        elem->length         = fields[5];
+        elem->file_size      = fields[6];
+        elem->rank_of_owner  = fields[2];
+        elem->index_of_owner = fields[3];
+        elem->next           = NULL;
+
+        if (heads[rank_index] == NULL) {
+            heads[rank_index] = elem;
+        }
+        if (tail != NULL) {
+            tail->next = elem;
+        }
+        tails[rank_index] = elem;
+        bytes[rank_index] += strlen(elem->name) + 1 + 5 * 8;
+    }
+
+    /* send the elements to the ranks that will process them,
+     * we receive them in sorted order */
+    mfu_file_chunk* head = chunk_list_exchange(sendlist, first_send_rank, send_ranks, heads, bytes);
+
+    mfu_free(&sendlist);
+    mfu_free(&heads);
+    mfu_free(&tails);
+    mfu_free(&bytes);
+    mfu_free(&recs);
+
+    return head;
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc(mfu_flist list, uint64_t chunk_size)
+{
+    return chunk_list_alloc(list, chunk_size, MFU_FILE_CHUNK_WEIGHT_NONE, 0, NULL, NULL);
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc_weighted(mfu_flist list, uint64_t chunk_size, uint64_t file_cost)
+{
+    return chunk_list_alloc(list, chunk_size, MFU_FILE_CHUNK_WEIGHT_BYTES, file_cost, NULL, NULL);
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc_data(mfu_flist list, uint64_t chunk_size, uint64_t file_cost)
+{
+    return chunk_list_alloc(list, chunk_size, MFU_FILE_CHUNK_WEIGHT_DATA, file_cost, NULL, NULL);
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc_skip(mfu_flist list, uint64_t chunk_size,
+    mfu_file_chunk_weight weight, uint64_t file_cost, mfu_file_chunk_skip_fn skip, void* arg)
+{
+    return chunk_list_alloc(list, chunk_size, (int) weight, file_cost, skip, arg);
+}
+
+mfu_file_chunk* mfu_file_chunk_list_alloc_physical(mfu_flist list, uint64_t chunk_size,
+    uint64_t file_cost, mfu_file_chunk_skip_fn skip, void* arg)
+{
+    return chunk_list_alloc_physical(list, chunk_size, file_cost, skip, arg);
+}
+
+/* copy each element of our list to the rank shift places after us,
+ * and return the list of elements we get from the rank shift before */
+mfu_file_chunk* mfu_file_chunk_list_shift(const mfu_file_chunk* head, int shift)
+{
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* pick the rank we send to, keep the shift in range */
+    shift %= ranks;
+    if (shift < 0) {
+        shift += ranks;
+    }
+    int dest = (rank + shift) % ranks;
+
+    /* duplicate our elements, since the exchange frees what it sends */
+    mfu_file_chunk* copy = NULL;
+    mfu_file_chunk* tail = NULL;
+    uint64_t bytes = 0;
+    const mfu_file_chunk* p;
+    for (p = head; p != NULL; p = p->next) {
+        mfu_file_chunk* elem = (mfu_file_chunk*) MFU_MALLOC(sizeof(mfu_file_chunk));
+        elem->name           = p->name;
+        elem->offset         = p->offset;
+        elem->length         = p->length;
+        elem->file_size      = p->file_size;
+        elem->rank_of_owner  = p->rank_of_owner;
+        elem->index_of_owner = p->index_of_owner;
+        elem->next           = NULL;
+        if (tail != NULL) {
+            tail->next = elem;
+        } else {
+            copy = elem;
+        }
+        tail = elem;
+
+        bytes += strlen(p->name) + 1 + 5 * sizeof(uint64_t);
+    }
+
+    /* only send if we have something */
+    int* sendlist = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendlist[i] = 0;
+    }
+    int send_ranks = 0;
+    if (copy != NULL) {
+        sendlist[dest] = 1;
+        send_ranks = 1;
+    }
+
+    mfu_file_chunk* shifted = chunk_list_exchange(sendlist, dest, send_ranks, &copy, &bytes);
+
+    mfu_free(&sendlist);
+
+    return shifted;
+}
+
+/* free the linked list of structs (copy elem's) */
+void mfu_file_chunk_list_free(mfu_file_chunk** phead)
+{
+    /* check whether we were given a pointer */
+    if (phead != NULL) {
+        /* free the linked list of structs (mfu_file_chunk) */
+        mfu_file_chunk* tmp;
+        mfu_file_chunk* current = *phead;
+        while (current != NULL) {
+            /* get pointer to current element and advance current */
+            tmp = current;
+            current = current->next;
+
+            /* free the name string we had strdup'd */
+            mfu_free(&tmp->name);
+
+            /* free the element */
+            mfu_free(&tmp);
+        }
+
+        /* set caller's pointer to NULL to indicate it's freed */
+        *phead = NULL;
+    }
+
+    return;
+}
+
+uint64_t mfu_file_chunk_list_size(const mfu_file_chunk* p)
+{
+    uint64_t count = 0;
+    while (p != NULL) {
+        count++;
+        p = p->next;
+    }
+    return count;
+}
+
+/* given an flist, a file chunk list generated from that flist,
+ * and an input array of flags with one element per chunk,
+ * execute a LOR per item in the flist, and return the result
+ * to the process owning that item in the flist */
+void mfu_file_chunk_list_lor(mfu_flist list, const mfu_file_chunk* head, const int* vals, int* results)
+{
     /* get number of ranks */
     int ranks;
     MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
+    /* get a count of how many items are the chunk list */
+    uint64_t list_count = mfu_file_chunk_list_size(head);
+
     /* allocate arrays for alltoall -- one for sending, and one for receiving */
     int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
     int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
     int* recvdisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
     int* senddisps  = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
 
-    /* allocate space for send buffer, we'll send an index value and comparison
-     * flag, both as uint64_t */
-    size_t sendbytes = list_count * 2 * sizeof(uint64_t); 
-    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC(sendbytes);
-
     /* initialize sendcounts array */
-    for (int idx = 0; idx < ranks; idx++) {
-        sendcounts[idx] = 0;
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
     }
 
-    /* Iterate over the list of files. For each file a process needs to report on,
-     * we increment the counter correspoinding to the "owner" of the file. After
-     * going through all files, we then have a count of the number of files we 
-     * will report for each rank */
-    int disp = 0;
-    p = head;
-    for (i = 0; i < list_count; i++) {
-        /* if we have the last byte of the file, we need to send scan result to owner */
-        if (p->offset + p->length >= p->file_size) {
-            /* increment count of items that will be sent to owner */
-            int owner = (int) p->rank_of_owner;
-            sendcounts[owner] += 2;
-
-            /* copy index and flag value to send buffer */
-            uint64_t file_index = p->index_of_owner;
-            uint64_t flag       = (uint64_t) ltr[i];
-            sendbuf[disp    ]   = file_index;
-            sendbuf[disp + 1]   = flag;
-            
-            /* advance to next value in buffer */
-            disp += 2;
-        }
-
-        /* advance to next chunk */
-        p = p->next;
+    /* send the flag of every chunk straight to the owner of its file,
+     * rather than combining flags of the chunks of a file with a scan,
+     * since chunks of a file need not be next to each other in the
+     * list, count the values we send to each owner first */
+    const mfu_file_chunk* p;
+    for (p = head; p != NULL; p = p->next) {
+        int owner = (int) p->rank_of_owner;
+        sendcounts[owner] += 2;
     }
 
     /* compute send buffer displacements */
     senddisps[0] = 0;
-    for (i = 1; i < (uint64_t)ranks; i++) {
+    for (i = 1; i < ranks; i++) {
         senddisps[i] = senddisps[i - 1] + sendcounts[i - 1];
     }
 
+    /* pack an index and flag value for each chunk, ordered by owner */
+    size_t sendbytes = list_count * 2 * sizeof(uint64_t);
+    uint64_t* sendbuf = (uint64_t*) MFU_MALLOC(sendbytes);
+    int* offsets = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = senddisps[i];
+    }
+    uint64_t j = 0;
+    for (p = head; p != NULL; p = p->next) {
+        int owner = (int) p->rank_of_owner;
+        int disp = offsets[owner];
+        sendbuf[disp    ] = p->index_of_owner;
+        sendbuf[disp + 1] = (vals[j] != 0);
+        offsets[owner] += 2;
+        j++;
+    }
+
     /* alltoall to let every process know a count of how much it will be receiving */
     MPI_Alltoall(sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
 
     /* calculate total incoming bytes and displacements for alltoallv */
     int recv_total = recvcounts[0];
     recvdisps[0] = 0;
-    for (i = 1; i < (uint64_t)ranks; i++) {
+    for (i = 1; i < ranks; i++) {
         recv_total += recvcounts[i];
         recvdisps[i] = recvdisps[i - 1] + recvcounts[i - 1];
     }
@@ -555,30 +1050,460 @@ void mfu_file_chunk_list_lor(mfu_flist list, const mfu_file_chunk* head, const i
         recvbuf, recvcounts, recvdisps, MPI_UINT64_T, MPI_COMM_WORLD
     );
 
-    /* unpack contents of recv buffer & store results in strmap */
-    disp = 0;
-    while (disp < recv_total) {
-        /* local store of idx & flag values for each file */
+    /* clear the result of each item we got a flag for,
+     * then OR in the flags of all of its chunks */
+    int disp;
+    for (disp = 0; disp < recv_total; disp += 2) {
+        uint64_t idx = recvbuf[disp];
+        results[idx] = 0;
+    }
+    for (disp = 0; disp < recv_total; disp += 2) {
         uint64_t idx  = recvbuf[disp];
         uint64_t flag = recvbuf[disp + 1];
-
-        /* set value in output array for corresponding item */
-        results[idx] = (int)flag;
-
-        /* go to next id & flag */
-        disp += 2;
+        if (flag) {
+            results[idx] = 1;
+        }
     }
 
     mfu_free(&recvbuf);
     mfu_free(&sendbuf);
+    mfu_free(&offsets);
 
     mfu_free(&sendcounts);
     mfu_free(&recvcounts);
     mfu_free(&recvdisps);
     mfu_free(&senddisps);
 
-    mfu_free(&keys);
-    mfu_free(&ltr);
+    return;
+}
+
+/****************************************
+ * Functions to process a file chunk list
+ ***************************************/
+
+/* message tags used by work stealing */
+#define CHUNK_TAG_REQUEST (1)
+#define CHUNK_TAG_REPLY   (2)
+#define CHUNK_TAG_RESULT  (3)
+
+/* a section of a file queued for processing on this rank,
+ * owner and elem identify the chunk list element on the rank
+ * that must be told the outcome */
+typedef struct {
+    char* name;         /* full path to file */
+    uint64_t offset;    /* starting byte offset of section */
+    uint64_t length;    /* number of bytes in section */
+    uint64_t file_size; /* full size of file */
+    uint64_t owner;     /* rank holding the chunk list element */
+    uint64_t elem;      /* index of element in owner's chunk list */
+    int name_alloc;     /* whether we must free name */
+} chunk_task;
+
+/* double-ended queue of tasks, we process from the front
+ * and thieves take from the back */
+typedef struct {
+    chunk_task* tasks;
+    uint64_t first;
+    uint64_t last;
+    uint64_t capacity;
+} chunk_queue;
+
+/* outstanding non-blocking send and its buffer */
+typedef struct chunk_send_struct {
+    MPI_Request req;
+    void* buf;
+    struct chunk_send_struct* next;
+} chunk_send;
+
+static void chunk_queue_append(chunk_queue* q, const chunk_task* t)
+{
+    /* reset to the start of the array if queue is empty */
+    if (q->first == q->last) {
+        q->first = 0;
+        q->last  = 0;
+    }
+
+    /* grow array if needed */
+    if (q->last == q->capacity) {
+        q->capacity = (q->capacity > 0) ? q->capacity * 2 : 64;
+        q->tasks = (chunk_task*) realloc(q->tasks, q->capacity * sizeof(chunk_task));
+        if (q->tasks == NULL) {
+            MFU_ABORT(-1, "Failed to allocate work queue of %llu tasks",
+                (unsigned long long) q->capacity);
+        }
+    }
+
+    q->tasks[q->last] = *t;
+    q->last++;
+}
+
+/* free any completed sends, or wait on all of them if wait is set */
+static void chunk_sends_reap(chunk_send** phead, int wait)
+{
+    chunk_send* prev = NULL;
+    chunk_send* s = *phead;
+    while (s != NULL) {
+        int flag = 1;
+        if (wait) {
+            MPI_Wait(&s->req, MPI_STATUS_IGNORE);
+        } else {
+            MPI_Test(&s->req, &flag, MPI_STATUS_IGNORE);
+        }
+
+        chunk_send* next = s->next;
+        if (flag) {
+            if (prev == NULL) {
+                *phead = next;
+            } else {
+                prev->next = next;
+            }
+            mfu_free(&s->buf);
+            mfu_free(&s);
+        } else {
+            prev = s;
+        }
+        s = next;
+    }
+}
+
+/* post a non-blocking send of buf, which is freed once the send completes */
+static void chunk_send_post(chunk_send** phead, void* buf, int bytes,
+                            int dest, int tag, MPI_Comm comm)
+{
+    chunk_send* s = (chunk_send*) MFU_MALLOC(sizeof(chunk_send));
+    s->buf  = buf;
+    s->next = *phead;
+    MPI_Isend(buf, bytes, MPI_BYTE, dest, tag, comm, &s->req);
+    *phead = s;
+}
+
+/* answer a steal request from rank thief, we hand over the back
+ * half of our queue, or if we only have one task left, the back
+ * half of its chunks, returns number of tasks given away */
+static uint64_t chunk_serve_steal(chunk_queue* q, uint64_t chunk_size,
+                                  int thief, chunk_send** sends, MPI_Comm comm)
+{
+    /* pick tasks to give away, we may need one extra
+     * to hold the tail of a split task */
+    uint64_t count = q->last - q->first;
+    uint64_t give  = count / 2;
+    chunk_task split;
+    int have_split = 0;
+    if (count == 1) {
+        /* split the remaining task at a chunk boundary if it spans
+         * at least two chunks */
+        chunk_task* t = &q->tasks[q->first];
+        uint64_t chunks = t->length / chunk_size;
+        if (chunks * chunk_size < t->length) {
+            chunks++;
+        }
+        if (chunks >= 2) {
+            uint64_t keep = ((chunks + 1) / 2) * chunk_size;
+            split = *t;
+            split.offset += keep;
+            split.length -= keep;
+            split.name_alloc = 0;
+            t->length = keep;
+            have_split = 1;
+        }
+    }
+
+    /* compute size of reply, a count followed by packed tasks */
+    uint64_t ntasks = give + (uint64_t) have_split;
+    size_t bytes = 8;
+    uint64_t i;
+    for (i = q->last - give; i < q->last; i++) {
+        bytes += strlen(q->tasks[i].name) + 1 + 5 * 8;
+    }
+    if (have_split) {
+        bytes += strlen(split.name) + 1 + 5 * 8;
+    }
+
+    /* pack tasks into reply */
+    char* buf = (char*) MFU_MALLOC(bytes);
+    char* ptr = buf;
+    mfu_pack_uint64(&ptr, ntasks);
+    for (i = 0; i < ntasks; i++) {
+        chunk_task* t = (have_split && i == give) ? &split : &q->tasks[q->last - give + i];
+        strcpy(ptr, t->name);
+        ptr += strlen(t->name) + 1;
+        mfu_pack_uint64(&ptr, t->offset);
+        mfu_pack_uint64(&ptr, t->length);
+        mfu_pack_uint64(&ptr, t->file_size);
+        mfu_pack_uint64(&ptr, t->owner);
+        mfu_pack_uint64(&ptr, t->elem);
+    }
+
+    /* drop tasks we gave away from our queue */
+    for (i = q->last - give; i < q->last; i++) {
+        if (q->tasks[i].name_alloc) {
+            mfu_free(&q->tasks[i].name);
+        }
+    }
+    q->last -= give;
+
+    chunk_send_post(sends, buf, (int) bytes, thief, CHUNK_TAG_REPLY, comm);
+
+    return ntasks;
+}
+
+/* record outcome of a task, result for an element we hold in our
+ * chunk list is applied directly, otherwise sent to its owner,
+ * weight is the amount of work the task represented */
+static void chunk_task_done(const chunk_task* t, uint64_t weight, int flag,
+                            int rank, int* vals, uint64_t* outstanding,
+                            chunk_send** sends, MPI_Comm comm)
+{
+    if (t->owner == (uint64_t) rank) {
+        vals[t->elem] |= flag;
+        *outstanding -= weight;
+    } else {
+        uint64_t* buf = (uint64_t*) MFU_MALLOC(3 * sizeof(uint64_t));
+        buf[0] = t->elem;
+        buf[1] = (uint64_t) flag;
+        buf[2] = weight;
+        chunk_send_post(sends, buf, (int)(3 * sizeof(uint64_t)),
+                        (int) t->owner, CHUNK_TAG_RESULT, comm);
+    }
+}
+
+/* handle any incoming steal requests and results,
+ * if serve is 0, we reply to all requests with no work */
+static void chunk_poll(chunk_queue* q, uint64_t chunk_size, int serve,
+                       int* vals, uint64_t* outstanding, uint64_t* given,
+                       chunk_send** sends, MPI_Comm comm)
+{
+    int flag;
+    MPI_Status st;
+
+    /* apply results for our chunks that others processed */
+    MPI_Iprobe(MPI_ANY_SOURCE, CHUNK_TAG_RESULT, comm, &flag, &st);
+    while (flag) {
+        uint64_t res[3];
+        MPI_Recv(res, (int)(3 * sizeof(uint64_t)), MPI_BYTE, st.MPI_SOURCE,
+                 CHUNK_TAG_RESULT, comm, MPI_STATUS_IGNORE);
+        vals[res[0]] |= (int) res[1];
+        *outstanding -= res[2];
+        MPI_Iprobe(MPI_ANY_SOURCE, CHUNK_TAG_RESULT, comm, &flag, &st);
+    }
+
+    /* give work to idle ranks */
+    MPI_Iprobe(MPI_ANY_SOURCE, CHUNK_TAG_REQUEST, comm, &flag, &st);
+    while (flag) {
+        int dummy;
+        MPI_Recv(&dummy, (int) sizeof(int), MPI_BYTE, st.MPI_SOURCE,
+                 CHUNK_TAG_REQUEST, comm, MPI_STATUS_IGNORE);
+        if (serve) {
+            *given += chunk_serve_steal(q, chunk_size, st.MPI_SOURCE, sends, comm);
+        } else {
+            uint64_t* buf = (uint64_t*) MFU_MALLOC(sizeof(uint64_t));
+            *buf = 0;
+            chunk_send_post(sends, buf, (int) sizeof(uint64_t),
+                            st.MPI_SOURCE, CHUNK_TAG_REPLY, comm);
+        }
+        MPI_Iprobe(MPI_ANY_SOURCE, CHUNK_TAG_REQUEST, comm, &flag, &st);
+    }
+
+    /* free buffers of completed sends */
+    chunk_sends_reap(sends, 0);
+}
+
+/* check for reply to our steal request, append any tasks
+ * to our queue, returns 1 if a reply was received */
+static int chunk_recv_reply(chunk_queue* q, int victim, uint64_t* taken, MPI_Comm comm)
+{
+    int flag;
+    MPI_Status st;
+    MPI_Iprobe(victim, CHUNK_TAG_REPLY, comm, &flag, &st);
+    if (! flag) {
+        return 0;
+    }
+
+    int bytes;
+    MPI_Get_count(&st, MPI_BYTE, &bytes);
+    char* buf = (char*) MFU_MALLOC((size_t) bytes);
+    MPI_Recv(buf, bytes, MPI_BYTE, victim, CHUNK_TAG_REPLY, comm, MPI_STATUS_IGNORE);
+
+    /* unpack tasks */
+    const char* ptr = buf;
+    uint64_t ntasks, i;
+    mfu_unpack_uint64(&ptr, &ntasks);
+    for (i = 0; i < ntasks; i++) {
+        chunk_task t;
+        t.name = MFU_STRDUP(ptr);
+        t.name_alloc = 1;
+        ptr += strlen(ptr) + 1;
+        mfu_unpack_uint64(&ptr, &t.offset);
+        mfu_unpack_uint64(&ptr, &t.length);
+        mfu_unpack_uint64(&ptr, &t.file_size);
+        mfu_unpack_uint64(&ptr, &t.owner);
+        mfu_unpack_uint64(&ptr, &t.elem);
+        chunk_queue_append(q, &t);
+    }
+    *taken += ntasks;
+
+    mfu_free(&buf);
+    return 1;
+}
+
+/* invoke fn on each section in the chunk list, setting vals[i] to 1
+ * if fn fails on any part of element i, or to the OR of the masks fn
+ * returns for its parts if it returns masks, when dynamic is set, ranks
+ * that run out of work steal sections from other ranks until all
+ * sections everywhere have been processed */
+void mfu_file_chunk_list_execute(const mfu_file_chunk* head, uint64_t chunk_size,
+                                 int dynamic, mfu_file_chunk_fn fn, void* arg, int* vals)
+{
+    /* get our rank and number of ranks */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* assume each chunk will succeed */
+    uint64_t list_count = mfu_file_chunk_list_size(head);
+    uint64_t i;
+    for (i = 0; i < list_count; i++) {
+        vals[i] = 0;
+    }
+
+/* work stealing needs non-blocking barrier for termination */
+#if MPI_VERSION < 3
+    dynamic = 0;
+#endif
+
+    /* with one rank or without dynamic mode, just run our list in order */
+    if (! dynamic || ranks == 1) {
+        const mfu_file_chunk* p = head;
+        for (i = 0; i < list_count; i++) {
+            int ret = (*fn)(p->name, p->offset, p->length, p->file_size, arg);
+            vals[i] = (ret < 0) ? 1 : ret;
+            p = p->next;
+        }
+        return;
+    }
+
+#if MPI_VERSION >= 3
+    /* use our own communicator to keep our messages separate */
+    MPI_Comm comm;
+    MPI_Comm_dup(MPI_COMM_WORLD, &comm);
+
+    /* queue up our own chunks, we track the amount of work that
+     * remains on our chunks, counting an empty file as one byte */
+    chunk_queue q;
+    q.tasks    = NULL;
+    q.first    = 0;
+    q.last     = 0;
+    q.capacity = 0;
+    uint64_t outstanding = 0;
+    const mfu_file_chunk* p = head;
+    for (i = 0; i < list_count; i++) {
+        chunk_task t;
+        t.name       = (char*) p->name;
+        t.offset     = p->offset;
+        t.length     = p->length;
+        t.file_size  = p->file_size;
+        t.owner      = (uint64_t) rank;
+        t.elem       = i;
+        t.name_alloc = 0;
+        chunk_queue_append(&q, &t);
+        outstanding += (p->length > 0) ? p->length : 1;
+        p = p->next;
+    }
+
+    /* seed victim selection differently on each rank */
+    uint64_t seed = (uint64_t) rank * 2654435761ULL + 1;
+
+    chunk_send* sends = NULL;
+    int victim = MPI_PROC_NULL;
+    int done_sent = 0;
+    MPI_Request done_req = MPI_REQUEST_NULL;
+    uint64_t given = 0;
+    uint64_t taken = 0;
+
+    int done = 0;
+    while (! done) {
+        chunk_poll(&q, chunk_size, 1, vals, &outstanding, &given, &sends, comm);
+
+        if (q.first < q.last) {
+            /* process up to one chunk of the task at the front,
+             * so that we keep servicing requests on large tasks */
+            chunk_task* t = &q.tasks[q.first];
+            uint64_t len = t->length;
+            if (len > chunk_size) {
+                len = chunk_size;
+            }
+            int ret = (*fn)(t->name, t->offset, len, t->file_size, arg);
+            int flag = (ret < 0) ? 1 : ret;
+
+            /* an empty file is treated as a one byte task */
+            uint64_t weight = (t->length > 0) ? len : 1;
+            chunk_task_done(t, weight, flag, rank, vals, &outstanding, &sends, comm);
+
+            t->offset += len;
+            t->length -= len;
+            if (t->length == 0) {
+                if (t->name_alloc) {
+                    mfu_free(&t->name);
+                }
+                q.first++;
+            }
+            continue;
+        }
+
+        /* once all work on our chunks is accounted for, signal
+         * that we're finished, we keep stealing until everyone is */
+        if (outstanding == 0 && ! done_sent) {
+            MPI_Ibarrier(comm, &done_req);
+            done_sent = 1;
+        }
+
+        /* ask a random rank for work if we don't have a request out */
+        if (victim == MPI_PROC_NULL) {
+            seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+            victim = (int)((uint64_t) rank + 1 + (seed >> 33) % (uint64_t)(ranks - 1)) % ranks;
+            int* buf = (int*) MFU_MALLOC(sizeof(int));
+            *buf = 0;
+            chunk_send_post(&sends, buf, (int) sizeof(int), victim, CHUNK_TAG_REQUEST, comm);
+        } else if (chunk_recv_reply(&q, victim, &taken, comm)) {
+            victim = MPI_PROC_NULL;
+        }
+
+        /* all ranks have finished once the barrier completes */
+        if (done_sent) {
+            MPI_Test(&done_req, &done, MPI_STATUS_IGNORE);
+        }
+    }
+
+    /* wait for reply to any outstanding steal request, turning
+     * away requests from others, then a second barrier ensures
+     * all requests have been answered before we free the comm */
+    while (victim != MPI_PROC_NULL) {
+        chunk_poll(&q, chunk_size, 0, vals, &outstanding, &given, &sends, comm);
+        if (chunk_recv_reply(&q, victim, &taken, comm)) {
+            victim = MPI_PROC_NULL;
+        }
+    }
+    MPI_Ibarrier(comm, &done_req);
+    done = 0;
+    while (! done) {
+        chunk_poll(&q, chunk_size, 0, vals, &outstanding, &given, &sends, comm);
+        MPI_Test(&done_req, &done, MPI_STATUS_IGNORE);
+    }
+    chunk_sends_reap(&sends, 1);
+
+    /* report how much work moved between ranks */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE) {
+        uint64_t total_taken;
+        MPI_Reduce(&taken, &total_taken, 1, MPI_UINT64_T, MPI_SUM, 0, comm);
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Work stealing moved %llu file sections between processes",
+                (unsigned long long) total_taken);
+        }
+    }
+
+    mfu_free(&q.tasks);
+    MPI_Comm_free(&comm);
+#endif
 
     return;
 }
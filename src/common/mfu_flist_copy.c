@@ -36,7 +36,9 @@
 #include <sys/param.h>
 
 #include <linux/fs.h>
-#include <linux/fiemap.h>
+
+/* for asynchronous read/write pipeline */
+#include <aio.h>
 
 /* define PRI64 */
 #include <inttypes.h>
@@ -67,19 +69,97 @@ typedef struct {
     int64_t  total_links;        /* sum of all symlinks */
     int64_t  total_size;         /* sum of all file sizes */
     int64_t  total_bytes_copied; /* total bytes written */
+    int64_t  total_bytes_cloned; /* bytes shared with FICLONERANGE */
+    int64_t  total_bytes_ranged; /* bytes transferred with copy_file_range */
+    int64_t  total_bytes_direct; /* bytes read and written with O_DIRECT */
+    int64_t  total_bytes_prealloc; /* bytes allocated with fallocate before copying */
+    int64_t  total_bytes_verified; /* bytes read back from the destination to verify */
+    int64_t  total_files_recopied; /* files copied again after failing verification */
+    uint64_t peak_dirty;         /* most dirty page cache seen on this node */
+    double   wtime_dirty;        /* time when dirty page cache was last sampled */
     time_t   time_started;       /* time when dcp command started */
     time_t   time_ended;         /* time when dcp command ended */
     double   wtime_started;      /* time when dcp command started */
     double   wtime_ended;        /* time when dcp command ended */
 } mfu_copy_stats_t;
 
-/* cache open file descriptor to avoid
- * opening / closing the same file */
+/* bits recorded in the hints of files in our open file cache */
+#define MFU_COPY_HINT_NO_CLONE  (1) /* FICLONERANGE failed on this file */
+#define MFU_COPY_HINT_NO_RANGE  (2) /* copy_file_range failed on this file */
+#define MFU_COPY_HINT_GROUPLOCK (4) /* already requested Lustre grouplock */
+#define MFU_COPY_HINT_DIRECT    (8) /* O_DIRECT is set on this file */
+#define MFU_COPY_HINT_NO_DIRECT (16) /* direct I/O is not possible on this file */
+
+/* alignment of our I/O buffers in memory */
+#define MFU_COPY_BUF_ALIGN (1024 * 1024)
+
+/* number of parent directories each process keeps open, enough to
+ * hold the source and destination paths of a deep tree while a
+ * process moves around in it */
+#define MFU_COPY_DIR_FDS (64)
+
+/* states of a buffer in the asynchronous copy pipeline */
+enum {
+    MFU_COPY_SLOT_IDLE = 0,  /* buffer is free */
+    MFU_COPY_SLOT_READING,   /* read into buffer is in flight */
+    MFU_COPY_SLOT_FULL,      /* buffer holds data waiting to be written */
+    MFU_COPY_SLOT_WRITING,   /* write from buffer is in flight */
+};
+
+/* one buffer in the asynchronous copy pipeline */
+typedef struct {
+    struct aiocb cb; /* control block of outstanding operation */
+    char*  buf;      /* block_size buffer */
+    int    state;    /* one of MFU_COPY_SLOT_* */
+    off_t  pos;      /* file offset of the first byte of buffer */
+    size_t bytes;    /* number of bytes to read into buffer */
+    size_t nread;    /* number of bytes read into buffer */
+    size_t done;     /* bytes of the current read or write already done */
+} mfu_copy_slot_t;
+
+/* CRC32C of a section of a source file, recorded while copying
+ * when a manifest is requested */
+typedef struct {
+    char* name;      /* source path, NULL for blocks of the current chunk */
+    uint64_t offset; /* starting byte offset of section */
+    uint64_t length; /* number of bytes in section */
+    uint32_t crc;    /* CRC32C of section */
+} mfu_copy_sum_t;
+
+/* growable array of checksummed sections */
+typedef struct {
+    mfu_copy_sum_t* sums;
+    uint64_t count;
+    uint64_t capacity;
+} mfu_copy_sum_list_t;
+
+/* journal of chunks this process has copied, records wait in buf
+ * until the data they describe is flushed to the destination */
+typedef struct {
+    int fd;            /* journal file of this process, -1 if not journaling */
+    int sync_fd;       /* open descriptor in destination file system, -1 if none */
+    char* buf;         /* packed records not yet written */
+    size_t size;       /* number of bytes in buf */
+    size_t capacity;   /* number of bytes allocated for buf */
+    double last_flush; /* time records were last written */
+} mfu_copy_journal_t;
+
+/* chunk recorded in the journal of an earlier run */
+typedef struct {
+    const char* name;    /* source path */
+    uint64_t offset;     /* starting byte offset of chunk */
+    uint64_t length;     /* number of bytes in chunk */
+    uint64_t file_size;  /* size of source file when copied */
+    uint64_t mtime;      /* mtime of source file when copied */
+    uint64_t mtime_nsec;
+} mfu_copy_jrec_t;
+
+/* sections of files in a list that an earlier run finished copying,
+ * as (index, offset, length) triples sorted by index and offset */
 typedef struct {
-    char* name; /* name of open file (NULL if none) */
-    int   read; /* whether file is open for read-only (1) or write (0) */
-    int   fd;   /* file descriptor */
-} mfu_copy_file_cache_t;
+    uint64_t* ranges;
+    uint64_t count;
+} mfu_copy_done_t;
 
 /****************************************
  * Define globals
@@ -88,1865 +168,4912 @@ typedef struct {
 /** Where we should keep statistics related to this file copy. */
 static mfu_copy_stats_t mfu_copy_stats;
 
-/** Cache most recent open file descriptor to avoid opening / closing the same file */
-static mfu_copy_file_cache_t mfu_copy_src_cache;
-static mfu_copy_file_cache_t mfu_copy_dst_cache;
-
-static int mfu_copy_open_file(const char* file, int read_flag,
-        mfu_copy_file_cache_t* cache, mfu_copy_opts_t* mfu_copy_opts)
+/** Cache recently used file descriptors to avoid opening / closing the same file */
+static mfu_fdcache* mfu_copy_fd_cache;
+
+/** Cache of source and destination parent directories, so that items
+ * are created, opened, and updated by name within their directory
+ * rather than by full path, NULL when not copying */
+static mfu_fdcache* mfu_copy_dir_cache;
+
+/** Buffers for asynchronous copy, allocated when io_depth > 1 */
+static mfu_copy_slot_t* mfu_copy_slots;
+static int mfu_copy_slot_count;
+
+/** Checksums of blocks in the chunk being copied, and of the chunks
+ * this process has copied, kept when writing a manifest */
+static mfu_copy_sum_list_t mfu_copy_blocks;
+static mfu_copy_sum_list_t mfu_copy_sums;
+
+/** Write-behind of copied data when dropping it from the page cache */
+static mfu_writebehind mfu_copy_wb;
+
+/** Set once fallocate fails because the file system does not support it */
+static int mfu_copy_prealloc_unsupported;
+
+/** Journal of copied chunks, and records loaded from the journals of
+ * an earlier run, held on the rank picked by hashing each file name */
+static mfu_copy_journal_t mfu_copy_journal = {-1, -1, NULL, 0, 0, 0.0};
+static mfu_copy_jrec_t* mfu_copy_resume_recs;
+static uint64_t mfu_copy_resume_count;
+static char* mfu_copy_resume_buf;
+
+/** Destinations of the copy in progress and the copy_into_dir flag of
+ * each, file data read from the source is written to all of them */
+static int mfu_copy_ndests = 1;
+static const mfu_param_path* mfu_copy_dests;
+static const int* mfu_copy_dests_into;
+
+/** copy_into_dir flag of each destination, the first may be replaced
+ * by the flag recorded by the run being resumed, and the flag the
+ * caller had in its options, which is put back when the copy ends */
+static int mfu_copy_into[MFU_COPY_MAX_DESTS];
+static int mfu_copy_into_caller;
+
+/** Settings in effect for the copy in progress, which start from the
+ * caller's options and are adjusted in mfu_copy_begin, so that options
+ * reused across copies are left as the caller set them */
+static bool mfu_copy_fused;
+static mfu_copy_offload_t mfu_copy_offload = MFU_COPY_OFFLOAD_NONE;
+
+/* point mfu_copy_opts at destination d and return its path */
+static const mfu_param_path* mfu_copy_use_dest(int d, mfu_copy_opts_t* mfu_copy_opts)
 {
-    int newfd = -1;
+    mfu_copy_opts->copy_into_dir = mfu_copy_dests_into[d];
+    return &mfu_copy_dests[d];
+}
 
-    /* see if we have a cached file descriptor */
-    char* name = cache->name;
-    if (name != NULL) {
-        /* we have a cached file descriptor */
-        int fd = cache->fd;
-        if (strcmp(name, file) == 0 && cache->read == read_flag) {
-            /* the file we're trying to open matches name and read/write mode,
-             * so just return the cached descriptor */
-            return fd;
-        } else {
-            /* the file we're trying to open is different,
-             * close the old file and delete the name */
-            mfu_close(name, fd);
-            mfu_free(&cache->name);
-        }
+/* return descriptor of the parent directory of path from our cache
+ * and set base to the name of path within it, or return AT_FDCWD
+ * and set base to path if we have no descriptor for the parent */
+static int mfu_copy_parent_fd(const char* path, const char** base)
+{
+    if (mfu_copy_dir_cache == NULL) {
+        *base = path;
+        return AT_FDCWD;
     }
+    return mfu_fdcache_parent(mfu_copy_dir_cache, path, base);
+}
 
-    /* open the new file */
+/* open file for reading or writing through our file cache,
+ * returns NULL with errno set on error */
+static mfu_fdcache_entry* mfu_copy_open_file(const char* file, int read_flag,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* determine flags to open file with */
+    int flags;
     if (read_flag) {
-        int flags = O_RDONLY;
-        if (mfu_copy_opts->synchronous) {
-            flags |= O_DIRECT;
-        }
-        newfd = mfu_open(file, flags);
+        flags = O_RDONLY;
     } else {
-        int flags = O_WRONLY | O_CREAT;
-        if (mfu_copy_opts->synchronous) {
-            flags |= O_DIRECT;
-        }
-        newfd = mfu_open(file, flags, DCOPY_DEF_PERMS_FILE);
+        flags = O_WRONLY | O_CREAT;
+    }
+
+    /* get an open descriptor, from cache if we have it */
+    mfu_fdcache_entry* e = mfu_fdcache_open(mfu_copy_fd_cache, file, flags, DCOPY_DEF_PERMS_FILE);
+    if (e == NULL) {
+        return NULL;
     }
 
-    /* cache the file descriptor */
-    if (newfd != -1) {
-        cache->name = MFU_STRDUP(file);
-        cache->fd   = newfd;
-        cache->read = read_flag;
 #ifdef LUSTRE_SUPPORT
-        /* Zero is an invalid ID for grouplock. */
-        if (mfu_copy_opts->grouplock_id != 0) {
-            errno = 0;
-            int rc = ioctl(newfd, LL_IOC_GROUP_LOCK, mfu_copy_opts->grouplock_id);
-            if (rc) {
-                MFU_LOG(MFU_LOG_ERR, "Failed to obtain grouplock with ID %d "
-                    "on file `%s', ignoring this error (errno=%d %s)",
-                    mfu_copy_opts->grouplock_id, file, errno, strerror(errno));
-            } else {
-                MFU_LOG(MFU_LOG_INFO, "Obtained grouplock with ID %d "
-                    "on file `%s', fd %d", mfu_copy_opts->grouplock_id,
-                    file, newfd);
-            }
+    /* Zero is an invalid ID for grouplock. */
+    if (mfu_copy_opts->grouplock_id != 0 && !(e->hints & MFU_COPY_HINT_GROUPLOCK)) {
+        e->hints |= MFU_COPY_HINT_GROUPLOCK;
+        errno = 0;
+        int rc = ioctl(e->fd, LL_IOC_GROUP_LOCK, mfu_copy_opts->grouplock_id);
+        if (rc) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to obtain grouplock with ID %d "
+                "on file `%s', ignoring this error (errno=%d %s)",
+                mfu_copy_opts->grouplock_id, file, errno, strerror(errno));
+        } else {
+            MFU_LOG(MFU_LOG_INFO, "Obtained grouplock with ID %d "
+                "on file `%s', fd %d", mfu_copy_opts->grouplock_id,
+                file, e->fd);
         }
-#endif
     }
+#endif
 
-    return newfd;
+    return e;
 }
 
-/* copy all extended attributes from op->operand to dest_path,
- * returns 0 on success and -1 on failure */
-static int mfu_copy_xattrs(
-    mfu_flist flist,
-    uint64_t idx,
-    const char* dest_path)
+/* turn O_DIRECT on or off for a file in our cache,
+ * returns 0 on success and -1 with errno set on error */
+static int mfu_copy_set_direct(mfu_fdcache_entry* e, int direct)
 {
-    /* assume that we'll succeed */
-    int rc = 0;
+    int on = (e->hints & MFU_COPY_HINT_DIRECT) ? 1 : 0;
+    if (on == direct) {
+        return 0;
+    }
 
-#if DCOPY_USE_XATTRS
-    /* get source file name */
-    const char* src_path = mfu_flist_file_get_name(flist, idx);
+    int flags = fcntl(e->fd, F_GETFL);
+    if (flags < 0) {
+        return -1;
+    }
+    if (direct) {
+        flags |= O_DIRECT;
+    } else {
+        flags &= ~O_DIRECT;
+    }
+    if (fcntl(e->fd, F_SETFL, flags) < 0) {
+        return -1;
+    }
 
-    /* start with a reasonable buffer, we'll allocate more as needed */
-    size_t list_bufsize = 1204;
-    char* list = (char*) MFU_MALLOC(list_bufsize);
+    e->hints ^= MFU_COPY_HINT_DIRECT;
+    return 0;
+}
 
-    /* get list, if list_size == ERANGE, try again */
-    ssize_t list_size;
-    int got_list = 0;
+/* return alignment of file offsets and lengths needed to copy between
+ * two files with direct I/O through our buffers, or 0 if direct I/O
+ * cannot be used, in which case we mark the files to not ask again */
+static size_t mfu_copy_direct_align(mfu_fdcache_entry* in_file,
+        mfu_fdcache_entry* out_file, mfu_copy_opts_t* mfu_copy_opts)
+{
+    if ((in_file->hints | out_file->hints) & MFU_COPY_HINT_NO_DIRECT) {
+        return 0;
+    }
 
-    /* get current estimate for list size */
-    while(! got_list) {
-        errno = 0;
-        list_size = llistxattr(src_path, list, list_bufsize);
+    size_t align = 0;
+    size_t in_mem, in_offset, out_mem, out_offset;
+    if (mfu_dio_align(in_file->fd, &in_mem, &in_offset) == 0 &&
+        mfu_dio_align(out_file->fd, &out_mem, &out_offset) == 0)
+    {
+        size_t mem = (in_mem > out_mem) ? in_mem : out_mem;
+        align = (in_offset > out_offset) ? in_offset : out_offset;
 
-        if(list_size < 0) {
-            if(errno == ERANGE) {
-                /* buffer is too small, free our current buffer
-                 * and call it again with size==0 to get new size */
-                mfu_free(&list);
-                list_bufsize = 0;
-            }
-            else if(errno == ENOTSUP) {
-                /* this is common enough that we silently ignore it */
-                break;
-            }
-            else {
-                /* this is a real error */
-                MFU_LOG(MFU_LOG_ERR, "Failed to get list of extended attributes on `%s' llistxattr() (errno=%d %s)",
-                    src_path, errno, strerror(errno)
-                   );
-                rc = -1;
-                break;
-            }
-        }
-        else {
-            if(list_size > 0 && list_bufsize == 0) {
-                /* called llistxattr with size==0 and got back positive
-                 * number indicating size of buffer we need to allocate */
-                list_bufsize = (size_t) list_size;
-                list = (char*) MFU_MALLOC(list_bufsize);
-            }
-            else {
-                /* got our list, it's size is in list_size, which may be 0 */
-                got_list = 1;
-            }
+        /* each transfer of the aligned part is a whole number
+         * of blocks read into one of our buffers */
+        if (mem > MFU_COPY_BUF_ALIGN || mfu_copy_opts->block_size % align != 0) {
+            align = 0;
         }
     }
 
-    /* iterate over list and copy values to new object lgetxattr/lsetxattr */
-    if(got_list) {
-        char* name = list;
+    if (align == 0) {
+        MFU_LOG(MFU_LOG_DBG, "Cannot use direct I/O from `%s' to `%s', using buffered I/O",
+            in_file->name, out_file->name);
+        in_file->hints  |= MFU_COPY_HINT_NO_DIRECT;
+        out_file->hints |= MFU_COPY_HINT_NO_DIRECT;
+    }
+    return align;
+}
 
-        while(name < list + list_size) {
-            /* start with a reasonable buffer,
-             * allocate something bigger as needed */
-            size_t val_bufsize = 1024;
-            void* val = (void*) MFU_MALLOC(val_bufsize);
+/* report hit rate of our open file and directory caches */
+static void mfu_copy_print_fd_cache(void)
+{
+    mfu_pool_stats pool;
+    mfu_pool_get_stats(&pool);
+
+    uint64_t values[10], sums[10];
+    values[0] = mfu_copy_fd_cache->hits;
+    values[1] = mfu_copy_fd_cache->misses;
+    values[2] = mfu_copy_fd_cache->evictions;
+    values[3] = mfu_copy_dir_cache->hits;
+    values[4] = mfu_copy_dir_cache->misses;
+    values[5] = mfu_copy_dir_cache->evictions;
+    values[6] = pool.maps;
+    values[7] = pool.reuses;
+    values[8] = pool.bytes_mapped;
+    values[9] = pool.bytes_hugetlb;
+    MPI_Reduce(values, sums, 10, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
 
-            /* lookup value for name */
-            ssize_t val_size;
-            int got_val = 0;
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Open file cache: %llu hits, %llu misses, %llu evictions (%d files per process)",
+            (unsigned long long) sums[0], (unsigned long long) sums[1],
+            (unsigned long long) sums[2], mfu_copy_fd_cache->size);
+        MFU_LOG(MFU_LOG_INFO, "Directory cache: %llu hits, %llu misses, %llu evictions (%d directories per process)",
+            (unsigned long long) sums[3], (unsigned long long) sums[4],
+            (unsigned long long) sums[5], mfu_copy_dir_cache->size);
+
+        double mapped_tmp, huge_tmp;
+        const char* mapped_units;
+        const char* huge_units;
+        mfu_format_bytes(sums[8], &mapped_tmp, &mapped_units);
+        mfu_format_bytes(sums[9], &huge_tmp, &huge_units);
+        MFU_LOG(MFU_LOG_INFO, "Buffer pool: %llu buffers mapped (%.3lf %s, %.3lf %s in reserved huge pages), %llu reused",
+            (unsigned long long) sums[6], mapped_tmp, mapped_units,
+            huge_tmp, huge_units, (unsigned long long) sums[7]);
+    }
+}
 
-            while(! got_val) {
-                errno = 0;
-                val_size = lgetxattr(src_path, name, val, val_bufsize);
+/****************************************
+ * Journal of copied chunks
+ ***************************************/
 
-                if(val_size < 0) {
-                    if(errno == ERANGE) {
-                        /* buffer is too small, free our current buffer
-                         * and call it again with size==0 to get new size */
-                        mfu_free(&val);
-                        val_bufsize = 0;
-                    }
-                    else if(errno == ENOATTR) {
-                        /* source object no longer has this attribute,
-                         * maybe deleted out from under us, ignore but print warning */
-                        MFU_LOG(MFU_LOG_WARN, "Attribute does not exist for name=%s on `%s' llistxattr() (errno=%d %s)",
-                            name, src_path, errno, strerror(errno)
-                           );
-                        break;
-                    }
-                    else {
-                        /* this is a real error */
-                        MFU_LOG(MFU_LOG_ERR, "Failed to get value for name=%s on `%s' llistxattr() (errno=%d %s)",
-                            name, src_path, errno, strerror(errno)
-                           );
-                        rc = -1;
-                        break;
-                    }
-                }
-                else {
-                    if(val_size > 0 && val_bufsize == 0) {
-                        /* called lgetxattr with size==0 and got back positive
-                         * number indicating size of buffer we need to allocate */
-                        val_bufsize = (size_t) val_size;
-                        val = (void*) MFU_MALLOC(val_bufsize);
-                    }
-                    else {
-                        /* got our value, it's size is in val_size, which may be 0 */
-                        got_val = 1;
-                    }
-                }
-            }
+/* bytes in a packed journal record before the file name:
+ * offset, length, file size, mtime, mtime_nsec, and name length */
+#define MFU_COPY_JREC_HEADER (5 * 8 + 4)
 
-            /* set attribute on destination object */
-            if(got_val) {
-                errno = 0;
-                int setrc = lsetxattr(dest_path, name, val, (size_t) val_size, 0);
-                if(setrc != 0) {
-                    /* failed to set attribute */
-                    MFU_LOG(MFU_LOG_ERR, "Failed to set value for name=%s on `%s' llistxattr() (errno=%d %s)",
-                        name, dest_path, errno, strerror(errno)
-                       );
-                    rc = -1;
-                }
-            }
+/* rank that holds journal records and checksums for the named file */
+static int mfu_copy_name_rank(const char* name, int ranks)
+{
+    uint32_t hash = mfu_hash_jenkins(name, strlen(name));
+    return (int)(hash % (uint32_t)ranks);
+}
 
-            /* free value string */
-            mfu_free(&val);
-            val_bufsize = 0;
+/* map items to the rank their name hashes to */
+static int mfu_copy_name_map(mfu_flist flist, uint64_t idx, int ranks, const void* args)
+{
+    const char* name = mfu_flist_file_get_name(flist, idx);
+    return mfu_copy_name_rank(name, ranks);
+}
 
-            /* jump to next name */
-            size_t namelen = strlen(name) + 1;
-            name += namelen;
-        }
+/* given packed records in sendbuf ordered by destination rank with
+ * sendcounts bytes for each rank, send them and return a buffer
+ * holding the bytes we receive, which the caller frees, sets
+ * recvcounts to the bytes received from each rank and recvtotal
+ * to their sum */
+static char* mfu_copy_exchange(const char* sendbuf, const int* sendcounts,
+        int* recvcounts, int* recvtotal)
+{
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    int* senddisps = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvdisps = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+
+    MPI_Alltoall((void*)sendcounts, 1, MPI_INT, recvcounts, 1, MPI_INT, MPI_COMM_WORLD);
+
+    int i;
+    int sendtotal = 0;
+    int total = 0;
+    for (i = 0; i < ranks; i++) {
+        senddisps[i] = sendtotal;
+        sendtotal += sendcounts[i];
+        recvdisps[i] = total;
+        total += recvcounts[i];
     }
 
-    /* free space allocated for list */
-    mfu_free(&list);
-    list_bufsize = 0;
+    char* recvbuf = (char*) MFU_MALLOC((size_t)total + 1);
+    MPI_Alltoallv(
+        (void*)sendbuf, (int*)sendcounts, senddisps, MPI_BYTE,
+        recvbuf, recvcounts, recvdisps, MPI_BYTE, MPI_COMM_WORLD
+    );
 
-#endif /* DCOPY_USE_XATTR */
+    mfu_free(&recvdisps);
+    mfu_free(&senddisps);
 
-    return rc;
+    *recvtotal = total;
+    return recvbuf;
 }
 
-static int mfu_copy_ownership(
-    mfu_flist flist,
-    uint64_t idx,
-    const char* dest_path)
+/* return name of journal file for the given rank, or of the file
+ * describing the copy for a rank of -1 */
+static char* mfu_copy_journal_name(const char* prefix, int rank)
 {
-    /* assume we'll succeed */
-    int rc = 0;
-
-    /* get user id and group id of file */
-    uid_t uid = (uid_t) mfu_flist_file_get_uid(flist, idx);
-    gid_t gid = (gid_t) mfu_flist_file_get_gid(flist, idx);
+    size_t len = strlen(prefix) + 16;
+    char* name = (char*) MFU_MALLOC(len);
+    if (rank < 0) {
+        snprintf(name, len, "%s.info", prefix);
+    } else {
+        snprintf(name, len, "%s.%d", prefix, rank);
+    }
+    return name;
+}
 
-    /* note that we use lchown to change ownership of link itself, it path happens to be a link */
-    if(mfu_lchown(dest_path, uid, gid) != 0) {
-        /* TODO: are there other EPERM conditions we do want to report? */
+/* parse one packed journal record at ptr with left bytes remaining,
+ * returns the size of the record, or 0 if the rest of the buffer
+ * does not hold a whole record, e.g., if a write was cut short */
+static size_t mfu_copy_jrec_unpack(const char* ptr, size_t left, mfu_copy_jrec_t* rec)
+{
+    if (left < MFU_COPY_JREC_HEADER) {
+        return 0;
+    }
 
-        /* since the user running dcp may not be the owner of the
-         * file, we could hit an EPERM error here, and the file
-         * will be left with the effective uid and gid of the dcp
-         * process, don't bother reporting an error for that case */
-        if (errno != EPERM) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to change ownership on `%s' lchown() (errno=%d %s)",
-                dest_path, errno, strerror(errno)
-               );
-        }
-        rc = -1;
+    const char* p = ptr;
+    uint32_t name_len;
+    mfu_unpack_uint64(&p, &rec->offset);
+    mfu_unpack_uint64(&p, &rec->length);
+    mfu_unpack_uint64(&p, &rec->file_size);
+    mfu_unpack_uint64(&p, &rec->mtime);
+    mfu_unpack_uint64(&p, &rec->mtime_nsec);
+    mfu_unpack_uint32(&p, &name_len);
+
+    /* names are stored with their terminating NUL */
+    if (name_len == 0 || left - MFU_COPY_JREC_HEADER < (size_t) name_len ||
+        p[name_len - 1] != '\0')
+    {
+        return 0;
     }
+    rec->name = p;
 
-    return rc;
+    return MFU_COPY_JREC_HEADER + (size_t) name_len;
 }
 
-/* TODO: condionally set setuid and setgid bits? */
-static int mfu_copy_permissions(
-    mfu_flist flist,
-    uint64_t idx,
-    const char* dest_path)
+/* order journal records by file name and then by offset */
+static int mfu_copy_jrec_cmp(const void* a, const void* b)
 {
-    /* assume we'll succeed */
-    int rc = 0;
-
-    /* get mode and type */
-    mfu_filetype type = mfu_flist_file_get_type(flist, idx);
-    mode_t mode = (mode_t) mfu_flist_file_get_mode(flist, idx);
-
-    /* change mode */
-    if(type != MFU_TYPE_LINK) {
-        if(mfu_chmod(dest_path, mode) != 0) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' chmod() (errno=%d %s)",
-                dest_path, errno, strerror(errno)
-               );
-            rc = -1;
-        }
+    const mfu_copy_jrec_t* ra = (const mfu_copy_jrec_t*) a;
+    const mfu_copy_jrec_t* rb = (const mfu_copy_jrec_t*) b;
+    int rc = strcmp(ra->name, rb->name);
+    if (rc != 0) {
+        return rc;
     }
-
-    return rc;
+    if (ra->offset != rb->offset) {
+        return (ra->offset < rb->offset) ? -1 : 1;
+    }
+    return 0;
 }
 
-/* copy GPFS ACLs from source to destination */
-static int mfu_copy_acls(
-    mfu_flist flist,
-    uint64_t idx,
-    const char* dest_path)
+/* read journals left by an earlier run, which may have used a
+ * different number of processes, and send each record to the rank
+ * picked by hashing its file name, returns 0 on success and -1 on error */
+static int mfu_copy_resume_load(mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* assume we'll succeed */
     int rc = 0;
 
-#ifdef GPFS_SUPPORT
-    /* get type */
-    mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* copy ACLs unless item is a link */
-    if(type != MFU_TYPE_LINK) {
-         /* if we have GPFS support enabled, then we'll use the GPFS API to read
-          * the ACL from the src_path and write to the dest_path.
-          * We use the opaque method as we are not trying to alter the ACL contents.
-          * Note that if the source is not a GPFS file-system, then the call will
-          * fail with EINVAL and so we never try to apply this to the dest_path */
-     
-         /* need the file path to read the existing ACL */
-         const char* src_path = mfu_flist_file_get_name(flist, idx);
-     
-         /* acl param mapped with gpfs_opaque_acl_t structure */
-         int aclflags = 0;
-         unsigned char acltype = GPFS_ACL_TYPE_ACCESS;
-     
-         /* initial size of the struct for gpfs_opaque_acl, 512 bytes should
-          * be large enough for a fairly large ACL anyway */
-         size_t bufsize = 512;
-     
-         /* gpfs_getacl needs a *void for where it will place the data, so we need
-          * to allocate some memory and then place a gpfs_opaque_acl into the
-          * memory as aclflags is set to 0 to indicate gpfs_opaque_acl_t */
-         void* aclbufmem = MFU_MALLOC(bufsize);
-         memset(aclbufmem, 0, bufsize);
-     
-         /* set fields in structure to define acl query */
-         struct gpfs_opaque_acl* aclbuffer = (struct gpfs_opaque_acl*) aclbufmem;
-         aclbuffer->acl_buffer_len = (int) (bufsize - sizeof(struct gpfs_opaque_acl));
-         aclbuffer->acl_type = acltype;
-     
-         /* try and get the ACL */
-         errno = 0;
-         int r = gpfs_getacl(src_path, aclflags, aclbufmem);
-     
-         /* the buffer may not be big enough, if not, we'll get EONSPC and
-          * the first 4 bytes (acl_buffer_len) will tell us how much space we need */
-         if ((r != 0) && (errno == ENOSPC)) {
-           /* make a buffer which is exactly the right size */
-           unsigned int len = *(unsigned int*) &(aclbuffer->acl_buffer_len);
-           bufsize = len + sizeof(struct gpfs_opaque_acl);
-           MFU_LOG(MFU_LOG_DBG, "GPFS ACL buffer too small, needs to be %d",
-                   (int) bufsize);
-     
-           /* free the old buffer, then malloc the new size */
-           mfu_free(&aclbufmem);
-           aclbufmem = MFU_MALLOC(bufsize);
-           memset(aclbufmem, 0, bufsize);
-     
-           /* set fields in structure to define acl query */
-           aclbuffer = (struct gpfs_opaque_acl*) aclbufmem;
-           aclbuffer->acl_buffer_len = (int) (bufsize - sizeof(struct gpfs_opaque_acl));
-           aclbuffer->acl_type = acltype;
-     
-           /* once again try and get the ACL */
-           r = gpfs_getacl(src_path, aclflags, aclbufmem);
-         }
-     
-         /* check whether we read the ACL successfully */
-         if (r == 0) {
-           /* Assuming we now have a valid call to an ACL,
-            * try to place it on dest_path */
-           errno = 0;
-           r = gpfs_putacl(dest_path, aclflags, aclbufmem);
-           if (r != 0 && errno != EINVAL) {
-             /* failed to put GPFS ACL, print message unless target is not a GPFS file system */
-             MFU_LOG(MFU_LOG_ERR, "Failed to copy GPFS ACL from %s to %s errno=%d (%s)",
-                     src_path, dest_path, errno, strerror(errno));
-             rc = -1;
-           }
-         } else {
-           /* failed to get GPFS ACL, print message unless source is not a GPFS file system */
-           if (errno != EINVAL) {
-             MFU_LOG(MFU_LOG_ERR, "Failed to get GPFS ACL on %s errno=%d (%s)",
-                     src_path, errno, strerror(errno));
-             rc = -1;
-           }
-         }
-     
-         /* free the memory from the buffer */
-         mfu_free(&aclbufmem);
+    /* the earlier run created the destination, which now exists,
+     * so map source paths to destination paths the way it did */
+    int copy_into_dir = mfu_copy_into[0];
+    if (rank == 0) {
+        char* name = mfu_copy_journal_name(mfu_copy_opts->journal, -1);
+        FILE* fp = fopen(name, "r");
+        if (fp != NULL) {
+            if (fscanf(fp, "copy_into_dir %d", &copy_into_dir) != 1) {
+                copy_into_dir = mfu_copy_into[0];
+            }
+            fclose(fp);
+        }
+        mfu_free(&name);
     }
-#endif /* GPFS_SUPPORT */
+    MPI_Bcast(&copy_into_dir, 1, MPI_INT, 0, MPI_COMM_WORLD);
+    mfu_copy_into[0] = copy_into_dir;
+    mfu_copy_use_dest(0, mfu_copy_opts);
+
+    /* journals are numbered from 0 without gaps, read every
+     * ranks-th one starting with our rank until we run out */
+    char* data = NULL;
+    size_t data_size = 0;
+    int k;
+    for (k = rank; ; k += ranks) {
+        char* name = mfu_copy_journal_name(mfu_copy_opts->journal, k);
+        struct stat st;
+        if (mfu_lstat(name, &st) != 0) {
+            if (errno != ENOENT) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to stat journal `%s' (errno=%d %s)",
+                    name, errno, strerror(errno));
+                rc = -1;
+            }
+            mfu_free(&name);
+            break;
+        }
 
-    return rc;
-}
+        int fd = mfu_open(name, O_RDONLY);
+        if (fd < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open journal `%s' (errno=%d %s)",
+                name, errno, strerror(errno));
+            rc = -1;
+            mfu_free(&name);
+            continue;
+        }
 
-static int mfu_copy_timestamps(
-    mfu_flist flist,
-    uint64_t idx,
-    const char* dest_path)
-{
-    /* assume we'll succeed */
-    int rc = 0;
+        /* append contents of this journal to our buffer,
+         * only keeping whole records */
+        size_t file_size = (size_t) st.st_size;
+        char* buf = (char*) MFU_MALLOC(data_size + file_size + 1);
+        if (data_size > 0) {
+            memcpy(buf, data, data_size);
+        }
+        mfu_free(&data);
+        data = buf;
 
-    /* get atime seconds and nsecs */
-    uint64_t atime      = mfu_flist_file_get_atime(flist, idx);
-    uint64_t atime_nsec = mfu_flist_file_get_atime_nsec(flist, idx);
+        size_t got = 0;
+        while (got < file_size) {
+            ssize_t n = mfu_read(name, fd, data + data_size + got, file_size - got);
+            if (n <= 0) {
+                break;
+            }
+            got += (size_t) n;
+        }
+        mfu_close(name, fd);
 
-    /* get mtime seconds and nsecs */
-    uint64_t mtime      = mfu_flist_file_get_mtime(flist, idx);
-    uint64_t mtime_nsec = mfu_flist_file_get_mtime_nsec(flist, idx);
+        size_t pos = 0;
+        mfu_copy_jrec_t rec;
+        size_t len;
+        while ((len = mfu_copy_jrec_unpack(data + data_size + pos, got - pos, &rec)) > 0) {
+            pos += len;
+        }
+        if (pos < got) {
+            /* drop the partial record, so records appended by this
+             * run can be read back */
+            MFU_LOG(MFU_LOG_WARN, "Ignoring partial record at end of journal `%s'", name);
+            if (mfu_truncate(name, (off_t) pos) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to truncate journal `%s' (errno=%d %s)",
+                    name, errno, strerror(errno));
+                rc = -1;
+            }
+        }
+        data_size += pos;
 
-    /* fill in time structures */
-    struct timespec times[2];
-    times[0].tv_sec  = (time_t) atime;
-    times[0].tv_nsec = (long)   atime_nsec;
-    times[1].tv_sec  = (time_t) mtime;
-    times[1].tv_nsec = (long)   mtime_nsec;
+        mfu_free(&name);
+    }
 
-    /* set times with nanosecond precision using utimensat,
-     * assume path is relative to current working directory,
-     * if it's not absolute, and set times on link (not target file)
-     * if dest_path refers to a link */
-    if(mfu_utimensat(AT_FDCWD, dest_path, times, AT_SYMLINK_NOFOLLOW) != 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to change timestamps on `%s' utime() (errno=%d %s)",
-            dest_path, errno, strerror(errno)
-           );
-        rc = -1;
+    /* pack records by destination rank */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int i;
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
     }
 
-    return rc;
-}
+    size_t pos = 0;
+    mfu_copy_jrec_t rec;
+    size_t len;
+    while ((len = mfu_copy_jrec_unpack(data + pos, data_size - pos, &rec)) > 0) {
+        sendcounts[mfu_copy_name_rank(rec.name, ranks)] += (int) len;
+        pos += len;
+    }
 
-static int mfu_copy_close_file(mfu_copy_file_cache_t* cache)
-{
-    int rc = 0;
+    int disp = 0;
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = disp;
+        disp += sendcounts[i];
+    }
 
-    /* close file if we have one */
-    char* name = cache->name;
-    if (name != NULL) {
-        int fd = cache->fd;
+    char* sendbuf = (char*) MFU_MALLOC(data_size + 1);
+    pos = 0;
+    while ((len = mfu_copy_jrec_unpack(data + pos, data_size - pos, &rec)) > 0) {
+        int dest = mfu_copy_name_rank(rec.name, ranks);
+        memcpy(sendbuf + offsets[dest], data + pos, len);
+        offsets[dest] += (int) len;
+        pos += len;
+    }
+    mfu_free(&data);
+
+    int recvtotal;
+    mfu_copy_resume_buf = mfu_copy_exchange(sendbuf, sendcounts, recvcounts, &recvtotal);
+    mfu_free(&sendbuf);
+
+    /* index and sort the records we received */
+    uint64_t count = 0;
+    pos = 0;
+    while ((len = mfu_copy_jrec_unpack(mfu_copy_resume_buf + pos, (size_t)recvtotal - pos, &rec)) > 0) {
+        count++;
+        pos += len;
+    }
+    mfu_copy_resume_recs = (mfu_copy_jrec_t*) MFU_MALLOC(count * sizeof(mfu_copy_jrec_t));
+    mfu_copy_resume_count = count;
+    count = 0;
+    pos = 0;
+    while ((len = mfu_copy_jrec_unpack(mfu_copy_resume_buf + pos, (size_t)recvtotal - pos, &rec)) > 0) {
+        mfu_copy_resume_recs[count] = rec;
+        count++;
+        pos += len;
+    }
+    if (count > 0) {
+        qsort(mfu_copy_resume_recs, (size_t) count, sizeof(mfu_copy_jrec_t), mfu_copy_jrec_cmp);
+    }
 
-        /* if open for write, fsync */
-        int read_flag = cache->read;
-        if (! read_flag) {
-            rc = mfu_fsync(name, fd);
-        }
+    mfu_free(&offsets);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
 
-        /* close the file and delete the name string */
-        rc = mfu_close(name, fd);
-        mfu_free(&cache->name);
+    /* report how much we found */
+    uint64_t all_count;
+    MPI_Allreduce(&count, &all_count, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Resuming copy, found %llu copied chunks in journal",
+            (unsigned long long) all_count);
     }
 
     return rc;
 }
 
-/* progress message to print while setting file metadata */
-static void meta_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+/* free journal records loaded by mfu_copy_resume_load */
+static void mfu_copy_resume_free(void)
 {
-#if 0
-    /* compute percentage of items removed */
-    double percent = 0.0;
-    if (remove_count_total > 0) {
-        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
-    }
-#endif
-
-    /* compute average delete rate */
-    double rate = 0.0;
-    if (secs > 0) {
-        rate = (double)vals[0] / secs;
-    }
+    mfu_free(&mfu_copy_resume_recs);
+    mfu_free(&mfu_copy_resume_buf);
+    mfu_copy_resume_count = 0;
+}
 
-#if 0
-    /* compute estimated time remaining */
-    double secs_remaining = -1.0;
-    if (rate > 0.0) {
-        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
+/* order (index, offset, length) triples by index and then by offset */
+static int mfu_copy_done_cmp(const void* a, const void* b)
+{
+    const uint64_t* ta = (const uint64_t*) a;
+    const uint64_t* tb = (const uint64_t*) b;
+    if (ta[0] != tb[0]) {
+        return (ta[0] < tb[0]) ? -1 : 1;
     }
-#endif
-
-    if (complete < ranks) {
-        MFU_LOG(MFU_LOG_INFO, "Updated %llu items in %f secs (%f items/sec) ...",
-            vals[0], secs, rate);
-    } else {
-        MFU_LOG(MFU_LOG_INFO, "Updated %llu items in %f secs (%f items/sec) done",
-            vals[0], secs, rate);
+    if (ta[1] != tb[1]) {
+        return (ta[1] < tb[1]) ? -1 : 1;
     }
+    return 0;
 }
 
-/* iterate through list of files and set ownership, timestamps,
- * and permissions starting from deepest level and working upwards,
- * we go in this direction in case updating a file updates its
- * parent directory */
-static int mfu_copy_set_metadata(int levels, int minlevel, mfu_flist* lists,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* for each regular file in list, ask the rank holding its journal
+ * records which sections an earlier run copied, records only count
+ * if the source still has the size and mtime it had then */
+static void mfu_copy_resume_lookup(mfu_flist list, mfu_copy_done_t* done)
 {
-    /* assume we'll succeed */
-    int rc = 0;
+    int i;
+    uint64_t idx;
 
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    /* get current rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
 
-    if (rank == 0) {
-        if(mfu_copy_opts->preserve) {
-            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps.");
+    /* send index, size, mtime, and name of each file,
+     * packed the same way as a journal record */
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) == MFU_TYPE_FILE) {
+            const char* name = mfu_flist_file_get_name(list, idx);
+            sendcounts[mfu_copy_name_rank(name, ranks)] += MFU_COPY_JREC_HEADER + (int)strlen(name) + 1;
         }
-        else {
-            MFU_LOG(MFU_LOG_INFO, "Fixing permissions.");
+    }
+    int disp = 0;
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = disp;
+        disp += sendcounts[i];
+    }
+    char* sendbuf = (char*) MFU_MALLOC((size_t)disp + 1);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) == MFU_TYPE_FILE) {
+            const char* name = mfu_flist_file_get_name(list, idx);
+            int dest = mfu_copy_name_rank(name, ranks);
+            char* ptr = sendbuf + offsets[dest];
+            uint32_t name_len = (uint32_t) strlen(name) + 1;
+            mfu_pack_uint64(&ptr, idx);
+            mfu_pack_uint64(&ptr, 0);
+            mfu_pack_uint64(&ptr, mfu_flist_file_get_size(list, idx));
+            mfu_pack_uint64(&ptr, mfu_flist_file_get_mtime(list, idx));
+            mfu_pack_uint64(&ptr, mfu_flist_file_get_mtime_nsec(list, idx));
+            mfu_pack_uint32(&ptr, name_len);
+            memcpy(ptr, name, name_len);
+            offsets[dest] += MFU_COPY_JREC_HEADER + (int) name_len;
         }
     }
 
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
-
-    /* start progress messages while setting metadata */
-    mfu_progress* meta_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, meta_progress_fn);
-
-    /* now set timestamps on files starting from deepest level */
-    int tmp_rc;
-    int level;
-    for (level = levels-1; level >= 0; level--) {
-        /* get list at this level */
-        mfu_flist list = lists[level];
-
-        /* cycle through our list of items and set timestamps
-         * for each one at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* TODO: skip file if it's not readable */
-
-            /* get source name of item */
-            const char* name = mfu_flist_file_get_name(list, idx);
+    int recvtotal;
+    char* recvbuf = mfu_copy_exchange(sendbuf, sendcounts, recvcounts, &recvtotal);
+    mfu_free(&sendbuf);
+
+    /* answer each query with the merged sections copied for that
+     * file, as (index, offset, length) triples, first count them */
+    int pass;
+    uint64_t* replies = NULL;
+    for (pass = 0; pass < 2; pass++) {
+        for (i = 0; i < ranks; i++) {
+            sendcounts[i] = 0;
+        }
 
-            /* get destination name of item */
-            char* dest = mfu_param_path_copy_dest(name, numpaths,
-                    paths, destpath, mfu_copy_opts);
+        const char* ptr = recvbuf;
+        for (i = 0; i < ranks; i++) {
+            const char* end = ptr + recvcounts[i];
+            mfu_copy_jrec_t q;
+            size_t len;
+            while (ptr < end && (len = mfu_copy_jrec_unpack(ptr, (size_t)(end - ptr), &q)) > 0) {
+                ptr += len;
+
+                /* find first record for this file */
+                uint64_t low = 0;
+                uint64_t high = mfu_copy_resume_count;
+                while (low < high) {
+                    uint64_t mid = low + (high - low) / 2;
+                    if (strcmp(mfu_copy_resume_recs[mid].name, q.name) < 0) {
+                        low = mid + 1;
+                    } else {
+                        high = mid;
+                    }
+                }
 
-            /* No need to copy it */
-            if (dest == NULL) {
-                continue;
-            }
+                /* merge overlapping and adjacent records,
+                 * q.offset holds the index of the file */
+                int have = 0;
+                uint64_t start = 0;
+                uint64_t stop = 0;
+                uint64_t r;
+                for (r = low; r <= mfu_copy_resume_count; r++) {
+                    const mfu_copy_jrec_t* rec = NULL;
+                    if (r < mfu_copy_resume_count &&
+                        strcmp(mfu_copy_resume_recs[r].name, q.name) == 0)
+                    {
+                        rec = &mfu_copy_resume_recs[r];
+                        if (rec->file_size != q.file_size ||
+                            rec->mtime != q.mtime || rec->mtime_nsec != q.mtime_nsec)
+                        {
+                            /* source changed since this chunk was copied */
+                            continue;
+                        }
+                        if (have && rec->offset <= stop) {
+                            if (rec->offset + rec->length > stop) {
+                                stop = rec->offset + rec->length;
+                            }
+                            continue;
+                        }
+                    }
 
-            /* update our running total */
-            total_count++;
+                    /* emit the section we have built up */
+                    if (have) {
+                        if (pass == 1) {
+                            uint64_t* t = &replies[offsets[i] / 8];
+                            t[0] = q.offset;
+                            t[1] = start;
+                            t[2] = stop - start;
+                            offsets[i] += 3 * 8;
+                        }
+                        sendcounts[i] += 3 * 8;
+                        have = 0;
+                    }
+                    if (rec == NULL) {
+                        break;
+                    }
 
-            if(mfu_copy_opts->preserve) {
-                tmp_rc = mfu_copy_ownership(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_permissions(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_acls(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_timestamps(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
+                    have  = 1;
+                    start = rec->offset;
+                    stop  = rec->offset + rec->length;
                 }
             }
-            else {
-                /* TODO: set permissions based on source permissons
-                 * masked by umask */
-                tmp_rc = mfu_copy_permissions(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
+        }
+
+        if (pass == 0) {
+            disp = 0;
+            for (i = 0; i < ranks; i++) {
+                offsets[i] = disp;
+                disp += sendcounts[i];
             }
+            replies = (uint64_t*) MFU_MALLOC((size_t)disp + 8);
+        }
+    }
+    mfu_free(&recvbuf);
 
-            /* free destination item */
-            mfu_free(&dest);
+    /* send replies back to the ranks that asked */
+    recvbuf = mfu_copy_exchange((const char*)replies, sendcounts, recvcounts, &recvtotal);
+    mfu_free(&replies);
 
-            /* update number of items we have completed for progress messages */
-            mfu_progress_update(&total_count, meta_prog);
-        }
-
-        /* wait for all procs to finish before we start
-         * with files at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
+    done->count  = (uint64_t) recvtotal / (3 * 8);
+    done->ranges = (uint64_t*) recvbuf;
+    if (done->count > 0) {
+        qsort(done->ranges, (size_t) done->count, 3 * sizeof(uint64_t), mfu_copy_done_cmp);
     }
 
-    /* finalize progress messages */
-    mfu_progress_complete(&total_count, &meta_prog);
-
-    /* stop timer and report total count */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_end = MPI_Wtime();
+    mfu_free(&offsets);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+}
 
-    /* print timing statistics */
-    if (verbose) {
-        uint64_t sum;
-        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        double rate = 0.0;
-        double secs = total_end - total_start;
-        if (secs > 0.0) {
-          rate = (double)sum / secs;
-        }
-        if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Updated %lu items in %f seconds (%f items/sec)",
-              (unsigned long)sum, secs, rate
-            );
+/* return 1 if an earlier run copied the section of item idx starting
+ * at offset, for an empty section, return 1 if it copied any part of
+ * the file, otherwise return 0, can be used as mfu_file_chunk_skip_fn */
+static int mfu_copy_resume_skip(mfu_flist list, uint64_t idx,
+        uint64_t offset, uint64_t length, void* arg)
+{
+    const mfu_copy_done_t* done = (const mfu_copy_done_t*) arg;
+
+    /* find first section of this file */
+    uint64_t low = 0;
+    uint64_t high = done->count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (done->ranges[mid * 3] < idx) {
+            low = mid + 1;
+        } else {
+            high = mid;
         }
     }
 
-    return rc;
+    /* sections are merged, so one must cover the whole range */
+    uint64_t i;
+    for (i = low; i < done->count && done->ranges[i * 3] == idx; i++) {
+        uint64_t start = done->ranges[i * 3 + 1];
+        uint64_t stop  = start + done->ranges[i * 3 + 2];
+        if (length == 0 || (start <= offset && offset + length <= stop)) {
+            return 1;
+        }
+    }
+    return 0;
 }
 
-/* iterate through list of files and set ownership, timestamps,
- * and permissions starting from deepest level and working upwards,
- * we go in this direction in case updating a file updates its
- * parent directory */
-static int mfu_copy_set_metadata_dirs(int levels, int minlevel, mfu_flist* lists,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* open the journal for this process, a new copy clears out journals
+ * left from an earlier run, and a resumed copy appends to them,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_journal_open(mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* assume we'll succeed */
-    int rc = 0;
-
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
-
-    /* get current rank */
-    int rank;
+    int rank, ranks;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    if (rank == 0) {
-        if(mfu_copy_opts->preserve) {
-            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps on directories.");
-        }
-        else {
-            MFU_LOG(MFU_LOG_INFO, "Fixing permissions on directories.");
+    /* remember how to map source to destination paths, and remove
+     * journals of extra processes from an earlier run,
+     * so a later resume does not read them */
+    if (! mfu_copy_opts->resume && rank == 0) {
+        char* info = mfu_copy_journal_name(mfu_copy_opts->journal, -1);
+        FILE* fp = fopen(info, "w");
+        if (fp != NULL) {
+            fprintf(fp, "copy_into_dir %d\n", mfu_copy_into[0]);
+            fclose(fp);
+        } else {
+            MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' (errno=%d %s)",
+                info, errno, strerror(errno));
         }
-    }
-
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
-
-    /* now set timestamps on files starting from deepest level */
-    int tmp_rc;
-    int level;
-    for (level = levels-1; level >= 0; level--) {
-        /* get list at this level */
-        mfu_flist list = lists[level];
-
-        /* cycle through our list of items and set timestamps
-         * for each one at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        for (idx = 0; idx < size; idx++) {
-            /* TODO: skip file if it's not readable */
-
-            /* get source name of item */
-            const char* name = mfu_flist_file_get_name(list, idx);
-
-            /* get destination name of item */
-            char* dest = mfu_param_path_copy_dest(name, numpaths,
-                    paths, destpath, mfu_copy_opts);
-
-            /* No need to copy it */
-            if (dest == NULL) {
-                continue;
-            }
-
-            /* only need to set metadata on directories */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type != MFU_TYPE_DIR) {
-                continue;
-            }
-
-            /* update our running total */
-            total_count++;
-
-            if(mfu_copy_opts->preserve) {
-                tmp_rc = mfu_copy_ownership(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_permissions(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_acls(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-                tmp_rc = mfu_copy_timestamps(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-            }
-            else {
-                /* TODO: set permissions based on source permissons
-                 * masked by umask */
-                tmp_rc = mfu_copy_permissions(list, idx, dest);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
+        mfu_free(&info);
+
+        int k;
+        for (k = ranks; ; k++) {
+            char* name = mfu_copy_journal_name(mfu_copy_opts->journal, k);
+            int unlink_rc = mfu_unlink(name);
+            mfu_free(&name);
+            if (unlink_rc != 0) {
+                break;
             }
-
-            /* free destination item */
-            mfu_free(&dest);
         }
-
-        /* wait for all procs to finish before we start
-         * with files at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
     }
 
-    /* stop timer and report total count */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_end = MPI_Wtime();
+    int flags = O_WRONLY | O_CREAT | O_APPEND;
+    if (! mfu_copy_opts->resume) {
+        flags |= O_TRUNC;
+    }
 
-    /* print timing statistics */
-    if (verbose) {
-        uint64_t sum;
-        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        double rate = 0.0;
-        double secs = total_end - total_start;
-        if (secs > 0.0) {
-          rate = (double)sum / secs;
-        }
-        if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Updated %lu items in %f seconds (%f items/sec)",
-              (unsigned long)sum, secs, rate
-            );
-        }
+    char* name = mfu_copy_journal_name(mfu_copy_opts->journal, rank);
+    int fd = mfu_open(name, flags, S_IRUSR | S_IWUSR);
+    if (fd < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open journal `%s' (errno=%d %s)",
+            name, errno, strerror(errno));
+        mfu_free(&name);
+        return -1;
     }
+    mfu_free(&name);
 
-    return rc;
+    mfu_copy_journal.fd         = fd;
+    mfu_copy_journal.sync_fd    = -1;
+    mfu_copy_journal.size       = 0;
+    mfu_copy_journal.last_flush = MPI_Wtime();
+    return 0;
 }
 
-/* creates dir in destpath for specified item, identifies source path
- * that contains source dir, computes relative path to dir under source path,
- * and creates dir at same relative path under destpath, copies xattrs
- * when preserving permissions, which contains file striping info on Lustre,
- * returns 0 on success and -1 on error */
-static int mfu_create_directory(mfu_flist list, uint64_t idx,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* write pending records to our journal, first forcing the data they
+ * describe to the destination so a record never claims data that
+ * could still be lost */
+static void mfu_copy_journal_flush(mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* assume we'll succeed */
-    int rc = 0;
-
-    /* get name of directory */
-    const char* name = mfu_flist_file_get_name(list, idx);
-
-    /* get destination name */
-    char* dest_path = mfu_param_path_copy_dest(name, numpaths, paths,
-            destpath, mfu_copy_opts);
-
-    /* No need to copy it */
-    if (dest_path == NULL) {
-        return 0;
+    mfu_copy_journal_t* j = &mfu_copy_journal;
+    if (j->fd < 0 || j->size == 0) {
+        return;
     }
 
-    /* Skipping the destination directory ONLY if it already exists.
-     * If we are doing a sync operation and if the dest dir does not
-     * exist, we need to create it. The reason that
-     * the dest_path and the destpath->path are compared is because
-     * if we are syncing two directories we want the tree to have the
-     * same number of levels. If dsync is on then only the contents of
-     * the top level source directory will be copied (if necessary) into
-     * the target directory. So, the top level src directory is removed
-     * from the destination path. This path slicing based on whether or
-     * not dsync is on happens prior to this in
-     * mfu_param_path_copy_dest. */
+    /* flush the destination file system, open it on first use since
+     * the destination may not exist until we create it */
+    if (j->sync_fd < 0) {
+        j->sync_fd = mfu_open(mfu_copy_opts->dest_path, O_RDONLY);
+    }
+    if (j->sync_fd < 0 || syncfs(j->sync_fd) != 0) {
+        sync();
+    }
 
-    if (mfu_copy_opts->do_sync &&
-        (strncmp(dest_path, destpath->path, strlen(dest_path)) == 0) &&
-        destpath->target_stat_valid)
-    {
-        mfu_free(&dest_path);
-        return 0;
+    ssize_t n = mfu_write(mfu_copy_opts->journal, j->fd, j->buf, j->size);
+    if (n < 0 || (size_t) n != j->size || mfu_fsync(mfu_copy_opts->journal, j->fd) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to write journal, disabling it (errno=%d %s)",
+            errno, strerror(errno));
+        mfu_close(mfu_copy_opts->journal, j->fd);
+        j->fd = -1;
     }
 
-    /* create the destination directory */
-    MFU_LOG(MFU_LOG_DBG, "Creating directory `%s'", dest_path);
-    int mkdir_rc = mfu_mkdir(dest_path, DCOPY_DEF_PERMS_DIR);
-    if(mkdir_rc < 0) {
-        if(errno == EEXIST) {
-            MFU_LOG(MFU_LOG_WARN,
-                    "Original directory exists, skip the creation: `%s' (errno=%d %s)",
-                    dest_path, errno, strerror(errno));
+    j->size = 0;
+    j->last_flush = MPI_Wtime();
+}
 
-        } else {
-            MFU_LOG(MFU_LOG_ERR, "Create `%s' mkdir() failed (errno=%d %s)",
-                    dest_path, errno, strerror(errno)
-            );
-            mfu_free(&dest_path);
-            return -1;
-        }
+/* record that we copied a section of file src, and write out pending
+ * records if it has been journal_interval seconds since the last write */
+static void mfu_copy_journal_add(const char* src, uint64_t offset, uint64_t length,
+        uint64_t file_size, mfu_copy_opts_t* mfu_copy_opts)
+{
+    mfu_copy_journal_t* j = &mfu_copy_journal;
+    if (j->fd < 0) {
+        return;
     }
 
-    /* we do this now in case there are Lustre attributes for
-     * creating / striping files in the directory */
+    /* record mtime of the source so a resume can tell whether it changed,
+     * the file was just copied so it is still in our cache */
+    struct stat st;
+    mfu_fdcache_entry* in_file = mfu_copy_open_file(src, 1, mfu_copy_opts);
+    if (in_file == NULL || fstat(in_file->fd, &st) != 0) {
+        return;
+    }
 
-    /* copy extended attributes on directory */
-    if (mfu_copy_opts->preserve) {
-        int tmp_rc = mfu_copy_xattrs(list, idx, dest_path);
-        if (tmp_rc < 0) {
-            rc = -1;
+    size_t name_len = strlen(src) + 1;
+    size_t len = MFU_COPY_JREC_HEADER + name_len;
+    if (j->size + len > j->capacity) {
+        size_t capacity = (j->capacity > 0) ? j->capacity * 2 : 64 * 1024;
+        while (capacity < j->size + len) {
+            capacity *= 2;
+        }
+        char* buf = (char*) MFU_MALLOC(capacity);
+        if (j->size > 0) {
+            memcpy(buf, j->buf, j->size);
         }
+        mfu_free(&j->buf);
+        j->buf = buf;
+        j->capacity = capacity;
     }
 
-    /* increment our directory count by one */
-    mfu_copy_stats.total_dirs++;
-
-    /* free the directory name */
-    mfu_free(&dest_path);
+    char* ptr = j->buf + j->size;
+    mfu_pack_uint64(&ptr, offset);
+    mfu_pack_uint64(&ptr, length);
+    mfu_pack_uint64(&ptr, file_size);
+    mfu_pack_uint64(&ptr, (uint64_t) st.st_mtim.tv_sec);
+    mfu_pack_uint64(&ptr, (uint64_t) st.st_mtim.tv_nsec);
+    mfu_pack_uint32(&ptr, (uint32_t) name_len);
+    memcpy(ptr, src, name_len);
+    j->size += len;
+
+    if (MPI_Wtime() - j->last_flush >= (double) mfu_copy_opts->journal_interval) {
+        mfu_copy_journal_flush(mfu_copy_opts);
+    }
+}
 
-    return rc;
+/* write out pending records and close our journal */
+static void mfu_copy_journal_close(mfu_copy_opts_t* mfu_copy_opts)
+{
+    mfu_copy_journal_t* j = &mfu_copy_journal;
+    mfu_copy_journal_flush(mfu_copy_opts);
+    if (j->fd >= 0) {
+        mfu_close(mfu_copy_opts->journal, j->fd);
+        j->fd = -1;
+    }
+    if (j->sync_fd >= 0) {
+        mfu_close(mfu_copy_opts->dest_path, j->sync_fd);
+        j->sync_fd = -1;
+    }
+    mfu_free(&j->buf);
+    j->size = 0;
+    j->capacity = 0;
 }
 
-/* create directories, we work from shallowest level to the deepest
- * with a barrier in between levels, so that we don't try to create
- * a child directory until the parent exists,
+/* copy all extended attributes from op->operand to dest_path,
+ * sets them through dest_fd instead if it is not -1,
  * returns 0 on success and -1 on failure */
-static int mfu_create_directories(int levels, int minlevel, mfu_flist* lists,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+static int mfu_copy_xattrs(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path,
+    int dest_fd)
 {
-    /* assume we'll succeed */
+    /* assume that we'll succeed */
     int rc = 0;
 
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
-
-    /* get current rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
-
-    /* indicate to user what phase we're in */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Creating directories.");
+#if DCOPY_USE_XATTRS
+    /* nothing to copy if the walk found no xattrs on the source */
+    if (mfu_flist_file_get_xattrs(flist, idx) == 0) {
+        return rc;
     }
 
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
+    /* get source file name */
+    const char* src_path = mfu_flist_file_get_name(flist, idx);
 
-    /* work from shallowest level to deepest level */
-    int level;
-    for (level = 0; level < levels; level++) {
-        /* time how long this takes */
-        double start = MPI_Wtime();
+    /* start with a reasonable buffer, we'll allocate more as needed */
+    size_t list_bufsize = 1204;
+    char* list = (char*) MFU_MALLOC(list_bufsize);
 
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
+    /* get list, if list_size == ERANGE, try again */
+    ssize_t list_size;
+    int got_list = 0;
 
-        /* create each directory we have at this level */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        uint64_t count = 0;
-        for (idx = 0; idx < size; idx++) {
-            /* check whether we have a directory */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type == MFU_TYPE_DIR) {
-                /* create the directory */
-                int tmp_rc = mfu_create_directory(list, idx, numpaths,
-                        paths, destpath, mfu_copy_opts);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
+    /* get current estimate for list size */
+    while(! got_list) {
+        errno = 0;
+        list_size = llistxattr(src_path, list, list_bufsize);
 
-                count++;
+        if(list_size < 0) {
+            if(errno == ERANGE) {
+                /* buffer is too small, free our current buffer
+                 * and call it again with size==0 to get new size */
+                mfu_free(&list);
+                list_bufsize = 0;
+            }
+            else if(errno == ENOTSUP) {
+                /* this is common enough that we silently ignore it */
+                break;
+            }
+            else {
+                /* this is a real error */
+                MFU_LOG(MFU_LOG_ERR, "Failed to get list of extended attributes on `%s' llistxattr() (errno=%d %s)",
+                    src_path, errno, strerror(errno)
+                   );
+                rc = -1;
+                break;
+            }
+        }
+        else {
+            if(list_size > 0 && list_bufsize == 0) {
+                /* called llistxattr with size==0 and got back positive
+                 * number indicating size of buffer we need to allocate */
+                list_bufsize = (size_t) list_size;
+                list = (char*) MFU_MALLOC(list_bufsize);
+            }
+            else {
+                /* got our list, it's size is in list_size, which may be 0 */
+                got_list = 1;
             }
         }
+    }
 
-        /* add items to our running total */
-        total_count += count;
+    /* iterate over list and copy values to new object lgetxattr/lsetxattr */
+    if(got_list) {
+        char* name = list;
 
-        /* wait for all procs to finish before we start
-         * creating directories at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
+        while(name < list + list_size) {
+            /* start with a reasonable buffer,
+             * allocate something bigger as needed */
+            size_t val_bufsize = 1024;
+            void* val = (void*) MFU_MALLOC(val_bufsize);
 
-        /* stop our timer */
-        double end = MPI_Wtime();
+            /* lookup value for name */
+            ssize_t val_size;
+            int got_val = 0;
 
-         /* print statistics */
-        if (verbose) {
-            uint64_t min, max, sum;
-            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-            double rate = 0.0;
-            double secs = end - start;
-            if (secs > 0.0) {
-              rate = (double)sum / secs;
+            while(! got_val) {
+                errno = 0;
+                val_size = lgetxattr(src_path, name, val, val_bufsize);
+
+                if(val_size < 0) {
+                    if(errno == ERANGE) {
+                        /* buffer is too small, free our current buffer
+                         * and call it again with size==0 to get new size */
+                        mfu_free(&val);
+                        val_bufsize = 0;
+                    }
+                    else if(errno == ENOATTR) {
+                        /* source object no longer has this attribute,
+                         * maybe deleted out from under us, ignore but print warning */
+                        MFU_LOG(MFU_LOG_WARN, "Attribute does not exist for name=%s on `%s' llistxattr() (errno=%d %s)",
+                            name, src_path, errno, strerror(errno)
+                           );
+                        break;
+                    }
+                    else {
+                        /* this is a real error */
+                        MFU_LOG(MFU_LOG_ERR, "Failed to get value for name=%s on `%s' llistxattr() (errno=%d %s)",
+                            name, src_path, errno, strerror(errno)
+                           );
+                        rc = -1;
+                        break;
+                    }
+                }
+                else {
+                    if(val_size > 0 && val_bufsize == 0) {
+                        /* called lgetxattr with size==0 and got back positive
+                         * number indicating size of buffer we need to allocate */
+                        val_bufsize = (size_t) val_size;
+                        val = (void*) MFU_MALLOC(val_bufsize);
+                    }
+                    else {
+                        /* got our value, it's size is in val_size, which may be 0 */
+                        got_val = 1;
+                    }
+                }
             }
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f/sec secs=%f",
-                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
-                );
+
+            /* set attribute on destination object */
+            if(got_val) {
+                errno = 0;
+                int setrc;
+                if (dest_fd != -1) {
+                    setrc = fsetxattr(dest_fd, name, val, (size_t) val_size, 0);
+                } else {
+                    setrc = lsetxattr(dest_path, name, val, (size_t) val_size, 0);
+                }
+                if(setrc != 0) {
+                    /* failed to set attribute */
+                    MFU_LOG(MFU_LOG_ERR, "Failed to set value for name=%s on `%s' llistxattr() (errno=%d %s)",
+                        name, dest_path, errno, strerror(errno)
+                       );
+                    rc = -1;
+                }
             }
-        }
-    }
 
-    /* stop timer and report total count */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_end = MPI_Wtime();
+            /* free value string */
+            mfu_free(&val);
+            val_bufsize = 0;
 
-    /* print timing statistics */
-    if (verbose) {
-        uint64_t sum;
-        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        double rate = 0.0;
-        double secs = total_end - total_start;
-        if (secs > 0.0) {
-          rate = (double)sum / secs;
-        }
-        if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Created %lu directories in %f seconds (%f items/sec)",
-              (unsigned long)sum, secs, rate
-            );
+            /* jump to next name */
+            size_t namelen = strlen(name) + 1;
+            name += namelen;
         }
     }
 
+    /* free space allocated for list */
+    mfu_free(&list);
+    list_bufsize = 0;
+
+#endif /* DCOPY_USE_XATTR */
+
     return rc;
 }
 
-/* creates symlink in destpath for specified file, identifies source path
- * that contains source link, computes relative path to link under source path,
- * and creates link at same relative path under destpath,
- * returns 0 on success and -1 on error */
-static int mfu_create_link(mfu_flist list, uint64_t idx,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+static int mfu_copy_ownership(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path)
 {
     /* assume we'll succeed */
     int rc = 0;
 
-    /* get source name */
-    const char* src_path = mfu_flist_file_get_name(list, idx);
+    /* get user id and group id of file */
+    uid_t uid = (uid_t) mfu_flist_file_get_uid(flist, idx);
+    gid_t gid = (gid_t) mfu_flist_file_get_gid(flist, idx);
 
-    /* get destination name */
-    const char* dest_path = mfu_param_path_copy_dest(src_path, numpaths,
-           paths, destpath, mfu_copy_opts);
+    /* note that we change ownership of link itself, it path happens to be a link */
+    const char* base;
+    int dirfd = mfu_copy_parent_fd(dest_path, &base);
+    if(mfu_fchownat(dirfd, base, uid, gid, AT_SYMLINK_NOFOLLOW) != 0) {
+        /* TODO: are there other EPERM conditions we do want to report? */
 
-    /* No need to copy it */
-    if (dest_path == NULL) {
-        return 0;
+        /* since the user running dcp may not be the owner of the
+         * file, we could hit an EPERM error here, and the file
+         * will be left with the effective uid and gid of the dcp
+         * process, don't bother reporting an error for that case */
+        if (errno != EPERM) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change ownership on `%s' lchown() (errno=%d %s)",
+                dest_path, errno, strerror(errno)
+               );
+        }
+        rc = -1;
     }
 
-    /* read link target */
-    char path[PATH_MAX + 1];
-    ssize_t readlink_rc = mfu_readlink(src_path, path, sizeof(path) - 1);
-    if(readlink_rc < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to read link `%s' readlink() (errno=%d %s)",
-            src_path, errno, strerror(errno)
-        );
-        mfu_free(&dest_path);
-        return -1;
-    }
+    return rc;
+}
 
-    /* ensure that string ends with NUL */
-    path[readlink_rc] = '\0';
+/* TODO: condionally set setuid and setgid bits? */
+static int mfu_copy_permissions(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path)
+{
+    /* assume we'll succeed */
+    int rc = 0;
 
-    /* create new link */
-    int symlink_rc = mfu_symlink(path, dest_path);
-    if(symlink_rc < 0) {
-        if(errno == EEXIST) {
-            MFU_LOG(MFU_LOG_WARN,
-                    "Original link exists, skip the creation: `%s' (errno=%d %s)",
-                    dest_path, errno, strerror(errno));
-        } else {
-            MFU_LOG(MFU_LOG_ERR, "Create `%s' symlink() failed, (errno=%d %s)",
-                    dest_path, errno, strerror(errno)
-            );
-            mfu_free(&dest_path);
-            return -1;
-        }
-    }
+    /* get mode and type */
+    mfu_filetype type = mfu_flist_file_get_type(flist, idx);
+    mode_t mode = (mode_t) mfu_flist_file_get_mode(flist, idx);
 
-    /* set permissions on link */
-    if (mfu_copy_opts->preserve) {
-        int xattr_rc = mfu_copy_xattrs(list, idx, dest_path);
-        if (xattr_rc < 0) {
+    /* change mode */
+    if(type != MFU_TYPE_LINK) {
+        const char* base;
+        int dirfd = mfu_copy_parent_fd(dest_path, &base);
+        if(mfu_fchmodat(dirfd, base, mode, 0) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' chmod() (errno=%d %s)",
+                dest_path, errno, strerror(errno)
+               );
             rc = -1;
         }
     }
 
-    /* free destination path */
-    mfu_free(&dest_path);
-
-    /* increment our directory count by one */
-    mfu_copy_stats.total_links++;
-
     return rc;
 }
 
-/* creates inode in destpath for specified file, identifies source path
- * that contains source file, computes relative path to file under source path,
- * and creates file at same relative path under destpath, copies xattrs
- * when preserving permissions, which contains file striping info on Lustre,
- * returns 0 on success and -1 on error */
-static int mfu_create_file(mfu_flist list, uint64_t idx,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* copy GPFS ACLs from source to destination */
+static int mfu_copy_acls(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path)
 {
     /* assume we'll succeed */
     int rc = 0;
 
-    /* get source name */
-    const char* src_path = mfu_flist_file_get_name(list, idx);
-
-    /* get destination name */
-    const char* dest_path = mfu_param_path_copy_dest(src_path, numpaths,
-            paths, destpath, mfu_copy_opts);
+#ifdef GPFS_SUPPORT
+    /* get type */
+    mfu_filetype type = mfu_flist_file_get_type(flist, idx);
 
-    /* No need to copy it */
-    if (dest_path == NULL) {
-        return 0;
+    /* copy ACLs unless item is a link */
+    if(type != MFU_TYPE_LINK) {
+         /* if we have GPFS support enabled, then we'll use the GPFS API to read
+          * the ACL from the src_path and write to the dest_path.
+          * We use the opaque method as we are not trying to alter the ACL contents.
+          * Note that if the source is not a GPFS file-system, then the call will
+          * fail with EINVAL and so we never try to apply this to the dest_path */
+     
+         /* need the file path to read the existing ACL */
+         const char* src_path = mfu_flist_file_get_name(flist, idx);
+     
+         /* acl param mapped with gpfs_opaque_acl_t structure */
+         int aclflags = 0;
+         unsigned char acltype = GPFS_ACL_TYPE_ACCESS;
+     
+         /* initial size of the struct for gpfs_opaque_acl, 512 bytes should
+          * be large enough for a fairly large ACL anyway */
+         size_t bufsize = 512;
+     
+         /* gpfs_getacl needs a *void for where it will place the data, so we need
+          * to allocate some memory and then place a gpfs_opaque_acl into the
+          * memory as aclflags is set to 0 to indicate gpfs_opaque_acl_t */
+         void* aclbufmem = MFU_MALLOC(bufsize);
+         memset(aclbufmem, 0, bufsize);
+     
+         /* set fields in structure to define acl query */
+         struct gpfs_opaque_acl* aclbuffer = (struct gpfs_opaque_acl*) aclbufmem;
+         aclbuffer->acl_buffer_len = (int) (bufsize - sizeof(struct gpfs_opaque_acl));
+         aclbuffer->acl_type = acltype;
+     
+         /* try and get the ACL */
+         errno = 0;
+         int r = gpfs_getacl(src_path, aclflags, aclbufmem);
+     
+         /* the buffer may not be big enough, if not, we'll get EONSPC and
+          * the first 4 bytes (acl_buffer_len) will tell us how much space we need */
+         if ((r != 0) && (errno == ENOSPC)) {
+           /* make a buffer which is exactly the right size */
+           unsigned int len = *(unsigned int*) &(aclbuffer->acl_buffer_len);
+           bufsize = len + sizeof(struct gpfs_opaque_acl);
+           MFU_LOG(MFU_LOG_DBG, "GPFS ACL buffer too small, needs to be %d",
+                   (int) bufsize);
+     
+           /* free the old buffer, then malloc the new size */
+           mfu_free(&aclbufmem);
+           aclbufmem = MFU_MALLOC(bufsize);
+           memset(aclbufmem, 0, bufsize);
+     
+           /* set fields in structure to define acl query */
+           aclbuffer = (struct gpfs_opaque_acl*) aclbufmem;
+           aclbuffer->acl_buffer_len = (int) (bufsize - sizeof(struct gpfs_opaque_acl));
+           aclbuffer->acl_type = acltype;
+     
+           /* once again try and get the ACL */
+           r = gpfs_getacl(src_path, aclflags, aclbufmem);
+         }
+     
+         /* check whether we read the ACL successfully */
+         if (r == 0) {
+           /* Assuming we now have a valid call to an ACL,
+            * try to place it on dest_path */
+           errno = 0;
+           r = gpfs_putacl(dest_path, aclflags, aclbufmem);
+           if (r != 0 && errno != EINVAL) {
+             /* failed to put GPFS ACL, print message unless target is not a GPFS file system */
+             MFU_LOG(MFU_LOG_ERR, "Failed to copy GPFS ACL from %s to %s errno=%d (%s)",
+                     src_path, dest_path, errno, strerror(errno));
+             rc = -1;
+           }
+         } else {
+           /* failed to get GPFS ACL, print message unless source is not a GPFS file system */
+           if (errno != EINVAL) {
+             MFU_LOG(MFU_LOG_ERR, "Failed to get GPFS ACL on %s errno=%d (%s)",
+                     src_path, errno, strerror(errno));
+             rc = -1;
+           }
+         }
+     
+         /* free the memory from the buffer */
+         mfu_free(&aclbufmem);
     }
+#endif /* GPFS_SUPPORT */
 
-    /* since file systems like Lustre require xattrs to be set before file is opened,
-     * we first create it with mknod and then set xattrs */
+    return rc;
+}
 
-    /* create file with mknod
-     * for regular files, dev argument is supposed to be ignored,
-     * see makedev() to create valid dev */
-    dev_t dev;
-    memset(&dev, 0, sizeof(dev_t));
-    int mknod_rc = mfu_mknod(dest_path, DCOPY_DEF_PERMS_FILE | S_IFREG, dev);
-    if(mknod_rc < 0) {
-        if(errno == EEXIST) {
-            /* destination already exists, no big deal, but print warning */
-            MFU_LOG(MFU_LOG_WARN,
-                    "Original file exists, skip the creation: `%s' (errno=%d %s)",
-                    dest_path, errno, strerror(errno));
-        } else {
-            /* failed to create inode, that's a problem */
-            MFU_LOG(MFU_LOG_ERR, "File `%s' mknod() failed (errno=%d %s)",
-                    dest_path, errno, strerror(errno)
-            );
-            mfu_free(&dest_path);
-            return -1;
-        }
-    }
+static int mfu_copy_timestamps(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path)
+{
+    /* assume we'll succeed */
+    int rc = 0;
 
-    /* copy extended attributes, important to do this first before
-     * writing data because some attributes tell file system how to
-     * stripe data, e.g., Lustre */
-    if (mfu_copy_opts->preserve) {
-        int tmp_rc = mfu_copy_xattrs(list, idx, dest_path);
-        if (tmp_rc < 0) {
-            rc = -1;
-        }
-    }
+    /* get atime seconds and nsecs */
+    uint64_t atime      = mfu_flist_file_get_atime(flist, idx);
+    uint64_t atime_nsec = mfu_flist_file_get_atime_nsec(flist, idx);
 
-    /* Truncate destination files to 0 bytes when sparse file is enabled,
-     * this is because we will not overwrite sections corresponding to holes
-     * and we need those to be set to 0 */
-    if (mfu_copy_opts->sparse) {
-        /* truncate destination file to 0 bytes */
-        struct stat st;
-        int status = mfu_lstat(dest_path, &st);
-        if (status == 0) {
-            /* destination exists, truncate it to 0 bytes */
-            status = mfu_truncate(dest_path, 0);
-            if (status) {
-                /* when using sparse file optimization, consider this to be an error,
-                 * since we will not be overwriting the holes */
-                MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: `%s' (errno=%d %s)",
-                          dest_path, errno, strerror(errno));
-                rc = -1;
-            }
-        } else if (errno == -ENOENT) {
-            /* destination does not exist, which is fine */
-            status = 0;
-        } else {
-            /* had an error stating destination file */
-            MFU_LOG(MFU_LOG_ERR, "mfu_lstat() file: `%s' (errno=%d %s)",
-                      dest_path, errno, strerror(errno));
-        }
-    }
+    /* get mtime seconds and nsecs */
+    uint64_t mtime      = mfu_flist_file_get_mtime(flist, idx);
+    uint64_t mtime_nsec = mfu_flist_file_get_mtime_nsec(flist, idx);
 
-    /* free destination path */
-    mfu_free(&dest_path);
+    /* fill in time structures */
+    struct timespec times[2];
+    times[0].tv_sec  = (time_t) atime;
+    times[0].tv_nsec = (long)   atime_nsec;
+    times[1].tv_sec  = (time_t) mtime;
+    times[1].tv_nsec = (long)   mtime_nsec;
 
-    /* increment our file count by one */
-    mfu_copy_stats.total_files++;
+    /* set times with nanosecond precision using utimensat,
+     * relative to the parent directory, or to the current working
+     * directory if the path is not absolute and we have no parent,
+     * and set times on link (not target file) if dest_path refers
+     * to a link */
+    const char* base;
+    int dirfd = mfu_copy_parent_fd(dest_path, &base);
+    if(mfu_utimensat(dirfd, base, times, AT_SYMLINK_NOFOLLOW) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to change timestamps on `%s' utime() (errno=%d %s)",
+            dest_path, errno, strerror(errno)
+           );
+        rc = -1;
+    }
 
     return rc;
 }
 
-/* creates hardlink in destpath for specified file, identifies source path
- * returns 0 on success and -1 on error */
-static int mfu_create_hardlink(mfu_flist list, uint64_t idx,
-        const mfu_param_path* srcpath,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* set ownership, permissions, and timestamps on a regular file through
+ * a descriptor we have open on it, which avoids looking up dest_path
+ * for each call, returns 0 on success and -1 on error */
+static int mfu_copy_metadata_fd(
+    mfu_flist flist,
+    uint64_t idx,
+    const char* dest_path,
+    int fd,
+    mfu_copy_opts_t* mfu_copy_opts)
 {
     /* assume we'll succeed */
     int rc = 0;
 
-    /* get source name */
-    const char* src_path = mfu_flist_file_get_name(list, idx);
+    mode_t mode = (mode_t) mfu_flist_file_get_mode(flist, idx);
 
-    /* get destination name */
-    const char* dest_path = mfu_param_path_copy_dest(src_path, 1,
-            srcpath, destpath, mfu_copy_opts);
+    if (! mfu_copy_opts->preserve) {
+        /* TODO: set permissions based on source permissons
+         * masked by umask */
+        if (mfu_fchmod(fd, mode) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' fchmod() (errno=%d %s)",
+                dest_path, errno, strerror(errno)
+               );
+            rc = -1;
+        }
+        return rc;
+    }
 
-    /* No need to copy it */
-    if (dest_path == NULL) {
-        return 0;
+    /* change ownership, as with lchown, don't report EPERM since
+     * the user running dcp may not own the source file */
+    uid_t uid = (uid_t) mfu_flist_file_get_uid(flist, idx);
+    gid_t gid = (gid_t) mfu_flist_file_get_gid(flist, idx);
+    if (mfu_fchown(fd, uid, gid) != 0) {
+        if (errno != EPERM) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to change ownership on `%s' fchown() (errno=%d %s)",
+                dest_path, errno, strerror(errno)
+               );
+        }
+        rc = -1;
     }
 
-    rc = mfu_hardlink(src_path, dest_path);
-    if (rc != 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to create hardlink %s --> %s",
-                dest_path, src_path);
-        mfu_free(&dest_path);
-        return rc;
+    if (mfu_fchmod(fd, mode) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to change permissions on `%s' fchmod() (errno=%d %s)",
+            dest_path, errno, strerror(errno)
+           );
+        rc = -1;
     }
 
-    /* free destination path */
-    mfu_free(&dest_path);
+    if (mfu_copy_acls(flist, idx, dest_path) < 0) {
+        rc = -1;
+    }
 
-    /* increment our file count by one */
-    mfu_copy_stats.total_files++;
+    /* set timestamps last, after all data has been written */
+    struct timespec times[2];
+    times[0].tv_sec  = (time_t) mfu_flist_file_get_atime(flist, idx);
+    times[0].tv_nsec = (long)   mfu_flist_file_get_atime_nsec(flist, idx);
+    times[1].tv_sec  = (time_t) mfu_flist_file_get_mtime(flist, idx);
+    times[1].tv_nsec = (long)   mfu_flist_file_get_mtime_nsec(flist, idx);
+    if (mfu_futimens(fd, times) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to change timestamps on `%s' futimens() (errno=%d %s)",
+            dest_path, errno, strerror(errno)
+           );
+        rc = -1;
+    }
 
     return rc;
 }
 
-/* progress message to print while creating files */
-static void create_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+/* progress message to print while setting file metadata */
+static void meta_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
 {
 #if 0
-    /* compute percentage of items removed */
-    double percent = 0.0;
-    if (remove_count_total > 0) {
-        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    /* compute percentage of items removed */
+    double percent = 0.0;
+    if (remove_count_total > 0) {
+        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    }
+#endif
+
+    /* compute average delete rate */
+    double rate = 0.0;
+    if (secs > 0) {
+        rate = (double)vals[0] / secs;
+    }
+
+#if 0
+    /* compute estimated time remaining */
+    double secs_remaining = -1.0;
+    if (rate > 0.0) {
+        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
+    }
+#endif
+
+    if (complete < ranks) {
+        MFU_LOG(MFU_LOG_INFO, "Updated %llu items in %f secs (%f items/sec) ...",
+            vals[0], secs, rate);
+    } else {
+        MFU_LOG(MFU_LOG_INFO, "Updated %llu items in %f secs (%f items/sec) done",
+            vals[0], secs, rate);
+    }
+}
+
+/****************************************
+ * Directories in dependency order
+ ***************************************/
+
+/* Rather than working through directories one level at a time with a
+ * barrier between levels, a directory is created as soon as its
+ * parent exists, and its metadata is set once that of all of its
+ * subdirectories has been set.  Directories are spread over ranks by
+ * a hash of their name, so any rank can find where a parent lives, and
+ * ranks tell each other which directories are done in batches. */
+
+/* number of directory indices sent to a rank in one message */
+#define MFU_COPY_WAVE_BATCH (1024)
+
+/* parent index of a directory whose parent is not in the list */
+#define MFU_COPY_WAVE_NONE (UINT64_MAX)
+
+/* dependencies between directories spread over ranks */
+typedef struct {
+    mfu_flist list;        /* directories held by this rank */
+    uint64_t size;         /* number of directories in list */
+    int* parent_rank;      /* rank holding parent of each directory, -1 if none */
+    uint64_t* parent_idx;  /* index of parent in the list on that rank */
+    uint64_t* child_start; /* children of i are entries child_start[i] to child_start[i+1]-1 */
+    int* child_rank;       /* rank holding each child */
+    uint64_t* child_idx;   /* index of each child in the list on that rank */
+} mfu_copy_dirdeps_t;
+
+/* pick out directories from list, spread them over ranks, and find
+ * the parent and children of each one, collective */
+static void mfu_copy_dirdeps_build(mfu_flist list, mfu_copy_dirdeps_t* deps)
+{
+    int i;
+    uint64_t idx;
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* send each directory to the rank its name hashes to */
+    mfu_flist dirs = mfu_flist_subset(list);
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(list, idx) == MFU_TYPE_DIR) {
+            mfu_flist_file_copy(list, idx, dirs);
+        }
+    }
+    mfu_flist_summarize(dirs);
+    deps->list = mfu_flist_remap(dirs, mfu_copy_name_map, NULL);
+    mfu_flist_free(&dirs);
+
+    size = mfu_flist_size(deps->list);
+    deps->size        = size;
+    deps->parent_rank = (int*) MFU_MALLOC(size * sizeof(int));
+    deps->parent_idx  = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    deps->child_start = (uint64_t*) MFU_MALLOC((size + 1) * sizeof(uint64_t));
+
+    /* index our directories by name */
+    strmap* names = strmap_new();
+    for (idx = 0; idx < size; idx++) {
+        char value[32];
+        snprintf(value, sizeof(value), "%llu", (unsigned long long) idx);
+        strmap_set(names, mfu_flist_file_get_name(deps->list, idx), value);
+    }
+
+    /* ask the rank that would hold the parent of each directory for
+     * its index, each request is the child index and parent name */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    char** parents = (char**) MFU_MALLOC(size * sizeof(char*));
+    int* dests     = (int*) MFU_MALLOC(size * sizeof(int));
+    for (idx = 0; idx < size; idx++) {
+        mfu_path* path = mfu_path_from_str(mfu_flist_file_get_name(deps->list, idx));
+        mfu_path_dirname(path);
+        parents[idx] = mfu_path_strdup(path);
+        mfu_path_delete(&path);
+
+        dests[idx] = mfu_copy_name_rank(parents[idx], ranks);
+        sendcounts[dests[idx]] += 8 + (int)strlen(parents[idx]) + 1;
+    }
+
+    int sendtotal = 0;
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = sendtotal;
+        sendtotal += sendcounts[i];
+    }
+
+    char* sendbuf = (char*) MFU_MALLOC((size_t)sendtotal + 1);
+    for (idx = 0; idx < size; idx++) {
+        char* ptr = sendbuf + offsets[dests[idx]];
+        mfu_pack_uint64(&ptr, idx);
+        size_t len = strlen(parents[idx]) + 1;
+        memcpy(ptr, parents[idx], len);
+        offsets[dests[idx]] += 8 + (int)len;
+        mfu_free(&parents[idx]);
+    }
+    mfu_free(&parents);
+
+    int recvtotal;
+    char* recvbuf = mfu_copy_exchange(sendbuf, sendcounts, recvcounts, &recvtotal);
+    mfu_free(&sendbuf);
+
+    /* count the children of each of our directories */
+    uint64_t requests = 0;
+    for (idx = 0; idx <= size; idx++) {
+        deps->child_start[idx] = 0;
+    }
+    const char* ptr = recvbuf;
+    const char* end = recvbuf + recvtotal;
+    while (ptr < end) {
+        uint64_t child;
+        mfu_unpack_uint64(&ptr, &child);
+        const char* value = strmap_get(names, ptr);
+        if (value != NULL) {
+            uint64_t parent = strtoull(value, NULL, 10);
+            deps->child_start[parent + 1]++;
+        }
+        ptr += strlen(ptr) + 1;
+        requests++;
+    }
+    for (idx = 0; idx < size; idx++) {
+        deps->child_start[idx + 1] += deps->child_start[idx];
+    }
+    uint64_t children = deps->child_start[size];
+    deps->child_rank = (int*) MFU_MALLOC(children * sizeof(int));
+    deps->child_idx  = (uint64_t*) MFU_MALLOC(children * sizeof(uint64_t));
+
+    /* record each child, and reply to each request with the index
+     * of the parent, or with none if the parent is not in the list */
+    uint64_t* filled = (uint64_t*) MFU_MALLOC((size + 1) * sizeof(uint64_t));
+    for (idx = 0; idx < size; idx++) {
+        filled[idx] = deps->child_start[idx];
+    }
+    char* replybuf = (char*) MFU_MALLOC((size_t)requests * 16 + 1);
+    char* out = replybuf;
+    ptr = recvbuf;
+    for (i = 0; i < ranks; i++) {
+        end = ptr + recvcounts[i];
+        sendcounts[i] = 0;
+        while (ptr < end) {
+            uint64_t child;
+            mfu_unpack_uint64(&ptr, &child);
+            uint64_t parent = MFU_COPY_WAVE_NONE;
+            const char* value = strmap_get(names, ptr);
+            if (value != NULL) {
+                parent = strtoull(value, NULL, 10);
+                deps->child_rank[filled[parent]] = i;
+                deps->child_idx[filled[parent]]  = child;
+                filled[parent]++;
+            }
+            ptr += strlen(ptr) + 1;
+
+            mfu_pack_uint64(&out, child);
+            mfu_pack_uint64(&out, parent);
+            sendcounts[i] += 16;
+        }
+    }
+    mfu_free(&filled);
+    mfu_free(&recvbuf);
+    strmap_delete(&names);
+
+    /* record the parent of each of our directories */
+    char* answers = mfu_copy_exchange(replybuf, sendcounts, recvcounts, &recvtotal);
+    mfu_free(&replybuf);
+
+    ptr = answers;
+    for (i = 0; i < ranks; i++) {
+        end = ptr + recvcounts[i];
+        while (ptr < end) {
+            uint64_t child, parent;
+            mfu_unpack_uint64(&ptr, &child);
+            mfu_unpack_uint64(&ptr, &parent);
+            deps->parent_rank[child] = (parent != MFU_COPY_WAVE_NONE) ? i : -1;
+            deps->parent_idx[child]  = parent;
+        }
+    }
+    mfu_free(&answers);
+
+    mfu_free(&dests);
+    mfu_free(&offsets);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+}
+
+static void mfu_copy_dirdeps_free(mfu_copy_dirdeps_t* deps)
+{
+    mfu_flist_free(&deps->list);
+    mfu_free(&deps->parent_rank);
+    mfu_free(&deps->parent_idx);
+    mfu_free(&deps->child_start);
+    mfu_free(&deps->child_rank);
+    mfu_free(&deps->child_idx);
+}
+
+/* indices of finished directories waiting to be sent to each rank,
+ * and sends still in flight */
+typedef struct {
+    MPI_Comm comm;
+    uint64_t** batch;  /* indices waiting for each rank, NULL if none */
+    int* batch_count;  /* number of indices waiting for each rank */
+    MPI_Request* reqs; /* sends in flight */
+    uint64_t** bufs;   /* buffers of sends in flight */
+    int nreqs;         /* number of sends in flight */
+    int maxreqs;       /* capacity of reqs and bufs */
+} mfu_copy_wave_t;
+
+/* send indices waiting for rank r, if any, and free the buffers
+ * of sends that have completed */
+static void mfu_copy_wave_flush(mfu_copy_wave_t* wave, int r)
+{
+    if (wave->batch_count[r] > 0) {
+        if (wave->nreqs == wave->maxreqs) {
+            wave->maxreqs = (wave->maxreqs > 0) ? wave->maxreqs * 2 : 16;
+            wave->reqs = (MPI_Request*) realloc(wave->reqs, (size_t)wave->maxreqs * sizeof(MPI_Request));
+            wave->bufs = (uint64_t**) realloc(wave->bufs, (size_t)wave->maxreqs * sizeof(uint64_t*));
+            if (wave->reqs == NULL || wave->bufs == NULL) {
+                MFU_ABORT(-1, "Failed to allocate %d requests", wave->maxreqs);
+            }
+        }
+        MPI_Isend(wave->batch[r], wave->batch_count[r], MPI_UINT64_T, r, 0,
+            wave->comm, &wave->reqs[wave->nreqs]);
+        wave->bufs[wave->nreqs] = wave->batch[r];
+        wave->nreqs++;
+        wave->batch[r] = NULL;
+        wave->batch_count[r] = 0;
+    }
+
+    /* drop completed sends, moving the last one into their place */
+    int i = 0;
+    while (i < wave->nreqs) {
+        int done = 0;
+        MPI_Test(&wave->reqs[i], &done, MPI_STATUS_IGNORE);
+        if (done) {
+            mfu_free(&wave->bufs[i]);
+            wave->nreqs--;
+            wave->reqs[i] = wave->reqs[wave->nreqs];
+            wave->bufs[i] = wave->bufs[wave->nreqs];
+        } else {
+            i++;
+        }
+    }
+}
+
+/* function applied to each directory, returns 0 on success and -1 on error */
+typedef int (*mfu_copy_dir_fn)(mfu_flist list, uint64_t idx, void* arg);
+
+/* apply fn to each directory in deps once those it depends on are
+ * done, parents before children, or children before parents if
+ * bottom_up is set, sets count to the number of directories this
+ * rank processed, returns 0 on success and -1 if fn failed on any
+ * directory on this rank, collective */
+static int mfu_copy_dirs_wavefront(const mfu_copy_dirdeps_t* deps, int bottom_up,
+        mfu_copy_dir_fn fn, void* arg, uint64_t* count)
+{
+    int rc = 0;
+    int i;
+    uint64_t idx;
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* count how many directories each one waits on, and start
+     * with those that wait on none */
+    uint64_t size = deps->size;
+    uint64_t* pending = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t* ready   = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    uint64_t nready = 0;
+    for (idx = 0; idx < size; idx++) {
+        if (bottom_up) {
+            pending[idx] = deps->child_start[idx + 1] - deps->child_start[idx];
+        } else {
+            pending[idx] = (deps->parent_rank[idx] >= 0) ? 1 : 0;
+        }
+        if (pending[idx] == 0) {
+            ready[nready++] = idx;
+        }
+    }
+
+    /* use our own communicator so messages can't match anyone else's */
+    mfu_copy_wave_t wave;
+    MPI_Comm_dup(MPI_COMM_WORLD, &wave.comm);
+    wave.batch       = (uint64_t**) MFU_MALLOC((size_t)ranks * sizeof(uint64_t*));
+    wave.batch_count = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    wave.reqs        = NULL;
+    wave.bufs        = NULL;
+    wave.nreqs       = 0;
+    wave.maxreqs     = 0;
+    for (i = 0; i < ranks; i++) {
+        wave.batch[i]       = NULL;
+        wave.batch_count[i] = 0;
+    }
+
+    uint64_t* recvbuf = (uint64_t*) MFU_MALLOC(MFU_COPY_WAVE_BATCH * sizeof(uint64_t));
+
+    uint64_t done = 0;
+    while (done < size) {
+        /* take in directories that other ranks have finished, if we
+         * have nothing ready, send what we have and block until
+         * another rank tells us something */
+        while (1) {
+            int flag = 0;
+            MPI_Status status;
+            if (nready > 0) {
+                MPI_Iprobe(MPI_ANY_SOURCE, 0, wave.comm, &flag, &status);
+                if (! flag) {
+                    break;
+                }
+            } else {
+                for (i = 0; i < ranks; i++) {
+                    mfu_copy_wave_flush(&wave, i);
+                }
+                MPI_Probe(MPI_ANY_SOURCE, 0, wave.comm, &status);
+            }
+
+            int n;
+            MPI_Get_count(&status, MPI_UINT64_T, &n);
+            MPI_Recv(recvbuf, n, MPI_UINT64_T, status.MPI_SOURCE, 0, wave.comm, MPI_STATUS_IGNORE);
+            int k;
+            for (k = 0; k < n; k++) {
+                uint64_t j = recvbuf[k];
+                pending[j]--;
+                if (pending[j] == 0) {
+                    ready[nready++] = j;
+                }
+            }
+        }
+
+        /* process a directory */
+        idx = ready[--nready];
+        if (fn(deps->list, idx, arg) < 0) {
+            rc = -1;
+        }
+        done++;
+
+        /* and tell those that wait on it */
+        uint64_t first = 0;
+        uint64_t last  = 0;
+        if (! bottom_up) {
+            first = deps->child_start[idx];
+            last  = deps->child_start[idx + 1];
+        } else if (deps->parent_rank[idx] >= 0) {
+            last = 1;
+        }
+        uint64_t k;
+        for (k = first; k < last; k++) {
+            int r      = bottom_up ? deps->parent_rank[idx] : deps->child_rank[k];
+            uint64_t j = bottom_up ? deps->parent_idx[idx]  : deps->child_idx[k];
+            if (r == rank) {
+                pending[j]--;
+                if (pending[j] == 0) {
+                    ready[nready++] = j;
+                }
+                continue;
+            }
+            if (wave.batch[r] == NULL) {
+                wave.batch[r] = (uint64_t*) MFU_MALLOC(MFU_COPY_WAVE_BATCH * sizeof(uint64_t));
+            }
+            wave.batch[r][wave.batch_count[r]++] = j;
+            if (wave.batch_count[r] == MFU_COPY_WAVE_BATCH) {
+                mfu_copy_wave_flush(&wave, r);
+            }
+        }
+    }
+
+    /* send what's left and wait for the rest to be received */
+    for (i = 0; i < ranks; i++) {
+        mfu_copy_wave_flush(&wave, i);
+    }
+    MPI_Waitall(wave.nreqs, wave.reqs, MPI_STATUSES_IGNORE);
+    for (i = 0; i < wave.nreqs; i++) {
+        mfu_free(&wave.bufs[i]);
+    }
+    free(wave.reqs);
+    free(wave.bufs);
+    mfu_free(&wave.batch_count);
+    mfu_free(&wave.batch);
+    MPI_Comm_free(&wave.comm);
+
+    mfu_free(&recvbuf);
+    mfu_free(&ready);
+    mfu_free(&pending);
+
+    *count = done;
+    return rc;
+}
+
+/* arguments passed through mfu_copy_dirs_wavefront */
+typedef struct {
+    int numpaths;
+    const mfu_param_path* paths;
+    const mfu_param_path* destpath;
+    mfu_copy_opts_t* mfu_copy_opts;
+} mfu_copy_dir_args_t;
+
+/* set ownership, permissions, ACLs, and timestamps on an item
+ * when preserving, or just its permissions otherwise,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_item_metadata(mfu_flist list, uint64_t idx,
+        const char* dest, mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rc = 0;
+    int tmp_rc;
+
+    /* wait for our turn if metadata operations are limited */
+    mfu_throttle_charge(0, 1);
+
+    if(mfu_copy_opts->preserve) {
+        tmp_rc = mfu_copy_ownership(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        tmp_rc = mfu_copy_permissions(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        tmp_rc = mfu_copy_acls(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        tmp_rc = mfu_copy_timestamps(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+    else {
+        /* TODO: set permissions based on source permissons
+         * masked by umask */
+        tmp_rc = mfu_copy_permissions(list, idx, dest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+
+    return rc;
+}
+
+/* set ownership, permissions, and timestamps on the regular files
+ * in list, opening each file once and updating it through the
+ * descriptor rather than looking up its path for each call, falls
+ * back to the path if the file can't be opened, nothing depends on
+ * the order files are updated in, so this takes a single pass,
+ * if failed is not NULL, sets failed[idx] for each file of list
+ * that could not be updated */
+static int mfu_copy_set_metadata_files(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int* failed)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        if(mfu_copy_opts->preserve) {
+            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps on files.");
+        }
+        else {
+            MFU_LOG(MFU_LOG_INFO, "Fixing permissions on files.");
+        }
+    }
+
+    /* start timer for entire operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start progress messages while setting metadata */
+    mfu_progress* meta_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, meta_progress_fn);
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        if (type != MFU_TYPE_FILE) {
+            continue;
+        }
+
+        /* get destination name of item */
+        const char* name = mfu_flist_file_get_name(list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+
+        /* No need to copy it */
+        if (dest == NULL) {
+            continue;
+        }
+
+        total_count++;
+
+        /* open the file in its parent directory, we only need a
+         * descriptor to refer to it, so a read-only open will do */
+        const char* base;
+        int dirfd = mfu_copy_parent_fd(dest, &base);
+        int fd = mfu_openat(dirfd, base, O_RDONLY | O_NOFOLLOW);
+        int tmp_rc;
+        if (fd < 0) {
+            /* we may not be allowed to read it, try by path */
+            tmp_rc = mfu_copy_item_metadata(list, idx, dest, mfu_copy_opts);
+        } else {
+            /* wait for our turn if metadata operations are limited */
+            mfu_throttle_charge(0, 1);
+
+            tmp_rc = mfu_copy_metadata_fd(list, idx, dest, fd, mfu_copy_opts);
+            mfu_close(dest, fd);
+        }
+        if (tmp_rc < 0) {
+            if (failed != NULL) {
+                failed[idx] = 1;
+            }
+            rc = -1;
+        }
+
+        mfu_free(&dest);
+
+        /* update number of items we have completed for progress messages */
+        mfu_progress_update(&total_count, meta_prog);
+    }
+
+    /* finalize progress messages */
+    mfu_progress_complete(&total_count, &meta_prog);
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Updated %lu files in %f seconds (%f files/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* iterate through list of items other than regular files, which
+ * are done by mfu_copy_set_metadata_files, and set ownership,
+ * timestamps, and permissions starting from deepest level and
+ * working upwards, we go in this direction in case updating a file
+ * updates its parent directory, if skipped is not NULL, sets
+ * skipped[level][idx] for each item that could not be updated */
+static int mfu_copy_set_metadata(int levels, int minlevel, mfu_flist* lists,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int** skipped)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        if(mfu_copy_opts->preserve) {
+            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps.");
+        }
+        else {
+            MFU_LOG(MFU_LOG_INFO, "Fixing permissions.");
+        }
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start progress messages while setting metadata */
+    mfu_progress* meta_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, meta_progress_fn);
+
+    /* now set timestamps on files starting from deepest level */
+    int tmp_rc;
+    int level;
+    for (level = levels-1; level >= 0; level--) {
+        /* get list at this level */
+        mfu_flist list = lists[level];
+
+        /* cycle through our list of items and set timestamps
+         * for each one at this level */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        for (idx = 0; idx < size; idx++) {
+            /* regular files were done in their own pass */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (type == MFU_TYPE_FILE) {
+                continue;
+            }
+
+            /* get source name of item */
+            const char* name = mfu_flist_file_get_name(list, idx);
+
+            /* get destination name of item */
+            char* dest = mfu_param_path_copy_dest(name, numpaths,
+                    paths, destpath, mfu_copy_opts);
+
+            /* No need to copy it */
+            if (dest == NULL) {
+                continue;
+            }
+
+            /* update our running total */
+            total_count++;
+
+            tmp_rc = mfu_copy_item_metadata(list, idx, dest, mfu_copy_opts);
+            if (tmp_rc < 0) {
+                if (skipped != NULL) {
+                    skipped[level][idx] = 1;
+                }
+                rc = -1;
+            }
+
+            /* free destination item */
+            mfu_free(&dest);
+
+            /* update number of items we have completed for progress messages */
+            mfu_progress_update(&total_count, meta_prog);
+        }
+
+        /* wait for all procs to finish before we start
+         * with files at next level */
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    /* finalize progress messages */
+    mfu_progress_complete(&total_count, &meta_prog);
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Updated %lu items in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* iterate through list of files and set ownership, timestamps,
+ * and permissions starting from deepest level and working upwards,
+ * we go in this direction in case updating a file updates its
+ * parent directory */
+static int mfu_copy_set_metadata_dirs(int levels, int minlevel, mfu_flist* lists,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        if(mfu_copy_opts->preserve) {
+            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps on directories.");
+        }
+        else {
+            MFU_LOG(MFU_LOG_INFO, "Fixing permissions on directories.");
+        }
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* now set timestamps on files starting from deepest level */
+    int tmp_rc;
+    int level;
+    for (level = levels-1; level >= 0; level--) {
+        /* get list at this level */
+        mfu_flist list = lists[level];
+
+        /* cycle through our list of items and set timestamps
+         * for each one at this level */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        for (idx = 0; idx < size; idx++) {
+            /* TODO: skip file if it's not readable */
+
+            /* get source name of item */
+            const char* name = mfu_flist_file_get_name(list, idx);
+
+            /* get destination name of item */
+            char* dest = mfu_param_path_copy_dest(name, numpaths,
+                    paths, destpath, mfu_copy_opts);
+
+            /* No need to copy it */
+            if (dest == NULL) {
+                continue;
+            }
+
+            /* only need to set metadata on directories */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (type != MFU_TYPE_DIR) {
+                continue;
+            }
+
+            /* update our running total */
+            total_count++;
+
+            tmp_rc = mfu_copy_item_metadata(list, idx, dest, mfu_copy_opts);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+
+            /* free destination item */
+            mfu_free(&dest);
+        }
+
+        /* wait for all procs to finish before we start
+         * with files at next level */
+        MPI_Barrier(MPI_COMM_WORLD);
+    }
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Updated %lu items in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* set metadata on one directory for mfu_copy_dirs_wavefront */
+static int mfu_copy_dir_metadata_fn(mfu_flist list, uint64_t idx, void* arg)
+{
+    mfu_copy_dir_args_t* args = (mfu_copy_dir_args_t*) arg;
+
+    const char* name = mfu_flist_file_get_name(list, idx);
+    char* dest = mfu_param_path_copy_dest(name, args->numpaths,
+            args->paths, args->destpath, args->mfu_copy_opts);
+    if (dest == NULL) {
+        return 0;
+    }
+
+    int rc = mfu_copy_item_metadata(list, idx, dest, args->mfu_copy_opts);
+    mfu_free(&dest);
+    return rc;
+}
+
+/* like mfu_copy_set_metadata_dirs, but each directory is updated as
+ * soon as all of its subdirectories have been, without waiting for
+ * the rest of their level, collective */
+static int mfu_copy_set_metadata_dirs_wavefront(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    if (rank == 0) {
+        if(mfu_copy_opts->preserve) {
+            MFU_LOG(MFU_LOG_INFO, "Setting ownership, permissions, and timestamps on directories.");
+        }
+        else {
+            MFU_LOG(MFU_LOG_INFO, "Fixing permissions on directories.");
+        }
+    }
+
+    /* start timer for entire operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+
+    mfu_copy_dirdeps_t deps;
+    mfu_copy_dirdeps_build(list, &deps);
+
+    mfu_copy_dir_args_t args;
+    args.numpaths      = numpaths;
+    args.paths         = paths;
+    args.destpath      = destpath;
+    args.mfu_copy_opts = mfu_copy_opts;
+
+    uint64_t total_count;
+    int rc = mfu_copy_dirs_wavefront(&deps, 1, mfu_copy_dir_metadata_fn, &args, &total_count);
+
+    mfu_copy_dirdeps_free(&deps);
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Updated %lu items in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* creates dir in destpath for specified item, identifies source path
+ * that contains source dir, computes relative path to dir under source path,
+ * and creates dir at same relative path under destpath, copies xattrs
+ * when preserving permissions, which contains file striping info on Lustre,
+ * returns 0 on success and -1 on error */
+static int mfu_create_directory(mfu_flist list, uint64_t idx,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get name of directory */
+    const char* name = mfu_flist_file_get_name(list, idx);
+
+    /* get destination name */
+    char* dest_path = mfu_param_path_copy_dest(name, numpaths, paths,
+            destpath, mfu_copy_opts);
+
+    /* No need to copy it */
+    if (dest_path == NULL) {
+        return 0;
+    }
+
+    /* wait for our turn if metadata operations are limited */
+    mfu_throttle_charge(0, 1);
+
+    /* Skipping the destination directory ONLY if it already exists.
+     * If we are doing a sync operation and if the dest dir does not
+     * exist, we need to create it. The reason that
+     * the dest_path and the destpath->path are compared is because
+     * if we are syncing two directories we want the tree to have the
+     * same number of levels. If dsync is on then only the contents of
+     * the top level source directory will be copied (if necessary) into
+     * the target directory. So, the top level src directory is removed
+     * from the destination path. This path slicing based on whether or
+     * not dsync is on happens prior to this in
+     * mfu_param_path_copy_dest. */
+
+    if (mfu_copy_opts->do_sync &&
+        (strncmp(dest_path, destpath->path, strlen(dest_path)) == 0) &&
+        destpath->target_stat_valid)
+    {
+        mfu_free(&dest_path);
+        return 0;
+    }
+
+    /* create the destination directory */
+    MFU_LOG(MFU_LOG_DBG, "Creating directory `%s'", dest_path);
+    const char* base;
+    int dirfd = mfu_copy_parent_fd(dest_path, &base);
+    int mkdir_rc = mfu_mkdirat(dirfd, base, DCOPY_DEF_PERMS_DIR);
+    if(mkdir_rc < 0) {
+        if(errno == EEXIST) {
+            MFU_LOG(MFU_LOG_WARN,
+                    "Original directory exists, skip the creation: `%s' (errno=%d %s)",
+                    dest_path, errno, strerror(errno));
+
+        } else {
+            MFU_LOG(MFU_LOG_ERR, "Create `%s' mkdir() failed (errno=%d %s)",
+                    dest_path, errno, strerror(errno)
+            );
+            mfu_free(&dest_path);
+            return -1;
+        }
+    }
+
+    /* we do this now in case there are Lustre attributes for
+     * creating / striping files in the directory */
+
+    /* copy extended attributes on directory */
+    if (mfu_copy_opts->preserve) {
+        int tmp_rc = mfu_copy_xattrs(list, idx, dest_path, -1);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+
+    /* increment our directory count by one */
+    mfu_copy_stats.total_dirs++;
+
+    /* free the directory name */
+    mfu_free(&dest_path);
+
+    return rc;
+}
+
+/* create directories, we work from shallowest level to the deepest
+ * with a barrier in between levels, so that we don't try to create
+ * a child directory until the parent exists,
+ * returns 0 on success and -1 on failure */
+static int mfu_create_directories(int levels, int minlevel, mfu_flist* lists,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* indicate to user what phase we're in */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Creating directories.");
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* work from shallowest level to deepest level */
+    int level;
+    for (level = 0; level < levels; level++) {
+        /* time how long this takes */
+        double start = MPI_Wtime();
+
+        /* get list of items for this level */
+        mfu_flist list = lists[level];
+
+        /* create each directory we have at this level */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        uint64_t count = 0;
+        for (idx = 0; idx < size; idx++) {
+            /* check whether we have a directory */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (type == MFU_TYPE_DIR) {
+                /* create the directory */
+                int tmp_rc = mfu_create_directory(list, idx, numpaths,
+                        paths, destpath, mfu_copy_opts);
+                if (tmp_rc < 0) {
+                    rc = -1;
+                }
+
+                count++;
+            }
+        }
+
+        /* add items to our running total */
+        total_count += count;
+
+        /* wait for all procs to finish before we start
+         * creating directories at next level */
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        /* stop our timer */
+        double end = MPI_Wtime();
+
+         /* print statistics */
+        if (verbose) {
+            uint64_t min, max, sum;
+            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+            double rate = 0.0;
+            double secs = end - start;
+            if (secs > 0.0) {
+              rate = (double)sum / secs;
+            }
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f/sec secs=%f",
+                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
+                );
+            }
+        }
+    }
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Created %lu directories in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* create one directory for mfu_copy_dirs_wavefront */
+static int mfu_create_directory_fn(mfu_flist list, uint64_t idx, void* arg)
+{
+    mfu_copy_dir_args_t* args = (mfu_copy_dir_args_t*) arg;
+    return mfu_create_directory(list, idx, args->numpaths,
+            args->paths, args->destpath, args->mfu_copy_opts);
+}
+
+/* create directories, like mfu_create_directories, but each one is
+ * created as soon as its parent exists rather than after the whole
+ * level above it, returns 0 on success and -1 on failure, collective */
+static int mfu_create_directories_wavefront(mfu_flist list,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* indicate to user what phase we're in */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Creating directories.");
+    }
+
+    /* start timer for entire operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+
+    mfu_copy_dirdeps_t deps;
+    mfu_copy_dirdeps_build(list, &deps);
+
+    mfu_copy_dir_args_t args;
+    args.numpaths      = numpaths;
+    args.paths         = paths;
+    args.destpath      = destpath;
+    args.mfu_copy_opts = mfu_copy_opts;
+
+    uint64_t total_count;
+    int rc = mfu_copy_dirs_wavefront(&deps, 0, mfu_create_directory_fn, &args, &total_count);
+
+    mfu_copy_dirdeps_free(&deps);
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Created %lu directories in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* creates symlink in destpath for specified file, identifies source path
+ * that contains source link, computes relative path to link under source path,
+ * and creates link at same relative path under destpath,
+ * returns 0 on success, 1 if an item already existed at the
+ * destination and was left as it is, and -1 on error */
+static int mfu_create_link(mfu_flist list, uint64_t idx,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get source name */
+    const char* src_path = mfu_flist_file_get_name(list, idx);
+
+    /* get destination name */
+    const char* dest_path = mfu_param_path_copy_dest(src_path, numpaths,
+           paths, destpath, mfu_copy_opts);
+
+    /* No need to copy it */
+    if (dest_path == NULL) {
+        return 0;
+    }
+
+    /* wait for our turn if metadata operations are limited */
+    mfu_throttle_charge(0, 1);
+
+    /* read link target */
+    char path[PATH_MAX + 1];
+    const char* src_base;
+    int src_dirfd = mfu_copy_parent_fd(src_path, &src_base);
+    ssize_t readlink_rc = mfu_readlinkat(src_dirfd, src_base, path, sizeof(path) - 1);
+    if(readlink_rc < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to read link `%s' readlink() (errno=%d %s)",
+            src_path, errno, strerror(errno)
+        );
+        mfu_free(&dest_path);
+        return -1;
+    }
+
+    /* ensure that string ends with NUL */
+    path[readlink_rc] = '\0';
+
+    /* create new link */
+    const char* base;
+    int dirfd = mfu_copy_parent_fd(dest_path, &base);
+    int symlink_rc = mfu_symlinkat(path, dirfd, base);
+    if(symlink_rc < 0) {
+        if(errno == EEXIST) {
+            MFU_LOG(MFU_LOG_WARN,
+                    "Original link exists, skip the creation: `%s' (errno=%d %s)",
+                    dest_path, errno, strerror(errno));
+            rc = 1;
+        } else {
+            MFU_LOG(MFU_LOG_ERR, "Create `%s' symlink() failed, (errno=%d %s)",
+                    dest_path, errno, strerror(errno)
+            );
+            mfu_free(&dest_path);
+            return -1;
+        }
+    }
+
+    /* set permissions on link we created */
+    if (mfu_copy_opts->preserve && rc == 0) {
+        int xattr_rc = mfu_copy_xattrs(list, idx, dest_path, -1);
+        if (xattr_rc < 0) {
+            rc = -1;
+        }
+    }
+
+    /* free destination path */
+    mfu_free(&dest_path);
+
+    /* increment our directory count by one */
+    mfu_copy_stats.total_links++;
+
+    return rc;
+}
+
+/* allocate space for a destination file before its data is written,
+ * so that chunks written in any order by many processes land in few
+ * extents, sparse copies allocate only the data extents of the source
+ * and leave the file size for the copy to set,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_preallocate(const char* src, const char* dest,
+        int out_fd, uint64_t file_size, mfu_copy_opts_t* mfu_copy_opts)
+{
+#ifdef FALLOC_FL_KEEP_SIZE
+    if (mfu_copy_prealloc_unsupported || file_size == 0) {
+        return 0;
+    }
+
+    int rc = 0;
+    uint64_t bytes = 0;
+    if (mfu_copy_opts->sparse) {
+        mfu_fdcache_entry* in_file = mfu_copy_open_file(src, 1, mfu_copy_opts);
+        if (in_file == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            return -1;
+        }
+
+        mfu_extent_iter it;
+        mfu_extent_iter_init(&it, src, in_file->fd, 0, (off_t) file_size);
+        off_t start, len;
+        int found;
+        while ((found = mfu_extent_iter_next(&it, &start, &len)) > 0) {
+            rc = fallocate(out_fd, FALLOC_FL_KEEP_SIZE, start, len);
+            if (rc != 0) {
+                break;
+            }
+            bytes += (uint64_t) len;
+        }
+        if (found < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to find data extents in source path `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+            return -1;
+        }
+    } else {
+        rc = fallocate(out_fd, 0, 0, (off_t) file_size);
+        bytes = file_size;
+    }
+
+    if (rc != 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            /* don't bother trying again on this process */
+            MFU_LOG(MFU_LOG_DBG, "File system does not support fallocate on `%s', not preallocating files",
+                dest);
+            mfu_copy_prealloc_unsupported = 1;
+            return 0;
+        }
+        MFU_LOG(MFU_LOG_ERR, "Failed to allocate space for `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
+    }
+
+    mfu_copy_stats.total_bytes_prealloc += (int64_t) bytes;
+#endif
+    return 0;
+}
+
+/* creates inode in destpath for specified file, identifies source path
+ * that contains source file, computes relative path to file under source path,
+ * and creates file at same relative path under destpath, copies xattrs
+ * when preserving permissions, which contains file striping info on Lustre,
+ * returns 0 on success and -1 on error */
+static int mfu_create_file(mfu_flist list, uint64_t idx,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get source name */
+    const char* src_path = mfu_flist_file_get_name(list, idx);
+
+    /* get destination name */
+    const char* dest_path = mfu_param_path_copy_dest(src_path, numpaths,
+            paths, destpath, mfu_copy_opts);
+
+    /* No need to copy it */
+    if (dest_path == NULL) {
+        return 0;
+    }
+
+    /* wait for our turn if metadata operations are limited */
+    mfu_throttle_charge(0, 1);
+
+    /* since file systems like Lustre require xattrs to be set before file is opened,
+     * we first create it with mknod and then set xattrs */
+
+    /* create file with mknod
+     * for regular files, dev argument is supposed to be ignored,
+     * see makedev() to create valid dev */
+    dev_t dev;
+    memset(&dev, 0, sizeof(dev_t));
+    const char* base;
+    int dirfd = mfu_copy_parent_fd(dest_path, &base);
+    int mknod_rc = mfu_mknodat(dirfd, base, DCOPY_DEF_PERMS_FILE | S_IFREG, dev);
+    if(mknod_rc < 0) {
+        if(errno == EEXIST) {
+            /* destination already exists, no big deal, but print warning */
+            MFU_LOG(MFU_LOG_WARN,
+                    "Original file exists, skip the creation: `%s' (errno=%d %s)",
+                    dest_path, errno, strerror(errno));
+        } else {
+            /* failed to create inode, that's a problem */
+            MFU_LOG(MFU_LOG_ERR, "File `%s' mknod() failed (errno=%d %s)",
+                    dest_path, errno, strerror(errno)
+            );
+            mfu_free(&dest_path);
+            return -1;
+        }
+    }
+
+    /* copy extended attributes, important to do this first before
+     * writing data because some attributes tell file system how to
+     * stripe data, e.g., Lustre */
+    if (mfu_copy_opts->preserve) {
+        int tmp_rc = mfu_copy_xattrs(list, idx, dest_path, -1);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+
+    /* Truncate destination files to 0 bytes when sparse file is enabled,
+     * this is because we will not overwrite sections corresponding to holes
+     * and we need those to be set to 0 */
+    if (mfu_copy_opts->sparse) {
+        /* truncate destination file to 0 bytes */
+        struct stat st;
+        int status = mfu_lstat(dest_path, &st);
+        if (status == 0) {
+            /* destination exists, truncate it to 0 bytes */
+            status = mfu_truncate(dest_path, 0);
+            if (status) {
+                /* when using sparse file optimization, consider this to be an error,
+                 * since we will not be overwriting the holes */
+                MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: `%s' (errno=%d %s)",
+                          dest_path, errno, strerror(errno));
+                rc = -1;
+            }
+        } else if (errno == -ENOENT) {
+            /* destination does not exist, which is fine */
+            status = 0;
+        } else {
+            /* had an error stating destination file */
+            MFU_LOG(MFU_LOG_ERR, "mfu_lstat() file: `%s' (errno=%d %s)",
+                      dest_path, errno, strerror(errno));
+        }
+    }
+
+    /* allocate space for the data, the copy may pick up this
+     * descriptor from the file cache */
+    if (mfu_copy_opts->preallocate && rc == 0) {
+        uint64_t file_size = mfu_flist_file_get_size(list, idx);
+        mfu_fdcache_entry* out_file = mfu_copy_open_file(dest_path, 0, mfu_copy_opts);
+        if (out_file == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+                dest_path, errno, strerror(errno));
+            rc = -1;
+        } else if (mfu_copy_preallocate(src_path, dest_path, out_file->fd,
+            file_size, mfu_copy_opts) < 0)
+        {
+            rc = -1;
+        }
+    }
+
+    /* free destination path */
+    mfu_free(&dest_path);
+
+    /* increment our file count by one */
+    mfu_copy_stats.total_files++;
+
+    return rc;
+}
+
+/* creates hardlink in destpath for specified file, identifies source path
+ * returns 0 on success and -1 on error */
+static int mfu_create_hardlink(mfu_flist list, uint64_t idx,
+        const mfu_param_path* srcpath,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* get source name */
+    const char* src_path = mfu_flist_file_get_name(list, idx);
+
+    /* get destination name */
+    const char* dest_path = mfu_param_path_copy_dest(src_path, 1,
+            srcpath, destpath, mfu_copy_opts);
+
+    /* No need to copy it */
+    if (dest_path == NULL) {
+        return 0;
+    }
+
+    rc = mfu_hardlink(src_path, dest_path);
+    if (rc != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to create hardlink %s --> %s",
+                dest_path, src_path);
+        mfu_free(&dest_path);
+        return rc;
+    }
+
+    /* free destination path */
+    mfu_free(&dest_path);
+
+    /* increment our file count by one */
+    mfu_copy_stats.total_files++;
+
+    return rc;
+}
+
+/* progress message to print while creating files */
+static void create_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+{
+#if 0
+    /* compute percentage of items removed */
+    double percent = 0.0;
+    if (remove_count_total > 0) {
+        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    }
+#endif
+
+    /* compute average delete rate */
+    double rate = 0.0;
+    if (secs > 0) {
+        rate = (double)vals[0] / secs;
+    }
+
+#if 0
+    /* compute estimated time remaining */
+    double secs_remaining = -1.0;
+    if (rate > 0.0) {
+        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
+    }
+#endif
+
+    if (complete < ranks) {
+        MFU_LOG(MFU_LOG_INFO, "Created %llu items in %f secs (%f items/sec) ...",
+            vals[0], secs, rate);
+    } else {
+        MFU_LOG(MFU_LOG_INFO, "Created %llu items in %f secs (%f items/sec) done",
+            vals[0], secs, rate);
+    }
+}
+
+/* allocate a flag for each item in each of the lists for
+ * mfu_create_files, free with mfu_copy_skipped_free */
+static int** mfu_copy_skipped_alloc(int levels, mfu_flist* lists)
+{
+    int** skipped = (int**) MFU_MALLOC((size_t)levels * sizeof(int*));
+    int level;
+    for (level = 0; level < levels; level++) {
+        uint64_t size = mfu_flist_size(lists[level]);
+        skipped[level] = (int*) MFU_MALLOC((size_t)size * sizeof(int) + 1);
+        memset(skipped[level], 0, (size_t)size * sizeof(int));
+    }
+    return skipped;
+}
+
+static void mfu_copy_skipped_free(int levels, int*** skipped)
+{
+    int level;
+    for (level = 0; level < levels; level++) {
+        mfu_free(&(*skipped)[level]);
+    }
+    mfu_free(skipped);
+}
+
+/* given the flags set by mfu_create_files on the lists that
+ * mfu_flist_array_by_depth built from list, set failed[idx] for
+ * each item of list that was not created */
+static void mfu_copy_skipped_merge(mfu_flist list, int levels, int minlevel,
+        int** skipped, int* failed)
+{
+    /* items keep their order within each level */
+    uint64_t* pos = (uint64_t*) MFU_MALLOC((size_t)levels * sizeof(uint64_t) + 1);
+    int level;
+    for (level = 0; level < levels; level++) {
+        pos[level] = 0;
+    }
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        level = mfu_flist_file_get_depth(list, idx) - minlevel;
+        if (skipped[level][pos[level]]) {
+            failed[idx] = 1;
+        }
+        pos[level]++;
+    }
+
+    mfu_free(&pos);
+}
+
+/* creates file inodes and symlinks, if skipped is not NULL, sets
+ * skipped[level][idx] for each item of lists[level] that this call
+ * did not create, because of an error, because a link was already in
+ * the way, or because items of its type are not copied,
+ * returns 0 on success and -1 on error */
+static int mfu_create_files(int levels, int minlevel, mfu_flist* lists,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int** skipped)
+{
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* indicate to user what phase we're in */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Creating files.");
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start progress messages for creating files */
+    mfu_progress* create_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
+
+    int level;
+    for (level = 0; level < levels; level++) {
+        /* time how long this takes */
+        double start = MPI_Wtime();
+
+        /* get list of items for this level */
+        mfu_flist list = lists[level];
+
+        /* when resuming, find files an earlier run started copying */
+        mfu_copy_done_t done = {NULL, 0};
+        if (mfu_copy_opts->resume) {
+            mfu_copy_resume_lookup(list, &done);
+        }
+
+        /* iterate over items and set write bit on directories if needed */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        uint64_t count = 0;
+        for (idx = 0; idx < size; idx++) {
+            /* get type of item */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+
+            /* process files and links */
+            if (type == MFU_TYPE_FILE && mfu_copy_resume_skip(list, idx, 0, 0, &done)) {
+                /* file was created and has copied data we must not
+                 * truncate, so leave it as it is */
+                mfu_copy_stats.total_files++;
+                count++;
+                total_count++;
+            } else if (type == MFU_TYPE_FILE) {
+                /* create inode and copy xattr for regular file */
+                int tmp_rc = mfu_create_file(list, idx, numpaths,
+                        paths, destpath, mfu_copy_opts);
+                if (tmp_rc < 0) {
+                    rc = -1;
+                    if (skipped != NULL) {
+                        skipped[level][idx] = 1;
+                    }
+                }
+                count++;
+                total_count++;
+            } else if (type == MFU_TYPE_LINK) {
+                /* create symlink */
+                int tmp_rc = mfu_create_link(list, idx, numpaths,
+                        paths, destpath, mfu_copy_opts);
+                if (tmp_rc < 0) {
+                    rc = -1;
+                }
+                if (tmp_rc != 0 && skipped != NULL) {
+                    skipped[level][idx] = 1;
+                }
+                count++;
+                total_count++;
+            } else if (type != MFU_TYPE_DIR && skipped != NULL) {
+                /* nothing is created for other types */
+                skipped[level][idx] = 1;
+            }
+
+            /* update number of files we have created for progress messages */
+            mfu_progress_update(&total_count, create_prog);
+        }
+        mfu_free(&done.ranges);
+
+        /* wait for all procs to finish before we start
+         * with files at next level */
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        /* stop our timer */
+        double end = MPI_Wtime();
+
+        /* print timing statistics */
+        if (verbose) {
+            uint64_t min, max, sum;
+            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+            double rate = 0.0;
+            double secs = end - start;
+            if (secs > 0.0) {
+              rate = (double)sum / secs;
+            }
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f secs=%f",
+                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
+                );
+            }
+        }
+    }
+
+    /* finalize progress messages */
+    mfu_progress_complete(&total_count, &create_prog); 
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Created %lu items in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* creates hardlinks,
+ * returns 0 on success and -1 on error */
+static int mfu_create_hardlinks(int levels, int minlevel, mfu_flist* lists,
+        const mfu_param_path* srcpath,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* indicate to user what phase we're in */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Linking files.");
+    }
+
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    int level;
+    for (level = 0; level < levels; level++) {
+        /* time how long this takes */
+        double start = MPI_Wtime();
+
+        /* get list of items for this level */
+        mfu_flist list = lists[level];
+
+        /* iterate over items and create hardlink for each */
+        uint64_t idx;
+        uint64_t size = mfu_flist_size(list);
+        uint64_t count = 0;
+        for (idx = 0; idx < size; idx++) {
+            /* get type of item */
+            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            if (type != MFU_TYPE_FILE) {
+                MFU_LOG(MFU_LOG_ERR, "Can't create link for unregular files.");
+                rc = -1;
+                count++;
+                continue;
+            }
+
+            int tmp_rc = mfu_create_hardlink(list, idx, srcpath, destpath,
+                                             mfu_copy_opts);
+            if (tmp_rc != 0) {
+                rc = -1;
+            }
+            count++;
+        }
+
+        /* add items to our running total */
+        total_count += count;
+
+        /* wait for all procs to finish before we start
+         * with files at next level */
+        MPI_Barrier(MPI_COMM_WORLD);
+
+        /* stop our timer */
+        double end = MPI_Wtime();
+
+        /* print timing statistics */
+        if (verbose) {
+            uint64_t min, max, sum;
+            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+            double rate = 0.0;
+            double secs = end - start;
+            if (secs > 0.0) {
+              rate = (double)sum / secs;
+            }
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f secs=%f",
+                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
+                );
+            }
+        }
+    }
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Linked %lu items in %f seconds (%f items/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
+
+    return rc;
+}
+
+/* per-file overhead in bytes assumed when balancing by cost,
+ * until a copy has been timed to estimate it */
+#define MFU_COPY_FILE_COST_DEFAULT (1024 * 1024)
+
+/* per-file overhead in bytes estimated from the last copy, 0 if unknown */
+static uint64_t mfu_copy_file_cost_est = 0;
+
+/* hold state for copy progress messages */
+static mfu_progress* copy_prog;
+
+/* tracks number of bytes copied by this process */
+static uint64_t copy_count;
+
+/* progress message to print while copying data */
+static void copy_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+{
+#if 0
+    /* compute percentage of items removed */
+    double percent = 0.0;
+    if (remove_count_total > 0) {
+        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    }
+#endif
+
+    /* compute average delete rate */
+    double rate = 0.0;
+    if (secs > 0) {
+        rate = (double)vals[0] / secs;
+    }
+
+#if 0
+    /* compute estimated time remaining */
+    double secs_remaining = -1.0;
+    if (rate > 0.0) {
+        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
+    }
+#endif
+
+    /* convert bytes to units */
+    double agg_size_tmp;
+    const char* agg_size_units;
+    mfu_format_bytes(vals[0], &agg_size_tmp, &agg_size_units);
+
+    /* convert bandwidth to units */
+    double agg_rate_tmp;
+    const char* agg_rate_units;
+    mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
+
+    if (complete < ranks) {
+        MFU_LOG(MFU_LOG_INFO, "Copied %.3lf %s in %.3lf secs (%.3lf %s) ...",
+            agg_size_tmp, agg_size_units, secs, agg_rate_tmp, agg_rate_units);
+    } else {
+        MFU_LOG(MFU_LOG_INFO, "Copied %.3lf %s in %.3lf secs (%.3lf %s) done",
+            agg_size_tmp, agg_size_units, secs, agg_rate_tmp, agg_rate_units);
+    }
+}
+
+/* append a section to a list of checksums */
+static mfu_copy_sum_t* mfu_copy_sum_append(mfu_copy_sum_list_t* list,
+        uint64_t offset, uint64_t length, uint32_t crc)
+{
+    if (list->count == list->capacity) {
+        uint64_t capacity = (list->capacity > 0) ? list->capacity * 2 : 64;
+        mfu_copy_sum_t* sums = (mfu_copy_sum_t*) MFU_MALLOC(capacity * sizeof(mfu_copy_sum_t));
+        if (list->count > 0) {
+            memcpy(sums, list->sums, list->count * sizeof(mfu_copy_sum_t));
+        }
+        mfu_free(&list->sums);
+        list->sums = sums;
+        list->capacity = capacity;
+    }
+
+    mfu_copy_sum_t* sum = &list->sums[list->count];
+    sum->name   = NULL;
+    sum->offset = offset;
+    sum->length = length;
+    sum->crc    = crc;
+    list->count++;
+    return sum;
+}
+
+/* free names and memory held by a list of checksums */
+static void mfu_copy_sum_list_free(mfu_copy_sum_list_t* list)
+{
+    uint64_t i;
+    for (i = 0; i < list->count; i++) {
+        mfu_free(&list->sums[i].name);
+    }
+    mfu_free(&list->sums);
+    list->count    = 0;
+    list->capacity = 0;
+}
+
+/* record checksum of a block of the current chunk while its data
+ * is in our buffer, blocks that follow the last one are chained
+ * onto it, blocks finishing out of order are merged later */
+static void mfu_copy_sum_data(uint64_t offset, const void* buf, size_t length)
+{
+    mfu_copy_sum_list_t* list = &mfu_copy_blocks;
+    if (list->count > 0) {
+        mfu_copy_sum_t* last = &list->sums[list->count - 1];
+        if (last->offset + last->length == offset) {
+            last->crc = mfu_buf_crc32c(last->crc, buf, length);
+            last->length += (uint64_t) length;
+            return;
+        }
+    }
+    mfu_copy_sum_append(list, offset, (uint64_t) length, mfu_buf_crc32c(0, buf, length));
+}
+
+/* record checksum of a hole in the current chunk without reading it */
+static void mfu_copy_sum_zeros(uint64_t offset, uint64_t length)
+{
+    mfu_copy_sum_list_t* list = &mfu_copy_blocks;
+    if (list->count > 0) {
+        mfu_copy_sum_t* last = &list->sums[list->count - 1];
+        if (last->offset + last->length == offset) {
+            last->crc = mfu_buf_crc32c_zeros(last->crc, length);
+            last->length += length;
+            return;
+        }
+    }
+    mfu_copy_sum_append(list, offset, length, mfu_buf_crc32c_zeros(0, length));
+}
+
+/* order checksummed sections by file name and then by offset */
+static int mfu_copy_sum_cmp(const void* a, const void* b)
+{
+    const mfu_copy_sum_t* sa = (const mfu_copy_sum_t*) a;
+    const mfu_copy_sum_t* sb = (const mfu_copy_sum_t*) b;
+    if (sa->name != NULL && sb->name != NULL) {
+        int rc = strcmp(sa->name, sb->name);
+        if (rc != 0) {
+            return rc;
+        }
+    }
+    if (sa->offset != sb->offset) {
+        return (sa->offset < sb->offset) ? -1 : 1;
+    }
+    return 0;
+}
+
+/* merge checksums of blocks of the chunk we just copied from file
+ * name into as few sections as possible and add them to the list
+ * of sections this process copied, blocks of a failed copy are
+ * dropped, which leaves the file without a digest */
+static void mfu_copy_sum_finish(const char* name, int copy_rc)
+{
+    mfu_copy_sum_list_t* list = &mfu_copy_blocks;
+    if (copy_rc == 0 && list->count > 0) {
+        qsort(list->sums, (size_t) list->count, sizeof(mfu_copy_sum_t), mfu_copy_sum_cmp);
+
+        mfu_copy_sum_t run = list->sums[0];
+        uint64_t i;
+        for (i = 1; i <= list->count; i++) {
+            mfu_copy_sum_t* sum = (i < list->count) ? &list->sums[i] : NULL;
+            if (sum != NULL && run.offset + run.length == sum->offset) {
+                run.crc = mfu_buf_crc32c_combine(run.crc, sum->crc, sum->length);
+                run.length += sum->length;
+                continue;
+            }
+
+            mfu_copy_sum_t* piece = mfu_copy_sum_append(&mfu_copy_sums,
+                run.offset, run.length, run.crc);
+            piece->name = MFU_STRDUP(name);
+            if (sum != NULL) {
+                run = *sum;
+            }
+        }
+    }
+    list->count = 0;
+}
+
+/* truncate destination to its final size if the chunk ending at
+ * offset + length is the last one in the file,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_truncate_last(
+    const char* dest,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* no need to truncate if sparse file is enabled,
+     * since we truncated files when they were first created */
+    if (mfu_copy_opts->sparse) {
+        return 0;
+    }
+
+    /* if we wrote the last chunk, truncate the file */
+    off_t last_written = offset + length;
+    off_t file_size_offt = (off_t) file_size;
+    if (last_written >= file_size_offt || file_size == 0) {
+        /* Use ftruncate() here rather than truncate(), because grouplock
+         * of Lustre would cause block to truncate() since the fd is different
+         * from the out_fd. */
+        if(mfu_ftruncate(out_fd, file_size_offt) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
+       }
+    }
+
+    return 0;
+}
+
+static int mfu_copy_file_normal(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* seek to offset in source file */
+    if(mfu_lseek(src, in_fd, offset, SEEK_SET) == (off_t)-1) {
+        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
+    }
+
+    /* seek to offset in destination file */
+    if(mfu_lseek(dest, out_fd, offset, SEEK_SET) == (off_t)-1) {
+        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
+    }
+
+    /* get buffer */
+    size_t buf_size = mfu_copy_opts->block_size;
+    void* buf = mfu_copy_opts->block_buf1;
+
+    /* write data */
+    size_t total_bytes = 0;
+    while(total_bytes <= (size_t)length) {
+        /* determine number of bytes that we
+         * can read = max(buf size, remaining chunk) */
+        size_t left_to_read = (size_t)length - total_bytes;
+        if(left_to_read > buf_size) {
+            left_to_read = buf_size;
+        }
+
+        /* read data from source file */
+        ssize_t num_of_bytes_read = mfu_read(src, in_fd, buf, left_to_read);
+
+        /* check for EOF */
+        if(! num_of_bytes_read) {
+            break;
+        }
+
+        /* checksum the data while we have it */
+        if (mfu_copy_opts->manifest != NULL && num_of_bytes_read > 0) {
+            mfu_copy_sum_data(offset + (uint64_t) total_bytes, buf, (size_t) num_of_bytes_read);
+        }
+
+        /* compute number of bytes to write */
+        size_t bytes_to_write = (size_t) num_of_bytes_read;
+
+        /* Write data to destination file.
+         * Do nothing for a block of zeros in a sparse copy,
+         * sparse copies come through mfu_copy_file_extents,
+         * which sets the file size if it ends in zeros. */
+        ssize_t num_of_bytes_written = (ssize_t)bytes_to_write;
+        if (mfu_copy_opts->sparse && mfu_buf_is_zero(buf, bytes_to_write)) {
+            /* this section of the destination file is all 0,
+             * seek past this section */
+            if(mfu_lseek(dest, out_fd, (off_t)bytes_to_write, SEEK_CUR) == (off_t)-1) {
+                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
+                    dest, errno, strerror(errno));
+                return -1;
+            }
+        } else {
+            /* write bytes to destination file */
+            num_of_bytes_written = mfu_write(dest, out_fd, buf, bytes_to_write);
+        }
+
+        /* check for an error */
+        if(num_of_bytes_written < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            return -1;
+        }
+
+        /* check that we wrote the same number of bytes that we read */
+        if((size_t)num_of_bytes_written != bytes_to_write) {
+            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
+                src, dest);
+            return -1;
+        }
+
+        /* add bytes to our total (use bytes read,
+         * which may be less than number written) */
+        total_bytes += (size_t) num_of_bytes_read;
+
+        /* update number of bytes we have copied for progress messages */
+        copy_count += (uint64_t) num_of_bytes_read;
+        mfu_progress_update(&copy_count, copy_prog);
+    }
+
+    /* Increment the global counter. */
+    mfu_copy_stats.total_size += (int64_t) total_bytes;
+    mfu_copy_stats.total_bytes_copied += (int64_t) total_bytes;
+
+#if 0
+    /* force data to file system */
+    if(total_bytes > 0) {
+        mfu_fsync(dest, out_fd);
     }
 #endif
 
-    /* compute average delete rate */
-    double rate = 0.0;
-    if (secs > 0) {
-        rate = (double)vals[0] / secs;
+    /* set final size of file if we wrote the last chunk */
+    if (mfu_copy_truncate_last(dest, out_fd, offset, length, file_size, mfu_copy_opts) < 0) {
+        return -1;
     }
 
-#if 0
-    /* compute estimated time remaining */
-    double secs_remaining = -1.0;
-    if (rate > 0.0) {
-        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
-    }
-#endif
+    /* we don't bother closing the file because our cache does it for us */
 
-    if (complete < ranks) {
-        MFU_LOG(MFU_LOG_INFO, "Created %llu items in %f secs (%f items/sec) ...",
-            vals[0], secs, rate);
+    return 0;
+}
+
+/* start an asynchronous read or write of the part of the buffer of
+ * the given slot that is not done yet, reads fill bytes and writes
+ * drain nread bytes starting at file offset pos,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_slot_submit(
+    mfu_copy_slot_t* slot,
+    int fd,
+    int read_flag)
+{
+    size_t total = read_flag ? slot->bytes : slot->nread;
+    memset(&slot->cb, 0, sizeof(slot->cb));
+    slot->cb.aio_fildes = fd;
+    slot->cb.aio_offset = slot->pos + (off_t) slot->done;
+    slot->cb.aio_buf    = slot->buf + slot->done;
+    slot->cb.aio_nbytes = total - slot->done;
+    slot->cb.aio_sigevent.sigev_notify = SIGEV_NONE;
+
+    int rc;
+    if (read_flag) {
+        rc = aio_read(&slot->cb);
+        slot->state = MFU_COPY_SLOT_READING;
     } else {
-        MFU_LOG(MFU_LOG_INFO, "Created %llu items in %f secs (%f items/sec) done",
-            vals[0], secs, rate);
+        rc = aio_write(&slot->cb);
+        slot->state = MFU_COPY_SLOT_WRITING;
+    }
+    if (rc != 0) {
+        slot->state = read_flag ? MFU_COPY_SLOT_IDLE : MFU_COPY_SLOT_FULL;
+        return -1;
     }
+    return 0;
 }
 
-/* creates file inodes and symlinks,
+/* copy a chunk with asynchronous I/O so that reads of later blocks
+ * overlap writes of earlier ones, keeps up to io_depth operations
+ * in flight using the buffers in mfu_copy_slots,
  * returns 0 on success and -1 on error */
-static int mfu_create_files(int levels, int minlevel, mfu_flist* lists,
-        int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+static int mfu_copy_file_aio(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
 {
     int rc = 0;
 
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+    size_t buf_size = mfu_copy_opts->block_size;
+    int depth       = mfu_copy_opts->io_depth;
+    int nslots      = mfu_copy_slot_count;
 
-    /* get current rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    /* list of outstanding operations to wait on */
+    const struct aiocb** waitlist = (const struct aiocb**) MFU_MALLOC(nslots * sizeof(struct aiocb*));
 
-    /* indicate to user what phase we're in */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Creating files.");
+    int i;
+    for (i = 0; i < nslots; i++) {
+        mfu_copy_slots[i].state = MFU_COPY_SLOT_IDLE;
     }
 
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
+    uint64_t read_pos = offset;
+    uint64_t last_byte = offset + length;
+    int eof = 0;
+    int inflight = 0;
+    size_t total_bytes = 0;
+    while (1) {
+        /* issue writes first so full buffers drain before we read more */
+        for (i = 0; i < nslots && inflight < depth && rc == 0; i++) {
+            mfu_copy_slot_t* slot = &mfu_copy_slots[i];
+            if (slot->state != MFU_COPY_SLOT_FULL) {
+                continue;
+            }
 
-    /* start progress messages for creating files */
-    mfu_progress* create_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
+            slot->done = 0;
+            if (mfu_copy_slot_submit(slot, out_fd, 0) < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to write to `%s' (errno=%d %s)",
+                    dest, errno, strerror(errno));
+                rc = -1;
+                break;
+            }
+            inflight++;
+        }
 
-    int level;
-    for (level = 0; level < levels; level++) {
-        /* time how long this takes */
-        double start = MPI_Wtime();
+        /* refill idle buffers */
+        for (i = 0; i < nslots && inflight < depth && rc == 0; i++) {
+            mfu_copy_slot_t* slot = &mfu_copy_slots[i];
+            if (eof || read_pos >= last_byte) {
+                break;
+            }
+            if (slot->state != MFU_COPY_SLOT_IDLE) {
+                continue;
+            }
 
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
+            size_t left_to_read = (size_t) (last_byte - read_pos);
+            if (left_to_read > buf_size) {
+                left_to_read = buf_size;
+            }
 
-        /* iterate over items and set write bit on directories if needed */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        uint64_t count = 0;
-        for (idx = 0; idx < size; idx++) {
-            /* get type of item */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
+            slot->pos   = (off_t) read_pos;
+            slot->bytes = left_to_read;
+            slot->done  = 0;
+            if (mfu_copy_slot_submit(slot, in_fd, 1) < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to read from `%s' (errno=%d %s)",
+                    src, errno, strerror(errno));
+                rc = -1;
+                break;
+            }
+            read_pos += (uint64_t) left_to_read;
+            inflight++;
+        }
 
-            /* process files and links */
-            if (type == MFU_TYPE_FILE) {
-                /* create inode and copy xattr for regular file */
-                int tmp_rc = mfu_create_file(list, idx, numpaths,
-                        paths, destpath, mfu_copy_opts);
-                if (tmp_rc < 0) {
+        /* we're done once nothing is in flight, on error we still
+         * wait for outstanding operations since they use our buffers */
+        if (inflight == 0) {
+            break;
+        }
+
+        /* wait for at least one operation to complete */
+        int count = 0;
+        for (i = 0; i < nslots; i++) {
+            mfu_copy_slot_t* slot = &mfu_copy_slots[i];
+            if (slot->state == MFU_COPY_SLOT_READING || slot->state == MFU_COPY_SLOT_WRITING) {
+                waitlist[count] = &slot->cb;
+                count++;
+            }
+        }
+        if (aio_suspend(waitlist, count, NULL) != 0 && errno != EINTR) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to wait for I/O on `%s' (errno=%d %s)",
+                src, errno, strerror(errno));
+        }
+
+        /* process completed operations */
+        for (i = 0; i < nslots; i++) {
+            mfu_copy_slot_t* slot = &mfu_copy_slots[i];
+            if (slot->state != MFU_COPY_SLOT_READING && slot->state != MFU_COPY_SLOT_WRITING) {
+                continue;
+            }
+
+            int err = aio_error(&slot->cb);
+            if (err == EINPROGRESS) {
+                continue;
+            }
+            ssize_t ret = aio_return(&slot->cb);
+            inflight--;
+
+            if (slot->state == MFU_COPY_SLOT_READING) {
+                if (err != 0 || ret < 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to read from `%s' (errno=%d %s)",
+                        src, err, strerror(err));
                     rc = -1;
+                    slot->state = MFU_COPY_SLOT_IDLE;
+                    continue;
                 }
-                count++;
-                total_count++;
-            } else if (type == MFU_TYPE_LINK) {
-                /* create symlink */
-                int tmp_rc = mfu_create_link(list, idx, numpaths,
-                        paths, destpath, mfu_copy_opts);
-                if (tmp_rc < 0) {
+
+                /* only a read of nothing or one that reaches the size
+                 * of the file is at its end, others may just be short,
+                 * as they can be on network and parallel file systems,
+                 * so read the rest of the buffer */
+                slot->done += (size_t) ret;
+                uint64_t end = (uint64_t) slot->pos + (uint64_t) slot->done;
+                if (ret == 0 || end >= file_size) {
+                    eof = 1;
+                } else if (slot->done < slot->bytes && rc == 0) {
+                    if (mfu_copy_slot_submit(slot, in_fd, 1) < 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to read from `%s' (errno=%d %s)",
+                            src, errno, strerror(errno));
+                        rc = -1;
+                        slot->state = MFU_COPY_SLOT_IDLE;
+                    } else {
+                        inflight++;
+                    }
+                    continue;
+                }
+
+                if (slot->done == 0) {
+                    /* source is shorter than expected */
+                    slot->state = MFU_COPY_SLOT_IDLE;
+                    continue;
+                }
+                slot->nread = slot->done;
+                slot->state = MFU_COPY_SLOT_FULL;
+
+                /* checksum the data while we have it */
+                if (mfu_copy_opts->manifest != NULL) {
+                    mfu_copy_sum_data((uint64_t) slot->pos, slot->buf, slot->nread);
+                }
+            } else {
+                if (err != 0 || ret <= 0) {
+                    if (err == 0) {
+                        err = EIO;
+                    }
+                    MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                        src, dest, err, strerror(err));
                     rc = -1;
+                    slot->state = MFU_COPY_SLOT_IDLE;
+                    continue;
                 }
-                count++;
-                total_count++;
+
+                /* write the rest of a short write, like mfu_write does */
+                slot->done += (size_t) ret;
+                if (slot->done < slot->nread && rc == 0) {
+                    if (mfu_copy_slot_submit(slot, out_fd, 0) < 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to write to `%s' (errno=%d %s)",
+                            dest, errno, strerror(errno));
+                        rc = -1;
+                        slot->state = MFU_COPY_SLOT_IDLE;
+                    } else {
+                        inflight++;
+                    }
+                    continue;
+                }
+
+                /* update number of bytes we have copied for progress messages */
+                if (slot->done == slot->nread) {
+                    total_bytes += slot->nread;
+                    copy_count += (uint64_t) slot->nread;
+                    mfu_progress_update(&copy_count, copy_prog);
+                }
+                slot->state = MFU_COPY_SLOT_IDLE;
             }
+        }
+    }
 
-            /* update number of files we have created for progress messages */
-            mfu_progress_update(&total_count, create_prog);
+    mfu_free(&waitlist);
+
+    /* Increment the global counter. */
+    mfu_copy_stats.total_size += (int64_t) total_bytes;
+    mfu_copy_stats.total_bytes_copied += (int64_t) total_bytes;
+
+    if (rc != 0) {
+        return rc;
+    }
+
+    /* set final size of file if we wrote the last chunk */
+    return mfu_copy_truncate_last(dest, out_fd, offset, length, file_size, mfu_copy_opts);
+}
+
+/* copy a chunk through user buffers, asynchronously if configured,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_file_rw(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* sparse copies seek over zero blocks, so they stay sequential */
+    if (mfu_copy_slots != NULL && ! mfu_copy_opts->sparse) {
+        return mfu_copy_file_aio(src, dest, in_fd, out_fd,
+            offset, length, file_size, mfu_copy_opts);
+    }
+    return mfu_copy_file_normal(src, dest, in_fd, out_fd,
+        offset, length, file_size, mfu_copy_opts);
+}
+
+/* copy a chunk with direct I/O (O_DIRECT) so that the data bypasses
+ * the page cache, direct I/O needs aligned offsets and lengths, so the
+ * unaligned head and tail of the chunk, including a partial block at
+ * the end of the file, are copied with buffered I/O, the whole chunk
+ * is buffered if the file systems do not support direct I/O,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_file_direct(
+    const char* src,
+    const char* dest,
+    mfu_fdcache_entry* in_file,
+    mfu_fdcache_entry* out_file,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    int in_fd  = in_file->fd;
+    int out_fd = out_file->fd;
+
+    /* find the aligned body of the chunk */
+    uint64_t last_byte  = offset + length;
+    uint64_t body_start = offset;
+    uint64_t body_end   = offset;
+    size_t align = mfu_copy_direct_align(in_file, out_file, mfu_copy_opts);
+    if (align > 0) {
+        uint64_t end = (last_byte < file_size) ? last_byte : file_size;
+        body_start = (offset + align - 1) / align * align;
+        body_end   = end / align * align;
+        if (body_end <= body_start) {
+            body_start = offset;
+            body_end   = offset;
         }
+    }
 
-        /* wait for all procs to finish before we start
-         * with files at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
+    /* copy the head with buffered I/O */
+    if (mfu_copy_set_direct(in_file, 0) != 0 || mfu_copy_set_direct(out_file, 0) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to disable direct I/O from `%s' to `%s' (errno=%d %s)",
+            src, dest, errno, strerror(errno));
+        return -1;
+    }
+    if (body_end == body_start) {
+        return mfu_copy_file_rw(src, dest, in_fd, out_fd,
+            offset, length, file_size, mfu_copy_opts);
+    }
+    if (body_start > offset) {
+        if (mfu_copy_file_rw(src, dest, in_fd, out_fd,
+            offset, body_start - offset, file_size, mfu_copy_opts) < 0)
+        {
+            return -1;
+        }
+    }
 
-        /* stop our timer */
-        double end = MPI_Wtime();
+    /* copy the body with direct I/O, the kernel refuses O_DIRECT
+     * on some file systems even if statx does not say so */
+    if (mfu_copy_set_direct(in_file, 1) != 0 || mfu_copy_set_direct(out_file, 1) != 0) {
+        MFU_LOG(MFU_LOG_DBG, "Failed to enable direct I/O from `%s' to `%s', using buffered I/O (errno=%d %s)",
+            src, dest, errno, strerror(errno));
+        in_file->hints  |= MFU_COPY_HINT_NO_DIRECT;
+        out_file->hints |= MFU_COPY_HINT_NO_DIRECT;
+        if (mfu_copy_set_direct(in_file, 0) != 0 || mfu_copy_set_direct(out_file, 0) != 0) {
+            return -1;
+        }
+        return mfu_copy_file_rw(src, dest, in_fd, out_fd,
+            body_start, last_byte - body_start, file_size, mfu_copy_opts);
+    }
+    if (mfu_copy_file_rw(src, dest, in_fd, out_fd,
+        body_start, body_end - body_start, file_size, mfu_copy_opts) < 0)
+    {
+        return -1;
+    }
+    mfu_copy_stats.total_bytes_direct += (int64_t) (body_end - body_start);
 
-        /* print timing statistics */
-        if (verbose) {
-            uint64_t min, max, sum;
-            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-            double rate = 0.0;
-            double secs = end - start;
-            if (secs > 0.0) {
-              rate = (double)sum / secs;
-            }
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f secs=%f",
-                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
-                );
-            }
+    /* copy the tail with buffered I/O */
+    if (body_end < last_byte) {
+        if (mfu_copy_set_direct(in_file, 0) != 0 || mfu_copy_set_direct(out_file, 0) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to disable direct I/O from `%s' to `%s' (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            return -1;
+        }
+        if (mfu_copy_file_rw(src, dest, in_fd, out_fd,
+            body_end, last_byte - body_end, file_size, mfu_copy_opts) < 0)
+        {
+            return -1;
         }
     }
 
-    /* finalize progress messages */
-    mfu_progress_complete(&total_count, &create_prog); 
+    return 0;
+}
 
-    /* stop timer and report total count */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_end = MPI_Wtime();
+/* ask the kernel to transfer a chunk without passing the data through
+ * our buffer, first by sharing extents with FICLONERANGE and then
+ * with copy_file_range, sets done to the number of bytes transferred,
+ * if that is less than length, the caller should copy the remainder,
+ * either call is disabled for the rest of the file after it fails */
+static void mfu_copy_file_offload(
+    const char* src,
+    const char* dest,
+    const int in_fd,
+    const int out_fd,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t* done,
+    int* hints,
+    mfu_copy_opts_t* mfu_copy_opts)
+{
+    *done = 0;
 
-    /* print timing statistics */
-    if (verbose) {
-        uint64_t sum;
-        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        double rate = 0.0;
-        double secs = total_end - total_start;
-        if (secs > 0.0) {
-          rate = (double)sum / secs;
+#ifdef FICLONERANGE
+    /* try to share extents for the whole chunk, this only works
+     * within a file system and on block-aligned offsets */
+    if (mfu_copy_offload >= MFU_COPY_OFFLOAD_CLONE &&
+        !(*hints & MFU_COPY_HINT_NO_CLONE) && length > 0)
+    {
+        struct file_clone_range range;
+        range.src_fd      = (int64_t) in_fd;
+        range.src_offset  = offset;
+        range.src_length  = length;
+        range.dest_offset = offset;
+        if (ioctl(out_fd, FICLONERANGE, &range) == 0) {
+            *done = length;
+            mfu_copy_stats.total_bytes_cloned += (int64_t) length;
+        } else {
+            MFU_LOG(MFU_LOG_DBG, "FICLONERANGE failed from `%s' to `%s', falling back (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            *hints |= MFU_COPY_HINT_NO_CLONE;
         }
-        if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Created %lu items in %f seconds (%f items/sec)",
-              (unsigned long)sum, secs, rate
-            );
+    }
+#endif
+
+#ifdef SYS_copy_file_range
+    /* copy_file_range may fill holes, so sparse copies
+     * only call this on data extents */
+    while (mfu_copy_offload >= MFU_COPY_OFFLOAD_RANGE &&
+           !(*hints & MFU_COPY_HINT_NO_RANGE) &&
+           *done < length)
+    {
+        loff_t off_in  = (loff_t) (offset + *done);
+        loff_t off_out = (loff_t) (offset + *done);
+        size_t bytes   = (size_t) (length - *done);
+        ssize_t rc = syscall(SYS_copy_file_range, in_fd, &off_in, out_fd, &off_out, bytes, 0);
+        if (rc < 0) {
+            /* leave any real I/O error to be reported by read/write */
+            MFU_LOG(MFU_LOG_DBG, "copy_file_range failed from `%s' to `%s', falling back (errno=%d %s)",
+                src, dest, errno, strerror(errno));
+            *hints |= MFU_COPY_HINT_NO_RANGE;
+            break;
+        }
+        if (rc == 0) {
+            /* source file is shorter than expected */
+            break;
         }
+        *done += (uint64_t) rc;
+        mfu_copy_stats.total_bytes_ranged += (int64_t) rc;
+    }
+#endif
+
+    /* update number of bytes we have copied */
+    if (*done > 0) {
+        mfu_copy_stats.total_size += (int64_t) *done;
+        mfu_copy_stats.total_bytes_copied += (int64_t) *done;
+        copy_count += *done;
+        mfu_progress_update(&copy_count, copy_prog);
     }
 
-    return rc;
+    return;
 }
 
-/* creates hardlinks,
- * returns 0 on success and -1 on error */
-static int mfu_create_hardlinks(int levels, int minlevel, mfu_flist* lists,
-        const mfu_param_path* srcpath,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+/* copy a chunk of a sparse file one data extent at a time, holes in
+ * the source are skipped without reading them and are left as holes
+ * in the destination, returns 0 on success and -1 on error */
+static int mfu_copy_file_extents(
+    const char* src,
+    const char* dest,
+    mfu_fdcache_entry* in_file,
+    mfu_fdcache_entry* out_file,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
 {
-    int rc = 0;
-
-    /* determine whether we should print status messages */
-    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+    int in_fd  = in_file->fd;
+    int out_fd = out_file->fd;
+    uint64_t data_bytes = 0;
 
-    /* get current rank */
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    /* end of the last extent, to find holes we need to checksum */
+    uint64_t pos = offset;
 
-    /* indicate to user what phase we're in */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Linking files.");
-    }
+    mfu_extent_iter it;
+    mfu_extent_iter_init(&it, src, in_fd, (off_t)offset, (off_t)length);
 
-    /* start timer for entie operation */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_start = MPI_Wtime();
-    uint64_t total_count = 0;
+    off_t ext_start, ext_len;
+    int found;
+    while ((found = mfu_extent_iter_next(&it, &ext_start, &ext_len)) > 0) {
+        uint64_t start = (uint64_t) ext_start;
+        uint64_t len   = (uint64_t) ext_len;
 
-    int level;
-    for (level = 0; level < levels; level++) {
-        /* time how long this takes */
-        double start = MPI_Wtime();
+        /* account for the hole before this extent */
+        if (mfu_copy_opts->manifest != NULL && start > pos) {
+            mfu_copy_sum_zeros(pos, start - pos);
+        }
+        pos = start + len;
 
-        /* get list of items for this level */
-        mfu_flist list = lists[level];
+        /* let the kernel move what it can */
+        uint64_t done = 0;
+        if (mfu_copy_offload != MFU_COPY_OFFLOAD_NONE && ! mfu_copy_opts->synchronous) {
+            mfu_copy_file_offload(src, dest, in_fd, out_fd, start,
+                len, &done, &out_file->hints, mfu_copy_opts);
+        }
 
-        /* iterate over items and create hardlink for each */
-        uint64_t idx;
-        uint64_t size = mfu_flist_size(list);
-        uint64_t count = 0;
-        for (idx = 0; idx < size; idx++) {
-            /* get type of item */
-            mfu_filetype type = mfu_flist_file_get_type(list, idx);
-            if (type != MFU_TYPE_FILE) {
-                MFU_LOG(MFU_LOG_ERR, "Can't create link for unregular files.");
-                rc = -1;
-                count++;
-                continue;
+        /* copy the rest, this also skips blocks of zeros within the extent */
+        if (done < len) {
+            int tmp_rc;
+            if (mfu_copy_opts->synchronous) {
+                tmp_rc = mfu_copy_file_direct(src, dest, in_file, out_file,
+                    start + done, len - done, file_size, mfu_copy_opts);
+            } else {
+                tmp_rc = mfu_copy_file_normal(src, dest, in_fd, out_fd,
+                    start + done, len - done, file_size, mfu_copy_opts);
             }
-
-            int tmp_rc = mfu_create_hardlink(list, idx, srcpath, destpath,
-                                             mfu_copy_opts);
-            if (tmp_rc != 0) {
-                rc = -1;
+            if (tmp_rc < 0) {
+                return -1;
             }
-            count++;
         }
 
-        /* add items to our running total */
-        total_count += count;
-
-        /* wait for all procs to finish before we start
-         * with files at next level */
-        MPI_Barrier(MPI_COMM_WORLD);
-
-        /* stop our timer */
-        double end = MPI_Wtime();
+        data_bytes += len;
+    }
+    if (found < 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to find data extents in source path `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
+    }
 
-        /* print timing statistics */
-        if (verbose) {
-            uint64_t min, max, sum;
-            MPI_Allreduce(&count, &min, 1, MPI_UINT64_T, MPI_MIN, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
-            MPI_Allreduce(&count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-            double rate = 0.0;
-            double secs = end - start;
-            if (secs > 0.0) {
-              rate = (double)sum / secs;
-            }
-            if (rank == 0) {
-                MFU_LOG(MFU_LOG_INFO, "  level=%d min=%lu max=%lu sum=%lu rate=%f secs=%f",
-                  (minlevel + level), (unsigned long)min, (unsigned long)max, (unsigned long)sum, rate, secs
-                );
-            }
-        }
+    /* account for a hole at the end of the chunk */
+    if (mfu_copy_opts->manifest != NULL && offset + length > pos) {
+        mfu_copy_sum_zeros(pos, offset + length - pos);
     }
 
-    /* stop timer and report total count */
-    MPI_Barrier(MPI_COMM_WORLD);
-    double total_end = MPI_Wtime();
+    /* count holes as copied for totals and progress messages */
+    if (length > data_bytes) {
+        uint64_t hole_bytes = length - data_bytes;
+        mfu_copy_stats.total_size += (int64_t) hole_bytes;
+        copy_count += hole_bytes;
+        mfu_progress_update(&copy_count, copy_prog);
+    }
 
-    /* print timing statistics */
-    if (verbose) {
-        uint64_t sum;
-        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-        double rate = 0.0;
-        double secs = total_end - total_start;
-        if (secs > 0.0) {
-          rate = (double)sum / secs;
-        }
-        if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Linked %lu items in %f seconds (%f items/sec)",
-              (unsigned long)sum, secs, rate
-            );
+    /* destination files are truncated to 0 when created for sparse
+     * copies, so extend the file in case it ends with a hole */
+    if (offset + length >= file_size) {
+        if (mfu_ftruncate(out_fd, (off_t) file_size) < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                dest, errno, strerror(errno));
+            return -1;
         }
     }
 
-    return rc;
+    return 0;
 }
 
-/* hold state for copy progress messages */
-static mfu_progress* copy_prog;
-
-/* tracks number of bytes copied by this process */
-static uint64_t copy_count;
-
-/* progress message to print while copying data */
-static void copy_progress_fn(const uint64_t* vals, int count, int complete, int ranks, double secs)
+static int mfu_copy_file_data(
+    const char* src,
+    const char* dest,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
 {
-#if 0
-    /* compute percentage of items removed */
-    double percent = 0.0;
-    if (remove_count_total > 0) {
-        percent = 100.0 * (double)vals[0] / (double)remove_count_total;
+    /* open the input file */
+    mfu_fdcache_entry* in_file = mfu_copy_open_file(src, 1, mfu_copy_opts);
+    if (in_file == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
+            src, errno, strerror(errno));
+        return -1;
     }
-#endif
+    int in_fd = in_file->fd;
 
-    /* compute average delete rate */
-    double rate = 0.0;
-    if (secs > 0) {
-        rate = (double)vals[0] / secs;
+    /* open the output file, the cache holds at least two files,
+     * so this does not close the input file */
+    mfu_fdcache_entry* out_file = mfu_copy_open_file(dest, 0, mfu_copy_opts);
+    if (out_file == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
     }
+    int out_fd = out_file->fd;
 
-#if 0
-    /* compute estimated time remaining */
-    double secs_remaining = -1.0;
-    if (rate > 0.0) {
-        secs_remaining = (double)(remove_count_total - vals[0]) / rate;
+    /* hint that we'll read the chunk sequentially */
+    if (mfu_copy_opts->pagecache == MFU_COPY_PAGECACHE_DROP) {
+        posix_fadvise(in_fd, (off_t) offset, (off_t) length, POSIX_FADV_SEQUENTIAL);
     }
-#endif
-
-    /* convert bytes to units */
-    double agg_size_tmp;
-    const char* agg_size_units;
-    mfu_format_bytes(vals[0], &agg_size_tmp, &agg_size_units);
 
-    /* convert bandwidth to units */
-    double agg_rate_tmp;
-    const char* agg_rate_units;
-    mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
+    /* skip holes in sparse files */
+    if (mfu_copy_opts->sparse) {
+        return mfu_copy_file_extents(src, dest, in_file, out_file, offset,
+            length, file_size, mfu_copy_opts);
+    }
 
-    if (complete < ranks) {
-        MFU_LOG(MFU_LOG_INFO, "Copied %.3lf %s in %.3lf secs (%.3lf %s) ...",
-            agg_size_tmp, agg_size_units, secs, agg_rate_tmp, agg_rate_units);
-    } else {
-        MFU_LOG(MFU_LOG_INFO, "Copied %.3lf %s in %.3lf secs (%.3lf %s) done",
-            agg_size_tmp, agg_size_units, secs, agg_rate_tmp, agg_rate_units);
+    /* bypass the page cache for aligned parts of the chunk */
+    if (mfu_copy_opts->synchronous) {
+        return mfu_copy_file_direct(src, dest, in_file, out_file, offset,
+            length, file_size, mfu_copy_opts);
     }
-}
 
-/* return 1 if entire buffer is 0, return 0 if any byte is not 0,
- * we avoid writing NULL blocks when supporting sparse files */
-static int mfu_is_all_null(const char* buf, uint64_t buf_size)
-{
-    uint64_t i;
-    for (i = 0; i < buf_size; i++) {
-        if (buf[i] != 0) {
-            return 0;
+    /* let the kernel move what it can */
+    if (mfu_copy_offload != MFU_COPY_OFFLOAD_NONE) {
+        uint64_t done;
+        mfu_copy_file_offload(src, dest, in_fd, out_fd, offset,
+                length, &done, &out_file->hints, mfu_copy_opts);
+        if (done == length) {
+            /* set final size of file if this was the last chunk */
+            return mfu_copy_truncate_last(dest, out_fd, offset, length,
+                file_size, mfu_copy_opts);
+        }
+        if (done > 0) {
+            /* copy whatever is left of the chunk the normal way */
+            return mfu_copy_file_rw(src, dest, in_fd, out_fd,
+                offset + done, length - done, file_size, mfu_copy_opts);
         }
     }
-    return 1;
+
+    return mfu_copy_file_rw(src, dest, in_fd, out_fd,
+            offset, length, file_size, mfu_copy_opts);
 }
 
-/* when using sparse files, we need to write the last byte if the
- * hole is adjacent to EOF, so we need to detect whether we're at
- * the end of the file */
-static int mfu_is_eof(const char* file, int fd)
+/* copy a section of a file, and if requested, record the checksum
+ * of the data we copied and add the section to our journal */
+static int mfu_copy_file(
+    const char* src,
+    const char* dest,
+    uint64_t offset,
+    uint64_t length,
+    uint64_t file_size,
+    mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* read one byte from fd to determine whether this is EOF.
-     * This is not efficient, but it is the only reliable way */
-    char buf[1];
-    ssize_t num_of_bytes_read = mfu_read(file, fd, buf, 1);
+    int64_t copied = mfu_copy_stats.total_bytes_copied;
+    int rc = mfu_copy_file_data(src, dest, offset, length, file_size, mfu_copy_opts);
+
+    /* count data we read and wrote against any bandwidth limit,
+     * holes skipped in sparse copies cost nothing */
+    copied = mfu_copy_stats.total_bytes_copied - copied;
+    mfu_throttle_charge(2 * (uint64_t) copied, 0);
+    if (mfu_copy_opts->manifest != NULL) {
+        mfu_copy_sum_finish(src, rc);
+    }
+    if (mfu_copy_opts->journal != NULL && rc == 0) {
+        mfu_copy_journal_add(src, offset, length, file_size, mfu_copy_opts);
+    }
+    if (mfu_copy_opts->pagecache == MFU_COPY_PAGECACHE_DROP && rc == 0) {
+        /* the files were just used, so they are still in our cache */
+        mfu_fdcache_entry* in_file = mfu_copy_open_file(src, 1, mfu_copy_opts);
+        int in_fd = (in_file != NULL) ? in_file->fd : -1;
+        mfu_fdcache_entry* out_file = mfu_copy_open_file(dest, 0, mfu_copy_opts);
+        if (out_file != NULL) {
+            mfu_writebehind_add(&mfu_copy_wb, dest, in_fd, out_file->fd, offset, length);
+        }
+    }
 
-    /* return if we detect EOF */
-    if(! num_of_bytes_read) {
-        return 1;
+    /* track how much dirty data builds up in the page cache,
+     * sampling at most ten times a second, only when the summary
+     * will report it, since each sample reads /proc/meminfo */
+    if (mfu_copy_opts->pagecache == MFU_COPY_PAGECACHE_DROP ||
+        mfu_debug_level >= MFU_LOG_VERBOSE)
+    {
+        double now = MPI_Wtime();
+        if (mfu_copy_stats.wtime_dirty < 0.0 || now - mfu_copy_stats.wtime_dirty >= 0.1) {
+            uint64_t dirty = mfu_dirty_bytes();
+            if (dirty > mfu_copy_stats.peak_dirty) {
+                mfu_copy_stats.peak_dirty = dirty;
+            }
+            mfu_copy_stats.wtime_dirty = now;
+        }
     }
+    return rc;
+}
 
-    /* otherwise, we're not at EOF yet, seek back one byte */
-    if(mfu_lseek(file, fd, -1, SEEK_CUR) == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in path `%s' (errno=%d %s)",
-                  file, errno, strerror(errno));
-        return -1;
+/* write length bytes from buf to fd at pos, unlike mfu_write this
+ * reports a failure rather than aborting, so that one bad destination
+ * of a fan-out copy does not stop the others,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_pwrite_all(int fd, const char* buf, size_t length, off_t pos)
+{
+    size_t n = 0;
+    while (n < length) {
+        ssize_t rc = pwrite(fd, buf + n, length - n, pos + (off_t)n);
+        if (rc < 0 && errno == EINTR) {
+            continue;
+        }
+        if (rc <= 0) {
+            return -1;
+        }
+        n += (size_t) rc;
     }
     return 0;
 }
 
-static int mfu_copy_file_normal(
+/* copy a section of a file to each of ndests destination files,
+ * reading each block of the source once into block_buf1 and writing
+ * it to every destination whose bit is not set in skip, returns 0 on
+ * success, and otherwise a mask with bit d set for each destination d
+ * that did not get all of the section */
+static int mfu_copy_file_fanout(
     const char* src,
-    const char* dest,
-    const int in_fd,
-    const int out_fd,
+    char** dests,
+    int ndests,
+    int skip,
     uint64_t offset,
     uint64_t length,
     uint64_t file_size,
     mfu_copy_opts_t* mfu_copy_opts)
 {
-    /* hint that we'll read from file sequentially */
-//    posix_fadvise(in_fd, offset, chunk_size, POSIX_FADV_SEQUENTIAL);
+    int all = (1 << ndests) - 1;
+    int mask = skip;
 
-    /* seek to offset in source file */
-    if(mfu_lseek(src, in_fd, offset, SEEK_SET) == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
+    /* open the input file */
+    mfu_fdcache_entry* in_file = mfu_copy_open_file(src, 1, mfu_copy_opts);
+    if (in_file == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
             src, errno, strerror(errno));
-        return -1;
+        return all;
     }
-
-    /* seek to offset in destination file */
-    if(mfu_lseek(dest, out_fd, offset, SEEK_SET) == (off_t)-1) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        return -1;
+    int in_fd = in_file->fd;
+
+    /* open the output files, the cache holds more files than there
+     * are destinations, so this does not close the input file */
+    int* out_fds = (int*) MFU_MALLOC((size_t)ndests * sizeof(int));
+    int d;
+    for (d = 0; d < ndests; d++) {
+        out_fds[d] = -1;
+        if (mask & (1 << d)) {
+            continue;
+        }
+        mfu_fdcache_entry* out_file = mfu_copy_open_file(dests[d], 0, mfu_copy_opts);
+        if (out_file == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+                dests[d], errno, strerror(errno));
+            mask |= (1 << d);
+            continue;
+        }
+        out_fds[d] = out_file->fd;
     }
 
-    /* get buffer */
     size_t buf_size = mfu_copy_opts->block_size;
-    void* buf = mfu_copy_opts->block_buf1;
+    char* buf = mfu_copy_opts->block_buf1;
 
-    /* write data */
-    size_t total_bytes = 0;
-    while(total_bytes <= (size_t)length) {
-        /* determine number of bytes that we
-         * can read = max(buf size, remaining chunk) */
-        size_t left_to_read = (size_t)length - total_bytes;
-        if(left_to_read > buf_size) {
+    uint64_t pos = offset;
+    uint64_t last_byte = offset + length;
+    while (pos < last_byte && mask != all) {
+        size_t left_to_read = (size_t) (last_byte - pos);
+        if (left_to_read > buf_size) {
             left_to_read = buf_size;
         }
 
-        /* read data from source file */
-        ssize_t num_of_bytes_read = mfu_read(src, in_fd, buf, left_to_read);
-
-        /* check for EOF */
-        if(! num_of_bytes_read) {
+        ssize_t nread = pread(in_fd, buf, left_to_read, (off_t) pos);
+        if (nread < 0 && errno == EINTR) {
+            continue;
+        }
+        if (nread < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to read `%s' at offset %" PRIu64 " (errno=%d %s)",
+                src, pos, errno, strerror(errno));
+            mask = all;
+            break;
+        }
+        if (nread == 0) {
             break;
         }
 
-        /* compute number of bytes to write */
-        size_t bytes_to_write = (size_t) num_of_bytes_read;
-        if(mfu_copy_opts->synchronous) {
-            /* O_DIRECT requires particular write sizes,
-             * ok to write beyond end of file so long as
-             * we truncate in cleanup step */
-            size_t remainder = buf_size - (size_t) num_of_bytes_read;
-            if(remainder > 0) {
-                /* zero out the end of the buffer for security,
-                 * don't want to leave data from another file at end of
-                 * current file if we fail before truncating */
-                char* bufzero = ((char*)buf + num_of_bytes_read);
-                memset(bufzero, 0, remainder);
-            }
-
-            /* assumes buf_size is magic size for O_DIRECT */
-            bytes_to_write = buf_size;
+        /* checksum the data while we have it */
+        if (mfu_copy_opts->manifest != NULL) {
+            mfu_copy_sum_data(pos, buf, (size_t) nread);
+        }
+
+        /* blocks of zeros are left as holes in sparse copies */
+        if (! (mfu_copy_opts->sparse && mfu_buf_is_zero(buf, (size_t) nread))) {
+            for (d = 0; d < ndests; d++) {
+                if (mask & (1 << d)) {
+                    continue;
+                }
+                if (mfu_copy_pwrite_all(out_fds[d], buf, (size_t) nread, (off_t) pos) < 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
+                        src, dests[d], errno, strerror(errno));
+                    mask |= (1 << d);
+                }
+            }
+        }
+
+        pos += (uint64_t) nread;
+
+        /* update number of bytes we have copied for progress messages */
+        copy_count += (uint64_t) nread;
+        mfu_progress_update(&copy_count, copy_prog);
+    }
+
+    /* count source data once, however many copies we made */
+    uint64_t bytes = pos - offset;
+    mfu_copy_stats.total_size += (int64_t) bytes;
+    mfu_copy_stats.total_bytes_copied += (int64_t) bytes;
+    mfu_throttle_charge((uint64_t)(1 + ndests) * bytes, 0);
+
+    /* set final size of each file if we wrote its last chunk,
+     * sparse destinations are truncated to 0 when created,
+     * so extend those in case the file ends with zeros */
+    for (d = 0; d < ndests; d++) {
+        if (mask & (1 << d)) {
+            continue;
+        }
+        if (mfu_copy_opts->sparse) {
+            if (offset + length >= file_size &&
+                mfu_ftruncate(out_fds[d], (off_t) file_size) < 0)
+            {
+                MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                    dests[d], errno, strerror(errno));
+                mask |= (1 << d);
+            }
+        } else if (mfu_copy_truncate_last(dests[d], out_fds[d], offset, length, file_size, mfu_copy_opts) < 0) {
+            mask |= (1 << d);
         }
+    }
+    mfu_free(&out_fds);
+
+    if (mfu_copy_opts->manifest != NULL) {
+        mfu_copy_sum_finish(src, (mask == all) ? -1 : 0);
+    }
+    if (mfu_copy_opts->journal != NULL && mask == 0) {
+        mfu_copy_journal_add(src, offset, length, file_size, mfu_copy_opts);
+    }
+
+    /* report only destinations that failed here */
+    return mask & ~skip;
+}
 
-        /* Write data to destination file.
-         * Do nothing for a hole in the middle of a file,
-         * because write of next chunk will create one for us.
-         * Write only the last byte to create the hole,
-         * if the hole is next to EOF. */
-        ssize_t num_of_bytes_written = (ssize_t)bytes_to_write;
-        if (mfu_copy_opts->sparse && mfu_is_all_null(buf, bytes_to_write)) {
-            /* TODO: isn't there a better way to know if we're at EOF,
-             * e.g., by using file size? */
-            /* determine whether we're at the end of the file */
-            int end_of_file = mfu_is_eof(src, in_fd);
-            if (end_of_file < 0) {
-                /* hit an error while looking for EOF */
-                return -1;
-            }
+/* arguments passed through mfu_file_chunk_list_execute to mfu_copy_chunk */
+typedef struct {
+    int numpaths;
+    const mfu_param_path* paths;
+    const mfu_param_path* destpath;
+    mfu_copy_opts_t* mfu_copy_opts;
+    uint64_t chunk_size;  /* chunk size used to build the chunk list */
+    uint64_t total_count; /* number of bytes this process copied */
+    uint64_t total_files; /* number of files this process started */
+} mfu_copy_chunk_args_t;
+
+/* compute name of item in each destination, sets no entry to NULL,
+ * returns an array the caller frees with mfu_copy_dest_names_free */
+static char** mfu_copy_dest_names(const char* name, int numpaths,
+        const mfu_param_path* paths, mfu_copy_opts_t* mfu_copy_opts)
+{
+    char** dests = (char**) MFU_MALLOC((size_t)mfu_copy_ndests * sizeof(char*));
+    int d;
+    for (d = 0; d < mfu_copy_ndests; d++) {
+        const mfu_param_path* destpath = mfu_copy_use_dest(d, mfu_copy_opts);
+        dests[d] = mfu_param_path_copy_dest(name, numpaths, paths,
+            destpath, mfu_copy_opts);
+    }
+    mfu_copy_use_dest(0, mfu_copy_opts);
+    return dests;
+}
 
-            /* if we're at the end of the file, write out a byte,
-             * otherwise just seek out destination file pointer
-             * ahead without writing anything */
-            if (end_of_file) {
-                /* seek to last byte position in file */
-                if(mfu_lseek(dest, out_fd, (off_t)bytes_to_write - 1, SEEK_CUR) == (off_t)-1) {
-                    MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-                        dest, errno, strerror(errno));
-                    return -1;
-                }
+static void mfu_copy_dest_names_free(char*** pdests)
+{
+    char** dests = *pdests;
+    int d;
+    for (d = 0; d < mfu_copy_ndests; d++) {
+        mfu_free(&dests[d]);
+    }
+    mfu_free(pdests);
+}
 
-                /* write out a single byte */
-                mfu_write(dest, out_fd, buf, 1);
-            } else {
-                /* this section of the destination file is all 0,
-                 * seek past this section */
-                if(mfu_lseek(dest, out_fd, (off_t)bytes_to_write, SEEK_CUR) == (off_t)-1) {
-                    MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-                        dest, errno, strerror(errno));
-                    return -1;
-                }
-            }
-        } else {
-            /* write bytes to destination file */
-            num_of_bytes_written = mfu_write(dest, out_fd, buf, bytes_to_write);
+/* copy a section of a file to all destinations, returns 0 on success,
+ * and otherwise a mask with bit d set for each destination d that did
+ * not get all of the section */
+static int mfu_copy_chunk_fanout(const char* name, uint64_t offset,
+        uint64_t length, uint64_t file_size, mfu_copy_chunk_args_t* args)
+{
+    mfu_copy_opts_t* mfu_copy_opts = args->mfu_copy_opts;
+    char** dests = mfu_copy_dest_names(name, args->numpaths, args->paths, mfu_copy_opts);
+
+    /* skip destinations this item does not go to */
+    int mask = 0;
+    int d;
+    for (d = 0; d < mfu_copy_ndests; d++) {
+        if (dests[d] == NULL) {
+            mask |= (1 << d);
         }
+    }
+    int skip = mask;
 
-        /* check for an error */
-        if(num_of_bytes_written < 0) {
-            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
-                src, dest, errno, strerror(errno));
-            return -1;
-        }
+    args->total_count += length;
+    if (offset == 0) {
+        args->total_files++;
+    }
 
-        /* check that we wrote the same number of bytes that we read */
-        if((size_t)num_of_bytes_written != bytes_to_write) {
-            MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
-                src, dest);
-            return -1;
+    /* journal each chunk as it completes */
+    uint64_t piece = length;
+    if (mfu_copy_opts->journal != NULL && args->chunk_size > 0) {
+        piece = args->chunk_size;
+    }
+    uint64_t done = 0;
+    do {
+        uint64_t len = length - done;
+        if (len > piece) {
+            len = piece;
         }
+        mask |= mfu_copy_file_fanout(name, dests, mfu_copy_ndests, mask,
+            offset + done, len, file_size, mfu_copy_opts);
+        done += len;
+    } while (done < length && mask != (1 << mfu_copy_ndests) - 1);
 
-        /* add bytes to our total (use bytes read,
-         * which may be less than number written) */
-        total_bytes += (size_t) num_of_bytes_read;
+    mfu_copy_dest_names_free(&dests);
 
-        /* update number of bytes we have copied for progress messages */
-        copy_count += (uint64_t) num_of_bytes_read;
-        mfu_progress_update(&copy_count, copy_prog);
-    }
+    return mask & ~skip;
+}
 
-    /* Increment the global counter. */
-    mfu_copy_stats.total_size += (int64_t) total_bytes;
-    mfu_copy_stats.total_bytes_copied += (int64_t) total_bytes;
+/* copy a section of a file, called once per chunk list section */
+static int mfu_copy_chunk(const char* name, uint64_t offset,
+        uint64_t length, uint64_t file_size, void* arg)
+{
+    mfu_copy_chunk_args_t* args = (mfu_copy_chunk_args_t*) arg;
 
-#if 0
-    /* force data to file system */
-    if(total_bytes > 0) {
-        mfu_fsync(dest, out_fd);
+    /* write to several destinations from the same reads */
+    if (mfu_copy_ndests > 1) {
+        return mfu_copy_chunk_fanout(name, offset, length, file_size, args);
     }
-#endif
 
-    /* no need to truncate if sparse file is enabled,
-     * since we truncated files when they were first created */
-    if (mfu_copy_opts->sparse) {
+    /* get name of destination file */
+    char* dest = mfu_param_path_copy_dest(name, args->numpaths,
+            args->paths, args->destpath, args->mfu_copy_opts);
+    if (dest == NULL) {
+        /* No need to copy it */
         return 0;
     }
 
-    /* if we wrote the last chunk, truncate the file */
-    off_t last_written = offset + length;
-    off_t file_size_offt = (off_t) file_size;
-    if (last_written >= file_size_offt || file_size == 0) {
-        /* Use ftruncate() here rather than truncate(), because grouplock
-         * of Lustre would cause block to truncate() since the fd is different
-         * from the out_fd. */
-        if(mfu_ftruncate(out_fd, file_size_offt) < 0) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
-                dest, errno, strerror(errno));
-            return -1;
-       }
+    /* add bytes to our running total */
+    args->total_count += length;
+    if (offset == 0) {
+        args->total_files++;
     }
 
-    /* we don't bother closing the file because our cache does it for us */
+    /* copy portion of file corresponding to this chunk, a section may
+     * span many chunks, so journal each chunk as it completes and
+     * start writeback after each write-behind window */
+    mfu_copy_opts_t* mfu_copy_opts = args->mfu_copy_opts;
+    uint64_t piece = length;
+    if (mfu_copy_opts->journal != NULL && args->chunk_size > 0) {
+        piece = args->chunk_size;
+    }
+    if (mfu_copy_opts->pagecache == MFU_COPY_PAGECACHE_DROP &&
+        mfu_copy_opts->writebehind > 0 && mfu_copy_opts->writebehind < piece)
+    {
+        piece = mfu_copy_opts->writebehind;
+    }
+    uint64_t done = 0;
+    int copy_rc;
+    do {
+        uint64_t len = length - done;
+        if (len > piece) {
+            len = piece;
+        }
+        copy_rc = mfu_copy_file(name, dest, offset + done, len,
+                file_size, mfu_copy_opts);
+        done += len;
+    } while (copy_rc == 0 && done < length);
 
-    return 0;
+    /* free the dest name */
+    mfu_free(&dest);
+
+    return copy_rc;
 }
 
-static int mfu_copy_file_fiemap(
-    const char* src,
-    const char* dest,
-    const int in_fd,
-    const int out_fd,
-    uint64_t offset,
-    uint64_t length,
-    uint64_t file_size,
-    bool* normal_copy_required,
-    mfu_copy_opts_t* mfu_copy_opts)
+/* number of times files that fail verification are copied again */
+#define MFU_COPY_VERIFY_RETRIES (2)
+
+/* number of recopies of failed files we are nested in */
+static int mfu_copy_verify_depth = 0;
+
+static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int* failed);
+
+/* read back a section of a destination file from storage and compare
+ * it to the source, returns 0 if they match and -1 otherwise */
+static int mfu_copy_verify_dest(const char* name, const char* dest,
+        uint64_t offset, uint64_t length, mfu_copy_opts_t* mfu_copy_opts)
 {
-    *normal_copy_required = true;
-    if (mfu_copy_opts->synchronous) {
-        goto fail_normal_copy;
+    /* write out anything still dirty in our cache and then drop the
+     * section, so that we read what the storage holds, the file stays
+     * open in the cache for the compare below */
+    mfu_fdcache_entry* e = mfu_fdcache_open(mfu_copy_fd_cache, dest, O_RDONLY, 0);
+    if (e == NULL) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
+            dest, errno, strerror(errno));
+        return -1;
+    }
+    fdatasync(e->fd);
+    posix_fadvise(e->fd, (off_t)offset, (off_t)length, POSIX_FADV_DONTNEED);
+
+    uint64_t bytes_read = 0, bytes_written = 0;
+    int cmp_rc = mfu_compare_contents_cached(name, dest, (off_t)offset,
+            (off_t)length, mfu_copy_opts->block_size, 0,
+            &bytes_read, &bytes_written, NULL, mfu_copy_fd_cache);
+    if (cmp_rc != 0) {
+        MFU_LOG(MFU_LOG_WARN, "Failed to verify `%s' at offset %" PRIu64 " length %" PRIu64,
+            dest, offset, length);
+        return -1;
     }
+    return 0;
+}
 
-    size_t last_ext_start = offset;
-    size_t last_ext_len = 0;
+/* verify a section of a file in each destination, called once per
+ * chunk list section, returns 0 if all match, and otherwise a mask
+ * with bit d set for each destination d that differs */
+static int mfu_copy_verify_chunk(const char* name, uint64_t offset,
+        uint64_t length, uint64_t file_size, void* arg)
+{
+    mfu_copy_chunk_args_t* args = (mfu_copy_chunk_args_t*) arg;
+    mfu_copy_opts_t* mfu_copy_opts = args->mfu_copy_opts;
 
-    struct fiemap *fiemap = (struct fiemap*)malloc(sizeof(struct fiemap));
-    if (fiemap == NULL) {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory allocating fiemap");
-        goto fail_normal_copy;
+    /* nothing to read in an empty file */
+    if (length == 0) {
+        return 0;
     }
-    memset(fiemap, 0, sizeof(struct fiemap));
 
-    fiemap->fm_start  = offset;
-    fiemap->fm_length = length;
-    fiemap->fm_flags  = FIEMAP_FLAG_SYNC;
-    fiemap->fm_extent_count   = 0;
-    fiemap->fm_mapped_extents = 0;
+    char** dests = mfu_copy_dest_names(name, args->numpaths, args->paths, mfu_copy_opts);
 
-    struct stat sb;
-    if (fstat(in_fd, &sb) < 0) {
-        goto fail_normal_copy;
+    int mask = 0;
+    int d;
+    for (d = 0; d < mfu_copy_ndests; d++) {
+        if (dests[d] == NULL) {
+            continue;
+        }
+        if (mfu_copy_verify_dest(name, dests[d], offset, length, mfu_copy_opts) < 0) {
+            mask |= (1 << d);
+        }
+        args->total_count += length;
     }
 
-    if (ioctl(in_fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src `%s'", src);
-        goto fail_normal_copy;
+    mfu_copy_dest_names_free(&dests);
+    return mask;
+}
+
+/* read back each chunk of head on the next process, which did not
+ * write it unless the chunk was stolen, and copy files whose data
+ * differs from the source again, up to MFU_COPY_VERIFY_RETRIES times,
+ * to only the destinations where they differ, sets results[i] for
+ * files that still differ, and with several destinations, sets
+ * dest_results[d * size + i] for each destination d they differ in */
+static void mfu_copy_verify(mfu_flist list, const mfu_file_chunk* head,
+        uint64_t chunk_size, int numpaths, const mfu_param_path* paths,
+        mfu_copy_opts_t* mfu_copy_opts, int* results, int* dest_results)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* hand our chunks to the next rank and read back those of the previous one */
+    mfu_file_chunk* shifted = mfu_file_chunk_list_shift(head, 1);
+    uint64_t count = mfu_file_chunk_list_size(shifted);
+    int* vals = (int*) MFU_MALLOC(count * sizeof(int));
+
+    mfu_copy_chunk_args_t args;
+    args.numpaths      = numpaths;
+    args.paths         = paths;
+    args.destpath      = mfu_copy_use_dest(0, mfu_copy_opts);
+    args.mfu_copy_opts = mfu_copy_opts;
+    args.chunk_size    = chunk_size;
+    args.total_count   = 0;
+    args.total_files   = 0;
+    mfu_file_chunk_list_execute(shifted, chunk_size, 0,
+        mfu_copy_verify_chunk, &args, vals);
+    mfu_fdcache_close_all(mfu_copy_fd_cache);
+    mfu_copy_stats.total_bytes_verified += (int64_t) args.total_count;
+
+    /* each chunk flag has a bit for each destination that differs,
+     * combine each bit over the chunks of a file on its owner */
+    int ndests = mfu_copy_ndests;
+    uint64_t i;
+    uint64_t size = mfu_flist_size(list);
+    int* differ = (int*) MFU_MALLOC((size_t)ndests * size * sizeof(int));
+    int* dest_vals = (int*) MFU_MALLOC(count * sizeof(int));
+    int d;
+    for (d = 0; d < ndests; d++) {
+        int* diff = &differ[(uint64_t)d * size];
+        uint64_t j;
+        for (j = 0; j < count; j++) {
+            dest_vals[j] = (vals[j] >> d) & 1;
+        }
+        for (i = 0; i < size; i++) {
+            diff[i] = 0;
+        }
+        mfu_file_chunk_list_lor(list, shifted, dest_vals, diff);
     }
+    mfu_free(&dest_vals);
+    mfu_free(&vals);
+    mfu_file_chunk_list_free(&shifted);
+
+    /* copy the whole of each file, and leave the manifest alone,
+     * since its checksums were taken from the source */
+    char* manifest = mfu_copy_opts->manifest;
+    bool resume = mfu_copy_opts->resume;
+    mfu_copy_opts->manifest = NULL;
+    mfu_copy_opts->resume   = false;
+
+    /* copy again to one destination at a time */
+    const mfu_param_path* dests = mfu_copy_dests;
+    const int* dests_into = mfu_copy_dests_into;
+    uint64_t* redo_idx = (uint64_t*) MFU_MALLOC(size * sizeof(uint64_t));
+    for (d = 0; d < ndests; d++) {
+        int* diff = &differ[(uint64_t)d * size];
+        int* dres = (dest_results != NULL) ? &dest_results[(uint64_t)d * size] : results;
+
+        /* pick out files that copied without error but read back wrong */
+        mfu_flist redo = mfu_flist_subset(list);
+        uint64_t redo_count = 0;
+        for (i = 0; i < size; i++) {
+            if (dres[i] == 0 && diff[i] != 0) {
+                mfu_flist_file_copy(list, i, redo);
+                redo_idx[redo_count] = i;
+                redo_count++;
+            }
+        }
+        mfu_flist_summarize(redo);
+
+        uint64_t redo_total = mfu_flist_global_size(redo);
+        int* redo_failed = (int*) MFU_MALLOC(redo_count * sizeof(int));
+        for (i = 0; i < redo_count; i++) {
+            redo_failed[i] = 1;
+        }
+        if (redo_total > 0 && mfu_copy_verify_depth < MFU_COPY_VERIFY_RETRIES) {
+            const mfu_param_path* destpath = mfu_copy_use_dest(d, mfu_copy_opts);
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "Copying %" PRIu64 " files that failed verification to `%s' again.",
+                    redo_total, destpath->orig);
+            }
+            mfu_copy_stats.total_files_recopied += (int64_t) redo_count;
+
+            /* sparse copies skip zeros rather than writing them,
+             * so clear what we wrote before, the copy below
+             * starts with a barrier */
+            if (mfu_copy_opts->sparse) {
+                for (i = 0; i < redo_count; i++) {
+                    const char* name = mfu_flist_file_get_name(redo, i);
+                    char* dest = mfu_param_path_copy_dest(name, numpaths,
+                        paths, destpath, mfu_copy_opts);
+                    if (dest != NULL && mfu_truncate(dest, 0) < 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
+                            dest, errno, strerror(errno));
+                    }
+                    mfu_free(&dest);
+                }
+            }
 
-    size_t extents_size = sizeof(struct fiemap_extent) * (fiemap->fm_mapped_extents);
+            mfu_copy_ndests      = 1;
+            mfu_copy_dests       = &dests[d];
+            mfu_copy_dests_into  = &dests_into[d];
+            mfu_copy_verify_depth++;
+            mfu_copy_files(redo, chunk_size, numpaths, paths, destpath,
+                mfu_copy_opts, redo_failed);
+            mfu_copy_verify_depth--;
+            mfu_copy_ndests      = ndests;
+            mfu_copy_dests       = dests;
+            mfu_copy_dests_into  = dests_into;
+        }
 
-    if ((fiemap = (struct fiemap*)realloc(fiemap,sizeof(struct fiemap) +
-                                  extents_size)) == NULL)
-    {
-        MFU_LOG(MFU_LOG_ERR, "Out of memory reallocating fiemap");
-        goto fail_normal_copy;
+        /* files that are out of retries count as failed */
+        for (i = 0; i < redo_count; i++) {
+            dres[redo_idx[i]] = redo_failed[i];
+            if (redo_failed[i]) {
+                results[redo_idx[i]] = 1;
+            }
+        }
+        mfu_free(&redo_failed);
+        mfu_flist_free(&redo);
     }
+    mfu_copy_use_dest(0, mfu_copy_opts);
+
+    mfu_copy_opts->manifest = manifest;
+    mfu_copy_opts->resume   = resume;
 
-    memset(fiemap->fm_extents, 0, extents_size);
-    fiemap->fm_extent_count   = fiemap->fm_mapped_extents;
-    fiemap->fm_mapped_extents = 0;
+    mfu_free(&redo_idx);
+    mfu_free(&differ);
+}
+
+/* slices files in list at boundaries of chunk size, evenly distributes
+ * chunks, and copies data from source to destination file,
+ * returns 0 on success and -1 on error */
+static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
+        int numpaths, const mfu_param_path* paths,
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        int* failed)
+{
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* determine whether we should print status messages */
+    int verbose = (mfu_debug_level >= MFU_LOG_VERBOSE);
+
+    /* get current rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* barrier to ensure all procs are ready to start copy */
+    MPI_Barrier(MPI_COMM_WORLD);
 
-    if (ioctl(in_fd, FS_IOC_FIEMAP, fiemap) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "fiemap ioctl() failed for src `%s'", src);
-        goto fail_normal_copy;
+    /* indicate which phase we're in to user */
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Copying data.");
     }
 
-    uint64_t last_byte = offset + length;
+    /* start timer for entie operation */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_start = MPI_Wtime();
+    uint64_t total_count = 0;
+
+    /* start up progress messages for the copy */
+    copy_count = 0;
+    copy_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, copy_progress_fn);
 
-    if (fiemap->fm_mapped_extents > 0) {
-        uint64_t fe_logical = fiemap->fm_extents[0].fe_logical;
-        uint64_t fe_length  = fiemap->fm_extents[0].fe_length;
-        if (fe_logical < offset) {
-            fiemap->fm_extents[0].fe_length -= (offset - fe_logical);
-            fiemap->fm_extents[0].fe_logical = offset;
+    /* determine the per-file overhead to balance with, use the
+     * estimate from our last copy unless the user gave one */
+    uint64_t file_cost = mfu_copy_opts->file_cost;
+    if (file_cost == 0) {
+        file_cost = mfu_copy_file_cost_est;
+        if (file_cost == 0) {
+            file_cost = MFU_COPY_FILE_COST_DEFAULT;
         }
+    }
 
-        fe_logical = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_logical;
-        fe_length  = fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length;
-        if (fe_logical + fe_length > last_byte) {
-           fiemap->fm_extents[fiemap->fm_mapped_extents - 1].fe_length -=
-           fe_logical + fe_length - last_byte;
+    /* split file list into a linked list of file sections,
+     * this evenly spreads the file sections across processes,
+     * when resuming, leave out chunks an earlier run copied */
+    mfu_file_chunk* head;
+    if (mfu_copy_opts->balance == MFU_COPY_BALANCE_PHYSICAL) {
+        mfu_copy_done_t done;
+        if (mfu_copy_opts->resume) {
+            mfu_copy_resume_lookup(list, &done);
+        }
+        head = mfu_file_chunk_list_alloc_physical(list, chunk_size, file_cost,
+            mfu_copy_opts->resume ? mfu_copy_resume_skip : NULL, &done);
+        if (mfu_copy_opts->resume) {
+            mfu_free(&done.ranges);
+        }
+    } else if (mfu_copy_opts->resume) {
+        mfu_file_chunk_weight weight = MFU_FILE_CHUNK_WEIGHT_NONE;
+        if (mfu_copy_opts->balance == MFU_COPY_BALANCE_COST) {
+            weight = MFU_FILE_CHUNK_WEIGHT_BYTES;
+        } else if (mfu_copy_opts->balance == MFU_COPY_BALANCE_DATA) {
+            weight = MFU_FILE_CHUNK_WEIGHT_DATA;
         }
+        mfu_copy_done_t done;
+        mfu_copy_resume_lookup(list, &done);
+        head = mfu_file_chunk_list_alloc_skip(list, chunk_size, weight,
+            file_cost, mfu_copy_resume_skip, &done);
+        mfu_free(&done.ranges);
+    } else if (mfu_copy_opts->balance == MFU_COPY_BALANCE_COST) {
+        head = mfu_file_chunk_list_alloc_weighted(list, chunk_size, file_cost);
+    } else if (mfu_copy_opts->balance == MFU_COPY_BALANCE_DATA) {
+        head = mfu_file_chunk_list_alloc_data(list, chunk_size, file_cost);
+    } else {
+        head = mfu_file_chunk_list_alloc(list, chunk_size);
     }
 
-    *normal_copy_required = false;
+    /* get a count of how many items are the chunk list */
+    uint64_t list_count = mfu_file_chunk_list_size(head);
 
-    /* seek to offset in source file */
-    if (mfu_lseek(src, in_fd, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
-        goto fail;
+    /* estimate cost of the chunks we were assigned, which is only
+     * reported, so skip scanning sources for data unless verbose */
+    double local_cost = 0.0;
+    const mfu_file_chunk* p;
+    for (p = head; verbose && p != NULL; p = p->next) {
+        /* count only data in sparse files when balancing by data */
+        uint64_t bytes = p->length;
+        if (mfu_copy_opts->balance == MFU_COPY_BALANCE_DATA && p->length > 0) {
+            mfu_fdcache_entry* e = mfu_copy_open_file(p->name, 1, mfu_copy_opts);
+            if (e != NULL) {
+                off_t data = mfu_data_size(p->name, e->fd, (off_t)p->offset, (off_t)p->length);
+                if (data >= 0) {
+                    bytes = (uint64_t) data;
+                }
+            }
+        }
+        local_cost += (double) bytes;
+        if (p->offset == 0) {
+            local_cost += (double) file_cost;
+        }
     }
 
-    /* seek to offset in destination file */
-    if (mfu_lseek(dest, out_fd, (off_t)last_ext_start, SEEK_SET) < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        goto fail;
-    }
+    /* allocate a flag for each element in chunk list,
+     * will store 0 to mean copy of this chunk succeeded and 1 otherwise
+     * to be used as input to logical OR to determine state of entire file */
+    int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
 
-    unsigned int i;
-    for (i = 0; i < fiemap->fm_mapped_extents; i++) {
-        size_t ext_start;
-        size_t ext_len;
-        size_t ext_hole_size;
+    /* copy data for each file section we're responsible for,
+     * possibly along with sections stolen from other processes */
+    mfu_copy_chunk_args_t args;
+    args.numpaths      = numpaths;
+    args.paths         = paths;
+    args.destpath      = destpath;
+    args.mfu_copy_opts = mfu_copy_opts;
+    args.chunk_size    = chunk_size;
+    args.total_count   = 0;
+    args.total_files   = 0;
+    mfu_file_chunk_list_execute(head, chunk_size, mfu_copy_opts->dynamic,
+        mfu_copy_chunk, &args, vals);
+    total_count = args.total_count;
+
+    /* write out and drop the last of our data from the page cache */
+    mfu_writebehind_finish(&mfu_copy_wb);
+
+    /* record the last of our chunks in the journal */
+    mfu_copy_journal_flush(mfu_copy_opts);
 
-        size_t buf_size = mfu_copy_opts->block_size;
-        void* buf = mfu_copy_opts->block_buf1;
+    /* close files */
+    mfu_fdcache_close_all(mfu_copy_fd_cache);
 
-        ext_start = fiemap->fm_extents[i].fe_logical;
-        ext_len = fiemap->fm_extents[i].fe_length;
-        ext_hole_size = ext_start - (last_ext_start + last_ext_len);
+    /* note when this process finished its own chunks */
+    double local_end = MPI_Wtime();
 
-        if (ext_hole_size) {
-            if (mfu_lseek(src, in_fd, (off_t)ext_start, SEEK_SET) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in source path `%s' (errno=%d %s)",
-                    src, errno, strerror(errno));
-                goto fail;
+    /* barrier to ensure all files are closed,
+     * may try to unlink bad destination files below */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    /* allocate a flag for each item in our file list */
+    uint64_t i;
+    uint64_t size = mfu_flist_size(list);
+    int* results = (int*) MFU_MALLOC(size * sizeof(int));
+
+    /* intialize values, since not every item is represented
+     * in chunk list */
+    for (i = 0; i < size; i++) {
+        results[i] = 0;
+    }
+
+    /* determnie which files were copied correctly */
+    mfu_file_chunk_list_lor(list, head, vals, results);
+
+    /* with several destinations, each chunk flag has a bit for each
+     * destination it missed, combine each bit over the chunks of a
+     * file to learn which destinations the file missed */
+    int ndests = mfu_copy_ndests;
+    int* dest_results = NULL;
+    if (ndests > 1) {
+        dest_results = (int*) MFU_MALLOC((size_t)ndests * size * sizeof(int));
+        int* dest_vals = (int*) MFU_MALLOC(list_count * sizeof(int));
+        int d;
+        for (d = 0; d < ndests; d++) {
+            int* dres = &dest_results[(uint64_t)d * size];
+            uint64_t j;
+            for (j = 0; j < list_count; j++) {
+                dest_vals[j] = (vals[j] >> d) & 1;
             }
-            if (mfu_lseek(dest, out_fd, (off_t)ext_hole_size, SEEK_CUR) < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Couldn't seek in destination path `%s' (errno=%d %s)",
-                    dest, errno, strerror(errno));
-                goto fail;
+            for (i = 0; i < size; i++) {
+                dres[i] = 0;
             }
+            mfu_file_chunk_list_lor(list, head, dest_vals, dres);
         }
+        mfu_free(&dest_vals);
+    }
+    mfu_free(&vals);
 
-        last_ext_start = ext_start;
-        last_ext_len = ext_len;
-
-        while (ext_len) {
-            ssize_t num_read = mfu_read(src, in_fd, buf, MIN(ext_len, buf_size));
+    /* finalize progress messages for the copy */
+    mfu_progress_complete(&copy_count, &copy_prog);
 
-            if (!num_read)
-                break;
+    /* read back what we wrote before anything else touches the
+     * files, copying those that differ again */
+    if (mfu_copy_opts->verify) {
+        mfu_copy_verify(list, head, chunk_size, numpaths, paths,
+            mfu_copy_opts, results, dest_results);
+    }
 
-            ssize_t num_written = mfu_write(dest, out_fd, buf, (size_t)num_read);
+    /* delete any destination file that failed to copy */
+    for (i = 0; i < size; i++) {
+        if (results[i] != 0) {
+            /* found a file that had an error during copy,
+             * compute destination name and delete it */
+            const char* name = mfu_flist_file_get_name(list, i);
 
-            if (num_written < 0) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s' (errno=%d %s)",
-                          src, dest, errno, strerror(errno));
-                goto fail;
-            }
-            if (num_written != num_read) {
-                MFU_LOG(MFU_LOG_ERR, "Write error when copying from `%s' to `%s'",
-                    src, dest);
-                goto fail;
+            /* report the destinations the file is missing from,
+             * or all of them if no destination was singled out */
+            int known = 0;
+            int d;
+            for (d = 0; d < ndests && dest_results != NULL; d++) {
+                known |= dest_results[(uint64_t)d * size + i];
             }
 
-            ext_len -= (size_t)num_written;
-            mfu_copy_stats.total_bytes_copied += (int64_t) num_written;
+            for (d = 0; d < ndests; d++) {
+                if (known && ! dest_results[(uint64_t)d * size + i]) {
+                    continue;
+                }
+                const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+                const char* dest = mfu_param_path_copy_dest(name, numpaths,
+                    paths, dp, mfu_copy_opts);
+                if (dest != NULL) {
+                    /* sanity check to ensure we don't * delete the source file */
+                    if (strcmp(dest, name) != 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
+                        rc = -1;
+#if 0
+                        /* delete destination file */
+                        int unlink_rc = mfu_unlink(dest);
+                        if (unlink_rc != 0) {
+                            MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                                      name, errno, strerror(errno)
+                                    );
+                        }
+#endif
+                    }
+
+                    /* free destination name */
+                    mfu_free(&dest);
+                }
+            }
+            mfu_copy_use_dest(0, mfu_copy_opts);
         }
     }
+    mfu_free(&dest_results);
 
-    off_t last_written = (off_t) last_byte;
-    off_t file_size_offt = (off_t) file_size;
-    if (last_written >= file_size_offt || file_size == 0) {
-        /* Use ftruncate() here rather than truncate(), because grouplock
-         * of Lustre would cause block to truncate() since the fd is different
-         * from the out_fd. */
-        if (mfu_ftruncate(out_fd, file_size_offt) < 0) {
-            MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: %s (errno=%d %s)",
-                dest, errno, strerror(errno));
-            goto fail;
-       }
+    /* free copy flags */
+    /* give caller the flag of each item if asked */
+    if (failed != NULL) {
+        memcpy(failed, results, size * sizeof(int));
+    }
+    mfu_free(&results);
+
+    /* free the list of file chunks */
+    mfu_file_chunk_list_free(&head);
+
+    /* stop timer and report total count */
+    MPI_Barrier(MPI_COMM_WORLD);
+    double total_end = MPI_Wtime();
+
+    /* refine our estimate of the per-file overhead by fitting
+     * busy time = alpha * files + beta * bytes across processes
+     * with least squares, the overhead in bytes is alpha / beta */
+    if (mfu_copy_opts->balance != MFU_COPY_BALANCE_CHUNKS && mfu_copy_opts->file_cost == 0) {
+        double f = (double) args.total_files;
+        double b = (double) args.total_count;
+        double t = local_end - total_start;
+        double sums[5], fit[5];
+        sums[0] = f * f;
+        sums[1] = f * b;
+        sums[2] = b * b;
+        sums[3] = f * t;
+        sums[4] = b * t;
+        MPI_Allreduce(sums, fit, 5, MPI_DOUBLE, MPI_SUM, MPI_COMM_WORLD);
+
+        /* skip the update if the system is too close to singular */
+        double det = fit[0] * fit[2] - fit[1] * fit[1];
+        if (det > 1.0e-9 * fit[0] * fit[2]) {
+            double alpha = (fit[3] * fit[2] - fit[4] * fit[1]) / det;
+            double beta  = (fit[4] * fit[0] - fit[3] * fit[1]) / det;
+            if (alpha > 0.0 && beta > 0.0) {
+                mfu_copy_file_cost_est = (uint64_t) (alpha / beta) + 1;
+            }
+        }
     }
 
-    if (last_written >= file_size_offt) {
-        mfu_copy_stats.total_size += (int64_t) (file_size_offt - (off_t) offset);
-    } else {
-        mfu_copy_stats.total_size += (int64_t) last_byte;
-    }
+    /* print timing statistics */
+    if (verbose) {
+        uint64_t sum;
+        MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+        double rate = 0.0;
+        double secs = total_end - total_start;
+        if (secs > 0.0) {
+          rate = (double)sum / secs;
+        }
+
+        /* convert bytes to units */
+        double agg_size_tmp;
+        const char* agg_size_units;
+        mfu_format_bytes(sum, &agg_size_tmp, &agg_size_units);
 
-    free(fiemap);
-    return 0;
+        /* convert bandwidth to units */
+        double agg_rate_tmp;
+        const char* agg_rate_units;
+        mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
 
-fail:
-    free(fiemap);
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Copy data: %.3lf %s (%lu bytes)",
+              agg_size_tmp, agg_size_units, sum
+            );
+            MFU_LOG(MFU_LOG_INFO, "Copy rate: %.3lf %s (%lu bytes in %f seconds)",
+              agg_rate_tmp, agg_rate_units, sum, secs
+            );
+        }
 
-fail_normal_copy:
-    return -1;
-}
+        /* compute bandwidth each process achieved over the time it was busy */
+        double local_rate = 0.0;
+        double local_secs = local_end - total_start;
+        if (local_secs > 0.0) {
+            local_rate = (double)total_count / local_secs;
+        }
+        double min_rate, max_rate, sum_rate;
+        MPI_Reduce(&local_rate, &min_rate, 1, MPI_DOUBLE, MPI_MIN, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&local_rate, &max_rate, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(&local_rate, &sum_rate, 1, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
-static int mfu_copy_file(
-    const char* src,
-    const char* dest,
-    uint64_t offset,
-    uint64_t length,
-    uint64_t file_size,
-    mfu_copy_opts_t* mfu_copy_opts)
-{
-    int ret;
-    bool normal_copy_required;
+        if (rank == 0) {
+            int ranks;
+            MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+            double min_tmp, max_tmp, mean_tmp;
+            const char* min_units;
+            const char* max_units;
+            const char* mean_units;
+            mfu_format_bw(min_rate, &min_tmp, &min_units);
+            mfu_format_bw(max_rate, &max_tmp, &max_units);
+            mfu_format_bw(sum_rate / (double)ranks, &mean_tmp, &mean_units);
+            MFU_LOG(MFU_LOG_INFO, "Copy rate per process: min %.3lf %s, max %.3lf %s, mean %.3lf %s (io depth %d)",
+              min_tmp, min_units, max_tmp, max_units, mean_tmp, mean_units,
+              mfu_copy_opts->io_depth
+            );
+        }
 
-    /* open the input file */
-    int in_fd = mfu_copy_open_file(src, 1, &mfu_copy_src_cache, mfu_copy_opts);
-    if (in_fd < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to open input file `%s' (errno=%d %s)",
-            src, errno, strerror(errno));
-        return -1;
-    }
+        /* report how far the most loaded process was from the mean,
+         * both in estimated cost and in time spent copying */
+        double local_secs_busy = local_end - total_start;
+        double costs[2] = {local_cost, local_secs_busy};
+        double max_costs[2], sum_costs[2];
+        MPI_Reduce(costs, max_costs, 2, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+        MPI_Reduce(costs, sum_costs, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
 
-    /* open the output file */
-    int out_fd = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, mfu_copy_opts);
-    if (out_fd < 0) {
-        MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
-            dest, errno, strerror(errno));
-        return -1;
-    }
+        if (rank == 0) {
+            int ranks;
+            MPI_Comm_size(MPI_COMM_WORLD, &ranks);
 
-    if (mfu_copy_opts->sparse) {
-        ret = mfu_copy_file_fiemap(src, dest, in_fd, out_fd, offset,
-                               length, file_size,
-                               &normal_copy_required, mfu_copy_opts);
-        if (!ret || !normal_copy_required) {
-            return ret;
+            double cost_ratio = 1.0;
+            double time_ratio = 1.0;
+            if (sum_costs[0] > 0.0) {
+                cost_ratio = max_costs[0] * (double)ranks / sum_costs[0];
+            }
+            if (sum_costs[1] > 0.0) {
+                time_ratio = max_costs[1] * (double)ranks / sum_costs[1];
+            }
+            MFU_LOG(MFU_LOG_INFO, "Copy imbalance (max/mean): estimated cost %.3lf, busy time %.3lf (file cost %llu bytes)",
+              cost_ratio, time_ratio, (unsigned long long) file_cost
+            );
         }
     }
 
-    ret = mfu_copy_file_normal(src, dest, in_fd, out_fd,
-            offset, length, file_size, mfu_copy_opts);
-
-    return ret;
+    return rc;
 }
 
-/* slices files in list at boundaries of chunk size, evenly distributes
- * chunks, and copies data from source to destination file,
+/* creates, copies, and sets metadata on each regular file in list that
+ * is smaller than a chunk in a single pass, using one open descriptor
+ * per file, and returns a new list of the remaining items in *prest,
  * returns 0 on success and -1 on error */
-static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
+static int mfu_copy_small_files(mfu_flist list,
         int numpaths, const mfu_param_path* paths,
-        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts)
+        const mfu_param_path* destpath, mfu_copy_opts_t* mfu_copy_opts,
+        mfu_flist* prest)
 {
-    /* assume we'll succeed */
     int rc = 0;
 
     /* determine whether we should print status messages */
@@ -1956,12 +5083,36 @@ static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* barrier to ensure all procs are ready to start copy */
-    MPI_Barrier(MPI_COMM_WORLD);
+    /* split off regular files that fit in a single chunk */
+    mfu_flist small = mfu_flist_subset(list);
+    mfu_flist rest  = mfu_flist_subset(list);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        uint64_t file_size = mfu_flist_file_get_size(list, idx);
+        if (type == MFU_TYPE_FILE && file_size < (uint64_t) mfu_copy_opts->chunk_size) {
+            mfu_flist_file_copy(list, idx, small);
+        } else {
+            mfu_flist_file_copy(list, idx, rest);
+        }
+    }
+    mfu_flist_summarize(small);
+    mfu_flist_summarize(rest);
+    *prest = rest;
+
+    /* nothing to do if there are no small files */
+    if (mfu_flist_global_size(small) == 0) {
+        mfu_flist_free(&small);
+        return rc;
+    }
+
+    /* spread the small files evenly over ranks */
+    mfu_flist spreadlist = mfu_flist_spread(small);
+    mfu_flist_free(&small);
 
-    /* indicate which phase we're in to user */
     if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Copying data.");
+        MFU_LOG(MFU_LOG_INFO, "Copying small files.");
     }
 
     /* start timer for entie operation */
@@ -1969,113 +5120,105 @@ static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
     double total_start = MPI_Wtime();
     uint64_t total_count = 0;
 
+    /* when resuming, find files an earlier run copied */
+    mfu_copy_done_t done = {NULL, 0};
+    if (mfu_copy_opts->resume) {
+        mfu_copy_resume_lookup(spreadlist, &done);
+    }
+
     /* start up progress messages for the copy */
     copy_count = 0;
     copy_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, copy_progress_fn);
 
-    /* split file list into a linked list of file sections,
-     * this evenly spreads the file sections across processes */
-    mfu_file_chunk* head = mfu_file_chunk_list_alloc(list, chunk_size);
-
-    /* get a count of how many items are the chunk list */
-    uint64_t list_count = mfu_file_chunk_list_size(head);
-
-    /* allocate a flag for each element in chunk list,
-     * will store 0 to mean copy of this chunk succeeded and 1 otherwise
-     * to be used as input to logical OR to determine state of entire file */
-    int* vals = (int*) MFU_MALLOC(list_count * sizeof(int));
-
-    /* loop over and copy data for each file section we're responsible for */
-    uint64_t i;
-    const mfu_file_chunk* p = head;
-    for (i = 0; i < list_count; i++) {
-         /* assume we'll succeed in copying this chunk */
-         vals[i] = 0;
+    size = mfu_flist_size(spreadlist);
+    for (idx = 0; idx < size; idx++) {
+        const char* name = mfu_flist_file_get_name(spreadlist, idx);
+        uint64_t file_size = mfu_flist_file_get_size(spreadlist, idx);
 
-        /* get name of destination file */
-        char* dest = mfu_param_path_copy_dest(p->name, numpaths,
+        /* get destination name of item */
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
                 paths, destpath, mfu_copy_opts);
         if (dest == NULL) {
             /* No need to copy it */
-            p = p->next;
             continue;
         }
 
-        /* add bytes to our running total */
-        total_count += (uint64_t)p->length;
+        /* wait for our turn to create the file and set its metadata
+         * if metadata operations are limited */
+        mfu_throttle_charge(0, 2);
 
-        /* copy portion of file corresponding to this chunk,
-         * and record whether copy operation succeeded */
-        int copy_rc = mfu_copy_file(p->name, dest, (uint64_t)p->offset,
-                (uint64_t)p->length, (uint64_t)p->file_size, mfu_copy_opts);
-        if (copy_rc < 0) {
-            /* error copying file */
-            vals[i] = 1;
+        /* create and open the destination, the data copy below
+         * picks up this descriptor from the file cache */
+        mfu_fdcache_entry* out_file = mfu_copy_open_file(dest, 0, mfu_copy_opts);
+        if (out_file == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
+                dest, errno, strerror(errno));
+            rc = -1;
+            mfu_free(&dest);
+            continue;
         }
+        int fd = out_file->fd;
+        mfu_copy_stats.total_files++;
 
-        /* free the dest name */
-        mfu_free(&dest);
+        /* an earlier run copied the data, but it may have stopped
+         * before setting metadata */
+        if (mfu_copy_resume_skip(spreadlist, idx, 0, file_size, &done)) {
+            mfu_copy_metadata_fd(spreadlist, idx, dest, fd, mfu_copy_opts);
+            total_count++;
+            mfu_free(&dest);
+            continue;
+        }
 
-        /* update pointer to next element */
-        p = p->next;
-    }
+        /* copy extended attributes before writing data,
+         * since some attributes tell file system how to stripe data */
+        if (mfu_copy_opts->preserve) {
+            int tmp_rc = mfu_copy_xattrs(spreadlist, idx, dest, fd);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
+        }
 
-    /* close files */
-    mfu_copy_close_file(&mfu_copy_src_cache);
-    mfu_copy_close_file(&mfu_copy_dst_cache);
+        /* the destination may already exist, we will not overwrite
+         * holes in sparse mode, so clear any old data */
+        if (mfu_copy_opts->sparse) {
+            if (mfu_ftruncate(fd, 0) != 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to truncate destination file: `%s' (errno=%d %s)",
+                          dest, errno, strerror(errno));
+                rc = -1;
+            }
+        }
 
-    /* barrier to ensure all files are closed,
-     * may try to unlink bad destination files below */
-    MPI_Barrier(MPI_COMM_WORLD);
+        /* allocate space for the data */
+        if (mfu_copy_opts->preallocate) {
+            if (mfu_copy_preallocate(name, dest, fd, file_size, mfu_copy_opts) < 0) {
+                rc = -1;
+            }
+        }
 
-    /* allocate a flag for each item in our file list */
-    uint64_t size = mfu_flist_size(list);
-    int* results = (int*) MFU_MALLOC(size * sizeof(int));
+        /* copy data and then set metadata on the same descriptor,
+         * metadata errors are not copy failures, like in
+         * mfu_copy_set_metadata */
+        int copy_rc = mfu_copy_file(name, dest, 0, file_size, file_size, mfu_copy_opts);
+        if (copy_rc < 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
+            rc = -1;
+        } else {
+            mfu_copy_metadata_fd(spreadlist, idx, dest, fd, mfu_copy_opts);
+        }
 
-    /* intialize values, since not every item is represented
-     * in chunk list */
-    for (i = 0; i < size; i++) {
-        results[i] = 0;
+        total_count++;
+        mfu_free(&dest);
     }
 
-    /* determnie which files were copied correctly */
-    mfu_file_chunk_list_lor(list, head, vals, results);
-
-    /* delete any destination file that failed to copy */
-    for (i = 0; i < size; i++) {
-        if (results[i] != 0) {
-            /* found a file that had an error during copy,
-             * compute destination name and delete it */
-            const char* name = mfu_flist_file_get_name(list, i);
-            const char* dest = mfu_param_path_copy_dest(name, numpaths,
-                paths, destpath, mfu_copy_opts);
-            if (dest != NULL) {
-                /* sanity check to ensure we don't * delete the source file */
-                if (strcmp(dest, name) != 0) {
-                    MFU_LOG(MFU_LOG_ERR, "Failed to copy `%s' to `%s'", name, dest);
-                    rc = -1;
-#if 0
-                    /* delete destination file */
-                    int unlink_rc = mfu_unlink(dest);
-                    if (unlink_rc != 0) {
-                        MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
-                                  name, errno, strerror(errno)
-                                );
-                    }
-#endif
-                }
-
-                /* free destination name */
-                mfu_free(&dest);
-            }
-        }
-    }
+    /* write out and drop the last of our data from the page cache */
+    mfu_writebehind_finish(&mfu_copy_wb);
 
-    /* free copy flags */
-    mfu_free(&results);
+    /* close files */
+    mfu_fdcache_close_all(mfu_copy_fd_cache);
+    mfu_free(&done.ranges);
 
-    /* free the list of file chunks */
-    mfu_file_chunk_list_free(&head);
+    /* record the last of our files in the journal */
+    mfu_copy_journal_flush(mfu_copy_opts);
 
     /* finalize progress messages for the copy */
     mfu_progress_complete(&copy_count, &copy_prog);
@@ -2088,55 +5231,352 @@ static int mfu_copy_files(mfu_flist list, uint64_t chunk_size,
     if (verbose) {
         uint64_t sum;
         MPI_Allreduce(&total_count, &sum, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
-
         double rate = 0.0;
         double secs = total_end - total_start;
         if (secs > 0.0) {
           rate = (double)sum / secs;
         }
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Copied %lu small files in %f seconds (%f files/sec)",
+              (unsigned long)sum, secs, rate
+            );
+        }
+    }
 
-        /* convert bytes to units */
-        double agg_size_tmp;
-        const char* agg_size_units;
-        mfu_format_bytes(sum, &agg_size_tmp, &agg_size_units);
+    mfu_flist_free(&spreadlist);
 
-        /* convert bandwidth to units */
-        double agg_rate_tmp;
-        const char* agg_rate_units;
-        mfu_format_bw(rate, &agg_rate_tmp, &agg_rate_units);
+    return rc;
+}
+
+static void mfu_sync_all(const char* msg)
+{
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double start = MPI_Wtime();
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "%s", msg);
+    }
+    sync();
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double end = MPI_Wtime();
+
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Sync completed in %f seconds.", (end - start));
+    }
+}
+
+/* send checksums of the sections we copied to the rank that combines
+ * each file, returns received sections sorted by name and offset,
+ * names point into the returned buffer, which the caller frees */
+static char* mfu_copy_sum_exchange(mfu_copy_sum_t** out_sums, uint64_t* out_count)
+{
+    int i;
+    uint64_t idx;
+
+    int ranks;
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* count bytes we send to each rank, each section is packed as
+     * offset, length, and crc followed by the file name */
+    int* sendcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* recvcounts = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    int* offsets    = (int*) MFU_MALLOC((size_t)ranks * sizeof(int));
+    for (i = 0; i < ranks; i++) {
+        sendcounts[i] = 0;
+    }
+    int* dests = (int*) MFU_MALLOC(mfu_copy_sums.count * sizeof(int));
+    for (idx = 0; idx < mfu_copy_sums.count; idx++) {
+        const char* name = mfu_copy_sums.sums[idx].name;
+        dests[idx] = mfu_copy_name_rank(name, ranks);
+        sendcounts[dests[idx]] += 8 + 8 + 4 + (int)strlen(name) + 1;
+    }
+
+    int sendtotal = 0;
+    for (i = 0; i < ranks; i++) {
+        offsets[i] = sendtotal;
+        sendtotal += sendcounts[i];
+    }
+
+    /* pack sections in order of destination rank */
+    char* sendbuf = (char*) MFU_MALLOC((size_t)sendtotal + 1);
+    for (idx = 0; idx < mfu_copy_sums.count; idx++) {
+        const mfu_copy_sum_t* sum = &mfu_copy_sums.sums[idx];
+        char* ptr = sendbuf + offsets[dests[idx]];
+        mfu_pack_uint64(&ptr, sum->offset);
+        mfu_pack_uint64(&ptr, sum->length);
+        mfu_pack_uint32(&ptr, sum->crc);
+        size_t len = strlen(sum->name) + 1;
+        memcpy(ptr, sum->name, len);
+        offsets[dests[idx]] += 8 + 8 + 4 + (int) len;
+    }
+
+    int recvtotal;
+    char* recvbuf = mfu_copy_exchange(sendbuf, sendcounts, recvcounts, &recvtotal);
+
+    /* unpack sections we received */
+    mfu_copy_sum_list_t list = {NULL, 0, 0};
+    const char* ptr = recvbuf;
+    const char* end = recvbuf + recvtotal;
+    while (ptr < end) {
+        uint64_t offset, length;
+        uint32_t crc;
+        mfu_unpack_uint64(&ptr, &offset);
+        mfu_unpack_uint64(&ptr, &length);
+        mfu_unpack_uint32(&ptr, &crc);
+        mfu_copy_sum_t* sum = mfu_copy_sum_append(&list, offset, length, crc);
+        sum->name = (char*) ptr;
+        ptr += strlen(ptr) + 1;
+    }
+    if (list.count > 0) {
+        qsort(list.sums, (size_t) list.count, sizeof(mfu_copy_sum_t), mfu_copy_sum_cmp);
+    }
+
+    mfu_free(&sendbuf);
+    mfu_free(&dests);
+    mfu_free(&offsets);
+    mfu_free(&recvcounts);
+    mfu_free(&sendcounts);
+
+    *out_sums  = list.sums;
+    *out_count = list.count;
+    return recvbuf;
+}
+
+/* combine checksums of the sections of a file into the checksum of
+ * the whole file, sums is sorted by name and offset, returns 0 on
+ * success and -1 if the sections do not cover the file */
+static int mfu_copy_sum_file(const char* name, uint64_t size,
+        const mfu_copy_sum_t* sums, uint64_t count, uint32_t* crc)
+{
+    /* binary search for the first section of this file */
+    uint64_t low = 0;
+    uint64_t high = count;
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        if (strcmp(sums[mid].name, name) < 0) {
+            low = mid + 1;
+        } else {
+            high = mid;
+        }
+    }
+
+    /* sections must follow each other from the start of the file */
+    uint32_t digest = 0;
+    uint64_t pos = 0;
+    uint64_t i;
+    for (i = low; i < count && strcmp(sums[i].name, name) == 0; i++) {
+        if (sums[i].offset != pos) {
+            return -1;
+        }
+        digest = mfu_buf_crc32c_combine(digest, sums[i].crc, sums[i].length);
+        pos += sums[i].length;
+    }
+    if (pos != size) {
+        return -1;
+    }
+
+    *crc = digest;
+    return 0;
+}
+
+/* write a line for each regular file in list giving its CRC32C,
+ * size, mtime, and destination path to the manifest file, the
+ * checksums of the sections each process copied are combined on a
+ * rank picked by hashing the file name, and every rank writes its
+ * lines with a collective write, returns 0 on success and -1 on error */
+static int mfu_copy_write_manifest(mfu_flist src_cp_list, int numpaths,
+        const mfu_param_path* paths, const mfu_param_path* destpath,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rc = 0;
+    uint64_t idx;
+
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    const char* name = mfu_copy_opts->manifest;
+    if (rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Writing manifest: %s", name);
+    }
+
+    /* gather checksums for each file on the rank that combines them */
+    mfu_copy_sum_t* sums;
+    uint64_t count;
+    char* sumbuf = mfu_copy_sum_exchange(&sums, &count);
+
+    /* send regular files to the same ranks */
+    mfu_flist files = mfu_flist_subset(src_cp_list);
+    uint64_t size = mfu_flist_size(src_cp_list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(src_cp_list, idx) == MFU_TYPE_FILE) {
+            mfu_flist_file_copy(src_cp_list, idx, files);
+        }
+    }
+    mfu_flist_summarize(files);
+    mfu_flist mapped = mfu_flist_remap(files, mfu_copy_name_map, NULL);
+    mfu_flist_free(&files);
+
+    /* format a line for each file, files without a complete set of
+     * checksums, e.g., because a copy failed, get a digest of "-" */
+    uint64_t missing = 0;
+    size_t bufsize = 0;
+    char* buf = NULL;
+    int pass;
+    for (pass = 0; pass < 2; pass++) {
+        size_t total = 0;
+        size = mfu_flist_size(mapped);
+        for (idx = 0; idx < size; idx++) {
+            const char* file = mfu_flist_file_get_name(mapped, idx);
+            char* dest = mfu_param_path_copy_dest(file, numpaths,
+                    paths, destpath, mfu_copy_opts);
+            if (dest == NULL) {
+                continue;
+            }
+
+            uint64_t filesize = mfu_flist_file_get_size(mapped, idx);
+            uint64_t mtime    = mfu_flist_file_get_mtime(mapped, idx);
+            uint64_t mtime_ns = mfu_flist_file_get_mtime_nsec(mapped, idx);
+
+            char digest[9] = "-";
+            uint32_t crc;
+            if (mfu_copy_sum_file(file, filesize, sums, count, &crc) == 0) {
+                snprintf(digest, sizeof(digest), "%08x", crc);
+            } else if (pass == 0) {
+                missing++;
+            }
+
+            char* ptr = (buf != NULL) ? buf + total : NULL;
+            size_t left = (buf != NULL) ? bufsize - total : 0;
+            int len = snprintf(ptr, left, "%s %llu %llu.%09llu %s\n",
+                digest, (unsigned long long) filesize,
+                (unsigned long long) mtime, (unsigned long long) mtime_ns, dest);
+            total += (size_t) len;
+
+            mfu_free(&dest);
+        }
+
+        /* allocate room for the terminating NUL snprintf writes */
+        if (pass == 0) {
+            bufsize = total + 1;
+            buf = (char*) MFU_MALLOC(bufsize);
+        } else {
+            bufsize = total;
+        }
+    }
+
+    /* compute byte offset to write our lines */
+    uint64_t offset = 0;
+    uint64_t bytes = (uint64_t) bufsize;
+    MPI_Exscan(&bytes, &offset, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0) {
+        offset = 0;
+    }
 
+    /* write in blocks of at most 128MB to keep counts within an int */
+    uint64_t maxwrite = 128 * 1024 * 1024;
+    uint64_t iters = (bytes + maxwrite - 1) / maxwrite;
+    uint64_t all_iters;
+    MPI_Allreduce(&iters, &all_iters, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+
+    MPI_File fh;
+    char datarep[] = "native";
+    int amode = MPI_MODE_WRONLY | MPI_MODE_CREATE;
+    int mpirc = MPI_File_open(MPI_COMM_WORLD, (char*)name, amode, MPI_INFO_NULL, &fh);
+    if (mpirc != MPI_SUCCESS) {
         if (rank == 0) {
-            MFU_LOG(MFU_LOG_INFO, "Copy data: %.3lf %s (%lu bytes)",
-              agg_size_tmp, agg_size_units, sum
-            );
-            MFU_LOG(MFU_LOG_INFO, "Copy rate: %.3lf %s (%lu bytes in %f seconds)",
-              agg_rate_tmp, agg_rate_units, sum, secs
-            );
+            MFU_LOG(MFU_LOG_ERR, "Failed to open manifest file: `%s'", name);
+        }
+        rc = -1;
+    } else {
+        /* truncate file to 0 bytes */
+        MPI_File_set_size(fh, 0);
+        MPI_File_set_view(fh, 0, MPI_BYTE, MPI_BYTE, datarep, MPI_INFO_NULL);
+
+        MPI_Offset write_offset = (MPI_Offset) offset;
+        uint64_t written = 0;
+        while (all_iters > 0) {
+            uint64_t remaining = bytes - written;
+            int write_count = (int) ((remaining < maxwrite) ? remaining : maxwrite);
+
+            MPI_Status status;
+            MPI_File_write_at_all(fh, write_offset, buf + written, write_count, MPI_BYTE, &status);
+
+            write_offset += (MPI_Offset) write_count;
+            written += (uint64_t) write_count;
+            all_iters--;
         }
+
+        MPI_File_close(&fh);
+    }
+
+    /* report files we could not checksum */
+    uint64_t all_missing;
+    MPI_Allreduce(&missing, &all_missing, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    if (rank == 0 && all_missing > 0) {
+        MFU_LOG(MFU_LOG_WARN, "No checksum for %llu files in manifest",
+            (unsigned long long) all_missing);
     }
 
+    mfu_free(&buf);
+    mfu_flist_free(&mapped);
+    mfu_free(&sums);
+    mfu_free(&sumbuf);
+
     return rc;
 }
 
-static void mfu_sync_all(const char* msg)
+/* count extents in the destination of each regular file in list,
+ * which shows how fragmented the copy left the files, returns the
+ * number of files counted, the total extents, and the most extents
+ * in any file summed across processes */
+static void mfu_copy_count_extents(mfu_flist src_cp_list, int numpaths,
+        const mfu_param_path* paths, const mfu_param_path* destpath,
+        mfu_copy_opts_t* mfu_copy_opts, uint64_t* files,
+        uint64_t* extents, uint64_t* max)
 {
-    int rank;
-    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    uint64_t values[2] = {0, 0};
+    uint64_t local_max = 0;
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    double start = MPI_Wtime();
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(src_cp_list);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(src_cp_list, idx) != MFU_TYPE_FILE) {
+            continue;
+        }
 
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "%s", msg);
-    }
-    sync();
+        const char* name = mfu_flist_file_get_name(src_cp_list, idx);
+        char* dest = mfu_param_path_copy_dest(name, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (dest == NULL) {
+            continue;
+        }
 
-    MPI_Barrier(MPI_COMM_WORLD);
-    double end = MPI_Wtime();
+        int fd = mfu_open(dest, O_RDONLY);
+        if (fd >= 0) {
+            int64_t count = mfu_extent_count(dest, fd);
+            if (count >= 0) {
+                values[0]++;
+                values[1] += (uint64_t) count;
+                if ((uint64_t) count > local_max) {
+                    local_max = (uint64_t) count;
+                }
+            }
+            mfu_close(dest, fd);
+        }
 
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Sync completed in %f seconds.", (end - start));
+        mfu_free(&dest);
     }
+
+    uint64_t sums[2];
+    MPI_Allreduce(values, sums, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    MPI_Allreduce(&local_max, max, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
+    *files   = sums[0];
+    *extents = sums[1];
 }
 
 static void print_summary(mfu_flist flist)
@@ -2219,28 +5659,515 @@ static void print_summary(mfu_flist flist)
         MFU_LOG(MFU_LOG_INFO, "  Links: %llu", (unsigned long long) all_links);
         /* MFU_LOG("  Unknown: %lu", (unsigned long long) all_unknown); */
 
-        if (mfu_flist_have_detail(flist)) {
-            double agg_size_tmp;
-            const char* agg_size_units;
-            mfu_format_bytes(all_bytes, &agg_size_tmp, &agg_size_units);
+        if (mfu_flist_have_detail(flist)) {
+            double agg_size_tmp;
+            const char* agg_size_units;
+            mfu_format_bytes(all_bytes, &agg_size_tmp, &agg_size_units);
+
+            uint64_t size_per_file = 0.0;
+            if (all_files > 0) {
+                size_per_file = (uint64_t)((double)all_bytes / (double)all_files);
+            }
+            double size_per_file_tmp;
+            const char* size_per_file_units;
+            mfu_format_bytes(size_per_file, &size_per_file_tmp, &size_per_file_units);
+
+            MFU_LOG(MFU_LOG_INFO, "Data: %.3lf %s (%.3lf %s per file)", agg_size_tmp, agg_size_units, size_per_file_tmp, size_per_file_units);
+        }
+    }
+
+    return;
+}
+
+int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
+        const mfu_param_path* paths, const mfu_param_path* destpath,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    int copy_into_dir = mfu_copy_opts->copy_into_dir;
+    return mfu_flist_copy_multi(src_cp_list, numpaths, paths, 1, destpath,
+        &copy_into_dir, mfu_copy_opts);
+}
+
+/* set up destinations, buffers, caches, journal, and statistics for
+ * a copy to numdests destinations, at most MFU_COPY_MAX_DESTS, prints
+ * a summary of src_cp_list unless it is NULL, returns 0 on success
+ * -1 on error */
+static int mfu_copy_begin(mfu_flist src_cp_list, int numdests,
+        const mfu_param_path* destpaths, const int* into_dirs,
+        mfu_copy_opts_t* mfu_copy_opts)
+{
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* assume we'll succeed */
+    int rc = 0;
+
+    /* remember our destinations, the first one is used for anything
+     * that only needs one, like the manifest */
+    int d;
+    for (d = 0; d < numdests; d++) {
+        mfu_copy_into[d] = into_dirs[d];
+    }
+    mfu_copy_into_caller = mfu_copy_opts->copy_into_dir;
+    mfu_copy_ndests      = numdests;
+    mfu_copy_dests       = destpaths;
+    mfu_copy_dests_into  = mfu_copy_into;
+    const mfu_param_path* destpath = mfu_copy_use_dest(0, mfu_copy_opts);
+
+    /* set mfu_copy options in mfu_copy_opts_t struct */
+
+    /* copy the destination path to user opts structure */
+    mfu_copy_opts->dest_path = MFU_STRDUP((*destpath).path);
+
+    /* print note about what we're doing and the amount of files/data to be moved */
+    if (rank == 0) {
+        int d;
+        for (d = 0; d < numdests; d++) {
+            MFU_LOG(MFU_LOG_INFO, "Copying to %s", destpaths[d].path);
+        }
+    }
+    if (src_cp_list != NULL) {
+        mfu_flist_print_summary(src_cp_list);
+    }
+
+    /* TODO: consider file system striping params here */
+    /* hard code some configurables for now */
+
+    /* allocate buffer to read/write files, aligned for direct I/O */
+    size_t alignment = MFU_COPY_BUF_ALIGN;
+    mfu_copy_opts->block_buf1 = (char*) MFU_POOL_ALLOC(mfu_copy_opts->block_size, alignment);
+    mfu_copy_opts->block_buf2 = (char*) MFU_POOL_ALLOC(mfu_copy_opts->block_size, alignment);
+
+    /* set up buffers for asynchronous copy, the first two reuse the
+     * block buffers allocated above */
+    mfu_copy_slots = NULL;
+    mfu_copy_slot_count = 0;
+    if (mfu_copy_opts->io_depth > 1) {
+        int nslots = mfu_copy_opts->io_buffers;
+        if (nslots < mfu_copy_opts->io_depth) {
+            nslots = mfu_copy_opts->io_depth;
+        }
+        mfu_copy_slots = (mfu_copy_slot_t*) MFU_MALLOC(nslots * sizeof(mfu_copy_slot_t));
+        mfu_copy_slots[0].buf = mfu_copy_opts->block_buf1;
+        mfu_copy_slots[1].buf = mfu_copy_opts->block_buf2;
+        int i;
+        for (i = 2; i < nslots; i++) {
+            mfu_copy_slots[i].buf = (char*) MFU_POOL_ALLOC(mfu_copy_opts->block_size, alignment);
+        }
+        mfu_copy_slot_count = nslots;
+    }
+
+    /* Grab a relative and actual start time for the epilogue. */
+    time(&(mfu_copy_stats.time_started));
+    mfu_copy_stats.wtime_started = MPI_Wtime();
+
+    /* Initialize statistics */
+    mfu_copy_stats.total_dirs  = 0;
+    mfu_copy_stats.total_files = 0;
+    mfu_copy_stats.total_links = 0;
+    mfu_copy_stats.total_size  = 0;
+    mfu_copy_stats.total_bytes_copied = 0;
+    mfu_copy_stats.total_bytes_cloned = 0;
+    mfu_copy_stats.total_bytes_ranged = 0;
+    mfu_copy_stats.total_bytes_direct = 0;
+    mfu_copy_stats.total_bytes_prealloc = 0;
+    mfu_copy_stats.total_bytes_verified = 0;
+    mfu_copy_stats.total_files_recopied = 0;
+    mfu_copy_stats.peak_dirty  = 0;
+    mfu_copy_stats.wtime_dirty = -1.0;
+    mfu_writebehind_init(&mfu_copy_wb, mfu_copy_opts->writebehind);
+
+    /* start from the caller's settings, adjusted below for this copy */
+    mfu_copy_fused   = mfu_copy_opts->fused;
+    mfu_copy_offload = mfu_copy_opts->offload;
+    int open_files   = mfu_copy_opts->open_files;
+
+    /* data written to several destinations is read and written
+     * through our buffer, one block at a time, and the open file cache
+     * must hold the source and all destinations of a chunk at once */
+    if (numdests > 1) {
+        if (mfu_copy_fused) {
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_INFO, "Disabling fused copy to write to several destinations");
+            }
+            mfu_copy_fused = false;
+        }
+        mfu_copy_offload = MFU_COPY_OFFLOAD_NONE;
+        if (open_files < numdests + 1) {
+            open_files = numdests + 1;
+        }
+    }
+
+    /* Initialize file cache, and cache of parent directories
+     * that files are opened and created in */
+    mfu_copy_fd_cache  = mfu_fdcache_new(open_files, 1);
+    mfu_copy_dir_cache = mfu_fdcache_new(MFU_COPY_DIR_FDS, 0);
+    mfu_fdcache_set_parents(mfu_copy_fd_cache, mfu_copy_dir_cache);
+
+    /* load records of chunks copied by an earlier run,
+     * then start our own journal */
+    if (mfu_copy_opts->journal != NULL) {
+        if (mfu_copy_opts->resume && mfu_copy_resume_load(mfu_copy_opts) < 0) {
+            rc = -1;
+        }
+        if (mfu_copy_journal_open(mfu_copy_opts) < 0) {
+            rc = -1;
+        }
+    }
+
+    /* checksums are computed from our buffers, so data must not be
+     * moved by the kernel when writing a manifest */
+    if (mfu_copy_opts->manifest != NULL && mfu_copy_offload != MFU_COPY_OFFLOAD_NONE) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Disabling copy offload to checksum data for manifest");
+        }
+        mfu_copy_offload = MFU_COPY_OFFLOAD_NONE;
+    }
+
+    /* files copied in a single pass skip the chunk list that
+     * verification reads back, so copy them in phases instead */
+    if (mfu_copy_opts->verify && mfu_copy_fused) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Disabling fused copy to verify all files");
+        }
+        mfu_copy_fused = false;
+    }
+
+    return rc;
+}
+
+/* create, copy, and set metadata on the items in the list, which
+ * holds no directories, in each destination, with --fused the list
+ * is replaced by the items left after copying small files in a single
+ * pass, returns 0 on success -1 on error */
+static int mfu_copy_batch(mfu_flist* spreadlist_ptr, int numpaths,
+        const mfu_param_path* paths, mfu_copy_opts_t* mfu_copy_opts)
+{
+    int rc = 0;
+    int tmp_rc;
+    int d;
+    const mfu_param_path* destpath = mfu_copy_use_dest(0, mfu_copy_opts);
+    mfu_flist spreadlist = *spreadlist_ptr;
+
+    /* copy small files in a single pass, and continue with the rest */
+    if (mfu_copy_fused) {
+        mfu_flist rest;
+        tmp_rc = mfu_copy_small_files(spreadlist, numpaths,
+                paths, destpath, mfu_copy_opts, &rest);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+        mfu_flist_free(&spreadlist);
+        spreadlist = rest;
+    }
+
+    /* split items in file list into sublists depending on their
+     * directory depth */
+    int levels, minlevel;
+    mfu_flist* lists;
+    mfu_flist_array_by_depth(spreadlist, &levels, &minlevel, &lists);
+
+    /* create files and links, noting which items were not created
+     * in every destination if someone wants to hear about the batch */
+    int** skipped = NULL;
+    if (mfu_copy_opts->copied_fn != NULL) {
+        skipped = mfu_copy_skipped_alloc(levels, lists);
+    }
+    for (d = mfu_copy_ndests - 1; d >= 0; d--) {
+        const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+        tmp_rc = mfu_create_files(levels, minlevel, lists, numpaths,
+                paths, dp, mfu_copy_opts, skipped);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+
+    /* copy data, noting which files failed if someone
+     * wants to hear about the batch */
+    int* failed = NULL;
+    if (mfu_copy_opts->copied_fn != NULL) {
+        uint64_t spread_size = mfu_flist_size(spreadlist);
+        failed = (int*) MFU_MALLOC(spread_size * sizeof(int));
+    }
+    tmp_rc = mfu_copy_files(spreadlist, mfu_copy_opts->chunk_size,
+            numpaths, paths, destpath, mfu_copy_opts, failed);
+    if (tmp_rc < 0) {
+        rc = -1;
+    }
+
+    /* force data to backend to avoid the following metadata
+     * setting mismatch, which may happen on lustre */
+    mfu_sync_all("Syncing data to disk.");
+
+    /* set permissions, ownership, and timestamps if needed,
+     * items that could not be updated count as failed */
+    for (d = mfu_copy_ndests - 1; d >= 0; d--) {
+        const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+        mfu_copy_set_metadata_files(spreadlist, numpaths,
+                paths, dp, mfu_copy_opts, failed);
+        mfu_copy_set_metadata(levels, minlevel, lists, numpaths,
+                paths, dp, mfu_copy_opts, skipped);
+    }
+    if (skipped != NULL) {
+        mfu_copy_skipped_merge(spreadlist, levels, minlevel, skipped, failed);
+        mfu_copy_skipped_free(levels, &skipped);
+    }
+
+    /* report the finished batch */
+    if (mfu_copy_opts->copied_fn != NULL) {
+        mfu_sync_all("Syncing updates to disk.");
+        mfu_copy_opts->copied_fn(spreadlist, failed, mfu_copy_opts->copied_arg);
+        mfu_free(&failed);
+    }
+
+    /* free our lists of levels */
+    mfu_flist_array_free(levels, &lists);
+
+    *spreadlist_ptr = spreadlist;
+    return rc;
+}
+
+/* write the manifest, release what mfu_copy_begin set up, and report
+ * statistics of the copy of src_cp_list, rc is the result of this
+ * process so far, returns 0 if all processes succeeded -1 otherwise */
+static int mfu_copy_end(mfu_flist src_cp_list, int numpaths,
+        const mfu_param_path* paths, mfu_copy_opts_t* mfu_copy_opts, int rc)
+{
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    int tmp_rc;
+    const mfu_param_path* destpath = mfu_copy_use_dest(0, mfu_copy_opts);
+
+    /* record checksums of the files we copied */
+    if (mfu_copy_opts->manifest != NULL) {
+        tmp_rc = mfu_copy_write_manifest(src_cp_list, numpaths,
+                paths, destpath, mfu_copy_opts);
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
+    }
+    mfu_copy_sum_list_free(&mfu_copy_blocks);
+    mfu_copy_sum_list_free(&mfu_copy_sums);
+
+    /* close our journal */
+    if (mfu_copy_opts->journal != NULL) {
+        mfu_copy_journal_close(mfu_copy_opts);
+        mfu_copy_resume_free();
+    }
+
+    /* free buffers */
+    if (mfu_copy_slots != NULL) {
+        int i;
+        for (i = 2; i < mfu_copy_slot_count; i++) {
+            mfu_pool_free(&mfu_copy_slots[i].buf);
+        }
+        mfu_free(&mfu_copy_slots);
+        mfu_copy_slot_count = 0;
+    }
+    mfu_pool_free(&mfu_copy_opts->block_buf1);
+    mfu_pool_free(&mfu_copy_opts->block_buf2);
+
+    /* report and free our open file and directory caches */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE) {
+        mfu_copy_print_fd_cache();
+    }
+    mfu_fdcache_delete(&mfu_copy_fd_cache);
+    mfu_fdcache_delete(&mfu_copy_dir_cache);
+
+    /* Determine the actual and relative end time for the epilogue. */
+    mfu_copy_stats.wtime_ended = MPI_Wtime();
+    time(&(mfu_copy_stats.time_ended));
+
+    /* compute time */
+    double rel_time = mfu_copy_stats.wtime_ended - \
+                      mfu_copy_stats.wtime_started;
+
+    /* count extents in destination files, after the timer has stopped
+     * so that the rate only covers the copy */
+    uint64_t extent_files = 0, extents = 0, extents_max = 0;
+    if (mfu_copy_opts->count_extents) {
+        mfu_copy_count_extents(src_cp_list, numpaths, paths, destpath,
+            mfu_copy_opts, &extent_files, &extents, &extents_max);
+    }
+
+    /* prep our values into buffer */
+    int64_t values[11];
+    values[0] = mfu_copy_stats.total_dirs;
+    values[1] = mfu_copy_stats.total_files;
+    values[2] = mfu_copy_stats.total_links;
+    values[3] = mfu_copy_stats.total_size;
+    values[4] = mfu_copy_stats.total_bytes_copied;
+    values[5] = mfu_copy_stats.total_bytes_cloned;
+    values[6] = mfu_copy_stats.total_bytes_ranged;
+    values[7] = mfu_copy_stats.total_bytes_direct;
+    values[8] = mfu_copy_stats.total_bytes_prealloc;
+    values[9] = mfu_copy_stats.total_bytes_verified;
+    values[10] = mfu_copy_stats.total_files_recopied;
+
+    /* sum values across processes */
+    int64_t sums[11];
+    MPI_Allreduce(values, sums, 11, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
+
+    /* extract results from allreduce */
+    int64_t agg_dirs   = sums[0];
+    int64_t agg_files  = sums[1];
+    int64_t agg_links  = sums[2];
+    int64_t agg_size   = sums[3];
+    int64_t agg_copied = sums[4];
+    int64_t agg_cloned = sums[5];
+    int64_t agg_ranged = sums[6];
+    int64_t agg_direct = sums[7];
+    int64_t agg_prealloc = sums[8];
+    int64_t agg_verified = sums[9];
+    int64_t agg_recopied = sums[10];
+
+    /* get page cache stats, dirty pages are counted per node,
+     * so take the max rather than the sum */
+    uint64_t peak_dirty, dropped;
+    double wait_secs;
+    MPI_Reduce(&mfu_copy_stats.peak_dirty, &peak_dirty, 1, MPI_UINT64_T, MPI_MAX, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&mfu_copy_wb.dropped, &dropped, 1, MPI_UINT64_T, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(&mfu_copy_wb.wait_secs, &wait_secs, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+
+    /* compute rate of copy */
+    double agg_rate = (double)agg_copied / rel_time;
+    if (rel_time > 0.0) {
+        agg_rate = (double)agg_copied / rel_time;
+    }
+
+    if(rank == 0) {
+        /* format start time */
+        char starttime_str[256];
+        struct tm* localstart = localtime(&(mfu_copy_stats.time_started));
+        strftime(starttime_str, 256, "%b-%d-%Y,%H:%M:%S", localstart);
+
+        /* format end time */
+        char endtime_str[256];
+        struct tm* localend = localtime(&(mfu_copy_stats.time_ended));
+        strftime(endtime_str, 256, "%b-%d-%Y,%H:%M:%S", localend);
+
+        /* total number of items */
+        int64_t agg_items = agg_dirs + agg_files + agg_links;
+
+        /* convert size to units */
+        double agg_size_tmp;
+        const char* agg_size_units;
+        mfu_format_bytes((uint64_t)agg_size, &agg_size_tmp, &agg_size_units);
+
+        /* convert bandwidth to units */
+        double agg_rate_tmp;
+        const char* agg_rate_units;
+        mfu_format_bw(agg_rate, &agg_rate_tmp, &agg_rate_units);
+
+        MFU_LOG(MFU_LOG_INFO, "Started: %s", starttime_str);
+        MFU_LOG(MFU_LOG_INFO, "Completed: %s", endtime_str);
+        MFU_LOG(MFU_LOG_INFO, "Seconds: %.3lf", rel_time);
+        MFU_LOG(MFU_LOG_INFO, "Items: %" PRId64, agg_items);
+        MFU_LOG(MFU_LOG_INFO, "  Directories: %" PRId64, agg_dirs);
+        MFU_LOG(MFU_LOG_INFO, "  Files: %" PRId64, agg_files);
+        MFU_LOG(MFU_LOG_INFO, "  Links: %" PRId64, agg_links);
+        MFU_LOG(MFU_LOG_INFO, "Data: %.3lf %s (%" PRId64 " bytes)",
+            agg_size_tmp, agg_size_units, agg_size);
+
+        /* break down how the data was moved */
+        if (mfu_copy_opts->synchronous) {
+            int64_t agg_buffered = agg_copied - agg_direct;
+            double path_tmp;
+            const char* path_units;
+            mfu_format_bytes((uint64_t)agg_direct, &path_tmp, &path_units);
+            MFU_LOG(MFU_LOG_INFO, "  Direct I/O: %.3lf %s (%" PRId64 " bytes)",
+                path_tmp, path_units, agg_direct);
+            mfu_format_bytes((uint64_t)agg_buffered, &path_tmp, &path_units);
+            MFU_LOG(MFU_LOG_INFO, "  Buffered I/O: %.3lf %s (%" PRId64 " bytes)",
+                path_tmp, path_units, agg_buffered);
+        } else if (mfu_copy_offload != MFU_COPY_OFFLOAD_NONE) {
+            int64_t agg_readwrite = agg_copied - agg_cloned - agg_ranged;
+            double path_tmp;
+            const char* path_units;
+            mfu_format_bytes((uint64_t)agg_cloned, &path_tmp, &path_units);
+            MFU_LOG(MFU_LOG_INFO, "  Cloned: %.3lf %s (%" PRId64 " bytes)",
+                path_tmp, path_units, agg_cloned);
+            mfu_format_bytes((uint64_t)agg_ranged, &path_tmp, &path_units);
+            MFU_LOG(MFU_LOG_INFO, "  Copy range: %.3lf %s (%" PRId64 " bytes)",
+                path_tmp, path_units, agg_ranged);
+            mfu_format_bytes((uint64_t)agg_readwrite, &path_tmp, &path_units);
+            MFU_LOG(MFU_LOG_INFO, "  Read/write: %.3lf %s (%" PRId64 " bytes)",
+                path_tmp, path_units, agg_readwrite);
+        }
 
-            uint64_t size_per_file = 0.0;
-            if (all_files > 0) {
-                size_per_file = (uint64_t)((double)all_bytes / (double)all_files);
-            }
-            double size_per_file_tmp;
-            const char* size_per_file_units;
-            mfu_format_bytes(size_per_file, &size_per_file_tmp, &size_per_file_units);
+        /* report how much data was left in the page cache,
+         * mfu_copy_file samples it under the same condition */
+        int drop = (mfu_copy_opts->pagecache == MFU_COPY_PAGECACHE_DROP);
+        if (drop || mfu_debug_level >= MFU_LOG_VERBOSE) {
+            double cache_tmp;
+            const char* cache_units;
+            mfu_format_bytes(peak_dirty, &cache_tmp, &cache_units);
+            MFU_LOG(MFU_LOG_INFO, "Peak dirty page cache: %.3lf %s",
+                cache_tmp, cache_units);
+        }
+        if (drop) {
+            double cache_tmp;
+            const char* cache_units;
+            mfu_format_bytes(dropped, &cache_tmp, &cache_units);
+            MFU_LOG(MFU_LOG_INFO, "  Dropped from cache: %.3lf %s (%" PRIu64 " bytes)",
+                cache_tmp, cache_units, dropped);
+            MFU_LOG(MFU_LOG_INFO, "  Writeback wait: %.3lf secs (max per process)",
+                wait_secs);
+        }
 
-            MFU_LOG(MFU_LOG_INFO, "Data: %.3lf %s (%.3lf %s per file)", agg_size_tmp, agg_size_units, size_per_file_tmp, size_per_file_units);
+        /* report space allocated ahead of the data and how many
+         * pieces the destination files ended up in */
+        if (mfu_copy_opts->preallocate) {
+            double prealloc_tmp;
+            const char* prealloc_units;
+            mfu_format_bytes((uint64_t)agg_prealloc, &prealloc_tmp, &prealloc_units);
+            MFU_LOG(MFU_LOG_INFO, "Preallocated: %.3lf %s (%" PRId64 " bytes)",
+                prealloc_tmp, prealloc_units, agg_prealloc);
         }
+        if (mfu_copy_opts->verify) {
+            double verify_tmp;
+            const char* verify_units;
+            mfu_format_bytes((uint64_t)agg_verified, &verify_tmp, &verify_units);
+            MFU_LOG(MFU_LOG_INFO, "Verified: %.3lf %s (%" PRId64 " bytes), %" PRId64 " files copied again",
+                verify_tmp, verify_units, agg_verified, agg_recopied);
+        }
+        if (mfu_copy_opts->count_extents) {
+            double per_file = 0.0;
+            if (extent_files > 0) {
+                per_file = (double)extents / (double)extent_files;
+            }
+            MFU_LOG(MFU_LOG_INFO, "Destination extents: %" PRIu64 " in %" PRIu64
+                " files (%.2lf per file, max %" PRIu64 ")",
+                extents, extent_files, per_file, extents_max);
+        }
+
+        MFU_LOG(MFU_LOG_INFO, "Rate: %.3lf %s " \
+            "(%.3" PRId64 " bytes in %.3lf seconds)", \
+            agg_rate_tmp, agg_rate_units, agg_copied, rel_time);
     }
 
-    return;
+    /* determine whether any process reported an error,
+     * inputs should are either 0 or -1, so min will be -1 on any -1 */
+    int all_rc;
+    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
+    rc = all_rc;
+
+    /* forget our destinations, and leave the caller's options as
+     * we found them */
+    mfu_copy_ndests     = 1;
+    mfu_copy_dests      = NULL;
+    mfu_copy_dests_into = NULL;
+    mfu_copy_opts->copy_into_dir = mfu_copy_into_caller;
+
+    return rc;
 }
 
-int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
-        const mfu_param_path* paths, const mfu_param_path* destpath,
+int mfu_flist_copy_multi(mfu_flist src_cp_list, int numpaths,
+        const mfu_param_path* paths, int numdests,
+        const mfu_param_path* destpaths, const int* into_dirs,
         mfu_copy_opts_t* mfu_copy_opts)
 {
     /* assume we'll succeed */
@@ -2250,39 +6177,21 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
     int rank;
     MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-    /* set mfu_copy options in mfu_copy_opts_t struct */
-
-    /* copy the destination path to user opts structure */
-    mfu_copy_opts->dest_path = MFU_STRDUP((*destpath).path);
-
-    /* print note about what we're doing and the amount of files/data to be moved */
-    if (rank == 0) {
-        MFU_LOG(MFU_LOG_INFO, "Copying to %s", mfu_copy_opts->dest_path);
+    /* each chunk reports the destinations it missed as bits of an int */
+    if (numdests < 1 || numdests > MFU_COPY_MAX_DESTS) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to copy to %d destinations, between 1 and %d are supported",
+                numdests, MFU_COPY_MAX_DESTS);
+        }
+        return -1;
     }
-    mfu_flist_print_summary(src_cp_list);
-
-    /* TODO: consider file system striping params here */
-    /* hard code some configurables for now */
 
-    /* allocate buffer to read/write files, aligned on 1MB boundaraies */
-    size_t alignment = 1024*1024;
-    mfu_copy_opts->block_buf1 = (char*) MFU_MEMALIGN(mfu_copy_opts->block_size, alignment);
-    mfu_copy_opts->block_buf2 = (char*) MFU_MEMALIGN(mfu_copy_opts->block_size, alignment);
-
-    /* Grab a relative and actual start time for the epilogue. */
-    time(&(mfu_copy_stats.time_started));
-    mfu_copy_stats.wtime_started = MPI_Wtime();
-
-    /* Initialize statistics */
-    mfu_copy_stats.total_dirs  = 0;
-    mfu_copy_stats.total_files = 0;
-    mfu_copy_stats.total_links = 0;
-    mfu_copy_stats.total_size  = 0;
-    mfu_copy_stats.total_bytes_copied = 0;
-
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
+    /* set up for the copy */
+    if (mfu_copy_begin(src_cp_list, numdests, destpaths, into_dirs, mfu_copy_opts) < 0) {
+        rc = -1;
+    }
+    const mfu_param_path* destpath = mfu_copy_use_dest(0, mfu_copy_opts);
+    int d;
 
     /* split items in file list into sublists depending on their
      * directory depth */
@@ -2292,11 +6201,22 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
 
     /* TODO: filter out files that are bigger than 0 bytes if we can't read them */
 
-    /* create directories, from top down */
-    int tmp_rc = mfu_create_directories(levels, minlevel, lists, numpaths,
-            paths, destpath, mfu_copy_opts);
-    if (tmp_rc < 0) {
-        rc = -1;
+    /* create directories, from top down, in each destination, the
+     * loops over destinations in this function count down so that
+     * they leave the options set for the first */
+    int tmp_rc;
+    for (d = numdests - 1; d >= 0; d--) {
+        const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+        if (mfu_copy_opts->wavefront) {
+            tmp_rc = mfu_create_directories_wavefront(src_cp_list, numpaths,
+                    paths, dp, mfu_copy_opts);
+        } else {
+            tmp_rc = mfu_create_directories(levels, minlevel, lists, numpaths,
+                    paths, dp, mfu_copy_opts);
+        }
+        if (tmp_rc < 0) {
+            rc = -1;
+        }
     }
 
     /* operate on files in batches if batch size is given */
@@ -2349,37 +6269,12 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
                 /* spread items evenly over ranks */
                 mfu_flist spreadlist = mfu_flist_spread(tmplist);
 
-                /* split items in file list into sublists depending on their
-                 * directory depth */
-                int levels2, minlevel2;
-                mfu_flist* lists2;
-                mfu_flist_array_by_depth(spreadlist, &levels2, &minlevel2, &lists2);
-
-                /* create files and links */
-                tmp_rc = mfu_create_files(levels2, minlevel2, lists2, numpaths,
-                        paths, destpath, mfu_copy_opts);
-                if (tmp_rc < 0) {
-                    rc = -1;
-                }
-
-                /* copy data */
-                tmp_rc = mfu_copy_files(spreadlist, mfu_copy_opts->chunk_size,
-                        numpaths, paths, destpath, mfu_copy_opts);
+                /* create, copy, and set metadata on the items */
+                tmp_rc = mfu_copy_batch(&spreadlist, numpaths, paths, mfu_copy_opts);
                 if (tmp_rc < 0) {
                     rc = -1;
                 }
 
-                /* force data to backend to avoid the following metadata
-                 * setting mismatch, which may happen on lustre */
-                mfu_sync_all("Syncing data to disk.");
-
-                /* set permissions, ownership, and timestamps if needed */
-                mfu_copy_set_metadata(levels2, minlevel2, lists2, numpaths,
-                        paths, destpath, mfu_copy_opts);
-
-                /* free our lists of levels */
-                mfu_flist_array_free(levels2, &lists2);
-
                 /* free the list of spread items */
                 mfu_flist_free(&spreadlist);
 
@@ -2460,25 +6355,64 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
             }
         }
 
-        /* set permissions, ownership, and timestamps if needed */
-        mfu_copy_set_metadata_dirs(levels, minlevel, lists, numpaths,
-                paths, destpath, mfu_copy_opts);
+        /* set permissions, ownership, and timestamps if needed,
+         * a caller removing what was copied must hear about failures */
+        for (d = numdests - 1; d >= 0; d--) {
+            const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+            if (mfu_copy_opts->wavefront) {
+                tmp_rc = mfu_copy_set_metadata_dirs_wavefront(src_cp_list, numpaths,
+                        paths, dp, mfu_copy_opts);
+            } else {
+                tmp_rc = mfu_copy_set_metadata_dirs(levels, minlevel, lists, numpaths,
+                        paths, dp, mfu_copy_opts);
+            }
+            if (tmp_rc < 0 && mfu_copy_opts->copied_fn != NULL) {
+                rc = -1;
+            }
+        }
 
         /* force updates to disk */
         mfu_sync_all("Syncing directory updates to disk.");
     } else {
         /* user does not want to batch files, so copy the whole list */
+        mfu_flist files_list = src_cp_list;
+
+        /* copy small files in a single pass, and continue with the rest */
+        mfu_flist rest = NULL;
+        if (mfu_copy_fused) {
+            tmp_rc = mfu_copy_small_files(src_cp_list, numpaths,
+                    paths, destpath, mfu_copy_opts, &rest);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
 
-        /* create files and links */
-        tmp_rc = mfu_create_files(levels, minlevel, lists, numpaths,
-                paths, destpath, mfu_copy_opts);
-        if (tmp_rc < 0) {
-            rc = -1;
+            /* rebuild our lists of levels from remaining items */
+            mfu_flist_array_free(levels, &lists);
+            mfu_flist_array_by_depth(rest, &levels, &minlevel, &lists);
+            files_list = rest;
+        }
+
+        /* create files and links, noting which items were not created */
+        int** skipped = NULL;
+        if (mfu_copy_opts->copied_fn != NULL) {
+            skipped = mfu_copy_skipped_alloc(levels, lists);
+        }
+        for (d = numdests - 1; d >= 0; d--) {
+            const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+            tmp_rc = mfu_create_files(levels, minlevel, lists, numpaths,
+                    paths, dp, mfu_copy_opts, skipped);
+            if (tmp_rc < 0) {
+                rc = -1;
+            }
         }
 
         /* copy data */
-        tmp_rc = mfu_copy_files(src_cp_list, mfu_copy_opts->chunk_size,
-                numpaths, paths, destpath, mfu_copy_opts);
+        int* failed = NULL;
+        if (mfu_copy_opts->copied_fn != NULL) {
+            failed = (int*) MFU_MALLOC(mfu_flist_size(files_list) * sizeof(int));
+        }
+        tmp_rc = mfu_copy_files(files_list, mfu_copy_opts->chunk_size,
+                numpaths, paths, destpath, mfu_copy_opts, failed);
         if (tmp_rc < 0) {
             rc = -1;
         }
@@ -2487,100 +6421,213 @@ int mfu_flist_copy(mfu_flist src_cp_list, int numpaths,
          * setting mismatch, which may happen on lustre */
         mfu_sync_all("Syncing data to disk.");
 
-        /* set permissions, ownership, and timestamps if needed */
-        mfu_copy_set_metadata(levels, minlevel, lists, numpaths,
-                paths, destpath, mfu_copy_opts);
+        /* set permissions, ownership, and timestamps if needed,
+         * first on regular files through descriptors, items that
+         * could not be updated count as failed */
+        for (d = numdests - 1; d >= 0; d--) {
+            const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+            mfu_copy_set_metadata_files(files_list, numpaths,
+                    paths, dp, mfu_copy_opts, failed);
+            if (mfu_copy_opts->wavefront) {
+                /* nothing else waits on links, so set their metadata in
+                 * one pass, and then that of directories from the bottom up */
+                mfu_flist links = mfu_flist_subset(files_list);
+                uint64_t idx;
+                uint64_t size = mfu_flist_size(files_list);
+                for (idx = 0; idx < size; idx++) {
+                    mfu_filetype type = mfu_flist_file_get_type(files_list, idx);
+                    if (type != MFU_TYPE_DIR && type != MFU_TYPE_FILE) {
+                        mfu_flist_file_copy(files_list, idx, links);
+                    }
+                }
+                mfu_flist_summarize(links);
+                int** link_skipped = NULL;
+                if (failed != NULL) {
+                    link_skipped = mfu_copy_skipped_alloc(1, &links);
+                }
+                mfu_copy_set_metadata(1, minlevel, &links, numpaths,
+                        paths, dp, mfu_copy_opts, link_skipped);
+                mfu_flist_free(&links);
+
+                /* links were taken from the list in order */
+                if (link_skipped != NULL) {
+                    uint64_t pos = 0;
+                    for (idx = 0; idx < size; idx++) {
+                        mfu_filetype type = mfu_flist_file_get_type(files_list, idx);
+                        if (type != MFU_TYPE_DIR && type != MFU_TYPE_FILE) {
+                            if (link_skipped[0][pos]) {
+                                failed[idx] = 1;
+                            }
+                            pos++;
+                        }
+                    }
+                    mfu_copy_skipped_free(1, &link_skipped);
+                }
+
+                tmp_rc = mfu_copy_set_metadata_dirs_wavefront(files_list, numpaths,
+                        paths, dp, mfu_copy_opts);
+                if (tmp_rc < 0 && mfu_copy_opts->copied_fn != NULL) {
+                    rc = -1;
+                }
+            } else {
+                mfu_copy_set_metadata(levels, minlevel, lists, numpaths,
+                        paths, dp, mfu_copy_opts, skipped);
+            }
+        }
+        if (skipped != NULL) {
+            mfu_copy_skipped_merge(files_list, levels, minlevel, skipped, failed);
+            mfu_copy_skipped_free(levels, &skipped);
+        }
 
         /* force updates to disk */
         mfu_sync_all("Syncing directory updates to disk.");
+
+        /* report the copied items */
+        if (mfu_copy_opts->copied_fn != NULL) {
+            mfu_copy_opts->copied_fn(files_list, failed, mfu_copy_opts->copied_arg);
+            mfu_free(&failed);
+        }
+
+        /* free list of items left after small files */
+        if (rest != NULL) {
+            mfu_flist_free(&rest);
+        }
     }
 
     /* free our lists of levels */
     mfu_flist_array_free(levels, &lists);
 
-    /* free buffers */
-    mfu_free(&mfu_copy_opts->block_buf1);
-    mfu_free(&mfu_copy_opts->block_buf2);
-
-    /* Determine the actual and relative end time for the epilogue. */
-    mfu_copy_stats.wtime_ended = MPI_Wtime();
-    time(&(mfu_copy_stats.time_ended));
-
-    /* compute time */
-    double rel_time = mfu_copy_stats.wtime_ended - \
-                      mfu_copy_stats.wtime_started;
-
-    /* prep our values into buffer */
-    int64_t values[5];
-    values[0] = mfu_copy_stats.total_dirs;
-    values[1] = mfu_copy_stats.total_files;
-    values[2] = mfu_copy_stats.total_links;
-    values[3] = mfu_copy_stats.total_size;
-    values[4] = mfu_copy_stats.total_bytes_copied;
-
-    /* sum values across processes */
-    int64_t sums[5];
-    MPI_Allreduce(values, sums, 5, MPI_INT64_T, MPI_SUM, MPI_COMM_WORLD);
-
-    /* extract results from allreduce */
-    int64_t agg_dirs   = sums[0];
-    int64_t agg_files  = sums[1];
-    int64_t agg_links  = sums[2];
-    int64_t agg_size   = sums[3];
-    int64_t agg_copied = sums[4];
+    /* report and clean up */
+    return mfu_copy_end(src_cp_list, numpaths, paths, mfu_copy_opts, rc);
+}
 
-    /* compute rate of copy */
-    double agg_rate = (double)agg_copied / rel_time;
-    if (rel_time > 0.0) {
-        agg_rate = (double)agg_copied / rel_time;
+/* arguments passed through the streaming walk to mfu_copy_stream_batch */
+typedef struct {
+    int numpaths;
+    const mfu_param_path* paths;
+    mfu_copy_opts_t* mfu_copy_opts;
+    uint64_t items;  /* number of items copied so far */
+    int rc;          /* -1 if any batch failed on this process */
+} mfu_copy_stream_args_t;
+
+/* called with the items of each round of the walk, creates their
+ * directories, and then creates, copies, and sets metadata on the
+ * rest, directory metadata is left for the end of the walk */
+static void mfu_copy_stream_batch(mfu_flist batch, void* arg)
+{
+    mfu_copy_stream_args_t* args = (mfu_copy_stream_args_t*) arg;
+    mfu_copy_opts_t* mfu_copy_opts = args->mfu_copy_opts;
+    int numpaths = args->numpaths;
+    const mfu_param_path* paths = args->paths;
+    int d;
+
+    /* the parents of these directories are in this or an earlier
+     * batch, so create them from the top down by level */
+    int levels, minlevel;
+    mfu_flist* lists;
+    mfu_flist_array_by_depth(batch, &levels, &minlevel, &lists);
+    for (d = mfu_copy_ndests - 1; d >= 0; d--) {
+        const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+        if (mfu_create_directories(levels, minlevel, lists, numpaths,
+                paths, dp, mfu_copy_opts) < 0)
+        {
+            args->rc = -1;
+        }
     }
+    mfu_flist_array_free(levels, &lists);
 
-    if(rank == 0) {
-        /* format start time */
-        char starttime_str[256];
-        struct tm* localstart = localtime(&(mfu_copy_stats.time_started));
-        strftime(starttime_str, 256, "%b-%d-%Y,%H:%M:%S", localstart);
+    /* copy everything else, spread evenly over ranks */
+    mfu_flist items = mfu_flist_subset(batch);
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(batch);
+    for (idx = 0; idx < size; idx++) {
+        if (mfu_flist_file_get_type(batch, idx) != MFU_TYPE_DIR) {
+            mfu_flist_file_copy(batch, idx, items);
+        }
+    }
+    mfu_flist_summarize(items);
+    if (mfu_flist_global_size(items) > 0) {
+        mfu_flist spreadlist = mfu_flist_spread(items);
+        if (mfu_copy_batch(&spreadlist, numpaths, paths, mfu_copy_opts) < 0) {
+            args->rc = -1;
+        }
+        mfu_flist_free(&spreadlist);
+    }
+    mfu_flist_free(&items);
 
-        /* format end time */
-        char endtime_str[256];
-        struct tm* localend = localtime(&(mfu_copy_stats.time_ended));
-        strftime(endtime_str, 256, "%b-%d-%Y,%H:%M:%S", localend);
+    args->items += mfu_flist_global_size(batch);
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Copied %" PRIu64 " items found so far", args->items);
+    }
+}
 
-        /* total number of items */
-        int64_t agg_items = agg_dirs + agg_files + agg_links;
+int mfu_flist_copy_stream(int numpaths, const mfu_param_path* paths,
+        mfu_walk_opts_t* walk_opts, uint64_t batch_items, int numdests,
+        const mfu_param_path* destpaths, const int* into_dirs,
+        mfu_copy_opts_t* mfu_copy_opts, mfu_flist src_cp_list)
+{
+    /* assume we'll succeed */
+    int rc = 0;
 
-        /* convert size to units */
-        double agg_size_tmp;
-        const char* agg_size_units;
-        mfu_format_bytes((uint64_t)agg_size, &agg_size_tmp, &agg_size_units);
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
 
-        /* convert bandwidth to units */
-        double agg_rate_tmp;
-        const char* agg_rate_units;
-        mfu_format_bw(agg_rate, &agg_rate_tmp, &agg_rate_units);
+    /* each chunk reports the destinations it missed as bits of an int */
+    if (numdests < 1 || numdests > MFU_COPY_MAX_DESTS) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to copy to %d destinations, between 1 and %d are supported",
+                numdests, MFU_COPY_MAX_DESTS);
+        }
+        return -1;
+    }
 
-        MFU_LOG(MFU_LOG_INFO, "Started: %s", starttime_str);
-        MFU_LOG(MFU_LOG_INFO, "Completed: %s", endtime_str);
-        MFU_LOG(MFU_LOG_INFO, "Seconds: %.3lf", rel_time);
-        MFU_LOG(MFU_LOG_INFO, "Items: %" PRId64, agg_items);
-        MFU_LOG(MFU_LOG_INFO, "  Directories: %" PRId64, agg_dirs);
-        MFU_LOG(MFU_LOG_INFO, "  Files: %" PRId64, agg_files);
-        MFU_LOG(MFU_LOG_INFO, "  Links: %" PRId64, agg_links);
-        MFU_LOG(MFU_LOG_INFO, "Data: %.3lf %s (%" PRId64 " bytes)",
-            agg_size_tmp, agg_size_units, agg_size);
+    /* set up for the copy, there is no list to summarize yet */
+    if (mfu_copy_begin(NULL, numdests, destpaths, into_dirs, mfu_copy_opts) < 0) {
+        rc = -1;
+    }
+    int d;
+
+    /* copy each batch of items as the walk finds them */
+    mfu_copy_stream_args_t args;
+    args.numpaths      = numpaths;
+    args.paths         = paths;
+    args.mfu_copy_opts = mfu_copy_opts;
+    args.items         = 0;
+    args.rc            = 0;
+    mfu_flist_walk_param_paths_stream((uint64_t) numpaths, paths, walk_opts,
+        batch_items, mfu_copy_stream_batch, &args, src_cp_list);
+    if (args.rc < 0) {
+        rc = -1;
+    }
+    mfu_flist_print_summary(src_cp_list);
 
-        MFU_LOG(MFU_LOG_INFO, "Rate: %.3lf %s " \
-            "(%.3" PRId64 " bytes in %.3lf seconds)", \
-            agg_rate_tmp, agg_rate_units, agg_copied, rel_time);
+    /* nothing is written to directories any more, so now set their
+     * permissions, ownership, and timestamps if needed */
+    int levels, minlevel;
+    mfu_flist* lists;
+    mfu_flist_array_by_depth(src_cp_list, &levels, &minlevel, &lists);
+    for (d = numdests - 1; d >= 0; d--) {
+        const mfu_param_path* dp = mfu_copy_use_dest(d, mfu_copy_opts);
+        int tmp_rc;
+        if (mfu_copy_opts->wavefront) {
+            tmp_rc = mfu_copy_set_metadata_dirs_wavefront(src_cp_list, numpaths,
+                    paths, dp, mfu_copy_opts);
+        } else {
+            tmp_rc = mfu_copy_set_metadata_dirs(levels, minlevel, lists, numpaths,
+                    paths, dp, mfu_copy_opts);
+        }
+        if (tmp_rc < 0 && mfu_copy_opts->copied_fn != NULL) {
+            rc = -1;
+        }
     }
+    mfu_flist_array_free(levels, &lists);
 
-    /* determine whether any process reported an error,
-     * inputs should are either 0 or -1, so min will be -1 on any -1 */
-    int all_rc;
-    MPI_Allreduce(&rc, &all_rc, 1, MPI_INT, MPI_MIN, MPI_COMM_WORLD);
-    rc = all_rc;
+    /* force updates to disk */
+    mfu_sync_all("Syncing directory updates to disk.");
 
-    return rc;
+    /* report and clean up */
+    return mfu_copy_end(src_cp_list, numpaths, paths, mfu_copy_opts, rc);
 }
 
 /* hold state for progress messages */
@@ -2643,12 +6690,13 @@ static int mfu_fill_file(
     int ret;
 
     /* open the file */
-    int out_fd = mfu_copy_open_file(dest, 0, &mfu_copy_dst_cache, mfu_copy_opts);
-    if (out_fd < 0) {
+    mfu_fdcache_entry* out_file = mfu_copy_open_file(dest, 0, mfu_copy_opts);
+    if (out_file == NULL) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file `%s' (errno=%d %s)",
             dest, errno, strerror(errno));
         return -1;
     }
+    int out_fd = out_file->fd;
 
     /* seek to offset in file */
     if (mfu_lseek(dest, out_fd, offset, SEEK_SET) == (off_t)-1) {
@@ -2661,7 +6709,15 @@ static int mfu_fill_file(
     size_t buf_size = mfu_copy_opts->block_size;
     void* buf = mfu_copy_opts->block_buf1;
 
-    /* fill buffer with data */
+    /* get alignment for direct I/O, if requested and supported */
+    size_t align = 0;
+    if (mfu_copy_opts->synchronous && !(out_file->hints & MFU_COPY_HINT_NO_DIRECT)) {
+        size_t mem_align;
+        if (mfu_dio_align(out_fd, &mem_align, &align) != 0 || mem_align > MFU_COPY_BUF_ALIGN) {
+            out_file->hints |= MFU_COPY_HINT_NO_DIRECT;
+            align = 0;
+        }
+    }
 
     /* write data */
     size_t total_bytes = 0;
@@ -2673,13 +6729,20 @@ static int mfu_fill_file(
             bytes_to_write = buf_size;
         }
 
-        /* compute number of bytes to write */
-        if (mfu_copy_opts->synchronous) {
-            /* O_DIRECT requires particular write sizes,
-             * ok to write beyond end of file so long as
-             * we truncate in cleanup step */
-            /* assumes buf_size is magic size for O_DIRECT */
-            bytes_to_write = buf_size;
+        /* use direct I/O for aligned writes, and buffered I/O
+         * for others, such as the partial block at end of file */
+        if (align > 0) {
+            uint64_t pos = offset + (uint64_t) total_bytes;
+            int direct = (pos % align == 0 && bytes_to_write % align == 0);
+            if (mfu_copy_set_direct(out_file, direct) != 0) {
+                out_file->hints |= MFU_COPY_HINT_NO_DIRECT;
+                align = 0;
+                if (mfu_copy_set_direct(out_file, 0) != 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to disable direct I/O on `%s' (errno=%d %s)",
+                        dest, errno, strerror(errno));
+                    return -1;
+                }
+            }
         }
 
         /* write bytes to destination file */
@@ -2742,9 +6805,9 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* mfu_copy_opts)
 {
     int rc = MFU_SUCCESS;
 
-    /* allocate buffer to write files, aligned on 1MB boundaraies */
-    size_t alignment = 1024*1024;
-    mfu_copy_opts->block_buf1 = (char*) MFU_MEMALIGN(mfu_copy_opts->block_size, alignment);
+    /* allocate buffer to write files, aligned for direct I/O */
+    size_t alignment = MFU_COPY_BUF_ALIGN;
+    mfu_copy_opts->block_buf1 = (char*) MFU_POOL_ALLOC(mfu_copy_opts->block_size, alignment);
 
     /* fill buffer with data */
     //memset(mfu_copy_opts->block_buf1, 0, mfu_copy_opts->block_size);
@@ -2774,6 +6837,9 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* mfu_copy_opts)
     double total_start = MPI_Wtime();
     uint64_t total_count = 0;
 
+    /* set up cache of open files */
+    mfu_copy_fd_cache = mfu_fdcache_new(mfu_copy_opts->open_files, 1);
+
     /* start up progress messages for the copy */
     fill_count = 0;
     fill_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, fill_progress_fn);
@@ -2814,7 +6880,7 @@ int mfu_flist_fill(mfu_flist list, mfu_copy_opts_t* mfu_copy_opts)
     }
 
     /* close files */
-    mfu_copy_close_file(&mfu_copy_dst_cache);
+    mfu_fdcache_delete(&mfu_copy_fd_cache);
 
     /* barrier to ensure all files are closed,
      * may try to unlink bad destination files below */
@@ -2933,10 +6999,15 @@ int mfu_flist_hardlink(mfu_flist src_link_list,
     mfu_copy_stats.total_links = 0;
     mfu_copy_stats.total_size  = 0;
     mfu_copy_stats.total_bytes_copied = 0;
-
-    /* Initialize file cache */
-    mfu_copy_src_cache.name = NULL;
-    mfu_copy_dst_cache.name = NULL;
+    mfu_copy_stats.total_bytes_cloned = 0;
+    mfu_copy_stats.total_bytes_ranged = 0;
+    mfu_copy_stats.total_bytes_direct = 0;
+    mfu_copy_stats.total_bytes_prealloc = 0;
+    mfu_copy_stats.total_bytes_verified = 0;
+    mfu_copy_stats.total_files_recopied = 0;
+    mfu_copy_stats.peak_dirty  = 0;
+    mfu_copy_stats.wtime_dirty = -1.0;
+    mfu_writebehind_init(&mfu_copy_wb, mfu_copy_opts->writebehind);
 
     /* split items in file list into sublists depending on their
      * directory depth */
@@ -2947,8 +7018,14 @@ int mfu_flist_hardlink(mfu_flist src_link_list,
     /* TODO: filter out files that are bigger than 0 bytes if we can't read them */
 
     /* create directories, from top down */
-    int tmp_rc = mfu_create_directories(levels, minlevel, lists, 1,
-            srcpath, destpath, mfu_copy_opts);
+    int tmp_rc;
+    if (mfu_copy_opts->wavefront) {
+        tmp_rc = mfu_create_directories_wavefront(src_link_list, 1,
+                srcpath, destpath, mfu_copy_opts);
+    } else {
+        tmp_rc = mfu_create_directories(levels, minlevel, lists, 1,
+                srcpath, destpath, mfu_copy_opts);
+    }
     if (tmp_rc < 0) {
         rc = -1;
     }
@@ -2966,8 +7043,10 @@ int mfu_flist_hardlink(mfu_flist src_link_list,
     }
 
     /* set permissions, ownership, and timestamps if needed */
+    mfu_copy_set_metadata_files(src_link_list, 1,
+            srcpath, destpath, mfu_copy_opts, NULL);
     mfu_copy_set_metadata(levels, minlevel, lists, 1,
-            srcpath, destpath, mfu_copy_opts);
+            srcpath, destpath, mfu_copy_opts, NULL);
 
     /* force updates to disk */
     mfu_sync_all("Syncing directory updates to disk.");
@@ -3140,6 +7219,56 @@ mfu_copy_opts_t* mfu_copy_opts_new(void)
     /* By default, do not limit the batch size */
     opts->batch_files   = 0;
 
+    /* By default, read and write data ourselves, tools opt in to offload */
+    opts->offload       = MFU_COPY_OFFLOAD_NONE;
+
+    /* By default, read and write each block synchronously */
+    opts->io_depth      = 1;
+    opts->io_buffers    = 0;
+
+    /* By default, each process copies the chunks assigned to it */
+    opts->dynamic       = 0;
+
+    /* By default, keep a few files open between chunks */
+    opts->open_files    = 16;
+
+    /* By default, create, copy, and set metadata on files in separate phases */
+    opts->fused         = false;
+
+    /* By default, assign the same number of chunks to each process,
+     * and estimate the per-file overhead when balancing by cost */
+    opts->balance       = MFU_COPY_BALANCE_CHUNKS;
+    opts->file_cost     = 0;
+
+    /* By default, don't checksum data as it is copied */
+    opts->manifest      = NULL;
+
+    /* by default, let the file system allocate space as data is written */
+    opts->preallocate   = false;
+
+    /* by default, don't count extents of copied files */
+    opts->count_extents = false;
+
+    /* By default, create directories and set their metadata one level at a time */
+    opts->wavefront     = false;
+
+    /* By default, trust the data that was written */
+    opts->verify        = false;
+
+    /* By default, nobody is told when a batch is done */
+    opts->copied_fn     = NULL;
+    opts->copied_arg    = NULL;
+
+    /* By default, don't record copied chunks, when asked to,
+     * write them out every 10 seconds */
+    opts->journal          = NULL;
+    opts->journal_interval = 10;
+    opts->resume           = false;
+
+    /* By default, leave the page cache to the kernel */
+    opts->pagecache   = MFU_COPY_PAGECACHE_KEEP;
+    opts->writebehind = 8 * 1024 * 1024;
+
     return opts;
 }
 
@@ -3152,8 +7281,10 @@ void mfu_copy_opts_delete(mfu_copy_opts_t** popts)
     if (opts != NULL) {
       mfu_free(&opts->dest_path);
       mfu_free(&opts->input_file);
-      mfu_free(&opts->block_buf1);
-      mfu_free(&opts->block_buf2);
+      mfu_pool_free(&opts->block_buf1);
+      mfu_pool_free(&opts->block_buf2);
+      mfu_free(&opts->manifest);
+      mfu_free(&opts->journal);
     }
 
     mfu_free(popts);
@@ -24,6 +24,14 @@ extern "C" {
  * Define types
  ***************************************/
 
+/* bits above the stat mode in the mode field of an element record
+ * whether the walk looked for extended attributes and found any,
+ * keeping them in the mode lets them move with the element when
+ * lists are sent between processes or written to a cache file */
+#define MFU_FLIST_MODE_MASK          ((uint64_t)0xFFFFFFFF)
+#define MFU_FLIST_MODE_XATTRS_KNOWN  ((uint64_t)1 << 32)
+#define MFU_FLIST_MODE_XATTRS        ((uint64_t)1 << 33)
+
 /* linked list element of stat data used during walk */
 typedef struct list_elem {
     char* file;             /* file name (strdup'd) */
@@ -55,6 +63,7 @@ typedef struct {
 /* abstraction for distributed file list */
 typedef struct flist {
     int detail;              /* set to 1 if we have stat, 0 if just file name */
+    int xattrs;              /* set to 1 to record whether items have xattrs as they are inserted */
     uint64_t offset;         /* global offset of our file across all procs */
     uint64_t total_files;    /* total file count in list across all procs */
     uint64_t total_users;    /* number of users (valid if detail is 1) */
@@ -71,6 +80,15 @@ typedef struct flist {
     elem_t*  list_tail;  /* points to item at tail of list */
     elem_t** list_index; /* an array with pointers to each item in list */
 
+    /* variables to track records served from a memory-mapped cache file,
+     * list is read-only while map_base is set */
+    void*    map_base;     /* start of mapped region, NULL if not mapped */
+    size_t   map_size;     /* number of bytes in mapped region */
+    char*    map_records;  /* points to first record owned by this process */
+    uint64_t map_chars;    /* number of bytes for file name in each record */
+    size_t   map_elem_size;/* number of bytes in each record */
+    elem_t   map_elem;     /* element used to decode the most recent record */
+
     /* buffers of users, groups, and files */
     buf_t users;
     buf_t groups;
@@ -112,6 +130,18 @@ void mfu_flist_insert_elem(flist_t* flist, elem_t* elem);
 /* insert a file given its mode and optional stat data */
 void mfu_flist_insert_stat(flist_t* flist, const char* fpath, mode_t mode, const struct stat* sb);
 
+/* decode record at given index of a mapped list into elem,
+ * the file name points into the mapped region */
+void mfu_flist_map_decode(flist_t* flist, uint64_t idx, elem_t* elem);
+
+/* copy all records of a mapped list into linked list elements
+ * and release the mapping, no-op if list is not mapped */
+void mfu_flist_map_release(flist_t* flist);
+
+/* unmap records of a mapped list without copying them,
+ * no-op if list is not mapped */
+void mfu_flist_map_free(flist_t* flist);
+
 /* given a mode_t from stat, return the corresponding MFU filetype */
 mfu_filetype mfu_flist_mode_to_filetype(mode_t mode);
 
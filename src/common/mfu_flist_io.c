@@ -4,6 +4,7 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <sys/syscall.h>
+#include <sys/mman.h>
 
 #include <limits.h>
 #include <stdio.h>
@@ -1100,6 +1101,283 @@ void mfu_flist_read_cache(
     return;
 }
 
+/****************************************
+ * Map file list from file
+ ***************************************/
+
+void mfu_flist_map_decode(flist_t* flist, uint64_t idx, elem_t* elem)
+{
+    const char* ptr = flist->map_records + idx * flist->map_elem_size;
+
+    /* file name is stored in place, padded with NULs */
+    elem->file   = (char*) ptr;
+    elem->depth  = mfu_flist_compute_depth(ptr);
+    elem->detail = 1;
+    ptr += flist->map_chars;
+
+    mfu_unpack_io_uint64(&ptr, &elem->mode);
+    mfu_unpack_io_uint64(&ptr, &elem->uid);
+    mfu_unpack_io_uint64(&ptr, &elem->gid);
+    mfu_unpack_io_uint64(&ptr, &elem->atime);
+    mfu_unpack_io_uint64(&ptr, &elem->atime_nsec);
+    mfu_unpack_io_uint64(&ptr, &elem->mtime);
+    mfu_unpack_io_uint64(&ptr, &elem->mtime_nsec);
+    mfu_unpack_io_uint64(&ptr, &elem->ctime);
+    mfu_unpack_io_uint64(&ptr, &elem->ctime_nsec);
+    mfu_unpack_io_uint64(&ptr, &elem->size);
+
+    /* use mode to set file type */
+    elem->type = mfu_flist_mode_to_filetype((mode_t)elem->mode);
+    elem->next = NULL;
+
+    return;
+}
+
+void mfu_flist_map_free(flist_t* flist)
+{
+    if (flist->map_base != NULL) {
+        munmap(flist->map_base, flist->map_size);
+        flist->map_base      = NULL;
+        flist->map_size      = 0;
+        flist->map_records   = NULL;
+        flist->map_chars     = 0;
+        flist->map_elem_size = 0;
+        flist->list_count    = 0;
+    }
+    return;
+}
+
+void mfu_flist_map_release(flist_t* flist)
+{
+    /* nothing to do if list is not mapped */
+    if (flist->map_base == NULL) {
+        return;
+    }
+
+    /* detach records from the list so that inserting
+     * elements below does not recurse back into us */
+    uint64_t count = flist->list_count;
+    char* ptr      = flist->map_records;
+    uint64_t chars = flist->map_chars;
+    size_t size    = flist->map_elem_size;
+    void* base     = flist->map_base;
+    size_t bytes   = flist->map_size;
+    flist->map_base    = NULL;
+    flist->map_records = NULL;
+    flist->list_count  = 0;
+
+    /* copy each record into a new element */
+    uint64_t i;
+    for (i = 0; i < count; i++) {
+        list_insert_ptr(flist, ptr, 1, chars);
+        ptr += size;
+    }
+
+    munmap(base, bytes);
+    flist->map_size      = 0;
+    flist->map_chars     = 0;
+    flist->map_elem_size = 0;
+
+    return;
+}
+
+/* read header, users, and groups of a version 4 cache file from
+ * mapped region, and point list at our portion of the records,
+ * returns MFU_SUCCESS if list is now backed by the mapped region */
+static int map_cache_v4(const char* name, int fd, uint64_t filesize, flist_t* flist)
+{
+    /* get our rank */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* read version and header, 7 consecutive uint64_t */
+    uint64_t header[7];
+    uint64_t header_packed[7];
+    size_t header_size = 7 * 8;
+    if (filesize < header_size) {
+        return MFU_FAILURE;
+    }
+    ssize_t nread = pread(fd, header_packed, header_size, 0);
+    if (nread != (ssize_t) header_size) {
+        return MFU_FAILURE;
+    }
+    const char* ptr = (const char*) header_packed;
+    int i;
+    for (i = 0; i < 7; i++) {
+        mfu_unpack_io_uint64(&ptr, &header[i]);
+    }
+
+    /* only version 4 has fixed-size records we can serve in place */
+    if (header[0] != 4) {
+        return MFU_FAILURE;
+    }
+
+    /* pointer to users, groups, and file buffer data structure */
+    buf_t* users  = &flist->users;
+    buf_t* groups = &flist->groups;
+
+    uint64_t users_count  = header[1];
+    uint64_t users_chars  = header[2];
+    uint64_t groups_count = header[3];
+    uint64_t groups_chars = header[4];
+    uint64_t all_count    = header[5];
+    uint64_t chars        = header[6];
+
+    /* compute offset to start of file records */
+    uint64_t disp = header_size;
+    disp += users_count * (users_chars + 8);
+    disp += groups_count * (groups_chars + 8);
+
+    /* compute count for each process, each takes a contiguous range */
+    uint64_t count = all_count / (uint64_t)ranks;
+    uint64_t remainder = all_count - count * (uint64_t)ranks;
+    uint64_t offset = count * (uint64_t)rank;
+    if ((uint64_t)rank < remainder) {
+        count++;
+        offset += (uint64_t)rank;
+    } else {
+        offset += remainder;
+    }
+
+    /* check that file holds all records it claims to */
+    size_t elem_size = list_elem_pack_size(1, chars, NULL);
+    uint64_t end = disp + all_count * (uint64_t)elem_size;
+    if (filesize < end) {
+        MFU_LOG(MFU_LOG_ERR, "Cache file is truncated `%s'", name);
+        return MFU_FAILURE;
+    }
+
+    /* map everything up to the end of our records, pages are only
+     * read as we touch them so the prefix owned by lower ranks
+     * costs us nothing beyond address space */
+    uint64_t map_end = disp + (offset + count) * (uint64_t)elem_size;
+    void* base = mmap(NULL, (size_t)map_end, PROT_READ, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to mmap `%s' (errno=%d %s)",
+            name, errno, strerror(errno));
+        return MFU_FAILURE;
+    }
+    char* records = (char*)base + disp + offset * (uint64_t)elem_size;
+
+    /* we'll scan our records front to back */
+    if (count > 0) {
+        madvise(records, (size_t)(count * elem_size), MADV_SEQUENTIAL);
+    }
+
+    /* unpack users and groups, which follow the header */
+    char* usrgrp = (char*)base + header_size;
+    if (users_count > 0 && users_chars > 0) {
+        users->count = users_count;
+        users->chars = users_chars;
+        mfu_flist_usrgrp_create_stridtype((int)users->chars, &(users->dt));
+
+        MPI_Aint lb_user, extent_user;
+        MPI_Type_get_extent(users->dt, &lb_user, &extent_user);
+        users->bufsize = users->count * (size_t)extent_user;
+        users->buf = (void*) MFU_MALLOC(users->bufsize);
+
+        buft_unpack(usrgrp, users);
+        usrgrp += buft_pack_size(users);
+    }
+    if (groups_count > 0 && groups_chars > 0) {
+        groups->count = groups_count;
+        groups->chars = groups_chars;
+        mfu_flist_usrgrp_create_stridtype((int)groups->chars, &(groups->dt));
+
+        MPI_Aint lb_group, extent_group;
+        MPI_Type_get_extent(groups->dt, &lb_group, &extent_group);
+        groups->bufsize = groups->count * (size_t)extent_group;
+        groups->buf = (void*) MFU_MALLOC(groups->bufsize);
+
+        buft_unpack(usrgrp, groups);
+    }
+
+    /* create maps of users and groups */
+    mfu_flist_usrgrp_create_map(&flist->users, flist->user_id2name);
+    mfu_flist_usrgrp_create_map(&flist->groups, flist->group_id2name);
+
+    /* point list at our records */
+    flist->detail        = 1;
+    flist->map_base      = base;
+    flist->map_size      = (size_t)map_end;
+    flist->map_records   = records;
+    flist->map_chars     = chars;
+    flist->map_elem_size = elem_size;
+    flist->list_count    = count;
+
+    return MFU_SUCCESS;
+}
+
+void mfu_flist_read_cache_map(
+    const char* name,
+    mfu_flist bflist)
+{
+    /* convert handle to flist_t */
+    flist_t* flist = (flist_t*) bflist;
+
+    /* start timer */
+    double start_read = MPI_Wtime();
+
+    /* report the filename we're reading from */
+    if (mfu_rank == 0) {
+        MFU_LOG(MFU_LOG_INFO, "Mapping input file: %s", name);
+    }
+
+    /* every process maps the file on its own */
+    int success = 0;
+    int fd = mfu_open(name, O_RDONLY);
+    if (fd >= 0) {
+        struct stat st;
+        if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+            if (map_cache_v4(name, fd, (uint64_t)st.st_size, flist) == MFU_SUCCESS) {
+                success = 1;
+            }
+        }
+
+        /* mapping stays valid after the file is closed */
+        mfu_close(name, fd);
+    }
+
+    /* fall back to reading the file if any process failed to map it,
+     * this also handles older cache formats */
+    int all_success;
+    MPI_Allreduce(&success, &all_success, 1, MPI_INT, MPI_LAND, MPI_COMM_WORLD);
+    if (!all_success) {
+        if (success) {
+            mfu_flist_map_free(flist);
+            mfu_flist_usrgrp_free(flist);
+            mfu_flist_usrgrp_init(flist);
+        }
+        mfu_flist_read_cache(name, bflist);
+        return;
+    }
+
+    /* compute global summary */
+    mfu_flist_summarize(bflist);
+
+    /* end timer */
+    double end_read = MPI_Wtime();
+
+    /* report read count, time, and rate */
+    if (mfu_rank == 0) {
+        uint64_t all_count = mfu_flist_global_size(bflist);
+        double time_diff = end_read - start_read;
+        double rate = 0.0;
+        if (time_diff > 0.0) {
+            rate = ((double)all_count) / time_diff;
+        }
+        MFU_LOG(MFU_LOG_INFO, "Mapped %lu files in %f seconds (%f files/sec)",
+               all_count, time_diff, rate
+              );
+    }
+
+    /* wait for summary to be printed */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return;
+}
+
 /****************************************
  * Write file list to file
  ***************************************/
@@ -1741,6 +2019,9 @@ void mfu_flist_write_cache(
     /* convert handle to flist_t */
     flist_t* flist = (flist_t*) bflist;
 
+    /* writers walk the linked list, so copy in any mapped records */
+    mfu_flist_map_release(flist);
+
     /* start timer */
     double start_write = MPI_Wtime();
 
@@ -8,6 +8,7 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -51,6 +52,17 @@ static flist_t* CURRENT_LIST;
 static int SET_DIR_PERMS;
 static int REMOVE_FILES;
 
+/* In a streaming walk, a process puts off items it dequeues once it
+ * has added WALK_BUDGET items to the current list, the items it put
+ * off are where it starts the next round, WALK_BUDGET is 0 otherwise */
+static uint64_t WALK_BUDGET;
+static int WALK_SEED_TOP;
+static char** WALK_SEED;
+static uint64_t WALK_SEED_COUNT;
+static char** WALK_DEFER;
+static uint64_t WALK_DEFER_COUNT;
+static uint64_t WALK_DEFER_CAP;
+
 /****************************************
  * Global counter and callbacks for LIBCIRCLE reductions
  ***************************************/
@@ -441,6 +453,31 @@ static void walk_getdents_process(CIRCLE_handle* handle)
     return;
 }
 
+/****************************************
+ * Put off items to later rounds of a streaming walk
+ ***************************************/
+
+/* returns 1 if path was set aside for the next round */
+static int walk_defer(const char* path)
+{
+    if (WALK_BUDGET == 0 || mfu_flist_size(CURRENT_LIST) < WALK_BUDGET) {
+        return 0;
+    }
+
+    /* grow our array as needed */
+    if (WALK_DEFER_COUNT == WALK_DEFER_CAP) {
+        WALK_DEFER_CAP = (WALK_DEFER_CAP > 0) ? 2 * WALK_DEFER_CAP : 1024;
+        WALK_DEFER = (char**) realloc(WALK_DEFER, WALK_DEFER_CAP * sizeof(char*));
+        if (WALK_DEFER == NULL) {
+            MFU_ABORT(-1, "Failed to allocate list of %llu paths",
+                (unsigned long long) WALK_DEFER_CAP);
+        }
+    }
+    WALK_DEFER[WALK_DEFER_COUNT] = MFU_STRDUP(path);
+    WALK_DEFER_COUNT++;
+    return 1;
+}
+
 /****************************************
  * Walk directory tree using stat at top level and readdir
  ***************************************/
@@ -588,6 +625,9 @@ static void walk_readdir_process(CIRCLE_handle* handle)
     /* in this case, only items on queue are directories */
     char path[CIRCLE_MAX_STRING_LEN];
     handle->dequeue(path);
+    if (walk_defer(path)) {
+        return;
+    }
     walk_readdir_process_dir(path, handle);
     reduce_items++;
     return;
@@ -658,6 +698,9 @@ static void walk_stat_process(CIRCLE_handle* handle)
     /* get path from queue */
     char path[CIRCLE_MAX_STRING_LEN];
     handle->dequeue(path);
+    if (walk_defer(path)) {
+        return;
+    }
 
     /* stat item */
     struct stat st;
@@ -795,10 +838,15 @@ void mfu_flist_walk_paths(uint64_t num_paths, const char** paths,
     CIRCLE_cb_reduce_op(&reduce_exec);
     CIRCLE_cb_reduce_fini(&reduce_fini);
 
+    /* record whether items have xattrs as they are inserted */
+    flist->xattrs = (walk_opts->use_stat && walk_opts->xattrs);
+
     /* run the libcircle job */
     CIRCLE_begin();
     CIRCLE_finalize();
 
+    flist->xattrs = 0;
+
     /* compute global summary */
     mfu_flist_summarize(bflist);
 
@@ -823,6 +871,188 @@ void mfu_flist_walk_paths(uint64_t num_paths, const char** paths,
     return;
 }
 
+/** Call back given to start each round of a streaming walk. */
+static void walk_stream_create(CIRCLE_handle* handle)
+{
+    /* the first round starts from the top paths on rank 0 */
+    if (WALK_SEED_TOP && mfu_rank == 0) {
+        if (CURRENT_LIST->detail) {
+            walk_stat_create(handle);
+        } else {
+            walk_readdir_create(handle);
+        }
+    }
+
+    /* and later rounds from what each process put off */
+    uint64_t i;
+    for (i = 0; i < WALK_SEED_COUNT; i++) {
+        handle->enqueue(WALK_SEED[i]);
+    }
+}
+
+/* Walk paths in rounds, each process stops adding to the list of a
+ * round after batch_items / ranks items, fn is called on all processes
+ * with the items of each round, which are then added to flist */
+void mfu_flist_walk_paths_stream(uint64_t num_paths, const char** paths,
+                                 mfu_walk_opts_t* walk_opts, uint64_t batch_items,
+                                 mfu_flist_walk_batch_fn fn, void* arg,
+                                 mfu_flist bflist)
+{
+    /* report walk count, time, and rate */
+    double start_walk = MPI_Wtime();
+
+    SET_DIR_PERMS = walk_opts->dir_perms ? 1 : 0;
+    REMOVE_FILES  = walk_opts->remove ? 1 : 0;
+
+    /* convert handle to flist_t */
+    flist_t* flist = (flist_t*) bflist;
+
+    /* get our rank and number of ranks in job */
+    int rank, ranks;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &ranks);
+
+    /* print message to user that we're starting */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        uint64_t i;
+        for (i = 0; i < num_paths; i++) {
+            MFU_LOG(MFU_LOG_INFO, "Walking %s", paths[i]);
+        }
+    }
+
+    /* look up users and groups once, each batch copies them */
+    flist->detail = 0;
+    if (walk_opts->use_stat) {
+        flist->detail = 1;
+        if (flist->have_users == 0) {
+            mfu_flist_usrgrp_get_users(flist);
+        }
+        if (flist->have_groups == 0) {
+            mfu_flist_usrgrp_get_groups(flist);
+        }
+    }
+
+    /* split the batch over processes */
+    WALK_BUDGET = batch_items / (uint64_t) ranks;
+    if (WALK_BUDGET == 0) {
+        WALK_BUDGET = 1;
+    }
+
+    CURRENT_NUM_DIRS = num_paths;
+    CURRENT_DIRS     = paths;
+    WALK_SEED_TOP    = 1;
+    WALK_SEED        = NULL;
+    WALK_SEED_COUNT  = 0;
+    WALK_DEFER       = NULL;
+    WALK_DEFER_COUNT = 0;
+    WALK_DEFER_CAP   = 0;
+
+    uint64_t rounds = 0;
+    uint64_t pending = 1;
+    while (pending > 0) {
+        /* walk into a list of its own for this round */
+        mfu_flist batch = mfu_flist_subset(bflist);
+        CURRENT_LIST = (flist_t*) batch;
+        CURRENT_LIST->xattrs = (walk_opts->use_stat && walk_opts->xattrs);
+
+        /* every process seeds the queue with its own items */
+        CIRCLE_init(0, NULL, CIRCLE_SPLIT_EQUAL | CIRCLE_CREATE_GLOBAL);
+        CIRCLE_enable_logging(CIRCLE_LOG_WARN);
+        CIRCLE_cb_create(&walk_stream_create);
+        if (walk_opts->use_stat) {
+            CIRCLE_cb_process(&walk_stat_process);
+        } else {
+            CIRCLE_cb_process(&walk_readdir_process);
+        }
+        reduce_items = 0;
+        CIRCLE_cb_reduce_init(&reduce_init);
+        CIRCLE_cb_reduce_op(&reduce_exec);
+        CIRCLE_cb_reduce_fini(&reduce_fini);
+        CIRCLE_begin();
+        CIRCLE_finalize();
+
+        CURRENT_LIST->xattrs = 0;
+        CURRENT_LIST = NULL;
+
+        /* items put off in this round start the next one */
+        uint64_t i;
+        for (i = 0; i < WALK_SEED_COUNT; i++) {
+            mfu_free(&WALK_SEED[i]);
+        }
+        mfu_free(&WALK_SEED);
+        WALK_SEED        = WALK_DEFER;
+        WALK_SEED_COUNT  = WALK_DEFER_COUNT;
+        WALK_SEED_TOP    = 0;
+        WALK_DEFER       = NULL;
+        WALK_DEFER_COUNT = 0;
+        WALK_DEFER_CAP   = 0;
+        MPI_Allreduce(&WALK_SEED_COUNT, &pending, 1, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        rounds++;
+
+        /* hand the items of this round to the caller,
+         * and then add them to the full list */
+        mfu_flist_summarize(batch);
+        if (fn != NULL) {
+            fn(batch, arg);
+        }
+        uint64_t size = mfu_flist_size(batch);
+        for (i = 0; i < size; i++) {
+            mfu_flist_file_copy(batch, i, bflist);
+        }
+        mfu_flist_free(&batch);
+    }
+
+    WALK_BUDGET = 0;
+
+    /* compute global summary */
+    mfu_flist_summarize(bflist);
+
+    double end_walk = MPI_Wtime();
+
+    /* report walk count, time, and rate */
+    if (mfu_debug_level >= MFU_LOG_VERBOSE && mfu_rank == 0) {
+        uint64_t all_count = mfu_flist_global_size(bflist);
+        double time_diff = end_walk - start_walk;
+        double rate = 0.0;
+        if (time_diff > 0.0) {
+            rate = ((double)all_count) / time_diff;
+        }
+        MFU_LOG(MFU_LOG_INFO, "Walked %lu items in %" PRIu64 " rounds and %f seconds (%f files/sec)",
+               all_count, rounds, time_diff, rate
+              );
+    }
+
+    /* hold procs here until summary is printed */
+    MPI_Barrier(MPI_COMM_WORLD);
+
+    return;
+}
+
+/* given a list of param_paths, walk them in rounds, see mfu_flist_walk_paths_stream */
+void mfu_flist_walk_param_paths_stream(uint64_t num,
+                                       const mfu_param_path* params,
+                                       mfu_walk_opts_t* walk_opts,
+                                       uint64_t batch_items,
+                                       mfu_flist_walk_batch_fn fn, void* arg,
+                                       mfu_flist flist)
+{
+    /* allocate memory to hold a list of paths */
+    const char** path_list = (const char**) MFU_MALLOC(num * sizeof(char*));
+
+    uint64_t i;
+    for (i = 0; i < num; i++) {
+        path_list[i] = params[i].path;
+    }
+
+    mfu_flist_walk_paths_stream((uint64_t) num, path_list, walk_opts,
+        batch_items, fn, arg, flist);
+
+    /* free the list */
+    mfu_free(&path_list);
+
+    return;
+}
+
 /* given a list of param_paths, walk each one and add to flist */
 void mfu_flist_walk_param_paths(uint64_t num,
                                 const mfu_param_path* params,
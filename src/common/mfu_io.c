@@ -1,3 +1,6 @@
+/* to get SEEK_DATA and SEEK_HOLE */
+#define _GNU_SOURCE
+
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -10,11 +13,19 @@
 #include <errno.h>
 #include <stdarg.h>
 
+/* to get FIEMAP */
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#include <linux/fiemap.h>
+
 #include "mfu.h"
 
 #define MFU_IO_TRIES  (5)
 #define MFU_IO_USLEEP (100)
 
+/* number of extents to fetch with each FIEMAP call */
+#define MFU_IO_FIEMAP_EXTENTS (64)
+
 /* calls access, and retries a few times if we get EIO or EINTR */
 int mfu_access(const char* path, int amode)
 {
@@ -57,6 +68,27 @@ retry:
     return rc;
 }
 
+/* calls fchownat, and retries a few times if we get EIO or EINTR */
+int mfu_fchownat(int dirfd, const char* path, uid_t owner, gid_t group, int flags)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchownat(dirfd, path, owner, group, flags);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* calls chmod, and retries a few times if we get EIO or EINTR */
 int mfu_chmod(const char* path, mode_t mode)
 {
@@ -78,6 +110,27 @@ retry:
     return rc;
 }
 
+/* calls fchmodat, and retries a few times if we get EIO or EINTR */
+int mfu_fchmodat(int dirfd, const char* path, mode_t mode, int flags)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchmodat(dirfd, path, mode, flags);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* calls utimensat, and retries a few times if we get EIO or EINTR */
 int mfu_utimensat(int dirfd, const char *pathname, const struct timespec times[2], int flags)
 {
@@ -99,6 +152,69 @@ retry:
     return rc;
 }
 
+/* calls fchown, and retries a few times if we get EIO or EINTR */
+int mfu_fchown(int fd, uid_t owner, gid_t group)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchown(fd, owner, group);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
+/* calls fchmod, and retries a few times if we get EIO or EINTR */
+int mfu_fchmod(int fd, mode_t mode)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = fchmod(fd, mode);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
+/* calls futimens, and retries a few times if we get EIO or EINTR */
+int mfu_futimens(int fd, const struct timespec times[2])
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = futimens(fd, times);
+    if (rc != 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* calls lstat, and retries a few times if we get EIO or EINTR */
 int mfu_lstat(const char* path, struct stat* buf)
 {
@@ -162,6 +278,27 @@ retry:
     return rc;
 }
 
+/* call mknodat, retry a few times on EINTR or EIO */
+int mfu_mknodat(int dirfd, const char* path, mode_t mode, dev_t dev)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = mknodat(dirfd, path, mode, dev);
+    if (rc < 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* call remove, retry a few times on EINTR or EIO */
 int mfu_remove(const char* path)
 {
@@ -208,6 +345,27 @@ retry:
     return rc;
 }
 
+/* call readlinkat, retry a few times on EINTR or EIO */
+ssize_t mfu_readlinkat(int dirfd, const char* path, char* buf, size_t bufsize)
+{
+    ssize_t rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = readlinkat(dirfd, path, buf, bufsize);
+    if (rc < 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* call symlink, retry a few times on EINTR or EIO */
 int mfu_symlink(const char* oldpath, const char* newpath)
 {
@@ -229,6 +387,27 @@ retry:
     return rc;
 }
 
+/* call symlinkat, retry a few times on EINTR or EIO */
+int mfu_symlinkat(const char* oldpath, int newdirfd, const char* newpath)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = symlinkat(oldpath, newdirfd, newpath);
+    if (rc < 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* call hardlink, retry a few times on EINTR or EIO */
 int mfu_hardlink(const char* oldpath, const char* newpath)
 {
@@ -306,6 +485,37 @@ int mfu_open(const char* file, int flags, ...)
     return fd;
 }
 
+/* open file relative to directory dirfd, retry open a few times on failure */
+int mfu_openat(int dirfd, const char* file, int flags, ...)
+{
+    /* extract the mode (see man 2 open) */
+    mode_t mode = 0;
+    if (flags & O_CREAT) {
+        va_list ap;
+        va_start(ap, flags);
+        mode = va_arg(ap, mode_t);
+        va_end(ap);
+    }
+
+    /* attempt to open file, the mode is ignored without O_CREAT */
+    errno = 0;
+    int fd = openat(dirfd, file, flags, mode);
+
+    /* if open failed, try a few more times */
+    int tries = MFU_IO_TRIES;
+    while (tries && fd < 0) {
+        /* sleep a bit before consecutive tries */
+        usleep(MFU_IO_USLEEP);
+
+        /* open again */
+        errno = 0;
+        fd = openat(dirfd, file, flags, mode);
+        tries--;
+    }
+
+    return fd;
+}
+
 /* close file */
 int mfu_close(const char* file, int fd)
 {
@@ -500,6 +710,519 @@ retry:
     return rc;
 }
 
+int mfu_dio_align(int fd, size_t* mem_align, size_t* offset_align)
+{
+    /* most devices use logical blocks of 4096 bytes or less */
+    *mem_align    = 4096;
+    *offset_align = 4096;
+
+#ifdef STATX_DIOALIGN
+    struct statx stx;
+    if (statx(fd, "", AT_EMPTY_PATH, STATX_DIOALIGN, &stx) == 0 &&
+        (stx.stx_mask & STATX_DIOALIGN))
+    {
+        /* the kernel reports zero if direct I/O is not supported */
+        if (stx.stx_dio_offset_align == 0) {
+            errno = EINVAL;
+            return -1;
+        }
+        *mem_align    = (size_t) stx.stx_dio_mem_align;
+        *offset_align = (size_t) stx.stx_dio_offset_align;
+    }
+#endif
+
+    return 0;
+}
+
+/*****************************
+ * Open file cache
+ ****************************/
+
+mfu_fdcache* mfu_fdcache_new(int size, int fsync_on_close)
+{
+    /* we need room for a source and destination at once */
+    if (size < 2) {
+        size = 2;
+    }
+
+    mfu_fdcache* cache = (mfu_fdcache*) MFU_MALLOC(sizeof(mfu_fdcache));
+    cache->size           = size;
+    cache->fsync_on_close = fsync_on_close;
+    cache->entries        = (mfu_fdcache_entry*) MFU_MALLOC((size_t)size * sizeof(mfu_fdcache_entry));
+    cache->clock          = 0;
+    cache->hits           = 0;
+    cache->misses         = 0;
+    cache->evictions      = 0;
+    cache->parents        = NULL;
+
+    int i;
+    for (i = 0; i < size; i++) {
+        cache->entries[i].name = NULL;
+    }
+
+    return cache;
+}
+
+/* close file held in entry and mark entry as unused */
+static int mfu_fdcache_release(mfu_fdcache_entry* e, int sync)
+{
+    int rc = 0;
+    if (sync && (e->flags & O_ACCMODE) != O_RDONLY) {
+        /* report delayed write errors, nobody else will see them */
+        if (mfu_fsync(e->name, e->fd) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to fsync `%s' (errno=%d %s)",
+                e->name, errno, strerror(errno));
+            rc = -1;
+        }
+    }
+    if (mfu_close(e->name, e->fd) != 0) {
+        MFU_LOG(MFU_LOG_ERR, "Failed to close `%s' (errno=%d %s)",
+            e->name, errno, strerror(errno));
+        rc = -1;
+    }
+    mfu_free(&e->name);
+    return rc;
+}
+
+mfu_fdcache_entry* mfu_fdcache_open(mfu_fdcache* cache, const char* file, int flags, mode_t mode)
+{
+    cache->clock++;
+
+    /* look for file among open entries, while tracking
+     * a free or least recently used entry to replace */
+    mfu_fdcache_entry* victim = NULL;
+    int i;
+    for (i = 0; i < cache->size; i++) {
+        mfu_fdcache_entry* e = &cache->entries[i];
+        if (e->name == NULL) {
+            if (victim == NULL || victim->name != NULL) {
+                victim = e;
+            }
+            continue;
+        }
+
+        if (e->flags == flags && strcmp(e->name, file) == 0) {
+            e->stamp = cache->clock;
+            cache->hits++;
+            return e;
+        }
+
+        if (victim == NULL || (victim->name != NULL && e->stamp < victim->stamp)) {
+            victim = e;
+        }
+    }
+
+    /* not in cache, open the file before evicting so that
+     * we keep the old entry if open fails, relative to its
+     * parent directory if we have a cache of those */
+    cache->misses++;
+    int fd;
+    if (cache->parents != NULL) {
+        const char* base;
+        int dirfd = mfu_fdcache_parent(cache->parents, file, &base);
+        fd = mfu_openat(dirfd, base, flags, mode);
+    } else if (flags & O_CREAT) {
+        fd = mfu_open(file, flags, mode);
+    } else {
+        fd = mfu_open(file, flags);
+    }
+    if (fd < 0) {
+        return NULL;
+    }
+
+    if (victim->name != NULL) {
+        int err = errno;
+        mfu_fdcache_release(victim, cache->fsync_on_close);
+        errno = err;
+        cache->evictions++;
+    }
+
+    victim->name  = MFU_STRDUP(file);
+    victim->flags = flags;
+    victim->fd    = fd;
+    victim->hints = 0;
+    victim->stamp = cache->clock;
+    return victim;
+}
+
+void mfu_fdcache_set_parents(mfu_fdcache* cache, mfu_fdcache* parents)
+{
+    cache->parents = parents;
+}
+
+int mfu_fdcache_parent(mfu_fdcache* cache, const char* path, const char** base)
+{
+    /* nothing to gain for names in the current directory */
+    const char* slash = strrchr(path, '/');
+    if (slash == NULL || slash[1] == '\0') {
+        *base = path;
+        return AT_FDCWD;
+    }
+
+    /* get the parent, which is the root for top-level items */
+    size_t len = (size_t)(slash - path);
+    char* parent = (char*) MFU_MALLOC(len + 2);
+    if (len == 0) {
+        strcpy(parent, "/");
+    } else {
+        memcpy(parent, path, len);
+        parent[len] = '\0';
+    }
+
+    /* O_PATH needs no permission to read the directory itself */
+#ifdef O_PATH
+    int flags = O_PATH | O_DIRECTORY;
+#else
+    int flags = O_RDONLY | O_DIRECTORY;
+#endif
+    mfu_fdcache_entry* e = mfu_fdcache_open(cache, parent, flags, 0);
+    mfu_free(&parent);
+
+    /* fall back to the full path if we can't open the parent */
+    if (e == NULL) {
+        *base = path;
+        return AT_FDCWD;
+    }
+
+    *base = slash + 1;
+    return e->fd;
+}
+
+int mfu_fdcache_close_all(mfu_fdcache* cache)
+{
+    int rc = 0;
+    int i;
+    for (i = 0; i < cache->size; i++) {
+        mfu_fdcache_entry* e = &cache->entries[i];
+        if (e->name != NULL) {
+            if (mfu_fdcache_release(e, 1) != 0) {
+                rc = -1;
+            }
+        }
+    }
+    return rc;
+}
+
+void mfu_fdcache_delete(mfu_fdcache** pcache)
+{
+    if (pcache != NULL && *pcache != NULL) {
+        mfu_fdcache* cache = *pcache;
+        mfu_fdcache_close_all(cache);
+        mfu_free(&cache->entries);
+        mfu_free(pcache);
+    }
+}
+
+/*****************************
+ * Data extents
+ ****************************/
+
+void mfu_extent_iter_init(mfu_extent_iter* it, const char* file, int fd, off_t offset, off_t length)
+{
+    it->file = file;
+    it->fd   = fd;
+    it->pos  = offset;
+    it->end  = offset + length;
+}
+
+int mfu_extent_iter_next(mfu_extent_iter* it, off_t* start, off_t* length)
+{
+    /* nothing left once we pass the end of the range */
+    if (it->pos >= it->end) {
+        return 0;
+    }
+
+    /* assume the rest of the range is data,
+     * in case the file system can't tell us otherwise */
+    off_t data = it->pos;
+    off_t hole = it->end;
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    /* find the start of the next data extent */
+    data = mfu_lseek(it->file, it->fd, it->pos, SEEK_DATA);
+    if (data == (off_t)-1) {
+        if (errno == ENXIO) {
+            /* the rest of the file is a hole */
+            it->pos = it->end;
+            return 0;
+        }
+        if (errno != EINVAL && errno != EOPNOTSUPP) {
+            return -1;
+        }
+
+        /* SEEK_DATA is not supported, treat everything as data */
+        data = it->pos;
+    } else {
+        if (data >= it->end) {
+            /* next data starts beyond our range */
+            it->pos = it->end;
+            return 0;
+        }
+
+        /* find the end of this data extent, there is always
+         * a hole at the end of the file */
+        hole = mfu_lseek(it->file, it->fd, data, SEEK_HOLE);
+        if (hole == (off_t)-1) {
+            if (errno != ENXIO) {
+                return -1;
+            }
+
+            /* file was truncated under us */
+            it->pos = it->end;
+            return 0;
+        }
+        if (hole > it->end) {
+            hole = it->end;
+        }
+    }
+#endif
+
+    *start  = data;
+    *length = hole - data;
+    it->pos = hole;
+    return 1;
+}
+
+off_t mfu_data_size(const char* file, int fd, off_t offset, off_t length)
+{
+    off_t total = 0;
+
+    mfu_extent_iter it;
+    mfu_extent_iter_init(&it, file, fd, offset, length);
+
+    off_t start, len;
+    int rc;
+    while ((rc = mfu_extent_iter_next(&it, &start, &len)) > 0) {
+        total += len;
+    }
+    if (rc < 0) {
+        return (off_t)-1;
+    }
+
+    return total;
+}
+
+int64_t mfu_extent_count(const char* file, int fd)
+{
+#ifdef FS_IOC_FIEMAP
+    /* with no room for extents, FIEMAP just counts them,
+     * sync first so delayed allocations are counted */
+    struct fiemap fm;
+    memset(&fm, 0, sizeof(fm));
+    fm.fm_start        = 0;
+    fm.fm_length       = FIEMAP_MAX_OFFSET;
+    fm.fm_flags        = FIEMAP_FLAG_SYNC;
+    fm.fm_extent_count = 0;
+    if (ioctl(fd, FS_IOC_FIEMAP, &fm) != 0) {
+        MFU_LOG(MFU_LOG_DBG, "Failed to get extents of `%s' (errno=%d %s)",
+            file, errno, strerror(errno));
+        return -1;
+    }
+    return (int64_t) fm.fm_mapped_extents;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+int mfu_physical_offsets(const char* file, int fd, uint64_t chunk_size,
+                         uint64_t chunks, uint64_t* phys)
+{
+    uint64_t i;
+    for (i = 0; i < chunks; i++) {
+        phys[i] = UINT64_MAX;
+    }
+
+#ifdef FS_IOC_FIEMAP
+    size_t bufsize = sizeof(struct fiemap) +
+        MFU_IO_FIEMAP_EXTENTS * sizeof(struct fiemap_extent);
+    struct fiemap* fm = (struct fiemap*) MFU_MALLOC(bufsize);
+
+    /* walk extents in logical order, so the first extent we see in
+     * a chunk holds its lowest mapped byte */
+    uint64_t start = 0;
+    uint64_t end   = chunks * chunk_size;
+    int last = 0;
+    while (! last && start < end) {
+        memset(fm, 0, bufsize);
+        fm->fm_start        = start;
+        fm->fm_length       = end - start;
+        fm->fm_extent_count = MFU_IO_FIEMAP_EXTENTS;
+        if (ioctl(fd, FS_IOC_FIEMAP, fm) != 0) {
+            MFU_LOG(MFU_LOG_DBG, "Failed to get extents of `%s' (errno=%d %s)",
+                file, errno, strerror(errno));
+            mfu_free(&fm);
+            return -1;
+        }
+        if (fm->fm_mapped_extents == 0) {
+            break;
+        }
+
+        uint32_t j;
+        for (j = 0; j < fm->fm_mapped_extents; j++) {
+            struct fiemap_extent* fe = &fm->fm_extents[j];
+            uint64_t ext_start = fe->fe_logical;
+            uint64_t ext_end   = fe->fe_logical + fe->fe_length;
+
+            /* delayed allocations and inline data have no address */
+            if (! (fe->fe_flags & (FIEMAP_EXTENT_UNKNOWN | FIEMAP_EXTENT_DATA_INLINE)) &&
+                ext_end > ext_start && ext_start < end)
+            {
+                uint64_t c    = ext_start / chunk_size;
+                uint64_t cend = (ext_end - 1) / chunk_size;
+                if (cend >= chunks) {
+                    cend = chunks - 1;
+                }
+                for (; c <= cend; c++) {
+                    if (phys[c] == UINT64_MAX) {
+                        uint64_t off = c * chunk_size;
+                        if (off < ext_start) {
+                            off = ext_start;
+                        }
+                        phys[c] = fe->fe_physical + (off - ext_start);
+                    }
+                }
+            }
+
+            if (fe->fe_flags & FIEMAP_EXTENT_LAST) {
+                last = 1;
+            }
+            start = ext_end;
+        }
+    }
+
+    mfu_free(&fm);
+    return 0;
+#else
+    errno = ENOTSUP;
+    return -1;
+#endif
+}
+
+/*****************************
+ * Write-behind
+ ****************************/
+
+void mfu_writebehind_init(mfu_writebehind* wb, uint64_t window)
+{
+    memset(wb, 0, sizeof(*wb));
+    wb->window = window;
+}
+
+/* wait for writeback of range, drop it from cache, and close it */
+static void mfu_writebehind_retire(mfu_writebehind* wb, mfu_writebehind_range* r)
+{
+    if (r->name == NULL) {
+        return;
+    }
+
+    off_t pos = (off_t) r->start;
+    off_t len = (off_t) (r->end - r->start);
+
+#ifdef SYNC_FILE_RANGE_WRITE
+    double start = MPI_Wtime();
+    if (sync_file_range(r->out_fd, pos, len,
+        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER) != 0)
+    {
+        /* write errors are reported when the file is closed */
+        MFU_LOG(MFU_LOG_DBG, "Failed to wait for writeback of `%s' (errno=%d %s)",
+            r->name, errno, strerror(errno));
+    }
+    wb->wait_secs += MPI_Wtime() - start;
+#endif
+
+    posix_fadvise(r->out_fd, pos, len, POSIX_FADV_DONTNEED);
+    if (r->in_fd >= 0) {
+        posix_fadvise(r->in_fd, pos, len, POSIX_FADV_DONTNEED);
+        close(r->in_fd);
+    }
+    close(r->out_fd);
+    wb->dropped += r->end - r->start;
+
+    mfu_free(&r->name);
+}
+
+/* start writeback of the dirty range and queue it,
+ * after retiring the range queued before it */
+static void mfu_writebehind_kick(mfu_writebehind* wb)
+{
+    mfu_writebehind_retire(wb, &wb->queued);
+
+    mfu_writebehind_range* r = &wb->dirty;
+    if (r->name == NULL) {
+        return;
+    }
+
+#ifdef SYNC_FILE_RANGE_WRITE
+    if (sync_file_range(r->out_fd, (off_t) r->start,
+        (off_t) (r->end - r->start), SYNC_FILE_RANGE_WRITE) != 0)
+    {
+        MFU_LOG(MFU_LOG_DBG, "Failed to start writeback of `%s' (errno=%d %s)",
+            r->name, errno, strerror(errno));
+    }
+#endif
+
+    wb->queued = *r;
+    r->name = NULL;
+}
+
+void mfu_writebehind_add(mfu_writebehind* wb, const char* name,
+    int in_fd, int out_fd, uint64_t offset, uint64_t length)
+{
+    if (length == 0) {
+        return;
+    }
+
+    /* start a new range unless this continues the dirty one */
+    mfu_writebehind_range* r = &wb->dirty;
+    if (r->name != NULL && (r->end != offset || strcmp(r->name, name) != 0)) {
+        mfu_writebehind_kick(wb);
+    }
+    if (r->name == NULL) {
+        r->out_fd = dup(out_fd);
+        if (r->out_fd < 0) {
+            return;
+        }
+        r->in_fd = (in_fd >= 0) ? dup(in_fd) : -1;
+        r->name  = MFU_STRDUP(name);
+        r->start = offset;
+        r->end   = offset;
+    }
+    r->end += length;
+
+    if (r->end - r->start >= wb->window) {
+        mfu_writebehind_kick(wb);
+    }
+}
+
+void mfu_writebehind_finish(mfu_writebehind* wb)
+{
+    mfu_writebehind_kick(wb);
+    mfu_writebehind_retire(wb, &wb->queued);
+}
+
+uint64_t mfu_dirty_bytes(void)
+{
+    FILE* fp = fopen("/proc/meminfo", "r");
+    if (fp == NULL) {
+        return 0;
+    }
+
+    uint64_t total = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), fp) != NULL) {
+        unsigned long long kb;
+        if (sscanf(line, "Dirty: %llu kB", &kb) == 1 ||
+            sscanf(line, "Writeback: %llu kB", &kb) == 1)
+        {
+            total += (uint64_t) kb * 1024;
+        }
+    }
+    fclose(fp);
+
+    return total;
+}
+
 /*****************************
  * Directories
  ****************************/
@@ -537,6 +1260,27 @@ retry:
     return rc;
 }
 
+/* create directory relative to dirfd, retry a few times on EINTR or EIO */
+int mfu_mkdirat(int dirfd, const char* dir, mode_t mode)
+{
+    int rc;
+    int tries = MFU_IO_TRIES;
+retry:
+    errno = 0;
+    rc = mkdirat(dirfd, dir, mode);
+    if (rc < 0) {
+        if (errno == EINTR || errno == EIO) {
+            tries--;
+            if (tries > 0) {
+                /* sleep a bit before consecutive tries */
+                usleep(MFU_IO_USLEEP);
+                goto retry;
+            }
+        }
+    }
+    return rc;
+}
+
 /* remove directory, retry a few times on EINTR or EIO */
 int mfu_rmdir(const char* dir)
 {
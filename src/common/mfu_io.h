@@ -28,6 +28,7 @@ extern "C" {
 #endif
 
 #include <stdlib.h>
+#include <stdint.h>
 #include <stdarg.h>
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -52,12 +53,27 @@ int mfu_access(const char* path, int amode);
 /* calls lchown, and retries a few times if we get EIO or EINTR */
 int mfu_lchown(const char* path, uid_t owner, gid_t group);
 
+/* calls fchownat, and retries a few times if we get EIO or EINTR */
+int mfu_fchownat(int dirfd, const char* path, uid_t owner, gid_t group, int flags);
+
 /* calls chmod, and retries a few times if we get EIO or EINTR */
 int mfu_chmod(const char* path, mode_t mode);
 
+/* calls fchmodat, and retries a few times if we get EIO or EINTR */
+int mfu_fchmodat(int dirfd, const char* path, mode_t mode, int flags);
+
 /* calls utimensat, and retries a few times if we get EIO or EINTR */
 int mfu_utimensat(int dirfd, const char *pathname, const struct timespec times[2], int flags);
 
+/* calls fchown, and retries a few times if we get EIO or EINTR */
+int mfu_fchown(int fd, uid_t owner, gid_t group);
+
+/* calls fchmod, and retries a few times if we get EIO or EINTR */
+int mfu_fchmod(int fd, mode_t mode);
+
+/* calls futimens, and retries a few times if we get EIO or EINTR */
+int mfu_futimens(int fd, const struct timespec times[2]);
+
 /* calls lstat, and retries a few times if we get EIO or EINTR */
 int mfu_lstat(const char* path, struct stat* buf);
 
@@ -67,6 +83,9 @@ int mfu_lstat64(const char* path, struct stat64* buf);
 /* call mknod, retry a few times on EINTR or EIO */
 int mfu_mknod(const char* path, mode_t mode, dev_t dev);
 
+/* call mknodat, retry a few times on EINTR or EIO */
+int mfu_mknodat(int dirfd, const char* path, mode_t mode, dev_t dev);
+
 /* call remove, retry a few times on EINTR or EIO */
 int mfu_remove(const char* path);
 
@@ -77,9 +96,15 @@ int mfu_remove(const char* path);
 /* call readlink, retry a few times on EINTR or EIO */
 ssize_t mfu_readlink(const char* path, char* buf, size_t bufsize);
 
+/* call readlinkat, retry a few times on EINTR or EIO */
+ssize_t mfu_readlinkat(int dirfd, const char* path, char* buf, size_t bufsize);
+
 /* call symlink, retry a few times on EINTR or EIO */
 int mfu_symlink(const char* oldpath, const char* newpath);
 
+/* call symlinkat, retry a few times on EINTR or EIO */
+int mfu_symlinkat(const char* oldpath, int newdirfd, const char* newpath);
+
 /* call hardlink, retry a few times on EINTR or EIO */
 int mfu_hardlink(const char* oldpath, const char* newpath);
 
@@ -90,6 +115,9 @@ int mfu_hardlink(const char* oldpath, const char* newpath);
 /* open file with specified flags and mode, retry open a few times on failure */
 int mfu_open(const char* file, int flags, ...);
 
+/* open file relative to directory dirfd, retry open a few times on failure */
+int mfu_openat(int dirfd, const char* file, int flags, ...);
+
 /* close file */
 int mfu_close(const char* file, int fd);
 
@@ -114,6 +142,152 @@ int mfu_unlink(const char* file);
 /* force flush of written data */
 int mfu_fsync(const char* file, int fd);
 
+/* get the alignment that direct I/O (O_DIRECT) on fd needs for memory
+ * buffers and for file offsets and lengths, returns 0 on success and
+ * -1 with errno set to EINVAL if the file system does not support
+ * direct I/O on this file, assumes 4096 bytes for both if the kernel
+ * does not report them */
+int mfu_dio_align(int fd, size_t* mem_align, size_t* offset_align);
+
+/*****************************
+ * Open file cache
+ ****************************/
+
+/* an open file descriptor held in an mfu_fdcache */
+typedef struct {
+    char*    name;  /* path of open file, NULL if entry is unused */
+    int      flags; /* flags file was opened with */
+    int      fd;    /* open file descriptor */
+    int      hints; /* bits for caller to record state of open file, 0 on open */
+    uint64_t stamp; /* value of cache clock when entry was last used */
+} mfu_fdcache_entry;
+
+/* least-recently-used cache of open file descriptors keyed by path
+ * and open flags, avoids closing and reopening files that are
+ * accessed repeatedly, such as different chunks of the same file */
+typedef struct mfu_fdcache_s {
+    int size;                   /* max number of open files */
+    int fsync_on_close;         /* whether to fsync files opened for write on eviction */
+    mfu_fdcache_entry* entries; /* array of size entries */
+    uint64_t clock;             /* incremented on each access */
+    uint64_t hits;              /* number of opens satisfied by cache */
+    uint64_t misses;            /* number of opens that had to open a file */
+    uint64_t evictions;         /* number of files closed to make room */
+    struct mfu_fdcache_s* parents; /* cache of parent directories to open files relative to, or NULL */
+} mfu_fdcache;
+
+/* allocate a cache holding up to size open files (at least 2),
+ * if fsync_on_close is set, files opened for writing are synced
+ * when evicted as well as in mfu_fdcache_close_all */
+mfu_fdcache* mfu_fdcache_new(int size, int fsync_on_close);
+
+/* return entry for file opened with flags (and mode if O_CREAT is set),
+ * opening it if needed and closing the least recently used file
+ * if the cache is full, returns NULL with errno set on error,
+ * entry remains valid until the next call on cache */
+mfu_fdcache_entry* mfu_fdcache_open(mfu_fdcache* cache, const char* file, int flags, mode_t mode);
+
+/* open files that miss in cache relative to their parent directory,
+ * held open in parents, rather than looking up their full path */
+void mfu_fdcache_set_parents(mfu_fdcache* cache, mfu_fdcache* parents);
+
+/* return a descriptor held in cache for the directory containing
+ * path and set base to the last component of path, for use with
+ * the *at() calls, if the directory can't be opened or path has
+ * no directory component, returns AT_FDCWD and sets base to path,
+ * the descriptor remains valid until the next call on cache */
+int mfu_fdcache_parent(mfu_fdcache* cache, const char* path, const char** base);
+
+/* close all open files, fsync those opened for writing,
+ * returns 0 on success and -1 if any close failed */
+int mfu_fdcache_close_all(mfu_fdcache* cache);
+
+/* close all open files and free the cache */
+void mfu_fdcache_delete(mfu_fdcache** pcache);
+
+/*****************************
+ * Data extents
+ ****************************/
+
+/* iterates over the data extents in a range of an open file,
+ * using lseek(SEEK_DATA) and lseek(SEEK_HOLE) to step over holes
+ * without reading them */
+typedef struct {
+    const char* file; /* path of file, for error messages */
+    int fd;           /* open file descriptor */
+    off_t pos;        /* offset to look for the next extent from */
+    off_t end;        /* offset just past the end of the range */
+} mfu_extent_iter;
+
+/* start iterating over data extents in [offset, offset + length) of fd */
+void mfu_extent_iter_init(mfu_extent_iter* it, const char* file, int fd, off_t offset, off_t length);
+
+/* get the next data extent in the range, returns 1 and sets start
+ * and length of the extent clipped to the range, returns 0 if no data
+ * is left, and -1 with errno set on error, if the file system cannot
+ * report holes, the rest of the range is returned as one extent,
+ * this moves the file offset of fd */
+int mfu_extent_iter_next(mfu_extent_iter* it, off_t* start, off_t* length);
+
+/* return number of bytes held in data extents in [offset, offset + length)
+ * of fd, returns -1 with errno set on error */
+off_t mfu_data_size(const char* file, int fd, off_t offset, off_t length);
+
+/* return number of extents the file system uses to store fd,
+ * from FIEMAP, returns -1 with errno set if that is not supported */
+int64_t mfu_extent_count(const char* file, int fd);
+
+/* set phys[i] to the address on the device of the first mapped byte of
+ * each of the first chunks sections of chunk_size bytes in fd, from
+ * FIEMAP, sections with no mapped data or whose address the file system
+ * does not report get UINT64_MAX, returns -1 with errno set if FIEMAP
+ * is not supported */
+int mfu_physical_offsets(const char* file, int fd, uint64_t chunk_size,
+                         uint64_t chunks, uint64_t* phys);
+
+/*****************************
+ * Write-behind
+ ****************************/
+
+/* a range of a file written by a streaming copy, holds duplicates
+ * of the descriptors so that it outlives the caller's open files */
+typedef struct {
+    char*    name;   /* path of destination file, NULL if range is empty */
+    int      in_fd;  /* source descriptor, -1 if none */
+    int      out_fd; /* destination descriptor */
+    uint64_t start;  /* offset of first byte in range */
+    uint64_t end;    /* offset just past last byte in range */
+} mfu_writebehind_range;
+
+/* keeps a streaming copy from filling the page cache, once window
+ * bytes have been written to a file, starts writeback of them with
+ * sync_file_range, then waits for writeback of the window before it
+ * and drops that window of source and destination from the page
+ * cache with posix_fadvise(POSIX_FADV_DONTNEED) */
+typedef struct {
+    uint64_t window;              /* bytes to write before starting writeback */
+    mfu_writebehind_range dirty;  /* written, writeback not started */
+    mfu_writebehind_range queued; /* writeback started, not waited for */
+    double   wait_secs;           /* time spent waiting for writeback */
+    uint64_t dropped;             /* bytes of destination dropped from cache */
+} mfu_writebehind;
+
+/* set up write-behind with given window size in bytes */
+void mfu_writebehind_init(mfu_writebehind* wb, uint64_t window);
+
+/* record that length bytes at offset were copied from in_fd to out_fd,
+ * which is open on name, in_fd may be -1 if there is no source file */
+void mfu_writebehind_add(mfu_writebehind* wb, const char* name,
+    int in_fd, int out_fd, uint64_t offset, uint64_t length);
+
+/* wait for writeback of all recorded ranges and drop them from cache,
+ * call before closing destination files to keep the window short */
+void mfu_writebehind_finish(mfu_writebehind* wb);
+
+/* return bytes of dirty and writeback pages on this node, from
+ * /proc/meminfo, or 0 if that is not available */
+uint64_t mfu_dirty_bytes(void);
+
 /*****************************
  * Directories
  ****************************/
@@ -124,6 +298,9 @@ void mfu_getcwd(char* buf, size_t size);
 /* create directory, retry a few times on EINTR or EIO */
 int mfu_mkdir(const char* dir, mode_t mode);
 
+/* create directory relative to dirfd, retry a few times on EINTR or EIO */
+int mfu_mkdirat(int dirfd, const char* dir, mode_t mode);
+
 /* remove directory, retry a few times on EINTR or EIO */
 int mfu_rmdir(const char* dir);
 
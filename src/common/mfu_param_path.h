@@ -84,8 +84,31 @@ typedef struct {
     int    dir_perms;    /* flag option to update dir perms during walk */
     int    remove;       /* flag option to remove files during walk */
     int    use_stat;     /* flag option on whether or not to stat files during walk */
+    int    xattrs;       /* flag option to record whether items have extended attributes during walk */
 } mfu_walk_opts_t;
 
+/* methods to transfer file data during a copy, each method falls back
+ * to the ones listed before it if the file system does not support it */
+typedef enum {
+    MFU_COPY_OFFLOAD_NONE  = 0, /* read and write through a user buffer */
+    MFU_COPY_OFFLOAD_RANGE = 1, /* copy_file_range, then read/write */
+    MFU_COPY_OFFLOAD_CLONE = 2, /* FICLONERANGE, then copy_file_range, then read/write */
+} mfu_copy_offload_t;
+
+/* how file chunks are assigned to processes for copy */
+typedef enum {
+    MFU_COPY_BALANCE_CHUNKS = 0, /* same number of chunks on each process */
+    MFU_COPY_BALANCE_COST   = 1, /* same estimated cost of bytes plus per-file overhead */
+    MFU_COPY_BALANCE_DATA   = 2, /* like cost, but only count bytes in data extents */
+    MFU_COPY_BALANCE_PHYSICAL = 3, /* like cost, in order of location on disk */
+} mfu_copy_balance_t;
+
+/* what to do with the page cache while copying file data */
+typedef enum {
+    MFU_COPY_PAGECACHE_KEEP = 0, /* leave caching to the kernel */
+    MFU_COPY_PAGECACHE_DROP = 1, /* write-behind and drop copied data from cache */
+} mfu_copy_pagecache_t;
+
 /* options passed to mfu_ */
 typedef struct {
     int    copy_into_dir; /* flag indicating whether copying into existing dir */
@@ -95,12 +118,41 @@ typedef struct {
     bool   preserve;      /* whether to preserve timestamps, ownership, permissions, etc. */
     bool   synchronous;   /* whether to use O_DIRECT */
     bool   sparse;        /* whether to create sparse files */
+    bool   fused;         /* whether to copy files smaller than a chunk in a single pass */
     size_t chunk_size;    /* size to chunk files by */
     size_t block_size;    /* block size to read/write to file system */
     char*  block_buf1;    /* buffer to read / write data */
     char*  block_buf2;    /* another buffer to read / write data */
     int    grouplock_id;  /* Lustre grouplock ID */
     uint64_t batch_files; /* max batch size to copy files, 0 implies no limit */
+    mfu_copy_offload_t offload; /* how to transfer file data */
+    int    io_depth;      /* max number of asynchronous reads/writes in flight, 1 disables */
+    int    io_buffers;    /* number of block_size buffers used by async copy, at least io_depth */
+    int    open_files;    /* max number of source and destination files each process keeps open */
+    int    dynamic;       /* whether idle processes steal chunks from busy ones during copy */
+    mfu_copy_balance_t balance; /* how to assign chunks to processes */
+    uint64_t file_cost;   /* per-file overhead in bytes for cost balance, 0 to estimate */
+    char*  manifest;      /* file to write checksums of copied files to, NULL to skip */
+    char*  journal;       /* prefix of per-process journals of copied chunks, NULL to skip */
+    int    journal_interval; /* seconds between writes to the journal */
+    bool   resume;        /* whether to skip chunks recorded in the journal */
+    mfu_copy_pagecache_t pagecache; /* how to treat the page cache */
+    uint64_t writebehind; /* bytes written to a file before starting its writeback */
+    bool   preallocate;   /* whether to allocate space for destination files before copying data */
+    bool   count_extents; /* whether to count extents of destination files after the copy */
+    bool   wavefront;     /* whether to handle each directory once its parent or children are done, rather than by level */
+    bool   verify;        /* whether to read back copied data on another process and copy files that differ again */
+
+    /* if not NULL, called on each process after each batch of items
+     * has been copied and its metadata set, list is the mfu_flist of
+     * items in the batch and failed has a flag for each item that is
+     * nonzero unless the copy created that item in every destination,
+     * for a regular file, copied its data, and set its metadata, a link
+     * that was already in the way counts as failed, files copied in the
+     * single pass of fused are not included, directories updated after
+     * the last batch make the copy return -1 if their metadata fails */
+    void (*copied_fn)(void* list, const int* failed, void* arg);
+    void* copied_arg;     /* opaque argument passed to copied_fn */
 } mfu_copy_opts_t;
 
 /* Given a source item name, determine which source path this item
@@ -0,0 +1,215 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "mfu.h"
+
+/* size of a huge page, buffers at least this large are placed on
+ * huge page boundaries so that huge pages can back them */
+#define MFU_POOL_HUGE (2UL * 1024UL * 1024UL)
+
+/* number of power of two size classes */
+#define MFU_POOL_CLASSES (48)
+
+/* most free buffers a thread keeps in each size class */
+#define MFU_POOL_MAX_FREE (16)
+
+/* bytes reserved in front of each buffer for its header */
+#define MFU_POOL_HDR_SIZE (64)
+
+/* marks a header written by mfu_pool_alloc */
+#define MFU_POOL_MAGIC (0x6d66752d706f6f6cULL)
+
+/* header kept just in front of each buffer */
+typedef struct mfu_pool_hdr_s {
+    uint64_t magic;              /* MFU_POOL_MAGIC */
+    void* base;                  /* start of the mapping */
+    size_t maplen;               /* length of the mapping in bytes */
+    size_t alignment;            /* alignment of the buffer */
+    struct mfu_pool_hdr_s* next; /* next free buffer in this class */
+    int cls;                     /* size class, buffer holds 2^cls bytes */
+} mfu_pool_hdr;
+
+/* free buffers and statistics of one thread */
+typedef struct {
+    mfu_pool_hdr* free[MFU_POOL_CLASSES];
+    int count[MFU_POOL_CLASSES];
+    mfu_pool_stats stats;
+} mfu_pool_cache;
+
+static __thread mfu_pool_cache mfu_pool_local;
+
+static int mfu_pool_hugetlb = 0;
+
+/* return smallest class whose buffers hold size bytes */
+static int mfu_pool_class(size_t size)
+{
+    int cls = 0;
+    while (((size_t)1 << cls) < size) {
+        cls++;
+    }
+    return cls;
+}
+
+/* round size up to a multiple of align, a power of two */
+static size_t mfu_pool_round(size_t size, size_t align)
+{
+    return (size + align - 1) & ~(align - 1);
+}
+
+void mfu_pool_set_hugetlb(int enable)
+{
+    mfu_pool_hugetlb = enable;
+}
+
+void* mfu_pool_alloc(size_t size, size_t alignment, const char* file, int line)
+{
+    /* only bother if size > 0 */
+    if (size == 0) {
+        return NULL;
+    }
+
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    if (alignment < page) {
+        alignment = page;
+    }
+
+    int cls = mfu_pool_class(size);
+    if (cls >= MFU_POOL_CLASSES) {
+        mfu_abort(file, line, 1, "Failed to allocate %llu bytes from buffer pool",
+            (unsigned long long) size);
+    }
+    size_t bytes = (size_t)1 << cls;
+
+    /* take a free buffer of this class if one is aligned well enough */
+    mfu_pool_cache* c = &mfu_pool_local;
+    mfu_pool_hdr** prev = &c->free[cls];
+    while (*prev != NULL) {
+        mfu_pool_hdr* h = *prev;
+        if (h->alignment >= alignment) {
+            *prev = h->next;
+            c->count[cls]--;
+            c->stats.reuses++;
+            return (char*)h + MFU_POOL_HDR_SIZE;
+        }
+        prev = &h->next;
+    }
+
+    /* place large buffers on huge page boundaries */
+    size_t place = alignment;
+    if (bytes >= MFU_POOL_HUGE && place < MFU_POOL_HUGE) {
+        place = MFU_POOL_HUGE;
+    }
+
+    /* map room for the buffer, its header, and the padding to align it */
+    size_t maplen = bytes + place + MFU_POOL_HDR_SIZE;
+    void* base = MAP_FAILED;
+    int hugetlb = 0;
+#ifdef MAP_HUGETLB
+    if (mfu_pool_hugetlb && bytes >= MFU_POOL_HUGE) {
+        /* the kernel reserves the huge pages here, so this fails
+         * rather than faulting later if too few are free */
+        size_t len = mfu_pool_round(maplen, MFU_POOL_HUGE);
+        base = mmap(NULL, len, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (base != MAP_FAILED) {
+            maplen = len;
+            hugetlb = 1;
+        }
+    }
+#endif
+    if (base == MAP_FAILED) {
+        maplen = mfu_pool_round(maplen, page);
+        base = mmap(NULL, maplen, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (base == MAP_FAILED) {
+            mfu_abort(file, line, 1, "Failed to map %llu bytes (errno=%d %s). Try using more nodes.",
+                (unsigned long long) maplen, errno, strerror(errno));
+        }
+#ifdef MADV_HUGEPAGE
+        /* ask for transparent huge pages before any page is faulted */
+        if (bytes >= MFU_POOL_HUGE) {
+            madvise(base, maplen, MADV_HUGEPAGE);
+        }
+#endif
+    }
+
+    uintptr_t addr = (uintptr_t)base + MFU_POOL_HDR_SIZE;
+    addr = (addr + place - 1) & ~((uintptr_t)place - 1);
+
+    mfu_pool_hdr* h = (mfu_pool_hdr*)(addr - MFU_POOL_HDR_SIZE);
+    h->magic     = MFU_POOL_MAGIC;
+    h->base      = base;
+    h->maplen    = maplen;
+    h->alignment = place;
+    h->next      = NULL;
+    h->cls       = cls;
+
+    /* fault in each page from this thread, so the memory is resident
+     * before the buffer is used and, with the default first-touch
+     * policy, on our NUMA node */
+    char* buf = (char*)addr;
+    size_t off;
+    for (off = 0; off < bytes; off += page) {
+        buf[off] = 0;
+    }
+
+    c->stats.maps++;
+    c->stats.bytes_mapped += bytes;
+    if (hugetlb) {
+        c->stats.bytes_hugetlb += bytes;
+    }
+
+    return buf;
+}
+
+void mfu_pool_free(void* p)
+{
+    /* verify that we got a valid pointer to a pointer */
+    if (p == NULL) {
+        return;
+    }
+
+    void* ptr = *(void**)p;
+    if (ptr != NULL) {
+        mfu_pool_hdr* h = (mfu_pool_hdr*)((char*)ptr - MFU_POOL_HDR_SIZE);
+        if (h->magic != MFU_POOL_MAGIC) {
+            MFU_LOG(MFU_LOG_ERR, "Freed buffer %p that is not from the buffer pool", ptr);
+        } else {
+            /* keep the buffer for reuse unless we hold enough of its size */
+            mfu_pool_cache* c = &mfu_pool_local;
+            if (c->count[h->cls] < MFU_POOL_MAX_FREE) {
+                h->next = c->free[h->cls];
+                c->free[h->cls] = h;
+                c->count[h->cls]++;
+            } else {
+                munmap(h->base, h->maplen);
+            }
+        }
+    }
+
+    /* set caller's pointer to NULL */
+    *(void**)p = NULL;
+}
+
+void mfu_pool_drain(void)
+{
+    mfu_pool_cache* c = &mfu_pool_local;
+    int i;
+    for (i = 0; i < MFU_POOL_CLASSES; i++) {
+        while (c->free[i] != NULL) {
+            mfu_pool_hdr* h = c->free[i];
+            c->free[i] = h->next;
+            munmap(h->base, h->maplen);
+        }
+        c->count[i] = 0;
+    }
+}
+
+void mfu_pool_get_stats(mfu_pool_stats* stats)
+{
+    *stats = mfu_pool_local.stats;
+}
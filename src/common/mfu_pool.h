@@ -0,0 +1,61 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_POOL_H
+#define MFU_POOL_H
+
+/* Pool of large I/O buffers for the copy, compare, and restripe paths.
+ * Buffers are mapped directly from the kernel and every page is
+ * touched by the allocating thread before the buffer is returned, so
+ * the pages are resident and, under the default first-touch policy,
+ * on the NUMA node of the process.  Buffers of 2MB and more are backed
+ * by huge pages when the kernel allows it.  Freed buffers are kept on
+ * a list for the calling thread, grouped by power of two size, and
+ * handed out again without another trip to the kernel. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* returns a buffer of at least size bytes aligned to alignment, which
+ * must be a power of two, alignments below the page size are raised
+ * to it, calls mfu_abort on failure, returns NULL if size == 0 */
+#define MFU_POOL_ALLOC(X, Y) mfu_pool_alloc(X, Y, __FILE__, __LINE__)
+void* mfu_pool_alloc(
+  size_t size,
+  size_t alignment,
+  const char* file,
+  int line
+);
+
+/* given a pointer to a buffer from mfu_pool_alloc, return the buffer
+ * to the pool of the calling thread and set the pointer to NULL,
+ * does nothing if the pointer is NULL */
+void mfu_pool_free(void* p);
+
+/* release buffers cached by the calling thread back to the kernel */
+void mfu_pool_drain(void);
+
+/* with a nonzero value, map buffers of 2MB and more from the reserved
+ * huge pages of the system (MAP_HUGETLB) when there are enough free,
+ * otherwise transparent huge pages are requested with madvise */
+void mfu_pool_set_hugetlb(int enable);
+
+/* statistics of the calling thread */
+typedef struct {
+    uint64_t maps;          /* number of buffers mapped from the kernel */
+    uint64_t reuses;        /* number of allocations served from the pool */
+    uint64_t bytes_mapped;  /* bytes of buffers mapped */
+    uint64_t bytes_hugetlb; /* bytes of buffers mapped from reserved huge pages */
+} mfu_pool_stats;
+
+/* copy statistics of the calling thread into stats */
+void mfu_pool_get_stats(mfu_pool_stats* stats);
+
+#endif /* MFU_POOL_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
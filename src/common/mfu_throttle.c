@@ -0,0 +1,377 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+
+#include "mfu.h"
+
+/* number of seconds between rounds that split limits among processes,
+ * this also bounds how long a process sleeps before checking again */
+#define MFU_THROTTLE_INTERVAL (0.5)
+
+/* most tokens a process may save up, in seconds of its rate */
+#define MFU_THROTTLE_BURST (0.5)
+
+/* most entries in a schedule */
+#define MFU_THROTTLE_MAX_LIMITS (32)
+
+/* limits for a time of day window */
+typedef struct {
+    int window;     /* whether this entry only applies in a window */
+    int start;      /* start of window in minutes after midnight */
+    int end;        /* end of window in minutes after midnight */
+    uint64_t bytes; /* bytes per second, 0 for unlimited */
+    uint64_t ops;   /* metadata operations per second, 0 for unlimited */
+} mfu_throttle_limit;
+
+/* state while throttling */
+typedef struct {
+    int depth;             /* number of nested start calls */
+    MPI_Comm comm;         /* dup'ed communicator to execute allreduce */
+    MPI_Request req;       /* request for outstanding allreduce */
+    int ranks;             /* number of processes in comm */
+    uint64_t send[2];      /* whether we were busy, whether we are done */
+    uint64_t recv[2];      /* number of busy processes, number done */
+    int busy;              /* whether we charged anything this round */
+    int sent_busy;         /* whether we were busy in the last round */
+    double share;          /* fraction of limits given to this process */
+    double bytes_rate;     /* bytes per second for this process */
+    double ops_rate;       /* ops per second for this process */
+    double bytes_tokens;   /* bytes we may transfer without waiting */
+    double ops_tokens;     /* ops we may execute without waiting */
+    double time_refill;    /* time when tokens were last added */
+    double time_round;     /* time when last round was started */
+    double wait_secs;      /* seconds spent sleeping for tokens */
+} mfu_throttle;
+
+static mfu_throttle_limit mfu_throttle_limits[MFU_THROTTLE_MAX_LIMITS];
+static int mfu_throttle_count = 0;
+static mfu_throttle mfu_throttle_state;
+
+/* parse a time of day given as HH:MM into minutes after midnight,
+ * returns 0 on success and -1 on error */
+static int mfu_throttle_parse_time(const char* str, int* minutes)
+{
+    int hh, mm, n = 0;
+    if (sscanf(str, "%d:%d%n", &hh, &mm, &n) != 2 || str[n] != '\0' ||
+        hh < 0 || hh > 24 || mm < 0 || mm > 59 || (hh == 24 && mm != 0))
+    {
+        return -1;
+    }
+    *minutes = hh * 60 + mm;
+    return 0;
+}
+
+/* parse one schedule entry, returns 0 on success and -1 on error */
+static int mfu_throttle_parse_limit(char* str, mfu_throttle_limit* limit)
+{
+    memset(limit, 0, sizeof(*limit));
+
+    /* split off the time window if there is one */
+    char* rate = str;
+    char* eq = strchr(str, '=');
+    if (eq != NULL) {
+        *eq = '\0';
+        rate = eq + 1;
+
+        char* dash = strchr(str, '-');
+        if (dash == NULL) {
+            return -1;
+        }
+        *dash = '\0';
+        if (mfu_throttle_parse_time(str, &limit->start) != 0 ||
+            mfu_throttle_parse_time(dash + 1, &limit->end) != 0)
+        {
+            return -1;
+        }
+        limit->window = 1;
+    }
+
+    /* split off the ops limit if there is one */
+    char* slash = strchr(rate, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+        char* end = NULL;
+        errno = 0;
+        unsigned long long ops = strtoull(slash + 1, &end, 10);
+        if (errno != 0 || end == slash + 1 || *end != '\0') {
+            return -1;
+        }
+        limit->ops = (uint64_t) ops;
+    }
+
+    unsigned long long bytes;
+    if (mfu_abtoull(rate, &bytes) != MFU_SUCCESS) {
+        return -1;
+    }
+    limit->bytes = (uint64_t) bytes;
+
+    return 0;
+}
+
+int mfu_throttle_set(const char* spec)
+{
+    mfu_throttle_count = 0;
+
+    int rc = 0;
+    char* copy = MFU_STRDUP(spec);
+    char* saveptr = NULL;
+    char* tok = strtok_r(copy, ",", &saveptr);
+    while (tok != NULL) {
+        if (mfu_throttle_count == MFU_THROTTLE_MAX_LIMITS ||
+            mfu_throttle_parse_limit(tok, &mfu_throttle_limits[mfu_throttle_count]) != 0)
+        {
+            rc = -1;
+            break;
+        }
+        mfu_throttle_count++;
+        tok = strtok_r(NULL, ",", &saveptr);
+    }
+    mfu_free(&copy);
+
+    if (rc != 0 || mfu_throttle_count == 0) {
+        mfu_throttle_count = 0;
+        return -1;
+    }
+    return 0;
+}
+
+/* return the limits that apply at the current time of day,
+ * or NULL if nothing is limited */
+static const mfu_throttle_limit* mfu_throttle_lookup(void)
+{
+    time_t now = time(NULL);
+    struct tm local;
+    localtime_r(&now, &local);
+    int minutes = local.tm_hour * 60 + local.tm_min;
+
+    /* the first window that holds the current time wins */
+    const mfu_throttle_limit* fallback = NULL;
+    int i;
+    for (i = 0; i < mfu_throttle_count; i++) {
+        const mfu_throttle_limit* l = &mfu_throttle_limits[i];
+        if (! l->window) {
+            if (fallback == NULL) {
+                fallback = l;
+            }
+            continue;
+        }
+
+        int in_window;
+        if (l->start < l->end) {
+            in_window = (minutes >= l->start && minutes < l->end);
+        } else if (l->start > l->end) {
+            /* window wraps past midnight */
+            in_window = (minutes >= l->start || minutes < l->end);
+        } else {
+            in_window = 1;
+        }
+        if (in_window) {
+            return l;
+        }
+    }
+    return fallback;
+}
+
+/* set rates of this process from the schedule and its share */
+static void mfu_throttle_update_rates(mfu_throttle* thr)
+{
+    const mfu_throttle_limit* l = mfu_throttle_lookup();
+    thr->bytes_rate = (l != NULL) ? (double)l->bytes * thr->share : 0.0;
+    thr->ops_rate   = (l != NULL) ? (double)l->ops   * thr->share : 0.0;
+}
+
+/* add tokens for the time since the last refill */
+static void mfu_throttle_refill(mfu_throttle* thr)
+{
+    double now = MPI_Wtime();
+    double elapsed = now - thr->time_refill;
+    thr->time_refill = now;
+
+    if (thr->bytes_rate > 0.0) {
+        thr->bytes_tokens += thr->bytes_rate * elapsed;
+        double max = thr->bytes_rate * MFU_THROTTLE_BURST;
+        if (thr->bytes_tokens > max) {
+            thr->bytes_tokens = max;
+        }
+    } else {
+        thr->bytes_tokens = 0.0;
+    }
+
+    if (thr->ops_rate > 0.0) {
+        thr->ops_tokens += thr->ops_rate * elapsed;
+        double max = thr->ops_rate * MFU_THROTTLE_BURST;
+        if (thr->ops_tokens > max) {
+            thr->ops_tokens = max;
+        }
+    } else {
+        thr->ops_tokens = 0.0;
+    }
+}
+
+/* fallback to a fixed share if non-blocking collectives aren't available */
+#if MPI_VERSION >= 3
+/* split the limits among busy processes once a round completes,
+ * and start the next round when it is time */
+static void mfu_throttle_poll(mfu_throttle* thr)
+{
+    if (thr->req != MPI_REQUEST_NULL) {
+        int done = 0;
+        MPI_Test(&thr->req, &done, MPI_STATUS_IGNORE);
+        if (! done) {
+            return;
+        }
+
+        /* a process that was idle last round takes the share it would
+         * get if all processes were busy, so that many processes that
+         * start at once don't each take the share of the busy ones */
+        uint64_t busy = thr->recv[0];
+        if (thr->sent_busy && busy > 0) {
+            thr->share = 1.0 / (double) busy;
+        } else {
+            thr->share = 1.0 / (double) thr->ranks;
+        }
+
+        /* the limits may also have changed with the time of day */
+        mfu_throttle_update_rates(thr);
+    }
+
+    double now = MPI_Wtime();
+    if (now - thr->time_round < MFU_THROTTLE_INTERVAL) {
+        return;
+    }
+
+    thr->send[0] = (uint64_t) thr->busy;
+    thr->send[1] = 0;
+    thr->sent_busy = thr->busy;
+    thr->busy = 0;
+    MPI_Iallreduce(thr->send, thr->recv, 2, MPI_UINT64_T, MPI_SUM, thr->comm, &thr->req);
+    thr->time_round = now;
+}
+#endif
+
+void mfu_throttle_start(MPI_Comm comm)
+{
+    /* nothing to do if no limits are set */
+    if (mfu_throttle_count == 0) {
+        return;
+    }
+
+    mfu_throttle* thr = &mfu_throttle_state;
+    thr->depth++;
+    if (thr->depth > 1) {
+        return;
+    }
+
+    /* dup input communicator so our non-blocking collectives
+     * don't interfere with caller's MPI communication */
+    MPI_Comm_dup(comm, &thr->comm);
+    MPI_Comm_size(thr->comm, &thr->ranks);
+    thr->req = MPI_REQUEST_NULL;
+
+    /* start with an even split of the limits */
+    thr->busy      = 0;
+    thr->sent_busy = 0;
+    thr->share     = 1.0 / (double) thr->ranks;
+    mfu_throttle_update_rates(thr);
+
+    thr->bytes_tokens = 0.0;
+    thr->ops_tokens   = 0.0;
+    thr->time_refill  = MPI_Wtime();
+    thr->time_round   = thr->time_refill;
+    thr->wait_secs    = 0.0;
+}
+
+void mfu_throttle_charge(uint64_t bytes, uint64_t ops)
+{
+    mfu_throttle* thr = &mfu_throttle_state;
+    if (thr->depth == 0) {
+        return;
+    }
+
+    thr->busy = 1;
+#if MPI_VERSION >= 3
+    mfu_throttle_poll(thr);
+#endif
+    mfu_throttle_refill(thr);
+
+    if (thr->bytes_rate > 0.0) {
+        thr->bytes_tokens -= (double) bytes;
+    }
+    if (thr->ops_rate > 0.0) {
+        thr->ops_tokens -= (double) ops;
+    }
+
+    /* sleep until we are out of debt, waking up to pick up
+     * changes in our share or the schedule */
+    while (1) {
+        double wait = 0.0;
+        if (thr->bytes_rate > 0.0 && thr->bytes_tokens < 0.0) {
+            wait = -thr->bytes_tokens / thr->bytes_rate;
+        }
+        if (thr->ops_rate > 0.0 && thr->ops_tokens < 0.0) {
+            double ops_wait = -thr->ops_tokens / thr->ops_rate;
+            if (ops_wait > wait) {
+                wait = ops_wait;
+            }
+        }
+        if (wait <= 0.0) {
+            break;
+        }
+        if (wait > MFU_THROTTLE_INTERVAL) {
+            wait = MFU_THROTTLE_INTERVAL;
+        }
+
+        struct timespec ts;
+        ts.tv_sec  = (time_t) wait;
+        ts.tv_nsec = (long) ((wait - (double) ts.tv_sec) * 1.0e9);
+        nanosleep(&ts, NULL);
+        thr->wait_secs += wait;
+
+#if MPI_VERSION >= 3
+        mfu_throttle_poll(thr);
+#endif
+        mfu_throttle_refill(thr);
+    }
+}
+
+void mfu_throttle_complete(void)
+{
+    mfu_throttle* thr = &mfu_throttle_state;
+    if (thr->depth == 0) {
+        return;
+    }
+    thr->depth--;
+    if (thr->depth > 0) {
+        return;
+    }
+
+#if MPI_VERSION >= 3
+    /* keep taking part in rounds until every process is done,
+     * all processes see the same sums, so they stop together */
+    while (1) {
+        if (thr->req == MPI_REQUEST_NULL) {
+            thr->send[0] = 0;
+            thr->send[1] = 1;
+            MPI_Iallreduce(thr->send, thr->recv, 2, MPI_UINT64_T, MPI_SUM, thr->comm, &thr->req);
+        }
+        MPI_Wait(&thr->req, MPI_STATUS_IGNORE);
+        if (thr->recv[1] == (uint64_t) thr->ranks) {
+            break;
+        }
+    }
+#endif
+
+    /* report the longest time any process was held back */
+    int rank;
+    double max_wait;
+    MPI_Comm_rank(thr->comm, &rank);
+    MPI_Reduce(&thr->wait_secs, &max_wait, 1, MPI_DOUBLE, MPI_MAX, 0, thr->comm);
+    if (rank == 0 && mfu_debug_level >= MFU_LOG_VERBOSE) {
+        MFU_LOG(MFU_LOG_INFO, "Throttled: %.3lf secs (max per process)", max_wait);
+    }
+
+    /* release communicator we dup'ed during start */
+    MPI_Comm_free(&thr->comm);
+}
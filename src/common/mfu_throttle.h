@@ -0,0 +1,51 @@
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#ifndef MFU_THROTTLE_H
+#define MFU_THROTTLE_H
+
+/* Limits the rate of file data and metadata operations across all
+ * processes of a job.  Each process draws from a token bucket that
+ * refills at its share of the job limit, and processes periodically
+ * sum how many of them are busy with a non-blocking allreduce to
+ * split the limit among them.  Limits may change with the time of
+ * day according to a schedule. */
+
+#include <stdint.h>
+#include "mpi.h"
+
+/* parse a throttle schedule and set it as the limits for this job,
+ * spec is a comma-separated list of entries of the form
+ *   [HH:MM-HH:MM=]BYTES[/OPS]
+ * giving the bytes per second of file data read and written, and the
+ * metadata operations per second, a limit of 0 is unlimited, entries
+ * with a time window apply from the first time to the second in local
+ * time, and may wrap past midnight, the first window that matches the
+ * current time is used, and an entry without a window applies at all
+ * other times, e.g., "500MB/200,20:00-06:00=0" allows 500MB/s and
+ * 200 ops/s during the day and no limit at night,
+ * returns 0 on success and -1 if spec is invalid */
+int mfu_throttle_set(const char* spec);
+
+/* start throttling across processes in comm, does nothing if no
+ * limits were set, calls may be nested, only the outermost pair of
+ * start and complete take effect, collective over comm */
+void mfu_throttle_start(MPI_Comm comm);
+
+/* account for bytes of file data and ops metadata operations about
+ * to be done by this process, and sleep as needed to stay in its
+ * share of the limits, never waits on other processes */
+void mfu_throttle_charge(uint64_t bytes, uint64_t ops);
+
+/* stop throttling and report time spent waiting for tokens,
+ * collective over the comm given in start */
+void mfu_throttle_complete(void);
+
+#endif /* MFU_THROTTLE_H */
+
+/* enable C++ codes to include this header directly */
+#ifdef __cplusplus
+} /* extern "C" */
+#endif
@@ -55,6 +55,7 @@ int mfu_init()
 int mfu_finalize()
 {
     if (mfu_initialized > 0) {
+        mfu_pool_drain();
         DTCMP_Finalize();
         mfu_initialized--;
     }
@@ -675,9 +676,34 @@ void mfu_stat_set_ctimes (struct stat* sb, uint64_t secs, uint64_t nsecs)
 #endif
 }
 
+/* advance it to the data extent that contains or follows pos, and set
+ * start and end to its range, or both to the end of the iterator range
+ * if no data is left, returns 1 if this moved the file offset,
+ * 0 if it did not, and -1 on error */
+static int mfu_compare_next_extent(mfu_extent_iter* it, off_t pos, off_t* start, off_t* end)
+{
+    int moved = 0;
+    while (*end <= pos) {
+        off_t len;
+        int rc = mfu_extent_iter_next(it, start, &len);
+        if (rc < 0) {
+            return -1;
+        }
+        moved = 1;
+        if (rc == 0) {
+            *start = it->end;
+            *end   = it->end;
+            break;
+        }
+        *end = *start + len;
+    }
+    return moved;
+}
+
 /* compares contents of two files and optionally overwrite dest with source,
+ * keeps files open in cache if it is not NULL,
  * returns -1 on error, 0 if equal, 1 if different */
-int mfu_compare_contents(
+int mfu_compare_contents_cached(
     const char* src_name,          /* IN  - path name to souce file */
     const char* dst_name,          /* IN  - path name to destination file */
     off_t offset,                  /* IN  - offset with file to start comparison */
@@ -686,10 +712,19 @@ int mfu_compare_contents(
     int overwrite,                 /* IN  - whether to replace dest with source contents (1) or not (0) */
     uint64_t* count_bytes_read,    /* OUT - number of bytes read (src + dest) */
     uint64_t* count_bytes_written, /* OUT - number of bytes written to dest */
-    mfu_progress* prg)             /* IN  - progress message structure */
+    mfu_progress* prg,             /* IN  - progress message structure */
+    mfu_fdcache* cache)            /* IN  - cache of open files, may be NULL */
 {
     /* open source file */
-    int src_fd = mfu_open(src_name, O_RDONLY);
+    int src_fd = -1;
+    if (cache != NULL) {
+        mfu_fdcache_entry* e = mfu_fdcache_open(cache, src_name, O_RDONLY, 0);
+        if (e != NULL) {
+            src_fd = e->fd;
+        }
+    } else {
+        src_fd = mfu_open(src_name, O_RDONLY);
+    }
     if (src_fd < 0) {
         /* log error if there is an open failure on the src side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
@@ -704,12 +739,22 @@ int mfu_compare_contents(
     }
 
     /* open destination file */
-    int dst_fd = mfu_open(dst_name, dst_flags);
+    int dst_fd = -1;
+    if (cache != NULL) {
+        mfu_fdcache_entry* e = mfu_fdcache_open(cache, dst_name, dst_flags, 0);
+        if (e != NULL) {
+            dst_fd = e->fd;
+        }
+    } else {
+        dst_fd = mfu_open(dst_name, dst_flags);
+    }
     if (dst_fd < 0) {
         /* log error if there is an open failure on the dst side */
         MFU_LOG(MFU_LOG_ERR, "Failed to open `%s' (errno=%d %s)",
           dst_name, errno, strerror(errno));
-        mfu_close(src_name, src_fd);
+        if (cache == NULL) {
+            mfu_close(src_name, src_fd);
+        }
         return -1;
     }
 
@@ -725,8 +770,10 @@ int mfu_compare_contents(
         /* log error if there is an lseek failure on the src side */
         MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %lx (errno=%d %s)",
           src_name, (unsigned long)offset, errno, strerror(errno));
-        mfu_close(dst_name, dst_fd);
-        mfu_close(src_name, src_fd);
+        if (cache == NULL) {
+            mfu_close(dst_name, dst_fd);
+            mfu_close(src_name, src_fd);
+        }
         return -1;
     }
 
@@ -735,14 +782,28 @@ int mfu_compare_contents(
         /* log error if there is an lseek failure on the dst side */
         MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %lx (errno=%d %s)",
           dst_name, (unsigned long)offset, errno, strerror(errno));
-        mfu_close(dst_name, dst_fd);
-        mfu_close(src_name, src_fd);
+        if (cache == NULL) {
+            mfu_close(dst_name, dst_fd);
+            mfu_close(src_name, src_fd);
+        }
         return -1;
     }
 
     /* allocate buffers to read file data */
-    void* src_buf  = MFU_MALLOC(bufsize);
-    void* dest_buf = MFU_MALLOC(bufsize);
+    void* src_buf  = MFU_POOL_ALLOC(bufsize, 0);
+    void* dest_buf = MFU_POOL_ALLOC(bufsize, 0);
+
+    /* when comparing a fixed range, skip parts that are holes in both
+     * files without reading them, for that we track the current or
+     * next data extent in each file */
+    int skip_holes = (length > 0);
+    mfu_extent_iter src_it, dst_it;
+    off_t src_ext = offset, src_ext_end = offset;
+    off_t dst_ext = offset, dst_ext_end = offset;
+    if (skip_holes) {
+        mfu_extent_iter_init(&src_it, src_name, src_fd, offset, length);
+        mfu_extent_iter_init(&dst_it, dst_name, dst_fd, offset, length);
+    }
 
     /* read and compare data from files */
     off_t total_bytes = 0;
@@ -750,8 +811,46 @@ int mfu_compare_contents(
         /* track current position in file for error reporting and seeking */
         off_t pos = offset + total_bytes;
 
-        /* whether we should copy the source bytes to the destination */
+        if (skip_holes) {
+            /* find the data extents at or after our position */
+            int src_moved = mfu_compare_next_extent(&src_it, pos, &src_ext, &src_ext_end);
+            int dst_moved = mfu_compare_next_extent(&dst_it, pos, &dst_ext, &dst_ext_end);
+            if (src_moved < 0 || dst_moved < 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to find data extents in `%s' or `%s' (errno=%d %s)",
+                  src_name, dst_name, errno, strerror(errno));
+                rc = -1;
+                break;
+            }
+
+            /* both files are zero up to the next data extent in either */
+            if (pos < src_ext && pos < dst_ext) {
+                off_t next = (src_ext < dst_ext) ? src_ext : dst_ext;
+                total_bytes = next - offset;
+                if (total_bytes >= length) {
+                    break;
+                }
+                pos = next;
+                src_moved = 1;
+            }
+
+            /* looking for extents moves the file offsets,
+             * so set them back to our position */
+            if (src_moved || dst_moved) {
+                if (mfu_lseek(src_name, src_fd, pos, SEEK_SET) == (off_t)-1 ||
+                    mfu_lseek(dst_name, dst_fd, pos, SEEK_SET) == (off_t)-1)
+                {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s' or `%s', offset: %llx (errno=%d %s)",
+                      src_name, dst_name, (unsigned long long)pos, errno, strerror(errno));
+                    rc = -1;
+                    break;
+                }
+            }
+        }
+
+        /* whether we should copy the source bytes to the destination,
+         * and the offset in the buffer of the first byte to copy */
         int need_copy = 0;
+        size_t copy_start = 0;
 
         /* determine number of bytes to read in this iteration */
         size_t left_to_read = bufsize;
@@ -809,13 +908,16 @@ int mfu_compare_contents(
 
         /* if have same size buffers, and read some data, let's check the contents */
         if (src_read == dst_read) {
-            if (memcmp((ssize_t*)src_buf, (ssize_t*)dest_buf, (size_t)src_read) != 0) {
-                /* memory contents are different */
+            size_t diff = mfu_buf_diff(src_buf, dest_buf, (size_t)src_read);
+            if (diff < (size_t)src_read) {
+                /* memory contents are different,
+                 * only the bytes from the first difference on need copying */
                 rc = 1;
                 if (! overwrite) {
                     break;
                 }
                 need_copy = 1;
+                copy_start = diff;
             }
         }
 
@@ -823,7 +925,8 @@ int mfu_compare_contents(
          * then copy the bytes from the source into the destination */
         if (overwrite && need_copy == 1) {
             /* seek back to position to write to in destination file */
-            if (mfu_lseek(dst_name, dst_fd, pos, SEEK_SET) == (off_t)-1) {
+            off_t write_pos = pos + (off_t)copy_start;
+            if (mfu_lseek(dst_name, dst_fd, write_pos, SEEK_SET) == (off_t)-1) {
                 /* log error if there is an lseek failure on the dst side */
                 MFU_LOG(MFU_LOG_ERR, "Failed to lseek `%s', offset: %llx (errno=%d %s)",
                   dst_name, (unsigned long long)pos, strerror(errno));
@@ -832,8 +935,8 @@ int mfu_compare_contents(
             }
 
             /* write data to destination file */
-            size_t bytes_to_write = (size_t) src_read;
-            ssize_t bytes_written = mfu_write(dst_name, dst_fd, src_buf, bytes_to_write);
+            size_t bytes_to_write = (size_t) src_read - copy_start;
+            ssize_t bytes_written = mfu_write(dst_name, dst_fd, (char*)src_buf + copy_start, bytes_to_write);
             if (bytes_written < 0) {
                 /* hit a write error */
                 MFU_LOG(MFU_LOG_ERR, "Failed to write `%s' at offset %llx (errno=%d %s)",
@@ -849,6 +952,13 @@ int mfu_compare_contents(
         /* add bytes to our total */
         total_bytes += (long unsigned int)src_read;
 
+        /* count data we read and wrote against any bandwidth limit */
+        uint64_t moved = (uint64_t) src_read + (uint64_t) dst_read;
+        if (overwrite && need_copy == 1) {
+            moved += (uint64_t) src_read - copy_start;
+        }
+        mfu_throttle_charge(moved, 0);
+
         /* update number of bytes read and written for progress messages */
         uint64_t count_bytes[2];
         count_bytes[0] = *count_bytes_read;
@@ -857,16 +967,33 @@ int mfu_compare_contents(
     }
 
     /* free buffers */
-    mfu_free(&dest_buf);
-    mfu_free(&src_buf);
+    mfu_pool_free(&dest_buf);
+    mfu_pool_free(&src_buf);
 
-    /* close files */
-    mfu_close(dst_name, dst_fd);
-    mfu_close(src_name, src_fd);
+    /* close files, unless we're caching them */
+    if (cache == NULL) {
+        mfu_close(dst_name, dst_fd);
+        mfu_close(src_name, src_fd);
+    }
 
     return rc;
 }
 
+int mfu_compare_contents(
+    const char* src_name,
+    const char* dst_name,
+    off_t offset,
+    off_t length,
+    size_t bufsize,
+    int overwrite,
+    uint64_t* count_bytes_read,
+    uint64_t* count_bytes_written,
+    mfu_progress* prg)
+{
+    return mfu_compare_contents_cached(src_name, dst_name, offset, length,
+        bufsize, overwrite, count_bytes_read, count_bytes_written, prg, NULL);
+}
+
 /* uses the lustre api to obtain stripe count and stripe size of a file */
 int mfu_stripe_get(const char *path, uint64_t *stripe_size, uint64_t *stripe_count)
 {
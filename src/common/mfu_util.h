@@ -32,6 +32,7 @@ extern "C" {
 #include "byteswap.h"
 
 #include "mfu_progress.h"
+#include "mfu_io.h"
 
 #if __BYTE_ORDER == __LITTLE_ENDIAN
 #ifdef HAVE_BYTESWAP_H
@@ -245,6 +246,21 @@ int mfu_compare_contents(
     mfu_progress* prg        /* IN  - progress message structure */
 );
 
+/* like mfu_compare_contents, but keeps files open in cache if it is not NULL,
+ * so that comparing several chunks of a file opens it only once */
+int mfu_compare_contents_cached(
+    const char* src,         /* IN  - path name to souce file */
+    const char* dst,         /* IN  - path name to destination file */
+    off_t offset,            /* IN  - offset with file to start comparison */
+    off_t length,            /* IN  - number of bytes to be compared */
+    size_t bufsize,          /* IN  - size of I/O buffer to be used during compare */
+    int overwrite,           /* IN  - whether to replace dest with source contents (1) or not (0) */
+    uint64_t* bytes_read,    /* OUT - number of bytes read (src + dest) */
+    uint64_t* bytes_written, /* OUT - number of bytes written to dest */
+    mfu_progress* prg,       /* IN  - progress message structure */
+    mfu_fdcache* cache       /* IN  - cache of open files, may be NULL */
+);
+
 /* uses the lustre api to obtain stripe count and stripe size of a file */
 int mfu_stripe_get(const char *path, uint64_t *stripe_size, uint64_t *stripe_count);
 
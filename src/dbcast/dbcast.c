@@ -467,6 +467,7 @@ static void print_usage(void)
     printf("\n");
     printf("Options:\n");
     printf("  -s, --size <SIZE>  - block size to divide files (default 1MB)\n");
+    printf("      --throttle <SPEC> - limit bytes/sec read and written, e.g. 500MB,20:00-06:00=0\n");
     printf("  -h, --help         - print usage\n");
     printf("For more information see https://mpifileutils.readthedocs.io.");
     printf("\n");
@@ -505,6 +506,7 @@ int main (int argc, char *argv[])
     int option_index = 0;
     static struct option long_options[] = {
         {"size",         1, 0, 's'},
+        {"throttle",     1, 0, 'T'},
         {"help",         0, 0, 'h'},
         {0, 0, 0, 0}
     };
@@ -532,6 +534,14 @@ int main (int argc, char *argv[])
                 }
                 stripe_size = (uint64_t) byte_val;
                 break;
+            case 'T':
+                if (mfu_throttle_set(optarg) != 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to parse throttle schedule: %s", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
             case 'h':
                 usage = 1;
                 break;
@@ -819,7 +829,9 @@ int main (int argc, char *argv[])
 
     /* TODO: if all writers failed, throw a more serious error */
 
-    /* first phase: all tasks read data and write to their local file */
+    /* first phase: all tasks read data and write to their local file,
+     * holding reads and writes to any rate limits */
+    mfu_throttle_start(MPI_COMM_WORLD);
     MPI_Barrier(MPI_COMM_WORLD);
 
     double time_start = MPI_Wtime();
@@ -871,6 +883,7 @@ if (node_rank != 0) {
                 }
 
                 /* read chunk from file */
+                mfu_throttle_charge((uint64_t) size1, 0);
                 errno = 0;
                 ssize_t return_size = mfu_read(in_file_path, in_file, buf1, size1);
                 if (return_size != (ssize_t)size1) {
@@ -1004,6 +1017,7 @@ if (node_rank == 0) {
                             }
 
                             /* read chunk from file */
+                            mfu_throttle_charge((uint64_t) size, 0);
                             errno = 0;
                             ssize_t return_size = mfu_read(out_file_path, out_file, readbuf, size);
                             if (return_size == (ssize_t)size) {
@@ -1047,6 +1061,7 @@ if (node_rank == 0) {
                             }
 
                             /* write chunk to output file */
+                            mfu_throttle_charge((uint64_t) size, 0);
                             errno = 0;
                             ssize_t return_size = mfu_write(out_file_path, out_file, copybuf, size);
                             if (return_size == -1) {
@@ -1095,6 +1110,7 @@ if (node_rank == 0) {
     free(readbuf);
 }
 
+    mfu_throttle_complete();
     MPI_Barrier(MPI_COMM_WORLD);
 
     /* every rank closes output file */
@@ -31,6 +31,7 @@ static void print_usage(void)
     printf("  -t, --text                - change output option to write in text format\n");
     printf("  -b, --base                - enable base checks and normal output with --output\n");
     printf("      --progress <N>        - print progress every N seconds\n");
+    printf("      --throttle <spec>     - limit bytes/sec read, e.g. 500MB,20:00-06:00=0\n");
     printf("  -v, --verbose             - verbose output\n");
     printf("  -q, --quiet               - quiet output\n");
     printf("  -l, --lite                - only compares file modification time and size\n");
@@ -486,11 +487,19 @@ static void dcmp_compare_acl(
     strmap* dst_map,
     int *diff)
 {
-    void *src_val, *dst_val;
+    void *src_val = NULL, *dst_val = NULL;
     ssize_t src_size, dst_size;
     bool is_same = true;
 
 #if DCOPY_USE_XATTRS
+    /* ACLs are xattrs, so if the walks found no xattrs
+     * on either item, they have the same (empty) ACLs */
+    if (mfu_flist_file_get_xattrs(src_list, src_index) == 0 &&
+        mfu_flist_file_get_xattrs(dst_list, dst_index) == 0)
+    {
+        goto out;
+    }
+
     src_val = mfu_flist_file_get_acl(src_list, src_index, &src_size,
                                      "system.posix_acl_access");
     dst_val = mfu_flist_file_get_acl(dst_list, dst_index, &dst_size,
@@ -782,6 +791,9 @@ static int dcmp_strmap_compare_data(
     /* start progress messages when comparing data */
     mfu_progress* prg = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
+    /* keep files open across chunks to avoid reopening them for each one */
+    mfu_fdcache* fdcache = mfu_fdcache_new(16, 0);
+
     /* compare bytes for each file section and set flag based on what we find */
     uint64_t i = 0;
     const mfu_file_chunk* src_p = src_head;
@@ -797,8 +809,8 @@ static int dcmp_strmap_compare_data(
 
         /* compare the contents of the files */
         int overwrite = 0;
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, &bytes_read, &bytes_written, prg);
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length,
+                1048576, overwrite, &bytes_read, &bytes_written, prg, fdcache);
         if (compare_rc == -1) {
             /* we hit an error while reading */
             rc = -1;
@@ -819,6 +831,9 @@ static int dcmp_strmap_compare_data(
         dst_p = dst_p->next;
     }
 
+    /* close any files we still have open */
+    mfu_fdcache_delete(&fdcache);
+
     /* finalize progress messages */
     uint64_t count_bytes[2];
     count_bytes[0] = bytes_read;
@@ -2061,6 +2076,7 @@ int main(int argc, char **argv)
         {"text",     0, 0, 't'},
         {"base",     0, 0, 'b'},
         {"progress", 1, 0, 'P'},
+        {"throttle", 1, 0, 'T'},
         {"verbose",  0, 0, 'v'},
         {"quiet",    0, 0, 'q'},
         {"lite",     0, 0, 'l'},
@@ -2100,6 +2116,14 @@ int main(int argc, char **argv)
         case 'P':
             mfu_progress_timeout = atoi(optarg);
             break;
+        case 'T':
+            if (mfu_throttle_set(optarg) != 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse throttle schedule: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
         case 'v':
             options.verbose++;
             mfu_debug_level = MFU_LOG_VERBOSE;
@@ -2195,6 +2219,8 @@ int main(int argc, char **argv)
     if (rank == 0) {
         MFU_LOG(MFU_LOG_INFO, "Walking source path");
     }
+    /* note which items have xattrs to skip reading ACLs on the rest */
+    walk_opts->xattrs = dcmp_option_need_compare(DCMPF_ACL);
     mfu_flist_walk_param_paths(1,  srcpath, walk_opts, flist1);
 
     if (rank == 0) {
@@ -2214,12 +2240,15 @@ int main(int argc, char **argv)
     strmap* map1 = dcmp_strmap_creat(flist3, path1);
     strmap* map2 = dcmp_strmap_creat(flist4, path2);
 
-    /* compare files in map1 with those in map2 */
+    /* compare files in map1 with those in map2,
+     * holding reads to any rate limits */
+    mfu_throttle_start(MPI_COMM_WORLD);
     int tmp_rc = dcmp_strmap_compare(flist3, map1, flist4, map2, strlen(path1), srcpath, destpath);
     if (tmp_rc < 0) {
         /* hit a read error on at least one file */
         rc = 1;
     }
+    mfu_throttle_complete();
 
     /* check the results are valid */
     if (options.debug) {
@@ -66,12 +66,34 @@ void print_usage(void)
     /* printf("  -g, --grouplock <id> - use Lustre grouplock when reading/writing file\n"); */
 #endif
     printf("  -b, --blocksize     - IO buffer size in bytes (default 1MB)\n");
+    printf("      --balance <mode> - assign chunks to processes by: chunks, cost, data, physical (default chunks)\n");
+    printf("      --count-extents - report number of extents in destination files after copy\n");
+    printf("      --dynamic       - balance copy work across processes at run time\n");
+    printf("      --fanout <dir>  - also copy to this target, reading the source once, may be repeated\n");
+    printf("      --filecost <N>  - per-file overhead in bytes for cost balance (default estimated)\n");
+    printf("      --fused         - create, copy, and set metadata on files smaller than chunksize in one pass\n");
+    printf("      --hugepages     - map large IO buffers from reserved huge pages\n");
     printf("  -i, --input <file>  - read source list from file\n");
     printf("  -k, --chunksize     - work size per task in bytes (default 1MB)\n");
+    printf("      --journal <prefix> - record copied chunks in per-process files named prefix.<rank>\n");
+    printf("      --journal-interval <N> - write journal records every N seconds (default 10)\n");
+    printf("      --resume        - skip chunks recorded in the journal by an earlier run\n");
+    printf("      --iodepth <N>   - max asynchronous reads/writes in flight per process (default 1)\n");
+    printf("      --iobuffers <N> - number of IO buffers per process for asynchronous copy\n");
+    printf("      --manifest <file> - write checksum, size, mtime, and path of copied files to file\n");
+    printf("      --openfiles <N> - number of files each process keeps open while copying\n");
+    printf("      --offload <mode> - kernel data transfer: clone, range, none (default clone)\n");
+    printf("      --pagecache <mode> - page cache use: keep, drop (default keep)\n");
+    printf("      --preallocate   - allocate space for destination files before copying data\n");
     printf("  -p, --preserve      - preserve permissions, ownership, timestamps, extended attributes\n");
-    printf("  -s, --synchronous   - use synchronous read/write calls (O_DIRECT)\n");
+    printf("  -s, --synchronous   - use direct I/O (O_DIRECT) for aligned data\n");
     printf("  -S, --sparse        - create sparse files when possible\n");
+    printf("      --stream <N>    - copy items in batches of about N while walking the source\n");
     printf("      --progress <N>  - print progress every N seconds\n");
+    printf("      --throttle <spec> - limit bytes/sec and metadata ops/sec, e.g. 500MB/200,20:00-06:00=0\n");
+    printf("      --verify        - read back copied data on another process and copy files that differ again\n");
+    printf("      --wavefront     - handle each directory once its parent or subdirectories are done, not by level\n");
+    printf("      --writebehind <N> - with --pagecache drop, bytes to write before starting writeback (default 8MB)\n");
     printf("  -v, --verbose       - verbose output\n");
     printf("  -q, --quiet         - quiet output\n");
     printf("  -h, --help          - print usage\n");
@@ -96,6 +118,10 @@ int main(int argc, char** argv)
     /* pointer to mfu_copy opts */
     mfu_copy_opts_t* mfu_copy_opts = mfu_copy_opts_new();
 
+    /* let the kernel move data when the file system allows */
+    mfu_copy_opts->offload = MFU_COPY_OFFLOAD_CLONE;
+    int offload_set = 0;
+
     /* pointer to mfu_walk opts */
     mfu_walk_opts_t* walk_opts = mfu_walk_opts_new();
 
@@ -109,17 +135,46 @@ int main(int argc, char** argv)
     /* By default, don't have iput file. */
     char* inputname = NULL;
 
+    /* number of items to walk before copying them, 0 to walk everything first */
+    uint64_t stream_items = 0;
+
+    /* targets to copy to in addition to the last path */
+    const char* fanout[MFU_COPY_MAX_DESTS];
+    int numfanout = 0;
+
     int option_index = 0;
     static struct option long_options[] = {
         {"blocksize"            , required_argument, 0, 'b'},
+        {"balance"              , required_argument, 0, 'L'},
+        {"count-extents"        , no_argument      , 0, 'X'},
         {"debug"                , required_argument, 0, 'd'}, // undocumented
+        {"dynamic"              , no_argument      , 0, 'D'},
+        {"fanout"               , required_argument, 0, 'N'},
+        {"filecost"             , required_argument, 0, 'F'},
+        {"fused"                , no_argument      , 0, 'U'},
         {"grouplock"            , required_argument, 0, 'g'}, // untested
+        {"hugepages"            , no_argument      , 0, 'H'},
         {"input"                , required_argument, 0, 'i'},
         {"chunksize"            , required_argument, 0, 'k'},
+        {"iodepth"              , required_argument, 0, 'Q'},
+        {"iobuffers"            , required_argument, 0, 'B'},
+        {"journal"              , required_argument, 0, 'J'},
+        {"journal-interval"     , required_argument, 0, 'j'},
+        {"resume"               , no_argument      , 0, 'R'},
+        {"manifest"             , required_argument, 0, 'M'},
+        {"openfiles"            , required_argument, 0, 'Y'},
+        {"offload"              , required_argument, 0, 'O'},
+        {"pagecache"            , required_argument, 0, 'C'},
+        {"preallocate"          , no_argument      , 0, 'A'},
         {"preserve"             , no_argument      , 0, 'p'},
         {"synchronous"          , no_argument      , 0, 's'},
         {"sparse"               , no_argument      , 0, 'S'},
+        {"stream"               , required_argument, 0, 'Z'},
         {"progress"             , required_argument, 0, 'P'},
+        {"throttle"             , required_argument, 0, 'T'},
+        {"verify"               , no_argument      , 0, 'E'},
+        {"wavefront"            , no_argument      , 0, 'V'},
+        {"writebehind"          , required_argument, 0, 'W'},
         {"verbose"              , no_argument      , 0, 'v'},
         {"quiet"                , no_argument      , 0, 'q'},
         {"help"                 , no_argument      , 0, 'h'},
@@ -220,6 +275,158 @@ int main(int argc, char** argv)
                     mfu_copy_opts->chunk_size = bytes;
                 }
                 break;
+            case 'D':
+                mfu_copy_opts->dynamic = 1;
+                break;
+            case 'U':
+                mfu_copy_opts->fused = true;
+                break;
+            case 'H':
+                mfu_pool_set_hugetlb(1);
+                break;
+            case 'L':
+                if (strcmp(optarg, "chunks") == 0) {
+                    mfu_copy_opts->balance = MFU_COPY_BALANCE_CHUNKS;
+                } else if (strcmp(optarg, "cost") == 0) {
+                    mfu_copy_opts->balance = MFU_COPY_BALANCE_COST;
+                } else if (strcmp(optarg, "data") == 0) {
+                    mfu_copy_opts->balance = MFU_COPY_BALANCE_DATA;
+                } else if (strcmp(optarg, "physical") == 0) {
+                    mfu_copy_opts->balance = MFU_COPY_BALANCE_PHYSICAL;
+                } else {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Unknown balance mode: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'N':
+                if (numfanout < MFU_COPY_MAX_DESTS - 1) {
+                    fanout[numfanout] = optarg;
+                    numfanout++;
+                } else {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "At most %d targets may be given with --fanout",
+                            MFU_COPY_MAX_DESTS - 1);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'F':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse file cost: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->file_cost = (uint64_t) bytes;
+                }
+                break;
+            case 'Q':
+                mfu_copy_opts->io_depth = atoi(optarg);
+                if (mfu_copy_opts->io_depth < 1) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "IO depth must be positive: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'B':
+                mfu_copy_opts->io_buffers = atoi(optarg);
+                if (mfu_copy_opts->io_buffers < 1) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Number of IO buffers must be positive: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'Y':
+                mfu_copy_opts->open_files = atoi(optarg);
+                if (mfu_copy_opts->open_files < 2) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Number of open files must be at least 2: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'J':
+                mfu_free(&mfu_copy_opts->journal);
+                mfu_copy_opts->journal = MFU_STRDUP(optarg);
+                break;
+            case 'j':
+                mfu_copy_opts->journal_interval = atoi(optarg);
+                if (mfu_copy_opts->journal_interval < 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Journal interval must be at least 0: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'R':
+                mfu_copy_opts->resume = true;
+                break;
+            case 'M':
+                mfu_free(&mfu_copy_opts->manifest);
+                mfu_copy_opts->manifest = MFU_STRDUP(optarg);
+                break;
+            case 'O':
+                offload_set = 1;
+                if (strcmp(optarg, "clone") == 0) {
+                    mfu_copy_opts->offload = MFU_COPY_OFFLOAD_CLONE;
+                } else if (strcmp(optarg, "range") == 0) {
+                    mfu_copy_opts->offload = MFU_COPY_OFFLOAD_RANGE;
+                } else if (strcmp(optarg, "none") == 0) {
+                    mfu_copy_opts->offload = MFU_COPY_OFFLOAD_NONE;
+                } else {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Unknown offload mode: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'C':
+                if (strcmp(optarg, "keep") == 0) {
+                    mfu_copy_opts->pagecache = MFU_COPY_PAGECACHE_KEEP;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    mfu_copy_opts->pagecache = MFU_COPY_PAGECACHE_DROP;
+                } else {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Unknown page cache mode: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
+            case 'E':
+                mfu_copy_opts->verify = true;
+                break;
+            case 'V':
+                mfu_copy_opts->wavefront = true;
+                break;
+            case 'W':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse write-behind size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->writebehind = (uint64_t) bytes;
+                }
+                break;
+            case 'A':
+                mfu_copy_opts->preallocate = true;
+                break;
+            case 'X':
+                mfu_copy_opts->count_extents = true;
+                break;
             case 'p':
                 mfu_copy_opts->preserve = true;
                 if(rank == 0) {
@@ -238,9 +445,29 @@ int main(int argc, char** argv)
                     MFU_LOG(MFU_LOG_INFO, "Using sparse file");
                 }
                 break;
+            case 'Z':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse stream batch size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    stream_items = (uint64_t)bytes;
+                }
+                break;
             case 'P':
                 mfu_progress_timeout = atoi(optarg);
                 break;
+            case 'T':
+                if (mfu_throttle_set(optarg) != 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse throttle schedule: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
             case 'v':
                 mfu_debug_level = MFU_LOG_VERBOSE;
                 break;
@@ -271,6 +498,33 @@ int main(int argc, char** argv)
         usage = 1;
     }
 
+    /* resuming needs the journal of the earlier run */
+    if (mfu_copy_opts->resume && mfu_copy_opts->journal == NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "--resume requires --journal");
+        }
+        usage = 1;
+    }
+
+    /* items from an input list are not found by walking */
+    if (stream_items > 0 && inputname != NULL) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "--stream cannot be used with --input");
+        }
+        usage = 1;
+    }
+
+    /* data moved by the kernel never passes through the asynchronous
+     * buffers, so --iodepth turns off the default offload, and only
+     * applies to data that falls back to read/write if both are given */
+    if (mfu_copy_opts->io_depth > 1 && mfu_copy_opts->offload != MFU_COPY_OFFLOAD_NONE) {
+        if (! offload_set) {
+            mfu_copy_opts->offload = MFU_COPY_OFFLOAD_NONE;
+        } else if (rank == 0) {
+            MFU_LOG(MFU_LOG_WARN, "--iodepth only applies to data that --offload cannot move");
+        }
+    }
+
     /* paths to walk come after the options */
     int numpaths = 0;
     int numpaths_src = 0;
@@ -328,26 +582,73 @@ int main(int argc, char** argv)
         return 1;
     }
 
+    /* check each additional target against the sources the same way */
+    int numdests = 1 + numfanout;
+    mfu_param_path* destpaths = (mfu_param_path*) MFU_MALLOC((size_t)numdests * sizeof(mfu_param_path));
+    int* into_dirs = (int*) MFU_MALLOC((size_t)numdests * sizeof(int));
+    destpaths[0] = *destpath;
+    into_dirs[0] = copy_into_dir;
+    if (numfanout > 0) {
+        mfu_param_path_set_all(numfanout, fanout, &destpaths[1]);
+    }
+    int d;
+    for (d = 1; d < numdests; d++) {
+        mfu_param_path_check_copy(numpaths_src, paths, &destpaths[d], &valid, &into_dirs[d]);
+        if (!valid) {
+            if(rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Invalid src/dest paths provided for `%s'. Exiting run.\n",
+                    destpaths[d].orig);
+            }
+            mfu_param_path_free_all(numfanout, &destpaths[1]);
+            mfu_free(&destpaths);
+            mfu_free(&into_dirs);
+            mfu_param_path_free_all(numpaths, paths);
+            mfu_free(&paths);
+            mfu_finalize();
+            MPI_Finalize();
+            return 1;
+        }
+    }
+
     /* create an empty file list */
     mfu_flist flist = mfu_flist_new();
 
-    if (inputname == NULL) {
-        mfu_flist_walk_param_paths(numpaths_src, paths, walk_opts, flist);
-    } else {
-        struct mfu_flist_skip_args skip_args;
+    /* note which items have xattrs, so we only copy those */
+    walk_opts->xattrs = mfu_copy_opts->preserve;
 
-        /* otherwise, read list of files from input, but then stat each one */
-        mfu_flist input_flist = mfu_flist_new();
-        mfu_flist_read_cache(inputname, input_flist);
+    int tmp_rc;
+    if (stream_items > 0) {
+        /* copy batches of items as the walk finds them */
+        mfu_throttle_start(MPI_COMM_WORLD);
+        tmp_rc = mfu_flist_copy_stream(numpaths_src, paths, walk_opts,
+            stream_items, numdests, destpaths, into_dirs, mfu_copy_opts, flist);
+        mfu_throttle_complete();
+    } else {
+        if (inputname == NULL) {
+            mfu_flist_walk_param_paths(numpaths_src, paths, walk_opts, flist);
+        } else {
+            struct mfu_flist_skip_args skip_args;
+
+            /* otherwise, read list of files from input, but then stat each one */
+            mfu_flist input_flist = mfu_flist_new();
+            mfu_flist_read_cache(inputname, input_flist);
+
+            skip_args.numpaths = numpaths_src;
+            skip_args.paths = paths;
+            mfu_flist_stat(input_flist, flist, input_flist_skip, (void *)&skip_args);
+            mfu_flist_free(&input_flist);
+        }
 
-        skip_args.numpaths = numpaths_src;
-        skip_args.paths = paths;
-        mfu_flist_stat(input_flist, flist, input_flist_skip, (void *)&skip_args);
-        mfu_flist_free(&input_flist);
+        /* copy flist into destination, holding to any rate limits */
+        mfu_throttle_start(MPI_COMM_WORLD);
+        if (numdests > 1) {
+            tmp_rc = mfu_flist_copy_multi(flist, numpaths_src, paths, numdests,
+                destpaths, into_dirs, mfu_copy_opts);
+        } else {
+            tmp_rc = mfu_flist_copy(flist, numpaths_src, paths, destpath, mfu_copy_opts);
+        }
+        mfu_throttle_complete();
     }
-
-    /* copy flist into destination */
-    int tmp_rc = mfu_flist_copy(flist, numpaths_src, paths, destpath, mfu_copy_opts);
     if (tmp_rc < 0) {
         /* hit some sort of error during copy */
         rc = 1;
@@ -356,7 +657,10 @@ int main(int argc, char** argv)
     /* free the file list */
     mfu_flist_free(&flist);
 
-    /* free the path parameters */
+    /* free the path parameters, the first destination is freed with paths */
+    mfu_param_path_free_all(numfanout, &destpaths[1]);
+    mfu_free(&destpaths);
+    mfu_free(&into_dirs);
     mfu_param_path_free_all(numpaths, paths);
 
     /* free memory allocated to hold params */
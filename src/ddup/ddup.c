@@ -294,7 +294,7 @@ int main(int argc, char** argv)
     mtcmp_cmp_init(&cmp);
 
     /* allocate buffer to read data from file */
-    char* chunk_buf = (char*)MFU_MALLOC(DDUP_CHUNK_SIZE);
+    char* chunk_buf = (char*)MFU_POOL_ALLOC(DDUP_CHUNK_SIZE, 0);
 
     /* allocate a file list */
     mfu_flist flist = mfu_flist_new();
@@ -368,6 +368,69 @@ int main(int argc, char** argv)
     MPI_Allreduce(&checking_files, &sum_checking_files, 1,
                   MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
 
+    /* most files that share a size already differ in their first
+     * chunk, so split groups by a CRC32C of that chunk before doing
+     * any SHA256 work, this drops those files after a cheap checksum,
+     * while files that remain read their first chunk again below */
+    if (sum_checking_files > 1) {
+        ptr = list;
+        for (i = 0; i < checking_files; i++) {
+            uint64_t idx = ptr[DDUP_KEY_SIZE];
+            const char* fname = mfu_flist_file_get_name(flist, idx);
+            file_size = mfu_flist_file_get_size(flist, idx);
+
+            /* read the first chunk of the file */
+            uint64_t data_size = 0;
+            status = read_data(fname, chunk_buf, 1,
+                               chunk_size, file_size, &data_size);
+            if (status) {
+                printf("failed to read file %s, maybe file "
+                       "size has been modified during the "
+                       "process", fname);
+            }
+
+            /* key on file size and checksum of first chunk */
+            ptr[1] = (uint64_t) mfu_buf_crc32c(0, chunk_buf, data_size);
+            ptr[2] = 0;
+            ptr[3] = 0;
+            ptr[4] = 0;
+
+            ptr += DDUP_KEY_SIZE + 1;
+        }
+
+        uint64_t groups;
+        DTCMP_Rankv(
+            (int)checking_files, list,
+            &groups, group_id, group_ranks, group_rank,
+            key, keysat, cmp, DTCMP_FLAG_NONE, MPI_COMM_WORLD
+        );
+
+        /* keep files that share a size and checksum with another file,
+         * the rest are unique */
+        new_checking_files = 0;
+        ptr = list;
+        uint64_t* new_ptr = new_list;
+        for (i = 0; i < checking_files; i++) {
+            if (group_ranks[i] > 1) {
+                new_ptr[0] = group_id[i];
+                new_ptr[DDUP_KEY_SIZE] = ptr[DDUP_KEY_SIZE];
+                new_checking_files++;
+                new_ptr += DDUP_KEY_SIZE + 1;
+            }
+            ptr += DDUP_KEY_SIZE + 1;
+        }
+
+        /* swap lists */
+        uint64_t* tmp_list = list;
+        list     = new_list;
+        new_list = tmp_list;
+
+        /* update size of current list */
+        checking_files = new_checking_files;
+        MPI_Allreduce(&checking_files, &sum_checking_files, 1,
+                      MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+    }
+
     uint64_t chunk_id = 0;
     while (sum_checking_files > 1) {
         /* update the chunk id we'll read from all files */
@@ -514,7 +577,7 @@ int main(int argc, char** argv)
     mfu_free(&new_list);
     mfu_free(&list);
     mfu_free(&file_items);
-    mfu_free(&chunk_buf);
+    mfu_pool_free(&chunk_buf);
     mfu_flist_free(&flist);
 
     mtcmp_cmp_fini(&cmp);
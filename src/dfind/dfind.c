@@ -488,8 +488,8 @@ int main (int argc, char** argv)
         mfu_flist_walk_param_paths(numpaths, paths, walk_opts, flist);
     }
     else {
-        /* read data from cache file */
-        mfu_flist_read_cache(inputname, flist);
+        /* map data from cache file, records are read on demand */
+        mfu_flist_read_cache_map(inputname, flist);
     }
 
     /* apply predicates to each item in list */
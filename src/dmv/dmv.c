@@ -0,0 +1,418 @@
+#include <stdio.h>
+#include <getopt.h>
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#include "mpi.h"
+#include "libcircle.h"
+#include "mfu.h"
+
+/* number of files to copy before removing their sources */
+#define DMV_BATCH_FILES (100000)
+
+/* what happened to each source path when renaming */
+#define DMV_COPY    (0)  /* must be copied */
+#define DMV_RENAMED (1)  /* renamed into place */
+#define DMV_FAILED  (-1) /* could not be moved */
+
+/* state of the callback that removes sources once they are copied */
+typedef struct {
+    uint64_t removed; /* number of source items removed */
+    uint64_t kept;    /* number of source items left in place */
+} dmv_remove_args;
+
+/** Print a usage message. */
+static void print_usage(void)
+{
+    printf("\n");
+    printf("Usage: dmv [options] source target\n");
+    printf("       dmv [options] source ... target_dir\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("  -b, --blocksize <N>   - IO buffer size in bytes (default 1MB)\n");
+    printf("      --batch-files <N> - copy and remove files in batches of N (default %d)\n", DMV_BATCH_FILES);
+    printf("  -k, --chunksize <N>   - work size per task in bytes (default 1MB)\n");
+    printf("  -s, --synchronous     - use direct I/O (O_DIRECT) for aligned data\n");
+    printf("      --progress <N>    - print progress every N seconds\n");
+    printf("  -v, --verbose         - verbose output\n");
+    printf("  -q, --quiet           - quiet output\n");
+    printf("  -h, --help            - print usage\n");
+    printf("For more information see https://mpifileutils.readthedocs.io.\n");
+    printf("\n");
+    fflush(stdout);
+}
+
+/* on rank 0, try to rename each source path to its destination when
+ * both are on the same device, and record in moved what happened */
+static void dmv_rename_paths(int numpaths, const mfu_param_path* paths,
+                             const mfu_param_path* destpath,
+                             mfu_copy_opts_t* copy_opts, int* moved)
+{
+    int i;
+    for (i = 0; i < numpaths; i++) {
+        moved[i] = DMV_COPY;
+
+        const char* src = paths[i].path;
+        char* dest = mfu_param_path_copy_dest(src, numpaths, paths, destpath, copy_opts);
+        if (dest == NULL) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to compute destination of `%s'", src);
+            moved[i] = DMV_FAILED;
+            continue;
+        }
+
+        /* compare the device of the source with that of the
+         * directory the destination will be created in */
+        mfu_path* parent = mfu_path_from_str(dest);
+        mfu_path_dirname(parent);
+        char* parent_str = mfu_path_strdup(parent);
+        mfu_path_delete(&parent);
+
+        struct stat src_st, parent_st;
+        if (mfu_lstat(src, &src_st) == 0 &&
+            stat(parent_str, &parent_st) == 0 &&
+            src_st.st_dev == parent_st.st_dev)
+        {
+            if (rename(src, dest) == 0) {
+                MFU_LOG(MFU_LOG_INFO, "Renamed `%s' to `%s'", src, dest);
+                moved[i] = DMV_RENAMED;
+            } else if (errno != EXDEV && errno != EEXIST && errno != ENOTEMPTY) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to rename `%s' to `%s' (errno=%d %s)",
+                    src, dest, errno, strerror(errno));
+                moved[i] = DMV_FAILED;
+            }
+
+            /* otherwise the destination is a directory with items in
+             * it or the file system refused, so copy into it instead */
+        }
+
+        mfu_free(&parent_str);
+        mfu_free(&dest);
+    }
+}
+
+/* called after each batch of items is copied, removes source items
+ * that the copy created, set the metadata of, and, for files, copied
+ * the data of without error on all processes, directories are left
+ * for later, but those that failed keep theirs in place */
+static void dmv_remove_copied(void* list, const int* failed, void* arg)
+{
+    dmv_remove_args* args = (dmv_remove_args*) arg;
+
+    uint64_t idx;
+    uint64_t size = mfu_flist_size(list);
+    for (idx = 0; idx < size; idx++) {
+        mfu_filetype type = mfu_flist_file_get_type(list, idx);
+        if (type == MFU_TYPE_DIR) {
+            if (failed[idx] != 0) {
+                args->kept++;
+            }
+            continue;
+        }
+
+        const char* name = mfu_flist_file_get_name(list, idx);
+
+        /* never take an item in the destination for our copy,
+         * it may have been there before */
+        int copied = (failed[idx] == 0);
+        if (! copied) {
+            args->kept++;
+            continue;
+        }
+
+        if (mfu_unlink(name) != 0) {
+            MFU_LOG(MFU_LOG_ERR, "Failed to unlink `%s' (errno=%d %s)",
+                name, errno, strerror(errno));
+            args->kept++;
+            continue;
+        }
+        args->removed++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    /* assume we'll exit with success */
+    int rc = 0;
+
+    /* initialize MPI */
+    MPI_Init(&argc, &argv);
+    mfu_init();
+
+    /* get our rank */
+    int rank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+
+    /* pointer to mfu_copy opts */
+    mfu_copy_opts_t* mfu_copy_opts = mfu_copy_opts_new();
+
+    /* pointer to mfu_walk_opts */
+    mfu_walk_opts_t* walk_opts = mfu_walk_opts_new();
+
+    /* a move keeps everything about an item */
+    mfu_copy_opts->preserve    = true;
+    mfu_copy_opts->batch_files = DMV_BATCH_FILES;
+    walk_opts->xattrs = 1;
+
+    /* By default, show info log messages. */
+    mfu_debug_level = MFU_LOG_VERBOSE;
+
+    int option_index = 0;
+    static struct option long_options[] = {
+        {"blocksize"            , required_argument, 0, 'b'},
+        {"batch-files"          , required_argument, 0, 'B'},
+        {"chunksize"            , required_argument, 0, 'k'},
+        {"synchronous"          , no_argument      , 0, 's'},
+        {"progress"             , required_argument, 0, 'P'},
+        {"verbose"              , no_argument      , 0, 'v'},
+        {"quiet"                , no_argument      , 0, 'q'},
+        {"help"                 , no_argument      , 0, 'h'},
+        {0                      , 0                , 0, 0  }
+    };
+
+    /* Parse options */
+    unsigned long long bytes = 0;
+    int usage = 0;
+    while(1) {
+        int c = getopt_long(
+                    argc, argv, "b:k:svqh",
+                    long_options, &option_index
+                );
+
+        if (c == -1) {
+            break;
+        }
+
+        switch(c) {
+            case 'b':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse block size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->block_size = (size_t)bytes;
+                }
+                break;
+            case 'B':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse batch files: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->batch_files = (uint64_t)bytes;
+                }
+                break;
+            case 'k':
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR,
+                                "Failed to parse chunk size: '%s'", optarg);
+                    }
+                    usage = 1;
+                } else {
+                    mfu_copy_opts->chunk_size = bytes;
+                }
+                break;
+            case 's':
+                mfu_copy_opts->synchronous = true;
+                if(rank == 0) {
+                    MFU_LOG(MFU_LOG_INFO, "Using synchronous read/write (O_DIRECT)");
+                }
+                break;
+            case 'P':
+                mfu_progress_timeout = atoi(optarg);
+                break;
+            case 'v':
+                mfu_debug_level = MFU_LOG_VERBOSE;
+                break;
+            case 'q':
+                mfu_debug_level = MFU_LOG_NONE;
+                /* since process won't be printed in quiet anyway,
+                 * disable the algorithm to save some overhead */
+                mfu_progress_timeout = 0;
+                break;
+            case 'h':
+                usage = 1;
+                break;
+            case '?':
+                usage = 1;
+                break;
+            default:
+                if(rank == 0) {
+                    printf("?? getopt returned character code 0%o ??\n", c);
+                }
+        }
+    }
+
+    /* check that we got a valid progress value */
+    if (mfu_progress_timeout < 0) {
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Seconds in --progress must be non-negative: %d invalid", mfu_progress_timeout);
+        }
+        usage = 1;
+    }
+
+    /* paths to move come after the options */
+    int numpaths = 0;
+    int numpaths_src = 0;
+    mfu_param_path* paths = NULL;
+    if (optind < argc) {
+        /* determine number of paths specified by user */
+        numpaths = argc - optind;
+
+        /* allocate space for each path */
+        paths = (mfu_param_path*) MFU_MALLOC((size_t)numpaths * sizeof(mfu_param_path));
+
+        /* process each path */
+        const char** argpaths = (const char**)(&argv[optind]);
+        mfu_param_path_set_all(numpaths, argpaths, paths);
+
+        /* advance to next set of options */
+        optind += numpaths;
+
+        /* the last path is the destination path, all others are source paths */
+        numpaths_src = numpaths - 1;
+    }
+
+    if (usage || numpaths_src == 0) {
+        if(rank == 0) {
+            if (usage != 1) {
+                MFU_LOG(MFU_LOG_ERR, "A source and destination path is needed");
+            } else {
+                print_usage();
+            }
+        }
+
+        mfu_param_path_free_all(numpaths, paths);
+        mfu_free(&paths);
+        mfu_copy_opts_delete(&mfu_copy_opts);
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_finalize();
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* last item in the list is the destination path */
+    const mfu_param_path* destpath = &paths[numpaths - 1];
+
+    /* Parse the source and destination paths. */
+    int valid, copy_into_dir;
+    mfu_param_path_check_copy(numpaths_src, paths, destpath, &valid, &copy_into_dir);
+    mfu_copy_opts->copy_into_dir = copy_into_dir;
+
+    /* exit job if we found a problem */
+    if (!valid) {
+        if(rank == 0) {
+            MFU_LOG(MFU_LOG_ERR, "Invalid src/dest paths provided. Exiting run.\n");
+        }
+        mfu_param_path_free_all(numpaths, paths);
+        mfu_free(&paths);
+        mfu_copy_opts_delete(&mfu_copy_opts);
+        mfu_walk_opts_delete(&walk_opts);
+        mfu_finalize();
+        MPI_Finalize();
+        return 1;
+    }
+
+    /* rename sources that are on the same file system as their
+     * destination, which moves a whole tree in one step */
+    int* moved = (int*) MFU_MALLOC((size_t)numpaths_src * sizeof(int));
+    if (rank == 0) {
+        dmv_rename_paths(numpaths_src, paths, destpath, mfu_copy_opts, moved);
+    }
+    MPI_Bcast(moved, numpaths_src, MPI_INT, 0, MPI_COMM_WORLD);
+
+    /* gather the sources we still have to copy, these
+     * share their fields with the full array */
+    int numcopy = 0;
+    mfu_param_path* copypaths = (mfu_param_path*) MFU_MALLOC((size_t)numpaths_src * sizeof(mfu_param_path));
+    int i;
+    for (i = 0; i < numpaths_src; i++) {
+        if (moved[i] == DMV_COPY) {
+            copypaths[numcopy] = paths[i];
+            numcopy++;
+        } else if (moved[i] == DMV_FAILED) {
+            rc = 1;
+        }
+    }
+
+    if (numcopy > 0) {
+        /* walk the sources we have to copy */
+        mfu_flist flist = mfu_flist_new();
+        mfu_flist_walk_param_paths(numcopy, copypaths, walk_opts, flist);
+
+        /* copy in batches, removing the sources of each batch
+         * once its data and metadata are in place, so that we need
+         * space for at most a batch of files beyond the source */
+        dmv_remove_args args;
+        args.removed = 0;
+        args.kept    = 0;
+        mfu_copy_opts->copied_fn  = dmv_remove_copied;
+        mfu_copy_opts->copied_arg = &args;
+
+        int copy_rc = mfu_flist_copy(flist, numcopy, copypaths, destpath, mfu_copy_opts);
+
+        /* count the source items we removed and left in place */
+        uint64_t counts[2], totals[2];
+        counts[0] = args.removed;
+        counts[1] = args.kept;
+        MPI_Allreduce(counts, totals, 2, MPI_UINT64_T, MPI_SUM, MPI_COMM_WORLD);
+        if (rank == 0) {
+            MFU_LOG(MFU_LOG_INFO, "Removed %" PRIu64 " source items after copy", totals[0]);
+        }
+
+        if (copy_rc < 0 || totals[1] > 0) {
+            /* some items were not moved, so keep their directories */
+            if (rank == 0) {
+                MFU_LOG(MFU_LOG_ERR, "Failed to move %" PRIu64 " items, "
+                    "leaving them and source directories in place", totals[1]);
+            }
+            rc = 1;
+        } else {
+            /* remove the source directories, which are now empty */
+            mfu_flist dirs = mfu_flist_subset(flist);
+            uint64_t idx;
+            uint64_t size = mfu_flist_size(flist);
+            for (idx = 0; idx < size; idx++) {
+                if (mfu_flist_file_get_type(flist, idx) == MFU_TYPE_DIR) {
+                    mfu_flist_file_copy(flist, idx, dirs);
+                }
+            }
+            mfu_flist_summarize(dirs);
+            mfu_flist_unlink(dirs, false);
+            mfu_flist_free(&dirs);
+        }
+
+        mfu_flist_free(&flist);
+    }
+
+    mfu_free(&copypaths);
+    mfu_free(&moved);
+
+    /* free the path parameters */
+    mfu_param_path_free_all(numpaths, paths);
+
+    /* free memory allocated to hold params */
+    mfu_free(&paths);
+
+    /* free the copy options */
+    mfu_copy_opts_delete(&mfu_copy_opts);
+
+    /* free the walk options */
+    mfu_walk_opts_delete(&walk_opts);
+
+    /* shut down MPI */
+    mfu_finalize();
+    MPI_Finalize();
+
+    return rc;
+}
@@ -1859,8 +1859,8 @@ int main(int argc, char** argv)
         mfu_flist_walk_param_paths(numpaths, paths, walk_opts, flist);
     }
     else {
-        /* read list from file */
-        mfu_flist_read_cache(inputname, flist);
+        /* map list from file, records are read on demand */
+        mfu_flist_read_cache_map(inputname, flist);
     }
 
     /* start process from the root directory */
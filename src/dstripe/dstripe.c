@@ -101,7 +101,10 @@ static void print_usage(void)
     printf("  -s, --size <SIZE>      - stripe size in bytes (default 1MB)\n");
     printf("  -m, --minsize <SIZE>   - minimum file size (default 0MB)\n");
     printf("  -r, --report           - display file size and stripe info\n");
+    printf("      --pagecache <MODE> - page cache use: keep, drop (default keep)\n");
     printf("      --progress <N>     - print progress every N seconds\n");
+    printf("      --throttle <SPEC>  - limit bytes/sec and metadata ops/sec, e.g. 500MB/200,20:00-06:00=0\n");
+    printf("      --writebehind <SIZE> - with --pagecache drop, bytes to write before starting writeback (default 8MB)\n");
     printf("  -v, --verbose          - verbose output\n");
     printf("  -q, --quiet            - quiet output\n");
     printf("  -h, --help             - print usage\n");
@@ -246,8 +249,11 @@ static mfu_flist filter_list(mfu_flist list, int stripe_count, uint64_t stripe_s
     return filtered;
 }
 
-/* write a chunk of the file */
-static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
+/* write a chunk of the file, files are left open in cache
+ * since we often write several chunks of the same file,
+ * if wb is not NULL, written data is dropped from the page cache */
+static void write_file_chunk(mfu_file_chunk* p, const char* out_path, mfu_fdcache* cache,
+    mfu_writebehind* wb)
 {
     size_t chunk_size = 1024*1024;
     uint64_t base = (off_t)p->offset;
@@ -262,21 +268,28 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
     }
 
     /* allocate buffer */
-    void* buf = MFU_MALLOC(chunk_size);
+    void* buf = MFU_POOL_ALLOC(chunk_size, 0);
 
     /* open input file for reading */
-    int in_fd = mfu_open(in_path, O_RDONLY);
-    if (in_fd < 0) {
+    mfu_fdcache_entry* in_file = mfu_fdcache_open(cache, in_path, O_RDONLY, 0);
+    if (in_file == NULL) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open input file %s (%s)", in_path, strerror(errno));
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    int in_fd = in_file->fd;
 
     /* open output file for writing */
-    int out_fd = mfu_open(out_path, O_WRONLY);
-    if (out_fd < 0) {
+    mfu_fdcache_entry* out_file = mfu_fdcache_open(cache, out_path, O_WRONLY, 0);
+    if (out_file == NULL) {
         MFU_LOG(MFU_LOG_ERR, "Failed to open output file %s (%s)", out_path, strerror(errno));
         MPI_Abort(MPI_COMM_WORLD, 1);
     }
+    int out_fd = out_file->fd;
+
+    /* hint that we'll read the stripe sequentially */
+    if (wb != NULL) {
+        posix_fadvise(in_fd, (off_t) base, (off_t) stripe_size, POSIX_FADV_SEQUENTIAL);
+    }
 
     /* write data */
     uint64_t chunk_id = 0;
@@ -322,7 +335,9 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
 
-        /* read chunk from input */
+        /* read chunk from input, counting the read and the
+         * write against any bandwidth limit */
+        mfu_throttle_charge(2 * (uint64_t) read_size, 0);
         ssize_t nread = mfu_read(in_path, in_fd, buf, read_size);
 
         /* check for errors */
@@ -359,6 +374,11 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
             MPI_Abort(MPI_COMM_WORLD, 1);
         }
 
+        /* start writeback and drop data we copied earlier */
+        if (wb != NULL) {
+            mfu_writebehind_add(wb, out_path, in_fd, out_fd, offset, (uint64_t) read_size);
+        }
+
         /* update our byte count for progress messages */
         stripe_prog_bytes += read_size;
         mfu_progress_update(&stripe_prog_bytes, stripe_prog);
@@ -372,13 +392,8 @@ static void write_file_chunk(mfu_file_chunk* p, const char* out_path)
         chunk_id++;
     }
 
-    /* close files */
-    mfu_fsync(out_path, out_fd);
-    mfu_close(out_path, out_fd);
-    mfu_close(in_path, in_fd);
-
-    /* free buffer */
-    mfu_free(&buf);
+    /* return buffer to the pool for the next chunk */
+    mfu_pool_free(&buf);
 }
 
 int main(int argc, char* argv[])
@@ -410,12 +425,19 @@ int main(int argc, char* argv[])
     uint64_t stripe_size = 1048576;
     uint64_t min_size = 0;
 
+    /* leave the page cache to the kernel by default */
+    int drop_cache = 0;
+    uint64_t writebehind = 8 * 1024 * 1024;
+
     static struct option long_options[] = {
         {"count",    1, 0, 'c'},
         {"size",     1, 0, 's'},
         {"minsize",  1, 0, 'm'},
         {"report",   0, 0, 'r'},
+        {"pagecache", 1, 0, 'C'},
         {"progress", 1, 0, 'P'},
+        {"throttle", 1, 0, 'T'},
+        {"writebehind", 1, 0, 'W'},
         {"verbose",  0, 0, 'v'},
         {"quiet",    0, 0, 'q'},
         {"help",     0, 0, 'h'},
@@ -459,9 +481,40 @@ int main(int argc, char* argv[])
                 /* report striping info */
 		report = 1;
                 break;
+            case 'C':
+                /* page cache mode */
+                if (strcmp(optarg, "keep") == 0) {
+                    drop_cache = 0;
+                } else if (strcmp(optarg, "drop") == 0) {
+                    drop_cache = 1;
+                } else {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Unknown page cache mode: %s", optarg);
+                    }
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                break;
+            case 'W':
+                /* write-behind window in bytes */
+                if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to parse write-behind size: %s", optarg);
+                    }
+                    MPI_Abort(MPI_COMM_WORLD, 1);
+                }
+                writebehind = (uint64_t)bytes;
+                break;
             case 'P':
                 mfu_progress_timeout = atoi(optarg);
                 break;
+            case 'T':
+                if (mfu_throttle_set(optarg) != 0) {
+                    if (rank == 0) {
+                        MFU_LOG(MFU_LOG_ERR, "Failed to parse throttle schedule: '%s'", optarg);
+                    }
+                    usage = 1;
+                }
+                break;
             case 'v':
                 mfu_debug_level = MFU_LOG_VERBOSE;
                 break;
@@ -609,6 +662,9 @@ int main(int argc, char* argv[])
         MPI_Allreduce(&attempt, &retry, 1, MPI_UINT64_T, MPI_MAX, MPI_COMM_WORLD);
     } while(retry != 0);
 
+    /* hold creates, data, and renames to any rate limits */
+    mfu_throttle_start(MPI_COMM_WORLD);
+
     /* initialize progress messages while creating files */
     create_prog_count = 0;
     create_prog = mfu_progress_start(mfu_progress_timeout, 1, MPI_COMM_WORLD, create_progress_fn);
@@ -621,6 +677,7 @@ int main(int argc, char* argv[])
         strcat(temp_path, suffix);
 
         /* create a striped file at the temp file path */
+        mfu_throttle_charge(0, 1);
         mfu_stripe_set(temp_path, stripe_size, stripes);
 
         /* update our status for file create progress */
@@ -640,6 +697,9 @@ int main(int argc, char* argv[])
     /* found a suffix, now we need to break our files into chunks based on stripe size */
     mfu_file_chunk* file_chunks = mfu_file_chunk_list_alloc(filtered, stripe_size);
     mfu_file_chunk* p = file_chunks;
+    mfu_fdcache* fdcache = mfu_fdcache_new(16, 1);
+    mfu_writebehind wb;
+    mfu_writebehind_init(&wb, writebehind);
     while (p != NULL) {
         /* build path to temp file */
         char temp_path[PATH_MAX];
@@ -647,13 +707,19 @@ int main(int argc, char* argv[])
         strcat(temp_path, suffix);
 
         /* write each chunk in our list */
-        write_file_chunk(p, temp_path);
+        write_file_chunk(p, temp_path, fdcache, drop_cache ? &wb : NULL);
 
         /* move on to next file chunk */
         p = p->next;
     }
     mfu_file_chunk_list_free(&file_chunks);
 
+    /* write out and drop the last of our data from the page cache */
+    mfu_writebehind_finish(&wb);
+
+    /* sync and close files we still have open */
+    mfu_fdcache_delete(&fdcache);
+
     /* finalize progress messages */
     mfu_progress_complete(&stripe_prog_bytes, &stripe_prog);
 
@@ -668,6 +734,7 @@ int main(int argc, char* argv[])
         strcat(out_path, suffix);
 
         /* change the mode of the newly restriped file to be the same as the old one */
+        mfu_throttle_charge(0, 2);
         mode_t mode = (mode_t) mfu_flist_file_get_mode(filtered, idx);
         if (mfu_chmod(out_path, mode) != 0) {
             MFU_LOG(MFU_LOG_ERR, "Failed to chmod file %s (%s)", out_path, strerror(errno));
@@ -682,6 +749,7 @@ int main(int argc, char* argv[])
     }
 
     /* wait for everyone to finish */
+    mfu_throttle_complete();
     MPI_Barrier(MPI_COMM_WORLD);
 
     /* free the walk options */
@@ -53,8 +53,12 @@ static void print_usage(void)
     printf("  -c, --contents        - read and compare file contents rather than compare size and mtime\n");
     printf("  -D, --delete          - delete extraneous files from target\n");
     printf("      --link-dest <DIR> - hardlink to files in DIR when unchanged\n");
+    printf("      --pagecache <mode> - page cache use: keep, drop (default keep)\n");
     printf("  -S, --sparse          - create sparse files when possible\n");
     printf("      --progress <N>    - print progress every N seconds\n");
+    printf("      --throttle <spec> - limit bytes/sec and metadata ops/sec, e.g. 500MB/200,20:00-06:00=0\n");
+    printf("      --wavefront       - handle each directory once its parent or subdirectories are done, not by level\n");
+    printf("      --writebehind <N> - with --pagecache drop, bytes to write before starting writeback (default 8MB)\n");
     printf("  -v, --verbose         - verbose output\n");
     printf("  -q, --quiet           - quiet output\n");
     printf("  -h, --help            - print usage\n");
@@ -503,11 +507,19 @@ static void dsync_compare_acl(
     strmap* dst_map,
     int *diff)
 {
-    void *src_val, *dst_val;
+    void *src_val = NULL, *dst_val = NULL;
     ssize_t src_size, dst_size;
     bool is_same = true;
 
 #if DCOPY_USE_XATTRS
+    /* ACLs are xattrs, so if the walks found no xattrs
+     * on either item, they have the same (empty) ACLs */
+    if (mfu_flist_file_get_xattrs(src_list, src_index) == 0 &&
+        mfu_flist_file_get_xattrs(dst_list, dst_index) == 0)
+    {
+        goto out;
+    }
+
     src_val = mfu_flist_file_get_acl(src_list, src_index, &src_size,
                                      "system.posix_acl_access");
     dst_val = mfu_flist_file_get_acl(dst_list, dst_index, &dst_size,
@@ -712,6 +724,9 @@ static void dsync_strmap_compare_data_link_dest(
     count_bytes[1] = *count_bytes_written;
     mfu_progress* compare_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
+    /* keep files open across chunks to avoid reopening them for each one */
+    mfu_fdcache* fdcache = mfu_fdcache_new(16, 0);
+
     /* compare bytes for each file section and set flag based on what we find */
     uint64_t i = 0;
     const mfu_file_chunk* src_p = src_head;
@@ -724,8 +739,8 @@ static void dsync_strmap_compare_data_link_dest(
         off_t length = (off_t)src_p->length;
         
         /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog);
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length,
+                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog, fdcache);
         if (compare_rc == -1) {
             /* we hit an error while reading */
             rc = -1;
@@ -746,6 +761,9 @@ static void dsync_strmap_compare_data_link_dest(
         dst_p = dst_p->next;
     }
 
+    /* close any files we still have open */
+    mfu_fdcache_delete(&fdcache);
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -827,6 +845,9 @@ static int dsync_strmap_compare_data(
     count_bytes[1] = *count_bytes_written;
     mfu_progress* compare_prog = mfu_progress_start(mfu_progress_timeout, 2, MPI_COMM_WORLD, compare_progress_fn);
 
+    /* keep files open across chunks to avoid reopening them for each one */
+    mfu_fdcache* fdcache = mfu_fdcache_new(16, 0);
+
     /* compare bytes for each file section and set flag based on what we find */
     uint64_t i = 0;
     const mfu_file_chunk* src_p = src_head;
@@ -839,8 +860,8 @@ static int dsync_strmap_compare_data(
         off_t length = (off_t)src_p->length;
 
         /* compare the contents of the files */
-        int compare_rc = mfu_compare_contents(src_p->name, dst_p->name, offset, length,
-                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog);
+        int compare_rc = mfu_compare_contents_cached(src_p->name, dst_p->name, offset, length,
+                1048576, overwrite, count_bytes_read, count_bytes_written, compare_prog, fdcache);
         if (compare_rc == -1) {
             /* we hit an error while reading */
             rc = -1;
@@ -861,6 +882,9 @@ static int dsync_strmap_compare_data(
         dst_p = dst_p->next;
     }
 
+    /* close any files we still have open */
+    mfu_fdcache_delete(&fdcache);
+
     /* finalize progress messages */
     count_bytes[0] = *count_bytes_read;
     count_bytes[1] = *count_bytes_written;
@@ -2815,8 +2839,12 @@ int main(int argc, char **argv)
         {"output",        1, 0, 'o'}, // undocumented
         {"debug",         0, 0, 'd'}, // undocumented
         {"link-dest",     1, 0, 'l'},
+        {"pagecache",     1, 0, 'C'},
         {"sparse",        0, 0, 'S'},
         {"progress",      1, 0, 'P'},
+        {"throttle",      1, 0, 'T'},
+        {"wavefront",     0, 0, 'V'},
+        {"writebehind",   1, 0, 'W'},
         {"verbose",       0, 0, 'v'},
         {"quiet",         0, 0, 'q'},
         {"help",          0, 0, 'h'},
@@ -2870,9 +2898,44 @@ int main(int argc, char **argv)
         case 'S':
             mfu_copy_opts->sparse = 1;
             break;
+        case 'C':
+            if (strcmp(optarg, "keep") == 0) {
+                mfu_copy_opts->pagecache = MFU_COPY_PAGECACHE_KEEP;
+            } else if (strcmp(optarg, "drop") == 0) {
+                mfu_copy_opts->pagecache = MFU_COPY_PAGECACHE_DROP;
+            } else {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Unknown page cache mode: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
+        case 'W': {
+            unsigned long long bytes;
+            if (mfu_abtoull(optarg, &bytes) != MFU_SUCCESS || bytes == 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse write-behind size: '%s'", optarg);
+                }
+                usage = 1;
+            } else {
+                mfu_copy_opts->writebehind = (uint64_t) bytes;
+            }
+            break;
+        }
         case 'P':
             mfu_progress_timeout = atoi(optarg);
             break;
+        case 'T':
+            if (mfu_throttle_set(optarg) != 0) {
+                if (rank == 0) {
+                    MFU_LOG(MFU_LOG_ERR, "Failed to parse throttle schedule: '%s'", optarg);
+                }
+                usage = 1;
+            }
+            break;
+        case 'V':
+            mfu_copy_opts->wavefront = true;
+            break;
         case 'v':
             options.verbose++;
             mfu_debug_level = MFU_LOG_VERBOSE;
@@ -2989,6 +3052,9 @@ int main(int argc, char **argv)
     if (rank == 0) {
         MFU_LOG(MFU_LOG_INFO, "Walking source path");
     }
+    /* note which items have xattrs only when comparing ACLs, copied
+     * items whose xattrs are unknown are still checked */
+    walk_opts->xattrs = dsync_option_need_compare(DCMPF_ACL);
     mfu_flist_walk_param_paths(1, srcpath, walk_opts, flist_tmp_src);
 
     /* check that we actually got something so that we don't delete
@@ -3016,6 +3082,7 @@ int main(int argc, char **argv)
     if (rank == 0) {
         MFU_LOG(MFU_LOG_INFO, "Walking destination path");
     }
+    walk_opts->xattrs = dsync_option_need_compare(DCMPF_ACL);
     mfu_flist_walk_param_paths(1, destpath, walk_opts, flist_tmp_dst);
 
     /* walk link-dest path if we have one */
@@ -3059,12 +3126,15 @@ int main(int argc, char **argv)
         map_link = dsync_strmap_creat(flist_link, path_link);
     }
 
-    /* compare files in map_src with those in map_dst */
+    /* compare files in map_src with those in map_dst,
+     * holding comparisons and copies to any rate limits */
+    mfu_throttle_start(MPI_COMM_WORLD);
     int tmp_rc = dsync_strmap_compare(flist_src, map_src, flist_dst, map_dst, flist_link, map_link,
         strlen(path_src), mfu_copy_opts, srcpath, destpath, linkpath);
     if (tmp_rc < 0) {
         rc = 1;
     }
+    mfu_throttle_complete();
 
     /* free maps of file names to comparison state info */
     strmap_delete(&map_src);
@@ -305,6 +305,7 @@ static void print_usage(void)
     printf("  -o, --output <file>     - write processed list to file in binary format\n");
     printf("  -t, --text              - use with -o; write processed list to file in ascii format\n");
     printf("  -l, --lite              - walk file system without stat\n");
+    printf("      --xattrs            - record which items have extended attributes\n");
     printf("  -s, --sort <fields>     - sort output by comma-delimited fields\n");
     printf("  -d, --distribution <field>:<separators> \n                          - print distribution by field\n");
     printf("  -f, --file_histogram    - print default size distribution of items\n");
@@ -368,6 +369,7 @@ int main(int argc, char** argv)
         {"output",         1, 0, 'o'},
         {"text",           0, 0, 't'},
         {"lite",           0, 0, 'l'},
+        {"xattrs",         0, 0, 'X'},
         {"sort",           1, 0, 's'},
         {"distribution",   1, 0, 'd'},
         {"file_histogram", 0, 0, 'f'},
@@ -400,6 +402,10 @@ int main(int argc, char** argv)
                 /* don't stat each file on the walk */
                 walk_opts->use_stat = 0;
                 break;
+            case 'X':
+                /* note which items have xattrs on the walk */
+                walk_opts->xattrs = 1;
+                break;
             case 's':
                 sortfields = MFU_STRDUP(optarg);
                 break;
@@ -564,8 +570,8 @@ int main(int argc, char** argv)
         mfu_flist_walk_param_paths(numpaths, paths, walk_opts, flist);
     }
     else {
-        /* read data from cache file */
-        mfu_flist_read_cache(inputname, flist);
+        /* map data from cache file, records are read on demand */
+        mfu_flist_read_cache_map(inputname, flist);
     }
 
     /* TODO: filter files */
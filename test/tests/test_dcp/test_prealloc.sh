@@ -0,0 +1,81 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Copy a large file and a sparse file with many processes and small
+#   chunks, with and without --preallocate, and print the copy rate and
+#   the number of extents in the destination files for each run.
+#   The last run also writes a second copy with --fanout.
+#
+#   Usage: test_prealloc.sh dcp_bin mpirun_bin src_dir dest_dir [size_in_MB]
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DCP_TEST_BIN=${DCP_TEST_BIN:-${1}}
+DCP_MPIRUN_BIN=${DCP_MPIRUN_BIN:-${2}}
+DCP_SRC_DIR=${DCP_SRC_DIR:-${3}}
+DCP_DEST_DIR=${DCP_DEST_DIR:-${4}}
+DCP_SIZE_MB=${DCP_SIZE_MB:-${5:-1024}}
+DCP_NP=${DCP_NP:-8}
+
+echo "Using dcp binary at: $DCP_TEST_BIN"
+echo "Using mpirun binary at: $DCP_MPIRUN_BIN"
+echo "Using src directory at: $DCP_SRC_DIR"
+echo "Using dest directory at: $DCP_DEST_DIR"
+
+SRC=$DCP_SRC_DIR/prealloc_src
+DEST=$DCP_DEST_DIR/prealloc_dest
+DEST2=$DCP_DEST_DIR/prealloc_dest2
+
+rm -rf $SRC $DEST $DEST2
+mkdir -p $SRC
+
+# one dense file, and one file with data between holes
+dd if=/dev/urandom of=$SRC/dense bs=1M count=$DCP_SIZE_MB 2> /dev/null
+for i in 0 4 8 12; do
+	dd if=/dev/urandom of=$SRC/sparse bs=1M seek=$((i * 16)) count=4 conv=notrunc 2> /dev/null
+done
+truncate -s $((DCP_SIZE_MB / 4))M $SRC/sparse
+
+function run_copy {
+	rm -rf $DEST $DEST2
+	sync
+	echo "dcp $@"
+	$DCP_MPIRUN_BIN -np $DCP_NP $DCP_TEST_BIN --chunksize 1MB --count-extents "$@" $SRC $DEST \
+		| grep -E "Rate:|Preallocated:|Destination extents:"
+	if [[ ${PIPESTATUS[0]} -ne 0 ]]; then
+		echo "Failed to run dcp $@"
+		rm -rf $SRC $DEST $DEST2
+		exit 1
+	fi
+
+	cmp $SRC/dense $DEST/dense && cmp $SRC/sparse $DEST/sparse
+	if [[ $? -ne 0 ]]; then
+		echo "Data mismatch after dcp $@"
+		rm -rf $SRC $DEST $DEST2
+		exit 1
+	fi
+	if [[ -e $DEST2 ]]; then
+		cmp $SRC/dense $DEST2/dense && cmp $SRC/sparse $DEST2/sparse
+		if [[ $? -ne 0 ]]; then
+			echo "Data mismatch in second destination after dcp $@"
+			rm -rf $SRC $DEST $DEST2
+			exit 1
+		fi
+	fi
+	du -k $DEST/sparse
+}
+
+run_copy
+run_copy --preallocate
+run_copy --sparse
+run_copy --sparse --preallocate
+run_copy --sparse --fanout $DEST2
+
+rm -rf $SRC $DEST $DEST2
+
+exit 0
@@ -0,0 +1,60 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Move a directory holding a symlink and a regular file onto a target
+#   where a regular file is already in the way of the link.  dmv must
+#   leave the source link in place, leave the file in the target as it
+#   was, move the regular file, and exit with an error.
+#
+#   Usage: test_link_collision.sh dmv_bin mpirun_bin tmp_dir
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+DMV_TEST_BIN=${DMV_TEST_BIN:-${1}}
+DMV_MPIRUN_BIN=${DMV_MPIRUN_BIN:-${2}}
+DMV_TMP_DIR=${DMV_TMP_DIR:-${3}}
+DMV_NP=${DMV_NP:-4}
+
+echo "Using dmv binary at: $DMV_TEST_BIN"
+echo "Using mpirun binary at: $DMV_MPIRUN_BIN"
+echo "Using tmp directory at: $DMV_TMP_DIR"
+
+SRC=$DMV_TMP_DIR/link_collision_src
+DEST=$DMV_TMP_DIR/link_collision_dest
+
+function fail {
+	echo "$@"
+	rm -rf $SRC $DEST
+	exit 1
+}
+
+rm -rf $SRC $DEST
+mkdir -p $SRC/a $DEST/a
+
+ln -s /some/target $SRC/a/l
+echo "source file" > $SRC/a/f
+echo "already here" > $DEST/a/l
+
+$DMV_MPIRUN_BIN -np $DMV_NP $DMV_TEST_BIN $SRC/a $DEST
+if [[ $? -eq 0 ]]; then
+	fail "dmv succeeded although a link could not be moved"
+fi
+
+if [[ ! -L $SRC/a/l || $(readlink $SRC/a/l) != "/some/target" ]]; then
+	fail "Source link was removed"
+fi
+if [[ -L $DEST/a/l || $(cat $DEST/a/l) != "already here" ]]; then
+	fail "Item in the way of the link was changed"
+fi
+if [[ -e $SRC/a/f || $(cat $DEST/a/f) != "source file" ]]; then
+	fail "Regular file was not moved"
+fi
+
+rm -rf $SRC $DEST
+
+exit 0
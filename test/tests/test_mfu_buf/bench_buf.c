@@ -0,0 +1,248 @@
+/*
+ * Check the buffer kernels in src/common/mfu_buf.c against simple
+ * byte loops for every implementation this CPU supports, and time
+ * each one on a large buffer.
+ *
+ * Build from the top of the source tree with:
+ *   cc -O2 -Isrc/common src/common/mfu_buf.c \
+ *      test/tests/test_mfu_buf/bench_buf.c -o bench_buf
+ *
+ * Usage: bench_buf [--check] [size_in_MB]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mfu_buf.h"
+
+static const char* impls[] = {"portable", "sse2", "avx2", "avx512"};
+#define NUM_IMPLS (sizeof(impls) / sizeof(impls[0]))
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1.0e-9;
+}
+
+static int ref_is_zero(const unsigned char* buf, size_t size)
+{
+    size_t i;
+    for (i = 0; i < size; i++) {
+        if (buf[i] != 0) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static size_t ref_diff(const unsigned char* a, const unsigned char* b, size_t size)
+{
+    size_t i = 0;
+    while (i < size && a[i] == b[i]) {
+        i++;
+    }
+    return i;
+}
+
+/* compare kernels to reference loops over many sizes and alignments,
+ * returns number of failures */
+static int check(const char* impl)
+{
+    int failures = 0;
+
+    size_t max = 1024;
+    unsigned char* a = malloc(max + 64);
+    unsigned char* b = malloc(max + 64);
+
+    /* CRC32C of "123456789" is a standard check value */
+    uint32_t crc = mfu_buf_crc32c(0, "123456789", 9);
+    if (crc != 0xE3069283) {
+        printf("%s: crc32c check value %08x, expected e3069283\n", impl, crc);
+        failures++;
+    }
+
+    size_t align, size;
+    for (align = 0; align < 64; align += 7) {
+        for (size = 0; size <= max; size += (size < 300) ? 1 : 61) {
+            unsigned char* pa = a + align;
+            unsigned char* pb = b + align;
+
+            /* all zero, then a single nonzero byte at each of a few spots */
+            memset(pa, 0, size);
+            if (mfu_buf_is_zero(pa, size) != 1) {
+                printf("%s: is_zero failed on zero buffer size=%zu align=%zu\n", impl, size, align);
+                failures++;
+            }
+            size_t spots[3] = {0, size / 2, size - 1};
+            int s;
+            for (s = 0; s < 3 && size > 0; s++) {
+                memset(pa, 0, size);
+                pa[spots[s]] = 0x80;
+                if (mfu_buf_is_zero(pa, size) != ref_is_zero(pa, size)) {
+                    printf("%s: is_zero failed size=%zu align=%zu pos=%zu\n", impl, size, align, spots[s]);
+                    failures++;
+                }
+            }
+
+            /* equal buffers, then a difference at each of a few spots */
+            size_t i;
+            for (i = 0; i < size; i++) {
+                pa[i] = (unsigned char) rand();
+            }
+            memcpy(pb, pa, size);
+            if (mfu_buf_diff(pa, pb, size) != size) {
+                printf("%s: diff failed on equal buffers size=%zu align=%zu\n", impl, size, align);
+                failures++;
+            }
+            for (s = 0; s < 3 && size > 0; s++) {
+                memcpy(pb, pa, size);
+                pb[spots[s]] ^= 0x01;
+                if (mfu_buf_diff(pa, pb, size) != ref_diff(pa, pb, size)) {
+                    printf("%s: diff failed size=%zu align=%zu pos=%zu\n", impl, size, align, spots[s]);
+                    failures++;
+                }
+            }
+
+            /* checksums must match the portable version and chain */
+            uint32_t c = mfu_buf_crc32c(0, pa, size);
+            mfu_buf_set_impl("portable");
+            uint32_t ref = mfu_buf_crc32c(0, pa, size);
+            mfu_buf_set_impl(impl);
+            uint32_t chained = mfu_buf_crc32c(mfu_buf_crc32c(0, pa, size / 3), pa + size / 3, size - size / 3);
+            if (c != ref || chained != ref) {
+                printf("%s: crc32c failed size=%zu align=%zu\n", impl, size, align);
+                failures++;
+            }
+
+            /* checksums of separate pieces must combine to the whole,
+             * and a run of zeros must match reading them */
+            size_t half = size / 2;
+            uint32_t combined = mfu_buf_crc32c_combine(
+                mfu_buf_crc32c(0, pa, half),
+                mfu_buf_crc32c(0, pa + half, size - half), size - half);
+            memset(pb, 0, size);
+            uint32_t zeros = mfu_buf_crc32c_zeros(mfu_buf_crc32c(0, pa, half), size - half);
+            memcpy(pb, pa, half);
+            if (combined != ref || zeros != mfu_buf_crc32c(0, pb, size)) {
+                printf("%s: crc32c combine failed size=%zu align=%zu\n", impl, size, align);
+                failures++;
+            }
+        }
+    }
+
+    free(b);
+    free(a);
+    return failures;
+}
+
+/* report rate of repeatedly running a kernel over a buffer */
+static void report(const char* impl, const char* kernel, size_t size, int reps, double secs)
+{
+    double gbs = 0.0;
+    if (secs > 0.0) {
+        gbs = (double)size * (double)reps / secs / 1.0e9;
+    }
+    printf("%-9s %-8s %8.2f GB/s\n", impl, kernel, gbs);
+}
+
+static void bench(const char* impl, unsigned char* a, unsigned char* b, size_t size, int reps)
+{
+    int r;
+    volatile size_t sink = 0;
+
+    memset(a, 0, size);
+    double start = now();
+    for (r = 0; r < reps; r++) {
+        sink += (size_t) mfu_buf_is_zero(a, size);
+    }
+    report(impl, "is_zero", size, reps, now() - start);
+
+    memset(b, 0, size);
+    start = now();
+    for (r = 0; r < reps; r++) {
+        sink += mfu_buf_diff(a, b, size);
+    }
+    report(impl, "diff", size, reps, now() - start);
+
+    start = now();
+    for (r = 0; r < reps; r++) {
+        sink += (size_t) mfu_buf_crc32c(0, a, size);
+    }
+    report(impl, "crc32c", size, reps, now() - start);
+
+    (void) sink;
+}
+
+int main(int argc, char* argv[])
+{
+    int check_only = 0;
+    size_t mb = 64;
+
+    int i;
+    for (i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--check") == 0) {
+            check_only = 1;
+        } else {
+            mb = (size_t) atol(argv[i]);
+        }
+    }
+
+    printf("default implementation: %s\n", mfu_buf_impl());
+
+    int failures = 0;
+    size_t k;
+    for (k = 0; k < NUM_IMPLS; k++) {
+        if (mfu_buf_set_impl(impls[k]) != 0) {
+            printf("%s: not supported\n", impls[k]);
+            continue;
+        }
+        failures += check(impls[k]);
+    }
+    if (failures > 0) {
+        printf("FAILED: %d checks\n", failures);
+        return 1;
+    }
+    printf("PASSED\n");
+
+    if (check_only) {
+        return 0;
+    }
+
+    size_t size = mb * 1024 * 1024;
+    unsigned char* a = malloc(size);
+    unsigned char* b = malloc(size);
+    if (a == NULL || b == NULL) {
+        printf("failed to allocate %zu MB buffers\n", mb);
+        return 1;
+    }
+    int reps = 10;
+
+    for (k = 0; k < NUM_IMPLS; k++) {
+        if (mfu_buf_set_impl(impls[k]) == 0) {
+            bench(impls[k], a, b, size, reps);
+        }
+    }
+
+    /* baselines for comparison */
+    volatile size_t sink = 0;
+    int r;
+    double start = now();
+    for (r = 0; r < reps; r++) {
+        sink += (size_t) ref_is_zero(a, size);
+    }
+    report("byteloop", "is_zero", size, reps, now() - start);
+
+    start = now();
+    for (r = 0; r < reps; r++) {
+        sink += (size_t) (memcmp(a, b, size) == 0);
+    }
+    report("memcmp", "diff", size, reps, now() - start);
+    (void) sink;
+
+    free(b);
+    free(a);
+    return 0;
+}
@@ -0,0 +1,35 @@
+#!/bin/bash
+
+##############################################################################
+# Description:
+#
+#   Check the buffer kernels used for sparse copy, compare, and ddup,
+#   and print their speed for each implementation this CPU supports.
+#
+#   Usage: test_buf.sh [size_in_MB]
+#
+##############################################################################
+
+# Turn on verbose output
+#set -x
+
+TEST_DIR=`dirname $0`
+SRC_DIR=${MFU_SRC_DIR:-"$TEST_DIR/../../../src/common"}
+BENCH_BIN=${BENCH_BIN:-"$TEST_DIR/bench_buf"}
+
+# build bench_buf if not found
+if [ ! -f "$BENCH_BIN" ]; then
+	cc -O2 -I$SRC_DIR $SRC_DIR/mfu_buf.c $TEST_DIR/bench_buf.c -o $BENCH_BIN
+	if [[ $? -ne 0 ]]; then
+		echo "Failed to build $TEST_DIR/bench_buf.c"
+		exit 1
+	fi
+fi
+
+$BENCH_BIN $1
+if [[ $? -ne 0 ]]; then
+	echo "Buffer kernel checks failed"
+	exit 1
+fi
+
+exit 0